@@ -293,7 +293,7 @@ shared_ptr<Packet> Context::create_header_packet(Glib::DateTime start_time)
 	header->feed_version = 1;
 	header->starttime.tv_sec = start_time.to_unix();
 	header->starttime.tv_usec = start_time.get_microsecond();
-	auto packet = g_new(struct sr_datafeed_packet, 1);
+	auto packet = g_new0(struct sr_datafeed_packet, 1);
 	packet->type = SR_DF_HEADER;
 	packet->payload = header;
 	return shared_ptr<Packet>{new Packet{nullptr, packet},
@@ -312,7 +312,7 @@ shared_ptr<Packet> Context::create_meta_packet(
 		output->data = value.gobj_copy();
 		meta->config = g_slist_append(meta->config, output);
 	}
-	auto packet = g_new(struct sr_datafeed_packet, 1);
+	auto packet = g_new0(struct sr_datafeed_packet, 1);
 	packet->type = SR_DF_META;
 	packet->payload = meta;
 	return shared_ptr<Packet>{new Packet{nullptr, packet},
@@ -326,7 +326,7 @@ shared_ptr<Packet> Context::create_logic_packet(
 	logic->length = data_length;
 	logic->unitsize = unit_size;
 	logic->data = data_pointer;
-	auto packet = g_new(struct sr_datafeed_packet, 1);
+	auto packet = g_new0(struct sr_datafeed_packet, 1);
 	packet->type = SR_DF_LOGIC;
 	packet->payload = logic;
 	return shared_ptr<Packet>{new Packet{nullptr, packet}, default_delete<Packet>{}};
@@ -373,7 +373,7 @@ shared_ptr<Packet> Context::create_analog_packet(
 
 	analog->num_samples = num_samples;
 	analog->data = (float*)data_pointer;
-	auto packet = g_new(struct sr_datafeed_packet, 1);
+	auto packet = g_new0(struct sr_datafeed_packet, 1);
 	packet->type = SR_DF_ANALOG;
 	packet->payload = analog;
 	return shared_ptr<Packet>{new Packet{nullptr, packet}, default_delete<Packet>{}};
@@ -381,7 +381,7 @@ shared_ptr<Packet> Context::create_analog_packet(
 
 shared_ptr<Packet> Context::create_end_packet()
 {
-	auto packet = g_new(struct sr_datafeed_packet, 1);
+	auto packet = g_new0(struct sr_datafeed_packet, 1);
 	packet->type = SR_DF_END;
 	return shared_ptr<Packet>{new Packet{nullptr, packet},
 		default_delete<Packet>{}};
@@ -1031,6 +1031,47 @@ void Session::set_stopped_callback(SessionStoppedCallback callback)
 				nullptr, nullptr));
 }
 
+static ProcessingStats processing_stats(
+	const struct sr_session_stats_timing *timing)
+{
+	return ProcessingStats{timing->id ? timing->id : "",
+		timing->calls, timing->total_us, timing->max_us,
+		timing->dropped};
+}
+
+void Session::set_stats_enabled(bool enable)
+{
+	check(sr_session_stats_enable(_structure, enable));
+}
+
+SessionStats Session::stats()
+{
+	struct sr_session_stats *c_stats;
+	check(sr_session_stats_get(_structure, &c_stats));
+
+	SessionStats result;
+	for (GSList *l = c_stats->packets; l; l = l->next) {
+		auto *const packets = static_cast<struct sr_session_stats_packets *>(l->data);
+		result.packets.push_back(PacketStats{
+			PacketType::get(packets->type), packets->packets,
+			packets->bytes, packets->samples});
+	}
+	for (GSList *l = c_stats->transforms; l; l = l->next)
+		result.transforms.push_back(processing_stats(
+			static_cast<struct sr_session_stats_timing *>(l->data)));
+	for (GSList *l = c_stats->callbacks; l; l = l->next)
+		result.callbacks.push_back(processing_stats(
+			static_cast<struct sr_session_stats_timing *>(l->data)));
+	sr_session_stats_free(c_stats);
+
+	return result;
+}
+
+void Session::reset_stats()
+{
+	check(sr_session_stats_reset(_structure));
+}
+
 static void datafeed_callback(const struct sr_dev_inst *sdi,
 	const struct sr_datafeed_packet *pkt, void *cb_data) noexcept
 {
@@ -1053,6 +1094,13 @@ void Session::remove_datafeed_callbacks()
 	_datafeed_callbacks.clear();
 }
 
+void Session::set_datafeed_queue(unsigned int depth,
+	const DatafeedOverflow *overflow)
+{
+	check(sr_session_datafeed_queue_set(_structure, depth,
+			static_cast<enum sr_datafeed_overflow>(overflow->id())));
+}
+
 shared_ptr<Trigger> Session::trigger()
 {
 	return _trigger;
@@ -1243,6 +1291,11 @@ void Analog::get_data_as_float(float *dest)
 	check(sr_analog_to_float(_structure, dest));
 }
 
+void Analog::get_data_as_double(double *dest)
+{
+	check(sr_analog_to_double(_structure, dest));
+}
+
 unsigned int Analog::num_samples() const
 {
 	return _structure->num_samples;
@@ -35,6 +35,7 @@ if not os.path.exists(os.path.join(outdirname, 'swig')):
 mapping = dict([
     ('sr_loglevel', ('LogLevel', 'Log verbosity level')),
     ('sr_packettype', ('PacketType', 'Type of datafeed packet')),
+    ('sr_datafeed_overflow', ('DatafeedOverflow', 'Datafeed queue overflow policy')),
     ('sr_mq', ('Quantity', 'Measured quantity')),
     ('sr_unit', ('Unit', 'Unit of measurement')),
     ('sr_mqflag', ('QuantityFlag', 'Flag applied to measured quantity')),
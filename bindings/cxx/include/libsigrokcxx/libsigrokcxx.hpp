@@ -592,6 +592,45 @@ private:
 	friend class Session;
 };
 
+/** Datafeed packet counters for one packet type */
+struct SR_API PacketStats
+{
+	/** Packet type. */
+	const PacketType *type;
+	/** Number of packets sent. */
+	uint64_t packets;
+	/** Number of payload bytes (logic and analog packets). */
+	uint64_t bytes;
+	/** Number of samples (logic and analog packets). */
+	uint64_t samples;
+};
+
+/** Processing time of a transform or datafeed callback */
+struct SR_API ProcessingStats
+{
+	/** Transform module ID, empty for datafeed callbacks. */
+	std::string id;
+	/** Number of invocations. */
+	uint64_t calls;
+	/** Cumulative wall time, in microseconds. */
+	uint64_t total_us;
+	/** Wall time of the longest invocation, in microseconds. */
+	uint64_t max_us;
+	/** Packets discarded due to datafeed queue overflow. */
+	uint64_t dropped;
+};
+
+/** Datafeed statistics of a session */
+struct SR_API SessionStats
+{
+	/** Packet counters, one entry per packet type. */
+	std::vector<PacketStats> packets;
+	/** Transforms, in execution order. */
+	std::vector<ProcessingStats> transforms;
+	/** Datafeed callbacks, in registration order. */
+	std::vector<ProcessingStats> callbacks;
+};
+
 /** A virtual device associated with a stored session */
 class SR_API SessionDevice :
 	public ParentOwned<SessionDevice, Session>,
@@ -622,6 +661,11 @@ public:
 	void add_datafeed_callback(DatafeedCallbackFunction callback);
 	/** Remove all datafeed callbacks from this session. */
 	void remove_datafeed_callbacks();
+	/** Run datafeed callbacks in threads of their own.
+	 * @param depth Packet queue depth per callback, 0 to disable.
+	 * @param overflow Policy to apply when a queue is full. */
+	void set_datafeed_queue(unsigned int depth,
+		const DatafeedOverflow *overflow);
 	/** Start the session. */
 	void start();
 	/** Run the session event loop. */
@@ -632,6 +676,12 @@ public:
 	bool is_running() const;
 	/** Set callback to be invoked on session stop. */
 	void set_stopped_callback(SessionStoppedCallback callback);
+	/** Enable or disable the collection of datafeed statistics. */
+	void set_stats_enabled(bool enable);
+	/** Get datafeed statistics of the current or last run. */
+	SessionStats stats();
+	/** Reset datafeed statistics. */
+	void reset_stats();
 	/** Get current trigger setting. */
 	std::shared_ptr<Trigger> trigger();
 	/** Get the context. */
@@ -778,6 +828,11 @@ public:
 	 * The pointer must have space for num_samples() floats.
 	 */
 	void get_data_as_float(float *dest);
+	/**
+	 * Fills dest pointer with the analog data converted to double.
+	 * The pointer must have space for num_samples() doubles.
+	 */
+	void get_data_as_double(double *dest);
 	/** Number of samples in this packet. */
 	unsigned int num_samples() const;
 	/** Channels for which this packet contains data. */
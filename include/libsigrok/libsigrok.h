@@ -176,6 +176,8 @@ enum sr_packettype {
 	SR_DF_FRAME_END,
 	/** Payload is struct sr_datafeed_analog. */
 	SR_DF_ANALOG,
+	/** Payload is struct sr_datafeed_logic_rle. */
+	SR_DF_LOGIC_RLE,
 
 	/* Update datafeed_dump() (session.c) upon changes! */
 };
@@ -453,13 +455,15 @@ struct sr_trigger_match {
 	 * For analog channels, only these matches may be used:
 	 * SR_TRIGGER_RISING
 	 * SR_TRIGGER_FALLING
+	 * SR_TRIGGER_EDGE
 	 * SR_TRIGGER_OVER
 	 * SR_TRIGGER_UNDER
 	 *
 	 */
 	int match;
 	/** If the trigger match is one of SR_TRIGGER_OVER or SR_TRIGGER_UNDER,
-	 * this contains the value to compare against. */
+	 * this contains the value to compare against. For edge matches on
+	 * analog channels, this is the level the value has to cross. */
 	float value;
 };
 
@@ -483,6 +487,100 @@ struct sr_context;
  */
 struct sr_session;
 
+/**
+ * @struct sr_session_index
+ * Opaque structure representing random access to a session file.
+ *
+ * None of the fields of this structure are meant to be accessed directly.
+ *
+ * @see sr_session_index_open(), sr_session_index_close().
+ */
+struct sr_session_index;
+
+/** Summary of a range of a logic channel's samples. */
+struct sr_summary_logic {
+	/** Number of samples in the range. */
+	uint64_t samples;
+	/** Value of the first sample. */
+	gboolean first;
+	/** Value of the last sample. */
+	gboolean last;
+	/** Whether any sample is high. */
+	gboolean any_high;
+	/** Whether all samples are high. */
+	gboolean all_high;
+	/** Number of transitions within the range, saturated. */
+	uint32_t transitions;
+};
+
+/** Summary of a range of an analog channel's samples. */
+struct sr_summary_analog {
+	/** Number of samples in the range. */
+	uint64_t samples;
+	/** Minimum value. */
+	float min;
+	/** Maximum value. */
+	float max;
+	/** Mean value. */
+	float mean;
+};
+
+/** Datafeed packet counters of a session, by packet type. */
+struct sr_session_stats_packets {
+	/** Packet type (enum sr_packettype). */
+	uint16_t type;
+	/** Number of packets which were sent. */
+	uint64_t packets;
+	/** Number of payload data bytes (logic and analog packets). */
+	uint64_t bytes;
+	/** Number of samples (logic and analog packets). */
+	uint64_t samples;
+};
+
+/** Processing time of a transform or a datafeed callback. */
+struct sr_session_stats_timing {
+	/** Transform module ID, NULL for datafeed callbacks. */
+	char *id;
+	/** Number of invocations. */
+	uint64_t calls;
+	/** Cumulative wall time spent, in microseconds. */
+	uint64_t total_us;
+	/** Wall time of the longest invocation, in microseconds. */
+	uint64_t max_us;
+	/** Number of packets discarded due to datafeed queue overflow. */
+	uint64_t dropped;
+};
+
+/**
+ * Datafeed statistics of a session.
+ *
+ * @see sr_session_stats_get(), sr_session_stats_free().
+ */
+struct sr_session_stats {
+	/** List of struct sr_session_stats_packets, one per packet type. */
+	GSList *packets;
+	/** List of struct sr_session_stats_timing, in transform order. */
+	GSList *transforms;
+	/** List of struct sr_session_stats_timing, in callback order. */
+	GSList *callbacks;
+};
+
+/** Policy applied when a datafeed callback's packet queue is full. */
+enum sr_datafeed_overflow {
+	/** Block the sender until the callback has consumed a packet. */
+	SR_DF_OVERFLOW_BLOCK = 10000,
+	/** Discard logic and analog packets, block for all other types. */
+	SR_DF_OVERFLOW_DROP,
+};
+
+/**
+ * @struct sr_buffer
+ * Opaque structure representing a reference counted sample buffer.
+ *
+ * @see sr_buffer_ref(), sr_buffer_unref(), sr_packet_buffer_ref().
+ */
+struct sr_buffer;
+
 struct sr_rational {
 	/** Numerator of the rational number. */
 	int64_t p;
@@ -494,6 +592,14 @@ struct sr_rational {
 struct sr_datafeed_packet {
 	uint16_t type;
 	const void *payload;
+	/**
+	 * Buffer which holds the data of a logic or analog packet, or
+	 * NULL. Set by libsigrok, packets which are created elsewhere
+	 * must leave it NULL. See sr_packet_buffer_ref().
+	 *
+	 * @since 0.6.0
+	 */
+	struct sr_buffer *buffer;
 };
 
 /** Header of a sigrok data feed. */
@@ -514,6 +620,41 @@ struct sr_datafeed_logic {
 	void *data;
 };
 
+/**
+ * Run-length encoded logic datafeed payload for type SR_DF_LOGIC_RLE.
+ *
+ * Sample values have the same layout as in SR_DF_LOGIC packets. Each
+ * value repeats for the number of samples given by its run length.
+ * Only datafeed callbacks which were registered with
+ * sr_session_datafeed_callback_add_rle() receive these packets, all
+ * others receive the expanded data in SR_DF_LOGIC packets.
+ */
+struct sr_datafeed_logic_rle {
+	/** Number of runs. */
+	uint64_t num_runs;
+	/** Size of a sample value in bytes. */
+	uint16_t unitsize;
+	/** Sample values, num_runs * unitsize bytes. */
+	void *data;
+	/** Run lengths in samples, num_runs items. Runs may be empty. */
+	uint64_t *lengths;
+};
+
+/**
+ * Iterator over the samples of an SR_DF_LOGIC_RLE payload.
+ *
+ * @see sr_logic_rle_iter_init(), sr_logic_rle_iter_next(),
+ *      sr_logic_rle_expand().
+ */
+struct sr_logic_rle_iter {
+	/** The payload which is iterated over. */
+	const struct sr_datafeed_logic_rle *rle;
+	/** Index of the current run. */
+	uint64_t run;
+	/** Number of samples of the current run which were consumed. */
+	uint64_t done;
+};
+
 /** Analog datafeed payload for type SR_DF_ANALOG. */
 struct sr_datafeed_analog {
 	void *data;
@@ -618,6 +759,8 @@ struct sr_resource {
 enum sr_output_flag {
 	/** If set, this output module writes the output itself. */
 	SR_OUTPUT_INTERNAL_IO_HANDLING = 0x01,
+	/** If set, this output module accepts SR_DF_LOGIC_RLE packets. */
+	SR_OUTPUT_LOGIC_RLE = 0x02,
 };
 
 struct sr_input;
@@ -1156,6 +1299,40 @@ enum sr_configkey {
 	 */
 	SR_CONF_INVERTED,
 
+	/**
+	 * Size of USB bulk transfers, in bytes.
+	 * @arg type: uint64_t
+	 * @arg get: get the size which is used for acquisitions
+	 * @arg set: set the size, 0 selects it automatically
+	 */
+	SR_CONF_USB_BUFFER_SIZE,
+
+	/**
+	 * Number of simultaneously submitted USB bulk transfers.
+	 * @arg type: uint64_t
+	 * @arg get: get the number which is used for acquisitions
+	 * @arg set: set the number, 0 selects it automatically
+	 */
+	SR_CONF_USB_QUEUE_DEPTH,
+
+	/**
+	 * Latency target of USB bulk transfers, in milliseconds. Determines
+	 * the transfer size unless that was set explicitly.
+	 * @arg type: uint64_t
+	 * @arg get: get the latency target
+	 * @arg set: set the latency target, 0 selects the default
+	 */
+	SR_CONF_USB_LATENCY,
+
+	/**
+	 * Benchmark mode. The device generates data in large chunks as
+	 * fast as possible, rather than paced to the samplerate.
+	 * @arg type: boolean
+	 * @arg get: @b true if benchmark mode is enabled
+	 * @arg set: enable or disable benchmark mode
+	 */
+	SR_CONF_BENCHMARK,
+
 	/* Update sr_key_info_config[] (hwdriver.c) upon changes! */
 
 	/*--- Special stuff -------------------------------------------------*/
@@ -1305,6 +1482,14 @@ enum sr_dev_inst_status {
 	SR_ST_STOPPING,
 };
 
+/** Hotplug monitor events, see sr_hotplug_monitor_start(). */
+enum sr_hotplug_event {
+	/** A device was found on a port which appeared. */
+	SR_HOTPLUG_ADDED = 10000,
+	/** The port of a previously added device disappeared. */
+	SR_HOTPLUG_REMOVED,
+};
+
 /** Device driver data. See also http://sigrok.org/wiki/Hardware_driver_API . */
 struct sr_dev_driver {
 	/* Driver-specific */
@@ -30,6 +30,8 @@
 
 SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		float *buf);
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *buf);
 SR_API const char *sr_analog_si_prefix(float *value, int *digits);
 SR_API gboolean sr_analog_si_prefix_friendly(enum sr_unit unit);
 SR_API int sr_analog_unit_to_string(const struct sr_datafeed_analog *analog,
@@ -57,6 +59,13 @@ SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count);
+SR_API int sr_a2l_threshold_packed(const struct sr_datafeed_analog *analog,
+		float threshold, uint8_t *output, uint16_t unitsize,
+		unsigned int index, uint64_t count);
+SR_API int sr_a2l_schmitt_trigger_packed(
+		const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
+		uint16_t unitsize, unsigned int index, uint64_t count);
 
 /*--- log.c -----------------------------------------------------------------*/
 
@@ -105,6 +114,10 @@ SR_API int sr_driver_init(struct sr_context *ctx,
 		struct sr_dev_driver *driver);
 SR_API GArray *sr_driver_scan_options_list(const struct sr_dev_driver *driver);
 SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options);
+SR_API GSList *sr_context_scan(struct sr_context *ctx,
+		struct sr_dev_driver **drivers, GSList *options);
+SR_API int sr_context_scan_cache_ttl_set(struct sr_context *ctx,
+		uint64_t ttl_ms);
 SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
@@ -120,6 +133,16 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 SR_API const struct sr_key_info *sr_key_info_get(int keytype, uint32_t key);
 SR_API const struct sr_key_info *sr_key_info_name_get(int keytype, const char *keyid);
 
+/*--- hotplug.c -------------------------------------------------------------*/
+
+typedef void (*sr_hotplug_callback)(struct sr_dev_inst *sdi,
+		enum sr_hotplug_event event, void *cb_data);
+
+SR_API int sr_hotplug_monitor_start(struct sr_context *ctx,
+		struct sr_dev_driver **drivers, sr_hotplug_callback cb,
+		void *cb_data);
+SR_API int sr_hotplug_monitor_stop(struct sr_context *ctx);
+
 /*--- session.c -------------------------------------------------------------*/
 
 typedef void (*sr_session_stopped_callback)(void *data);
@@ -131,6 +154,28 @@ SR_API struct sr_trigger *sr_session_trigger_get(struct sr_session *session);
 /* Session setup */
 SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	struct sr_session **session);
+SR_API int sr_session_index_open(const char *filename, gboolean persist,
+	struct sr_session_index **index);
+SR_API int sr_session_index_close(struct sr_session_index *index);
+SR_API int sr_session_index_get_samples(struct sr_session_index *index,
+	int channel, uint64_t *samples);
+SR_API int sr_session_index_get_unitsize(struct sr_session_index *index,
+	int *unitsize);
+SR_API int sr_session_index_read_logic(struct sr_session_index *index,
+	uint64_t start, uint64_t count, uint8_t *buf, uint64_t *samples_read);
+SR_API int sr_session_index_read_analog(struct sr_session_index *index,
+	int channel, uint64_t start, uint64_t count, float *buf,
+	uint64_t *samples_read);
+SR_API int sr_session_index_get_summary_levels(struct sr_session_index *index,
+	int *levels);
+SR_API int sr_session_index_get_summary(struct sr_session_index *index,
+	int channel, int level, uint64_t *record_samples, uint64_t *records);
+SR_API int sr_session_index_read_logic_summary(struct sr_session_index *index,
+	int channel, int level, uint64_t start, uint64_t count,
+	struct sr_summary_logic *summary, uint64_t *records_read);
+SR_API int sr_session_index_read_analog_summary(struct sr_session_index *index,
+	int channel, int level, uint64_t start, uint64_t count,
+	struct sr_summary_analog *summary, uint64_t *records_read);
 SR_API int sr_session_new(struct sr_context *ctx, struct sr_session **session);
 SR_API int sr_session_destroy(struct sr_session *session);
 SR_API int sr_session_dev_remove_all(struct sr_session *session);
@@ -145,6 +190,20 @@ SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger
 SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session);
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data);
+SR_API int sr_session_datafeed_callback_add_rle(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data);
+SR_API int sr_session_datafeed_queue_set(struct sr_session *session,
+		unsigned int depth, enum sr_datafeed_overflow overflow);
+SR_API int sr_session_usb_event_thread_set(struct sr_session *session,
+		gboolean enable);
+
+/* Statistics */
+SR_API int sr_session_stats_enable(struct sr_session *session,
+		gboolean enable);
+SR_API int sr_session_stats_get(struct sr_session *session,
+		struct sr_session_stats **stats);
+SR_API void sr_session_stats_free(struct sr_session_stats *stats);
+SR_API int sr_session_stats_reset(struct sr_session *session);
 
 /* Session control */
 SR_API int sr_session_start(struct sr_session *session);
@@ -157,6 +216,26 @@ SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet);
+SR_API struct sr_buffer *sr_packet_buffer_ref(
+		const struct sr_datafeed_packet *packet);
+
+/*--- buffer.c --------------------------------------------------------------*/
+
+SR_API struct sr_buffer *sr_buffer_ref(struct sr_buffer *buf);
+SR_API void sr_buffer_unref(struct sr_buffer *buf);
+SR_API void *sr_buffer_data_get(const struct sr_buffer *buf);
+SR_API size_t sr_buffer_size_get(const struct sr_buffer *buf);
+
+/*--- logic_rle.c -----------------------------------------------------------*/
+
+SR_API uint64_t sr_logic_rle_num_samples(
+		const struct sr_datafeed_logic_rle *rle);
+SR_API void sr_logic_rle_iter_init(struct sr_logic_rle_iter *iter,
+		const struct sr_datafeed_logic_rle *rle);
+SR_API gboolean sr_logic_rle_iter_next(struct sr_logic_rle_iter *iter,
+		const uint8_t **value, uint64_t *count);
+SR_API uint64_t sr_logic_rle_expand(struct sr_logic_rle_iter *iter,
+		uint8_t *buf, uint64_t max_samples);
 
 /*--- input/input.c ---------------------------------------------------------*/
 
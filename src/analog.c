@@ -157,59 +157,564 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 	return SR_OK;
 }
 
-/**
- * Convert an analog datafeed payload to an array of floats.
- *
- * The caller must provide the #outbuf space for the conversion result,
- * and is expected to free allocated space after use.
- *
- * @param[in] analog The analog payload to convert. Must not be NULL.
- *                   analog->data, analog->meaning, and analog->encoding
- *                   must not be NULL.
- * @param[out] outbuf Memory where to store the result. Must not be NULL.
- *
- * @retval SR_OK Success.
- * @retval SR_ERR Unsupported encoding.
- * @retval SR_ERR_ARG Invalid argument.
- *
- * @since 0.4.0
+/*
+ * The sample data types which the conversion routines accept. Samples
+ * are converted in bulk by SIMD kernels where available, and by plain
+ * loops otherwise (and for the remainder of the data).
  */
-SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
-		float *outbuf)
+enum analog_input_type {
+	ANALOG_IN_I8,
+	ANALOG_IN_U8,
+	ANALOG_IN_I16LE,
+	ANALOG_IN_I16BE,
+	ANALOG_IN_U16LE,
+	ANALOG_IN_U16BE,
+	ANALOG_IN_I32LE,
+	ANALOG_IN_I32BE,
+	ANALOG_IN_U32LE,
+	ANALOG_IN_U32BE,
+	ANALOG_IN_F32LE,
+	ANALOG_IN_F32BE,
+	ANALOG_IN_F64LE,
+	ANALOG_IN_F64BE,
+};
+
+static int analog_input_type(const struct sr_analog_encoding *encoding)
 {
-	size_t count;
-	gboolean host_bigendian;
-	gboolean input_float, input_signed, input_bigendian;
-	size_t input_unitsize;
-	double scale, offset, value;
-	const uint8_t *data8;
-	gboolean input_is_native;
-	char type_text[10];
+	gboolean be;
+
+	be = encoding->is_bigendian;
+	if (encoding->is_float) {
+		if (encoding->unitsize == sizeof(float))
+			return be ? ANALOG_IN_F32BE : ANALOG_IN_F32LE;
+		if (encoding->unitsize == sizeof(double))
+			return be ? ANALOG_IN_F64BE : ANALOG_IN_F64LE;
+		return -1;
+	}
 
-	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
-		return SR_ERR_ARG;
-	if (!outbuf)
-		return SR_ERR_ARG;
+	switch (encoding->unitsize) {
+	case sizeof(uint8_t):
+		return encoding->is_signed ? ANALOG_IN_I8 : ANALOG_IN_U8;
+	case sizeof(uint16_t):
+		if (encoding->is_signed)
+			return be ? ANALOG_IN_I16BE : ANALOG_IN_I16LE;
+		return be ? ANALOG_IN_U16BE : ANALOG_IN_U16LE;
+	case sizeof(uint32_t):
+		if (encoding->is_signed)
+			return be ? ANALOG_IN_I32BE : ANALOG_IN_I32LE;
+		return be ? ANALOG_IN_U32BE : ANALOG_IN_U32LE;
+	}
 
-	count = analog->num_samples * g_slist_length(analog->meaning->channels);
+	return -1;
+}
 
-	/*
-	 * Determine properties of the input data's and the host's
-	 * native formats, to simplify test conditions below.
-	 * Error messages for unsupported input property combinations
-	 * will only be seen by developers and maintainers of input
-	 * formats or acquisition device drivers. Terse output is
-	 * acceptable there, users shall never see them.
-	 */
-#ifdef WORDS_BIGENDIAN
-	host_bigendian = TRUE;
+/*
+ * The SIMD kernels below convert blocks of four samples. They do the
+ * exact same double precision calculation as the plain loops (multiply,
+ * then add), so results don't depend on the code path taken.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || \
+	(defined(__i386__) && defined(__SSE2__)))
+#define ANALOG_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON) && !defined(__AARCH64EB__)
+#define ANALOG_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+/** @cond PRIVATE */
+#define ANALOG_SIMD_SWITCH(loop, prefix) \
+	switch (type) { \
+	case ANALOG_IN_I8: loop(prefix##_load_i8, 1); break; \
+	case ANALOG_IN_U8: loop(prefix##_load_u8, 1); break; \
+	case ANALOG_IN_I16LE: loop(prefix##_load_i16le, 2); break; \
+	case ANALOG_IN_I16BE: loop(prefix##_load_i16be, 2); break; \
+	case ANALOG_IN_U16LE: loop(prefix##_load_u16le, 2); break; \
+	case ANALOG_IN_U16BE: loop(prefix##_load_u16be, 2); break; \
+	case ANALOG_IN_I32LE: loop(prefix##_load_i32le, 4); break; \
+	case ANALOG_IN_I32BE: loop(prefix##_load_i32be, 4); break; \
+	case ANALOG_IN_U32LE: loop(prefix##_load_u32le, 4); break; \
+	case ANALOG_IN_U32BE: loop(prefix##_load_u32be, 4); break; \
+	case ANALOG_IN_F32LE: loop(prefix##_load_f32le, 4); break; \
+	case ANALOG_IN_F32BE: loop(prefix##_load_f32be, 4); break; \
+	default: break; \
+	}
+/** @endcond */
+
+#ifdef ANALOG_SIMD_X86
+
+/* SSE2: Each load returns four samples as two vectors of two doubles. */
+
+static inline __m128i sse2_bswap16(__m128i v)
+{
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i sse2_bswap32(__m128i v)
+{
+	v = sse2_bswap16(v);
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline void sse2_cvt_i32(__m128i v, __m128d *lo, __m128d *hi)
+{
+	*lo = _mm_cvtepi32_pd(v);
+	*hi = _mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v));
+}
+
+static inline void sse2_cvt_u32(__m128i v, __m128d *lo, __m128d *hi)
+{
+	const __m128d bias = _mm_set1_pd(2147483648.0);
+
+	/* Convert as signed after flipping the MSB, then undo the flip. */
+	v = _mm_xor_si128(v, _mm_set1_epi32((int)0x80000000));
+	sse2_cvt_i32(v, lo, hi);
+	*lo = _mm_add_pd(*lo, bias);
+	*hi = _mm_add_pd(*hi, bias);
+}
+
+static inline void sse2_cvt_f32(__m128i v, __m128d *lo, __m128d *hi)
+{
+	__m128 f;
+
+	f = _mm_castsi128_ps(v);
+	*lo = _mm_cvtps_pd(f);
+	*hi = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+}
+
+static inline __m128i sse2_load32(const uint8_t *p)
+{
+	int32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return _mm_cvtsi32_si128(v);
+}
+
+static inline void sse2_load_i8(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	__m128i v;
+
+	v = sse2_load32(p);
+	v = _mm_unpacklo_epi8(v, v);
+	v = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 24);
+	sse2_cvt_i32(v, lo, hi);
+}
+
+static inline void sse2_load_u8(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	__m128i v;
+
+	v = sse2_load32(p);
+	v = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+	v = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+	sse2_cvt_i32(v, lo, hi);
+}
+
+static inline void sse2_load_i16le(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	__m128i v;
+
+	v = _mm_loadl_epi64((const __m128i *)p);
+	sse2_cvt_i32(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), lo, hi);
+}
+
+static inline void sse2_load_i16be(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	__m128i v;
+
+	v = sse2_bswap16(_mm_loadl_epi64((const __m128i *)p));
+	sse2_cvt_i32(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), lo, hi);
+}
+
+static inline void sse2_load_u16le(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	__m128i v;
+
+	v = _mm_loadl_epi64((const __m128i *)p);
+	sse2_cvt_i32(_mm_unpacklo_epi16(v, _mm_setzero_si128()), lo, hi);
+}
+
+static inline void sse2_load_u16be(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	__m128i v;
+
+	v = sse2_bswap16(_mm_loadl_epi64((const __m128i *)p));
+	sse2_cvt_i32(_mm_unpacklo_epi16(v, _mm_setzero_si128()), lo, hi);
+}
+
+static inline void sse2_load_i32le(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	sse2_cvt_i32(_mm_loadu_si128((const __m128i *)p), lo, hi);
+}
+
+static inline void sse2_load_i32be(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	sse2_cvt_i32(sse2_bswap32(_mm_loadu_si128((const __m128i *)p)), lo, hi);
+}
+
+static inline void sse2_load_u32le(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	sse2_cvt_u32(_mm_loadu_si128((const __m128i *)p), lo, hi);
+}
+
+static inline void sse2_load_u32be(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	sse2_cvt_u32(sse2_bswap32(_mm_loadu_si128((const __m128i *)p)), lo, hi);
+}
+
+static inline void sse2_load_f32le(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	sse2_cvt_f32(_mm_loadu_si128((const __m128i *)p), lo, hi);
+}
+
+static inline void sse2_load_f32be(const uint8_t *p, __m128d *lo, __m128d *hi)
+{
+	sse2_cvt_f32(sse2_bswap32(_mm_loadu_si128((const __m128i *)p)), lo, hi);
+}
+
+/** @cond PRIVATE */
+#define SSE2_LOOP(load, size) \
+	for (; i + 4 <= count; i += 4) { \
+		load(in + i * (size), &lo, &hi); \
+		lo = _mm_add_pd(_mm_mul_pd(lo, vscale), voffset); \
+		hi = _mm_add_pd(_mm_mul_pd(hi, vscale), voffset); \
+		if (fout) { \
+			_mm_storeu_ps(fout + i, _mm_movelh_ps( \
+				_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi))); \
+		} else { \
+			_mm_storeu_pd(dout + i, lo); \
+			_mm_storeu_pd(dout + i + 2, hi); \
+		} \
+	}
+/** @endcond */
+
+static size_t analog_convert_sse2(int type, const uint8_t *in,
+		float *fout, double *dout, size_t count,
+		double scale, double offset)
+{
+	__m128d vscale, voffset, lo, hi;
+	size_t i;
+
+	vscale = _mm_set1_pd(scale);
+	voffset = _mm_set1_pd(offset);
+	i = 0;
+	ANALOG_SIMD_SWITCH(SSE2_LOOP, sse2)
+
+	return i;
+}
+
+/* AVX2: Each load returns four samples as a vector of four doubles. */
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+static inline AVX2_TARGET __m128i avx2_load32(const uint8_t *p)
+{
+	int32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return _mm_cvtsi32_si128(v);
+}
+
+static inline AVX2_TARGET __m128i avx2_bswap16(__m128i v)
+{
+	return _mm_shuffle_epi8(v, _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6,
+		9, 8, 11, 10, 13, 12, 15, 14));
+}
+
+static inline AVX2_TARGET __m128i avx2_bswap32(__m128i v)
+{
+	return _mm_shuffle_epi8(v, _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+		11, 10, 9, 8, 15, 14, 13, 12));
+}
+
+static inline AVX2_TARGET __m256d avx2_cvt_u32(__m128i v)
+{
+	v = _mm_xor_si128(v, _mm_set1_epi32((int)0x80000000));
+	return _mm256_add_pd(_mm256_cvtepi32_pd(v),
+		_mm256_set1_pd(2147483648.0));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_i8(const uint8_t *p)
+{
+	return _mm256_cvtepi32_pd(_mm_cvtepi8_epi32(avx2_load32(p)));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_u8(const uint8_t *p)
+{
+	return _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(avx2_load32(p)));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_i16le(const uint8_t *p)
+{
+	return _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(
+		_mm_loadl_epi64((const __m128i *)p)));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_i16be(const uint8_t *p)
+{
+	return _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(
+		avx2_bswap16(_mm_loadl_epi64((const __m128i *)p))));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_u16le(const uint8_t *p)
+{
+	return _mm256_cvtepi32_pd(_mm_cvtepu16_epi32(
+		_mm_loadl_epi64((const __m128i *)p)));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_u16be(const uint8_t *p)
+{
+	return _mm256_cvtepi32_pd(_mm_cvtepu16_epi32(
+		avx2_bswap16(_mm_loadl_epi64((const __m128i *)p))));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_i32le(const uint8_t *p)
+{
+	return _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)p));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_i32be(const uint8_t *p)
+{
+	return _mm256_cvtepi32_pd(
+		avx2_bswap32(_mm_loadu_si128((const __m128i *)p)));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_u32le(const uint8_t *p)
+{
+	return avx2_cvt_u32(_mm_loadu_si128((const __m128i *)p));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_u32be(const uint8_t *p)
+{
+	return avx2_cvt_u32(avx2_bswap32(_mm_loadu_si128((const __m128i *)p)));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_f32le(const uint8_t *p)
+{
+	return _mm256_cvtps_pd(_mm_loadu_ps((const float *)p));
+}
+
+static inline AVX2_TARGET __m256d avx2_load_f32be(const uint8_t *p)
+{
+	return _mm256_cvtps_pd(_mm_castsi128_ps(
+		avx2_bswap32(_mm_loadu_si128((const __m128i *)p))));
+}
+
+/** @cond PRIVATE */
+#define AVX2_LOOP(load, size) \
+	for (; i + 4 <= count; i += 4) { \
+		v = load(in + i * (size)); \
+		v = _mm256_add_pd(_mm256_mul_pd(v, vscale), voffset); \
+		if (fout) \
+			_mm_storeu_ps(fout + i, _mm256_cvtpd_ps(v)); \
+		else \
+			_mm256_storeu_pd(dout + i, v); \
+	}
+/** @endcond */
+
+static AVX2_TARGET size_t analog_convert_avx2(int type, const uint8_t *in,
+		float *fout, double *dout, size_t count,
+		double scale, double offset)
+{
+	__m256d vscale, voffset, v;
+	size_t i;
+
+	vscale = _mm256_set1_pd(scale);
+	voffset = _mm256_set1_pd(offset);
+	i = 0;
+	ANALOG_SIMD_SWITCH(AVX2_LOOP, avx2)
+
+	return i;
+}
+
+#endif
+
+#ifdef ANALOG_SIMD_NEON
+
+/* NEON: Each load returns four samples as two vectors of two doubles. */
+
+static inline void neon_cvt_s32(int32x4_t v, float64x2_t *lo, float64x2_t *hi)
+{
+	*lo = vcvtq_f64_s64(vmovl_s32(vget_low_s32(v)));
+	*hi = vcvtq_f64_s64(vmovl_s32(vget_high_s32(v)));
+}
+
+static inline void neon_cvt_u32(uint32x4_t v, float64x2_t *lo, float64x2_t *hi)
+{
+	*lo = vcvtq_f64_u64(vmovl_u32(vget_low_u32(v)));
+	*hi = vcvtq_f64_u64(vmovl_u32(vget_high_u32(v)));
+}
+
+static inline void neon_cvt_f32(float32x4_t v, float64x2_t *lo, float64x2_t *hi)
+{
+	*lo = vcvt_f64_f32(vget_low_f32(v));
+	*hi = vcvt_high_f64_f32(v);
+}
+
+static inline uint8x8_t neon_load32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return vreinterpret_u8_u32(vdup_n_u32(v));
+}
+
+static inline void neon_load_i8(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	int16x8_t v;
+
+	v = vmovl_s8(vreinterpret_s8_u8(neon_load32(p)));
+	neon_cvt_s32(vmovl_s16(vget_low_s16(v)), lo, hi);
+}
+
+static inline void neon_load_u8(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	uint16x8_t v;
+
+	v = vmovl_u8(neon_load32(p));
+	neon_cvt_u32(vmovl_u16(vget_low_u16(v)), lo, hi);
+}
+
+static inline void neon_load_i16le(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	neon_cvt_s32(vmovl_s16(vreinterpret_s16_u8(vld1_u8(p))), lo, hi);
+}
+
+static inline void neon_load_i16be(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	neon_cvt_s32(vmovl_s16(vreinterpret_s16_u8(vrev16_u8(vld1_u8(p)))), lo, hi);
+}
+
+static inline void neon_load_u16le(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	neon_cvt_u32(vmovl_u16(vreinterpret_u16_u8(vld1_u8(p))), lo, hi);
+}
+
+static inline void neon_load_u16be(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	neon_cvt_u32(vmovl_u16(vreinterpret_u16_u8(vrev16_u8(vld1_u8(p)))), lo, hi);
+}
+
+static inline void neon_load_i32le(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	neon_cvt_s32(vreinterpretq_s32_u8(vld1q_u8(p)), lo, hi);
+}
+
+static inline void neon_load_i32be(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	neon_cvt_s32(vreinterpretq_s32_u8(vrev32q_u8(vld1q_u8(p))), lo, hi);
+}
+
+static inline void neon_load_u32le(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	neon_cvt_u32(vreinterpretq_u32_u8(vld1q_u8(p)), lo, hi);
+}
+
+static inline void neon_load_u32be(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	neon_cvt_u32(vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p))), lo, hi);
+}
+
+static inline void neon_load_f32le(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	neon_cvt_f32(vreinterpretq_f32_u8(vld1q_u8(p)), lo, hi);
+}
+
+static inline void neon_load_f32be(const uint8_t *p, float64x2_t *lo, float64x2_t *hi)
+{
+	neon_cvt_f32(vreinterpretq_f32_u8(vrev32q_u8(vld1q_u8(p))), lo, hi);
+}
+
+/** @cond PRIVATE */
+#define NEON_LOOP(load, size) \
+	for (; i + 4 <= count; i += 4) { \
+		load(in + i * (size), &lo, &hi); \
+		lo = vaddq_f64(vmulq_f64(lo, vscale), voffset); \
+		hi = vaddq_f64(vmulq_f64(hi, vscale), voffset); \
+		if (fout) { \
+			vst1q_f32(fout + i, vcombine_f32( \
+				vcvt_f32_f64(lo), vcvt_f32_f64(hi))); \
+		} else { \
+			vst1q_f64(dout + i, lo); \
+			vst1q_f64(dout + i + 2, hi); \
+		} \
+	}
+/** @endcond */
+
+static size_t analog_convert_neon(int type, const uint8_t *in,
+		float *fout, double *dout, size_t count,
+		double scale, double offset)
+{
+	float64x2_t vscale, voffset, lo, hi;
+	size_t i;
+
+	vscale = vdupq_n_f64(scale);
+	voffset = vdupq_n_f64(offset);
+	i = 0;
+	ANALOG_SIMD_SWITCH(NEON_LOOP, neon)
+
+	return i;
+}
+
+#endif
+
+/*
+ * Convert as many samples as the SIMD kernels of the running machine
+ * handle. Returns the number of samples converted.
+ */
+static size_t analog_convert_simd(int type, const uint8_t *in,
+		float *fout, double *dout, size_t count,
+		double scale, double offset)
+{
+#if defined(ANALOG_SIMD_X86)
+	if (__builtin_cpu_supports("avx2"))
+		return analog_convert_avx2(type, in, fout, dout, count,
+			scale, offset);
+	return analog_convert_sse2(type, in, fout, dout, count, scale, offset);
+#elif defined(ANALOG_SIMD_NEON)
+	return analog_convert_neon(type, in, fout, dout, count, scale, offset);
 #else
-	host_bigendian = FALSE;
+	(void)type;
+	(void)in;
+	(void)fout;
+	(void)dout;
+	(void)count;
+	(void)scale;
+	(void)offset;
+
+	return 0;
 #endif
-	input_float = analog->encoding->is_float;
-	input_signed = analog->encoding->is_signed;
-	input_bigendian = analog->encoding->is_bigendian;
-	input_unitsize = analog->encoding->unitsize;
+}
+
+/** @cond PRIVATE */
+#define ANALOG_SCALAR_LOOP(read, size) \
+	for (; i < count; i++) { \
+		value = read(in + i * (size)); \
+		value *= scale; \
+		value += offset; \
+		if (fout) \
+			fout[i] = value; \
+		else \
+			dout[i] = value; \
+	}
+/** @endcond */
+
+/*
+ * Common implementation of the conversion to single and double precision
+ * values. Exactly one of fout and dout is used.
+ */
+static int analog_convert(const struct sr_datafeed_analog *analog,
+		float *fout, double *dout)
+{
+	size_t count, i;
+	gboolean host_bigendian;
+	int type, native_type;
+	double scale, offset, value;
+	const uint8_t *in;
+	char type_text[10];
+
+	count = analog->num_samples * g_slist_length(analog->meaning->channels);
 
 	/*
 	 * Prepare the iteration over the sample data: Get the common
@@ -220,162 +725,158 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	offset /= analog->encoding->offset.q;
 	scale = analog->encoding->scale.p;
 	scale /= analog->encoding->scale.q;
-	data8 = analog->data;
+	in = analog->data;
 
 	/*
-	 * Immediately handle the special case where input data needs
-	 * no conversion because it already is in the application's
-	 * native format. Do apply scale/offset though when applicable
-	 * on our way out.
+	 * Error messages for unsupported input property combinations
+	 * will only be seen by developers and maintainers of input
+	 * formats or acquisition device drivers. Terse output is
+	 * acceptable there, users shall never see them.
 	 */
-	input_is_native = input_float &&
-		input_unitsize == sizeof(outbuf[0]) &&
-		input_bigendian == host_bigendian;
-	if (input_is_native) {
-		memcpy(outbuf, data8, count * sizeof(outbuf[0]));
-		if (scale != 1.0 || offset != 0.0) {
-			while (count--) {
-				*outbuf *= scale;
-				*outbuf += offset;
-				outbuf++;
-			}
-		}
-		return SR_OK;
+	type = analog_input_type(analog->encoding);
+	if (type < 0) {
+		snprintf(type_text, sizeof(type_text), "%c%d%s",
+			analog->encoding->is_float ? 'f' :
+			analog->encoding->is_signed ? 'i' : 'u',
+			analog->encoding->unitsize * 8,
+			analog->encoding->is_bigendian ? "be" : "le");
+		sr_err("Unsupported type for analog-to-%s conversion: %s.",
+			fout ? "float" : "double", type_text);
+		return SR_ERR;
 	}
 
 	/*
-	 * Accept sample values in different widths and data types and
-	 * endianess formats (floating point or signed or unsigned
-	 * integer, in either endianess, for a set of supported widths).
-	 * Common scale/offset factors apply to all sample values.
-	 *
-	 * Do most internal calculations on double precision values.
-	 * Only trim the result data to single precision, since that's
-	 * the routine's result data type in its public API which needs
-	 * to be kept for compatibility. It remains an option for later
-	 * to add another public routine which returns double precision
-	 * result data, call sites could migrate at their own pace.
+	 * Immediately handle the special case where input data needs
+	 * no conversion at all because it already is in the application's
+	 * native format, and there is no scale/offset to apply.
 	 */
-	if (input_float && input_unitsize == sizeof(float)) {
-		float (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_fltbe_inc;
-		else
-			reader = read_fltle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_float && input_unitsize == sizeof(double)) {
-		double (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_dblbe_inc;
-		else
-			reader = read_dblle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+#ifdef WORDS_BIGENDIAN
+	host_bigendian = TRUE;
+#else
+	host_bigendian = FALSE;
+#endif
+	if (fout)
+		native_type = host_bigendian ? ANALOG_IN_F32BE : ANALOG_IN_F32LE;
+	else
+		native_type = host_bigendian ? ANALOG_IN_F64BE : ANALOG_IN_F64LE;
+	if (type == native_type && scale == 1.0 && offset == 0.0) {
+		memcpy(fout ? (void *)fout : (void *)dout, in,
+			count * analog->encoding->unitsize);
 		return SR_OK;
 	}
-	if (input_float) {
-		snprintf(type_text, sizeof(type_text), "%c%zu%s",
-			'f', input_unitsize * 8, input_bigendian ? "be" : "le");
-		sr_err("Unsupported type for analog-to-float conversion: %s.",
-			type_text);
-		return SR_ERR;
-	}
 
-	if (input_unitsize == sizeof(uint8_t) && input_signed) {
-		int8_t (*reader)(const uint8_t **p);
-		reader = read_i8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint8_t)) {
-		uint8_t (*reader)(const uint8_t **p);
-		reader = read_u8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint16_t) && input_signed) {
-		int16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i16be_inc;
-		else
-			reader = read_i16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint16_t)) {
-		uint16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u16be_inc;
-		else
-			reader = read_u16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint32_t) && input_signed) {
-		int32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i32be_inc;
-		else
-			reader = read_i32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint32_t)) {
-		uint32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u32be_inc;
-		else
-			reader = read_u32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
+	/*
+	 * Do the calculations on double precision values, and only trim
+	 * the result to single precision for sr_analog_to_float(). Convert
+	 * the bulk of the data with SIMD kernels, the rest one at a time.
+	 */
+	i = analog_convert_simd(type, in, fout, dout, count, scale, offset);
+	switch (type) {
+	case ANALOG_IN_I8:
+		ANALOG_SCALAR_LOOP(read_i8, sizeof(int8_t));
+		break;
+	case ANALOG_IN_U8:
+		ANALOG_SCALAR_LOOP(read_u8, sizeof(uint8_t));
+		break;
+	case ANALOG_IN_I16LE:
+		ANALOG_SCALAR_LOOP(read_i16le, sizeof(int16_t));
+		break;
+	case ANALOG_IN_I16BE:
+		ANALOG_SCALAR_LOOP(read_i16be, sizeof(int16_t));
+		break;
+	case ANALOG_IN_U16LE:
+		ANALOG_SCALAR_LOOP(read_u16le, sizeof(uint16_t));
+		break;
+	case ANALOG_IN_U16BE:
+		ANALOG_SCALAR_LOOP(read_u16be, sizeof(uint16_t));
+		break;
+	case ANALOG_IN_I32LE:
+		ANALOG_SCALAR_LOOP(read_i32le, sizeof(int32_t));
+		break;
+	case ANALOG_IN_I32BE:
+		ANALOG_SCALAR_LOOP(read_i32be, sizeof(int32_t));
+		break;
+	case ANALOG_IN_U32LE:
+		ANALOG_SCALAR_LOOP(read_u32le, sizeof(uint32_t));
+		break;
+	case ANALOG_IN_U32BE:
+		ANALOG_SCALAR_LOOP(read_u32be, sizeof(uint32_t));
+		break;
+	case ANALOG_IN_F32LE:
+		ANALOG_SCALAR_LOOP(read_fltle, sizeof(float));
+		break;
+	case ANALOG_IN_F32BE:
+		ANALOG_SCALAR_LOOP(read_fltbe, sizeof(float));
+		break;
+	case ANALOG_IN_F64LE:
+		ANALOG_SCALAR_LOOP(read_dblle, sizeof(double));
+		break;
+	case ANALOG_IN_F64BE:
+		ANALOG_SCALAR_LOOP(read_dblbe, sizeof(double));
+		break;
 	}
-	snprintf(type_text, sizeof(type_text), "%c%zu%s",
-		input_float ? 'f' : input_signed ? 'i' : 'u',
-		input_unitsize * 8, input_bigendian ? "be" : "le");
-	sr_err("Unsupported type for analog-to-float conversion: %s.",
-		type_text);
-	return SR_ERR;
+
+	return SR_OK;
+}
+
+/**
+ * Convert an analog datafeed payload to an array of floats.
+ *
+ * The caller must provide the #outbuf space for the conversion result,
+ * and is expected to free allocated space after use.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
+		float *outbuf)
+{
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!outbuf)
+		return SR_ERR_ARG;
+
+	return analog_convert(analog, outbuf, NULL);
+}
+
+/**
+ * Convert an analog datafeed payload to an array of doubles.
+ *
+ * Like sr_analog_to_float(), but without trimming the result to single
+ * precision. This preserves the resolution of 32-bit integer and double
+ * precision sample data.
+ *
+ * The caller must provide the #outbuf space for the conversion result,
+ * and is expected to free allocated space after use.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *outbuf)
+{
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!outbuf)
+		return SR_ERR_ARG;
+
+	return analog_convert(analog, NULL, outbuf);
 }
 
 /**
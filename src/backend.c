@@ -635,7 +635,9 @@ SR_API int sr_init(struct sr_context **ctx)
 		goto done;
 	}
 #endif
+	g_mutex_init(&context->resource_mutex);
 	sr_resource_set_hooks(context, NULL, NULL, NULL, NULL);
+	g_mutex_init(&context->scan_mutex);
 
 	*ctx = context;
 	context = NULL;
@@ -663,6 +665,7 @@ SR_API int sr_exit(struct sr_context *ctx)
 		return SR_ERR;
 	}
 
+	sr_hotplug_monitor_stop(ctx);
 	sr_hw_cleanup_all(ctx);
 
 #ifdef _WIN32
@@ -677,6 +680,14 @@ SR_API int sr_exit(struct sr_context *ctx)
 #endif
 
 	g_free(sr_driver_list(ctx));
+	if (ctx->scan_cache)
+		g_hash_table_destroy(ctx->scan_cache);
+	g_mutex_clear(&ctx->scan_mutex);
+	if (ctx->resource_cache)
+		g_hash_table_destroy(ctx->resource_cache);
+	if (ctx->resource_uploads)
+		g_hash_table_destroy(ctx->resource_uploads);
+	g_mutex_clear(&ctx->resource_mutex);
 	g_free(ctx);
 
 	return SR_OK;
@@ -0,0 +1,341 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "buffer"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Reference counted sample buffers.
+ */
+
+/**
+ * @defgroup grp_buffer Sample buffers
+ *
+ * Reference counted memory which backs datafeed packets.
+ *
+ * Drivers can send logic and analog packets whose data lives in a
+ * reference counted buffer. Datafeed callbacks which want to keep the
+ * samples beyond the duration of the callback can then take a reference
+ * to the buffer (see sr_packet_buffer_ref()) instead of copying the data.
+ * Buffer content must be considered read-only by everyone but the driver
+ * which allocated the buffer.
+ *
+ * @{
+ */
+
+/* Smallest and largest size class of buffer pools (4 KiB .. 256 MiB). */
+#define POOL_MIN_SHIFT		12
+#define POOL_NUM_CLASSES	17
+/* Upper limit for the amount of idle memory a pool holds on to. */
+#define POOL_CACHE_LIMIT	(256 * 1024 * 1024)
+
+struct sr_buffer {
+	void *data;
+	size_t size;
+	gint refcount;
+	/* Pool the buffer returns to on release, and its size class. */
+	struct sr_buffer_pool *pool;
+	size_t capacity;
+	struct sr_buffer *next;
+};
+
+/*
+ * A pool keeps released buffers in per size class free lists, so that
+ * subsequent requests can be served without touching the heap. The pool
+ * is reference counted: its owner holds one reference, and each buffer
+ * which is handed out holds another. That way buffers which outlive the
+ * pool's owner can still be released safely.
+ */
+struct sr_buffer_pool {
+	GMutex mutex;
+	gint refcount;
+	gboolean closed;
+	struct sr_buffer *free_list[POOL_NUM_CLASSES];
+	size_t cached_bytes;
+};
+
+/**
+ * Allocate a new buffer.
+ *
+ * @param size Size of the buffer in bytes.
+ *
+ * @return A new buffer with a reference count of 1, or NULL when the
+ *         memory could not be allocated.
+ *
+ * @private
+ */
+SR_PRIV struct sr_buffer *sr_buffer_new(size_t size)
+{
+	struct sr_buffer *buf;
+
+	buf = g_malloc0(sizeof(*buf));
+	buf->data = g_try_malloc(size ? size : 1);
+	if (!buf->data) {
+		sr_err("Cannot allocate %zu bytes buffer.", size);
+		g_free(buf);
+		return NULL;
+	}
+	buf->size = size;
+	buf->refcount = 1;
+
+	return buf;
+}
+
+static void buffer_free(struct sr_buffer *buf)
+{
+	g_free(buf->data);
+	g_free(buf);
+}
+
+/**
+ * Create a new buffer pool.
+ *
+ * @return A new pool with a reference count of 1.
+ *
+ * @private
+ */
+SR_PRIV struct sr_buffer_pool *sr_buffer_pool_new(void)
+{
+	struct sr_buffer_pool *pool;
+
+	pool = g_malloc0(sizeof(*pool));
+	g_mutex_init(&pool->mutex);
+	pool->refcount = 1;
+
+	return pool;
+}
+
+static void buffer_pool_unref(struct sr_buffer_pool *pool)
+{
+	if (!g_atomic_int_dec_and_test(&pool->refcount))
+		return;
+
+	g_mutex_clear(&pool->mutex);
+	g_free(pool);
+}
+
+/**
+ * Release the owner's reference to a buffer pool.
+ *
+ * Idle buffers are freed immediately. Buffers which are still in use
+ * get freed instead of recycled when their last reference is dropped.
+ *
+ * @param pool The pool. Can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_buffer_pool_free(struct sr_buffer_pool *pool)
+{
+	struct sr_buffer *buf;
+	unsigned int i;
+
+	if (!pool)
+		return;
+
+	g_mutex_lock(&pool->mutex);
+	pool->closed = TRUE;
+	for (i = 0; i < POOL_NUM_CLASSES; i++) {
+		while ((buf = pool->free_list[i])) {
+			pool->free_list[i] = buf->next;
+			buffer_free(buf);
+		}
+	}
+	pool->cached_bytes = 0;
+	g_mutex_unlock(&pool->mutex);
+
+	buffer_pool_unref(pool);
+}
+
+/**
+ * Get a buffer from a pool.
+ *
+ * Requests are rounded up to a power of two size class. An idle buffer
+ * of that class is re-used if available, otherwise a new one gets
+ * allocated. When the last reference to the buffer is dropped, it
+ * returns to the pool. Requests beyond the largest size class are
+ * served by sr_buffer_new().
+ *
+ * @param pool The pool. Must not be NULL.
+ * @param size Number of bytes the caller needs.
+ *
+ * @return A buffer with a reference count of 1 and a size of @a size
+ *         bytes, or NULL when memory could not be allocated.
+ *
+ * @private
+ */
+SR_PRIV struct sr_buffer *sr_buffer_pool_get(struct sr_buffer_pool *pool,
+		size_t size)
+{
+	struct sr_buffer *buf;
+	unsigned int cls;
+	size_t capacity;
+
+	cls = 0;
+	capacity = (size_t)1 << POOL_MIN_SHIFT;
+	while (capacity < size && cls < POOL_NUM_CLASSES) {
+		capacity <<= 1;
+		cls++;
+	}
+	if (cls == POOL_NUM_CLASSES)
+		return sr_buffer_new(size);
+
+	g_mutex_lock(&pool->mutex);
+	buf = pool->free_list[cls];
+	if (buf) {
+		pool->free_list[cls] = buf->next;
+		pool->cached_bytes -= buf->capacity;
+	}
+	g_mutex_unlock(&pool->mutex);
+
+	if (!buf) {
+		buf = sr_buffer_new(capacity);
+		if (!buf)
+			return NULL;
+		buf->capacity = capacity;
+		buf->pool = pool;
+	}
+	buf->next = NULL;
+	buf->size = size;
+	buf->refcount = 1;
+	g_atomic_int_inc(&pool->refcount);
+
+	return buf;
+}
+
+/* Return a released buffer to its pool, or free it. */
+static void buffer_pool_put(struct sr_buffer *buf)
+{
+	struct sr_buffer_pool *pool;
+	unsigned int cls;
+
+	pool = buf->pool;
+	cls = 0;
+	while (((size_t)1 << (POOL_MIN_SHIFT + cls)) < buf->capacity)
+		cls++;
+
+	g_mutex_lock(&pool->mutex);
+	if (!pool->closed &&
+			pool->cached_bytes + buf->capacity <= POOL_CACHE_LIMIT) {
+		buf->next = pool->free_list[cls];
+		pool->free_list[cls] = buf;
+		pool->cached_bytes += buf->capacity;
+		buf = NULL;
+	}
+	g_mutex_unlock(&pool->mutex);
+
+	if (buf)
+		buffer_free(buf);
+	buffer_pool_unref(pool);
+}
+
+/**
+ * Check whether others than the caller hold a reference to a buffer.
+ *
+ * Producers use this to determine whether a buffer can be re-used for
+ * new data after it was sent, or whether a consumer still needs it.
+ *
+ * @param buf The buffer to check. Must not be NULL.
+ *
+ * @return TRUE if more than one reference exists, FALSE otherwise.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_buffer_is_shared(const struct sr_buffer *buf)
+{
+	return g_atomic_int_get(&buf->refcount) > 1;
+}
+
+/**
+ * Take a reference to a buffer.
+ *
+ * @param buf The buffer. Must not be NULL.
+ *
+ * @return The buffer.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_buffer *sr_buffer_ref(struct sr_buffer *buf)
+{
+	g_atomic_int_inc(&buf->refcount);
+
+	return buf;
+}
+
+/**
+ * Release a reference to a buffer.
+ *
+ * The buffer's memory is released (or returned to the pool it was taken
+ * from) when the last reference is dropped.
+ *
+ * @param buf The buffer. Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_buffer_unref(struct sr_buffer *buf)
+{
+	if (!buf)
+		return;
+
+	if (!g_atomic_int_dec_and_test(&buf->refcount))
+		return;
+
+	if (buf->pool)
+		buffer_pool_put(buf);
+	else
+		buffer_free(buf);
+}
+
+/**
+ * Get the memory of a buffer.
+ *
+ * @param buf The buffer. Must not be NULL.
+ *
+ * @return Pointer to the buffer's data.
+ *
+ * @since 0.6.0
+ */
+SR_API void *sr_buffer_data_get(const struct sr_buffer *buf)
+{
+	return buf->data;
+}
+
+/**
+ * Get the size of a buffer.
+ *
+ * @param buf The buffer. Must not be NULL.
+ *
+ * @return Size of the buffer in bytes.
+ *
+ * @since 0.6.0
+ */
+SR_API size_t sr_buffer_size_get(const struct sr_buffer *buf)
+{
+	return buf->size;
+}
+
+/** @} */
@@ -23,6 +23,9 @@
  * Conversion helper functions.
  */
 
+#include <config.h>
+#include <math.h>
+#include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -30,6 +33,436 @@
 #define LOG_PREFIX "conv"
 /** @endcond */
 
+/*
+ * The analog-to-logic conversion doesn't convert the samples to float.
+ * The thresholds get translated to the raw domain of the analog data
+ * instead, and the raw samples are compared against them, 64 samples
+ * into one bitmap word at a time (using SIMD compares where available).
+ * The bitmaps are then written to the logic output, which is processed
+ * in chunks to keep the bitmaps on the stack.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || \
+	(defined(__i386__) && defined(__SSE2__)))
+#define A2L_SIMD_X86 1
+#include <emmintrin.h>
+#endif
+
+/** @cond PRIVATE */
+#define A2L_CHUNK_SAMPLES 4096
+#define A2L_CHUNK_WORDS (A2L_CHUNK_SAMPLES / 64)
+/** @endcond */
+
+/*
+ * A comparison of analog samples against a level. A raw sample matches
+ * if it's at or above the raw domain level ('k' for integer data), the
+ * result gets inverted for negative scale factors. If the level is out
+ * of the range of the integer data type, the raw result is 'fixed'.
+ */
+struct a2l_cmp {
+	const struct sr_analog_encoding *enc;
+	double level;
+	float level_f;
+	int64_t k;
+	int fixed;
+	uint64_t invert;
+};
+
+/*
+ * Setup a comparison for "value >= level" (or "value > level" when
+ * 'strict' is set) of the sample values, optionally negated.
+ */
+static int a2l_cmp_init(struct a2l_cmp *cmp,
+		const struct sr_analog_encoding *enc, float level,
+		gboolean strict, gboolean negate)
+{
+	double scale, offset, t, min, max;
+	gboolean neg;
+	int bits;
+
+	if (!enc->scale.q || !enc->offset.q)
+		return SR_ERR_ARG;
+	scale = (double)enc->scale.p / enc->scale.q;
+	offset = (double)enc->offset.p / enc->offset.q;
+	if (scale == 0.0)
+		return SR_ERR_ARG;
+
+	/*
+	 * With negative scale factors "value >= level" becomes "raw <=
+	 * level", which is the inverse of "raw > level". Strict compares
+	 * against the next representable level turn every case into
+	 * "raw >= level", optionally inverted.
+	 */
+	neg = scale < 0.0;
+	t = (level - offset) / scale;
+	if (strict != neg)
+		t = nextafter(t, INFINITY);
+
+	cmp->enc = enc;
+	cmp->fixed = -1;
+	cmp->invert = (neg != negate) ? UINT64_MAX : 0;
+
+	if (enc->is_float) {
+		if (enc->unitsize != sizeof(float) &&
+				enc->unitsize != sizeof(double))
+			return SR_ERR_ARG;
+		cmp->level = t;
+		/* Smallest float which isn't below the level. */
+		cmp->level_f = (float)t;
+		if ((double)cmp->level_f < t)
+			cmp->level_f = nextafterf(cmp->level_f, INFINITY);
+		return SR_OK;
+	}
+
+	switch (enc->unitsize) {
+	case sizeof(uint8_t):
+	case sizeof(uint16_t):
+	case sizeof(uint32_t):
+		break;
+	default:
+		return SR_ERR_ARG;
+	}
+	bits = 8 * enc->unitsize;
+	min = enc->is_signed ? -ldexp(1.0, bits - 1) : 0.0;
+	max = ldexp(1.0, enc->is_signed ? bits - 1 : bits) - 1.0;
+	t = ceil(t);
+	if (isnan(t) || t > max)
+		cmp->fixed = 0;
+	else if (t <= min)
+		cmp->fixed = 1;
+	else
+		cmp->k = (int64_t)t;
+
+	return SR_OK;
+}
+
+#define A2L_SCALAR_LOOP(read, size, level) \
+	for (; i < count; i++) \
+		bits[i / 64] |= (uint64_t)(read(data + i * (size)) >= (level)) \
+			<< (i % 64);
+
+#ifdef A2L_SIMD_X86
+
+static inline __m128i a2l_sse2_bswap16(__m128i v)
+{
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i a2l_sse2_bswap32(__m128i v)
+{
+	v = a2l_sse2_bswap16(v);
+	return _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+}
+
+/*
+ * Compare the samples in 16 bytes of input. Unsigned integers get their
+ * sign bit flipped to use the signed compares, the level is biased
+ * accordingly. Returns all ones in the lanes of matching samples.
+ */
+static inline __m128i a2l_sse2_cmp(const uint8_t *p, int size, int be,
+		int is_float, __m128i bias, __m128i km1, __m128 kf)
+{
+	__m128i v;
+
+	v = _mm_loadu_si128((const __m128i *)p);
+	if (be && size == 2)
+		v = a2l_sse2_bswap16(v);
+	else if (be && size == 4)
+		v = a2l_sse2_bswap32(v);
+	if (is_float)
+		return _mm_castps_si128(_mm_cmpge_ps(_mm_castsi128_ps(v), kf));
+
+	v = _mm_xor_si128(v, bias);
+	switch (size) {
+	case 1:
+		return _mm_cmpgt_epi8(v, km1);
+	case 2:
+		return _mm_cmpgt_epi16(v, km1);
+	default:
+		return _mm_cmpgt_epi32(v, km1);
+	}
+}
+
+/* Compare 64 samples, narrow the lane masks and collect their bits. */
+static inline uint64_t a2l_sse2_word(const uint8_t *p, int size, int be,
+		int is_float, __m128i bias, __m128i km1, __m128 kf)
+{
+	__m128i c0, c1, c2, c3;
+	uint64_t word;
+	int j;
+
+	word = 0;
+	for (j = 0; j < 4; j++, p += 16 * size) {
+		c0 = a2l_sse2_cmp(p, size, be, is_float, bias, km1, kf);
+		if (size >= 2) {
+			c1 = a2l_sse2_cmp(p + 16, size, be, is_float,
+				bias, km1, kf);
+			if (size == 4) {
+				c2 = a2l_sse2_cmp(p + 32, size, be, is_float,
+					bias, km1, kf);
+				c3 = a2l_sse2_cmp(p + 48, size, be, is_float,
+					bias, km1, kf);
+				c0 = _mm_packs_epi32(c0, c1);
+				c1 = _mm_packs_epi32(c2, c3);
+			}
+			c0 = _mm_packs_epi16(c0, c1);
+		}
+		word |= (uint64_t)(uint16_t)_mm_movemask_epi8(c0) << (16 * j);
+	}
+
+	return word;
+}
+
+#define A2L_SSE2_LOOP(size, be, is_float) \
+	for (; i + 64 <= count; i += 64) \
+		bits[i / 64] = a2l_sse2_word(data + i * (size), size, be, \
+			is_float, bias, km1, kf);
+
+static size_t a2l_compare_sse2(const struct a2l_cmp *cmp,
+		const uint8_t *data, uint64_t *bits, size_t count)
+{
+	const struct sr_analog_encoding *enc;
+	__m128i bias, km1;
+	__m128 kf;
+	int64_t k;
+	size_t i;
+	int be;
+
+	enc = cmp->enc;
+	be = enc->is_bigendian;
+	k = cmp->k - 1;
+	bias = _mm_setzero_si128();
+	kf = _mm_set1_ps(cmp->level_f);
+	i = 0;
+
+	if (enc->is_float) {
+		if (enc->unitsize != sizeof(float))
+			return 0;
+		km1 = bias;
+		if (be)
+			A2L_SSE2_LOOP(4, 1, 1)
+		else
+			A2L_SSE2_LOOP(4, 0, 1)
+		return i;
+	}
+
+	switch (enc->unitsize) {
+	case sizeof(uint8_t):
+		if (!enc->is_signed) {
+			bias = _mm_set1_epi8((char)0x80);
+			k -= 0x80;
+		}
+		km1 = _mm_set1_epi8((char)k);
+		A2L_SSE2_LOOP(1, 0, 0)
+		break;
+	case sizeof(uint16_t):
+		if (!enc->is_signed) {
+			bias = _mm_set1_epi16((short)0x8000);
+			k -= 0x8000;
+		}
+		km1 = _mm_set1_epi16((short)k);
+		if (be)
+			A2L_SSE2_LOOP(2, 1, 0)
+		else
+			A2L_SSE2_LOOP(2, 0, 0)
+		break;
+	case sizeof(uint32_t):
+		if (!enc->is_signed) {
+			bias = _mm_set1_epi32((int)0x80000000u);
+			k -= 0x80000000ll;
+		}
+		km1 = _mm_set1_epi32((int)k);
+		if (be)
+			A2L_SSE2_LOOP(4, 1, 0)
+		else
+			A2L_SSE2_LOOP(4, 0, 0)
+		break;
+	}
+
+	return i;
+}
+
+#endif
+
+/* Compare 'count' samples, and store the results in a bitmap. */
+static void a2l_compare(const struct a2l_cmp *cmp,
+		const uint8_t *data, uint64_t *bits, size_t count)
+{
+	const struct sr_analog_encoding *enc;
+	size_t i, words;
+	int64_t k;
+
+	enc = cmp->enc;
+	words = (count + 63) / 64;
+
+	if (cmp->fixed >= 0) {
+		memset(bits, cmp->fixed ? 0xff : 0x00, words * sizeof(*bits));
+	} else {
+#ifdef A2L_SIMD_X86
+		i = a2l_compare_sse2(cmp, data, bits, count);
+#else
+		i = 0;
+#endif
+		memset(&bits[i / 64], 0, (words - i / 64) * sizeof(*bits));
+		k = cmp->k;
+		if (enc->is_float && enc->unitsize == sizeof(float)) {
+			if (enc->is_bigendian)
+				A2L_SCALAR_LOOP(read_fltbe, 4, cmp->level_f)
+			else
+				A2L_SCALAR_LOOP(read_fltle, 4, cmp->level_f)
+		} else if (enc->is_float) {
+			if (enc->is_bigendian)
+				A2L_SCALAR_LOOP(read_dblbe, 8, cmp->level)
+			else
+				A2L_SCALAR_LOOP(read_dblle, 8, cmp->level)
+		} else if (enc->unitsize == sizeof(uint8_t)) {
+			if (enc->is_signed)
+				A2L_SCALAR_LOOP(read_i8, 1, k)
+			else
+				A2L_SCALAR_LOOP(read_u8, 1, k)
+		} else if (enc->unitsize == sizeof(uint16_t)) {
+			if (enc->is_signed && enc->is_bigendian)
+				A2L_SCALAR_LOOP(read_i16be, 2, k)
+			else if (enc->is_signed)
+				A2L_SCALAR_LOOP(read_i16le, 2, k)
+			else if (enc->is_bigendian)
+				A2L_SCALAR_LOOP(read_u16be, 2, k)
+			else
+				A2L_SCALAR_LOOP(read_u16le, 2, k)
+		} else {
+			if (enc->is_signed && enc->is_bigendian)
+				A2L_SCALAR_LOOP(read_i32be, 4, k)
+			else if (enc->is_signed)
+				A2L_SCALAR_LOOP(read_i32le, 4, k)
+			else if (enc->is_bigendian)
+				A2L_SCALAR_LOOP(read_u32be, 4, k)
+			else
+				A2L_SCALAR_LOOP(read_u32le, 4, k)
+		}
+	}
+
+	for (i = 0; i < words; i++)
+		bits[i] ^= cmp->invert;
+}
+
+/*
+ * Run the Schmitt-trigger on bitmaps of the samples above the high and
+ * below the low threshold. A sample's state is 1 when it's above the
+ * high threshold, or when it's not below the low threshold and the
+ * previous sample's state is 1. That's the carry chain of an addition
+ * with 'gen' as generate and 'prop' as propagate bits, so the adder
+ * computes 64 states at once.
+ */
+static void a2l_schmitt(uint64_t *bits, const uint64_t *above,
+		const uint64_t *below, size_t words, uint64_t carry)
+{
+	uint64_t gen, prop, sum;
+	size_t i;
+
+	for (i = 0; i < words; i++) {
+		gen = above[i] & ~below[i];
+		prop = ~(above[i] | below[i]);
+		sum = (gen | prop) + gen + carry;
+		bits[i] = gen | (prop & (sum ^ prop));
+		carry = bits[i] >> 63;
+	}
+}
+
+/* Spread the 8 bits of a byte to the LSBs of the 8 bytes of a word. */
+static inline uint64_t a2l_spread8(uint64_t x)
+{
+	x = (x | x << 28) & 0x0000000f0000000full;
+	x = (x | x << 14) & 0x0003000300030003ull;
+	x = (x | x << 7) & 0x0101010101010101ull;
+
+	return x;
+}
+
+/*
+ * Write a bitmap to bit 'index' of 'count' logic samples. Other bits
+ * of the samples are kept unless 'replace' is set.
+ */
+static void a2l_scatter(uint8_t *output, uint16_t unitsize,
+		unsigned int index, gboolean replace,
+		const uint64_t *bits, size_t count)
+{
+	uint64_t keep, word;
+	uint8_t mask, keep8, bit;
+	size_t i;
+
+	output += index / 8;
+	index %= 8;
+	mask = 1 << index;
+	keep8 = replace ? 0 : ~mask;
+	i = 0;
+
+	if (unitsize == 1) {
+		keep = replace ? 0 : ~(0x0101010101010101ull << index);
+		for (; i + 8 <= count; i += 8) {
+			memcpy(&word, &output[i], sizeof(word));
+			word &= keep;
+			word |= GUINT64_TO_LE(
+				a2l_spread8((bits[i / 64] >> (i % 64)) & 0xff)
+				<< index);
+			memcpy(&output[i], &word, sizeof(word));
+		}
+	}
+
+	for (; i < count; i++) {
+		bit = (bits[i / 64] >> (i % 64)) & 1;
+		output[i * unitsize] &= keep8;
+		output[i * unitsize] |= bit << index;
+	}
+}
+
+static int a2l_convert(const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state,
+		uint8_t *output, uint16_t unitsize, unsigned int index,
+		gboolean replace, uint64_t count)
+{
+	uint64_t above[A2L_CHUNK_WORDS], below[A2L_CHUNK_WORDS];
+	uint64_t bits[A2L_CHUNK_WORDS];
+	struct a2l_cmp hi, lo;
+	const uint8_t *data;
+	uint64_t i;
+	size_t n;
+	int ret;
+
+	if (!analog || !analog->encoding || !output)
+		return SR_ERR_ARG;
+	if (!unitsize || index >= 8u * unitsize)
+		return SR_ERR_ARG;
+	if (count && !analog->data)
+		return SR_ERR_ARG;
+
+	/* Plain thresholds only use 'hi', Schmitt-triggers need both. */
+	ret = a2l_cmp_init(&hi, analog->encoding, hi_thr, !!state, FALSE);
+	if (ret == SR_OK && state)
+		ret = a2l_cmp_init(&lo, analog->encoding, lo_thr, FALSE, TRUE);
+	if (ret != SR_OK) {
+		sr_err("Unsupported encoding for analog-to-logic conversion.");
+		return ret;
+	}
+
+	data = analog->data;
+	for (i = 0; i < count; i += n) {
+		n = MIN(count - i, A2L_CHUNK_SAMPLES);
+		if (!state) {
+			a2l_compare(&hi, data, bits, n);
+		} else {
+			a2l_compare(&hi, data, above, n);
+			a2l_compare(&lo, data, below, n);
+			a2l_schmitt(bits, above, below, (n + 63) / 64,
+				*state ? 1 : 0);
+			*state = (bits[(n - 1) / 64] >> ((n - 1) % 64)) & 1;
+		}
+		a2l_scatter(output, unitsize, index, replace, bits, n);
+		data += n * analog->encoding->unitsize;
+		output += n * unitsize;
+	}
+
+	return SR_OK;
+}
+
 /**
  * Convert analog values to logic values by using a fixed threshold.
  *
@@ -44,22 +477,9 @@
 SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 		float threshold, uint8_t *output, uint64_t count)
 {
-	float *input;
-
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
-
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
-
-	for (uint64_t i = 0; i < count; i++)
-		output[i] = (input[i] >= threshold) ? 1 : 0;
-
-	if (!analog->encoding->is_float)
-		g_free(input);
+	if (a2l_convert(analog, threshold, threshold, NULL,
+			output, 1, 0, TRUE, count) != SR_OK)
+		return SR_ERR;
 
 	return SR_OK;
 }
@@ -82,28 +502,76 @@ SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count)
 {
-	float *input;
+	if (!state)
+		return SR_ERR;
+	if (a2l_convert(analog, lo_thr, hi_thr, state,
+			output, 1, 0, TRUE, count) != SR_OK)
+		return SR_ERR;
 
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
-
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
-
-	for (uint64_t i = 0; i < count; i++) {
-		if (input[i] < lo_thr)
-			*state = 0;
-		else if (input[i] > hi_thr)
-			*state = 1;
+	return SR_OK;
+}
 
-		output[i] = *state;
-	}
+/**
+ * Convert analog values to one channel of bit-packed logic data by using
+ * a fixed threshold.
+ *
+ * The samples are compared in the raw domain of the analog data, without
+ * converting them to floating point first. The result is written to bit
+ * 'index' of the logic samples, other bits are left untouched. Calling
+ * this once per analog channel builds logic data for several channels,
+ * suitable for SR_DF_LOGIC packets.
+ *
+ * @param[in] analog The analog input values.
+ * @param[in] threshold The threshold to use.
+ * @param[in,out] output The logic output samples. Must provide space for
+ *                       count samples of unitsize bytes.
+ * @param[in] unitsize The logic output's unitsize.
+ * @param[in] index The logic channel (bit) to write.
+ * @param[in] count The number of samples to process.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or unsupported analog encoding.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_threshold_packed(const struct sr_datafeed_analog *analog,
+		float threshold, uint8_t *output, uint16_t unitsize,
+		unsigned int index, uint64_t count)
+{
+	return a2l_convert(analog, threshold, threshold, NULL,
+		output, unitsize, index, FALSE, count);
+}
 
-	if (!analog->encoding->is_float)
-		g_free(input);
+/**
+ * Convert analog values to one channel of bit-packed logic data by using
+ * a Schmitt-trigger algorithm.
+ *
+ * See sr_a2l_threshold_packed() for the output format, and
+ * sr_a2l_schmitt_trigger() for the thresholds and the converter state.
+ *
+ * @param[in] analog The analog input values.
+ * @param[in] lo_thr The low threshold - result becomes 0 below it.
+ * @param[in] hi_thr The high threshold - result becomes 1 above it.
+ * @param[in,out] state The internal converter state.
+ * @param[in,out] output The logic output samples. Must provide space for
+ *                       count samples of unitsize bytes.
+ * @param[in] unitsize The logic output's unitsize.
+ * @param[in] index The logic channel (bit) to write.
+ * @param[in] count The number of samples to process.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or unsupported analog encoding.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_schmitt_trigger_packed(
+		const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
+		uint16_t unitsize, unsigned int index, uint64_t count)
+{
+	if (!state)
+		return SR_ERR_ARG;
 
-	return SR_OK;
+	return a2l_convert(analog, lo_thr, hi_thr, state,
+		output, unitsize, index, FALSE, count);
 }
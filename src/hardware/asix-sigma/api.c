@@ -155,7 +155,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all ASIX logic analyzers (which match the connection spec). */
 	devices = NULL;
-	libusb_get_device_list(usbctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (devidx = 0; devlist[devidx]; devidx++) {
 		devitem = devlist[devidx];
 
@@ -177,8 +177,11 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 			sr_warn("Cannot get serial number (index 0).");
 			continue;
 		}
+		/* ftdi-la and chronovu-la probe FTDI devices, too. */
+		sr_usb_scan_lock(devitem);
 		ret = libusb_open(devitem, &hdl);
 		if (ret < 0) {
+			sr_usb_scan_unlock(devitem);
 			sr_warn("Cannot open USB device %04x.%04x: %s.",
 				des.idVendor, des.idProduct,
 				libusb_error_name(ret));
@@ -191,9 +194,11 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 			sr_warn("Cannot get serial number (%s).",
 				libusb_error_name(ret));
 			libusb_close(hdl);
+			sr_usb_scan_unlock(devitem);
 			continue;
 		}
 		libusb_close(hdl);
+		sr_usb_scan_unlock(devitem);
 
 		/*
 		 * All ASIX logic analyzers have a serial number, which
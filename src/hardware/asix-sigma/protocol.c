@@ -829,6 +829,7 @@ static int upload_firmware(struct sr_context *ctx, struct dev_context *devc,
 	uint8_t pins;
 	size_t buf_size;
 	const char *firmware;
+	char device_id[32];
 
 	/* Check for valid firmware file selection. */
 	if (firmware_idx >= ARRAY_SIZE(firmware_files))
@@ -843,6 +844,26 @@ static int upload_firmware(struct sr_context *ctx, struct dev_context *devc,
 		return SR_OK;
 	}
 
+	/*
+	 * The device instance may be new while the hardware still runs
+	 * what an earlier one uploaded. The FPGA tells that it's up, the
+	 * context remembers which netlist it got.
+	 */
+	snprintf(device_id, sizeof(device_id), "asix-sigma/%08x",
+		devc->id.serno);
+	ret = sr_resource_upload_check(ctx, device_id,
+		SR_RESOURCE_FIRMWARE, firmware);
+	if (ret == SR_OK) {
+		PURGE_FTDI_BOTH(&devc->ftdi.ctx);
+		ret = sigma_fpga_init_la(devc);
+	}
+	if (ret == SR_OK) {
+		sr_info("Firmware file '%s' is loaded already.", firmware);
+		devc->state = SIGMA_IDLE;
+		devc->firmware_idx = firmware_idx;
+		return SR_OK;
+	}
+
 	devc->state = SIGMA_CONFIG;
 
 	/* Set the cable to bitbang mode. */
@@ -903,6 +924,7 @@ static int upload_firmware(struct sr_context *ctx, struct dev_context *devc,
 	/* Keep track of successful firmware download completion. */
 	devc->state = SIGMA_IDLE;
 	devc->firmware_idx = firmware_idx;
+	sr_resource_upload_done(ctx, device_id, SR_RESOURCE_FIRMWARE, firmware);
 	sr_info("Firmware uploaded.");
 
 	return SR_OK;
@@ -1265,29 +1287,46 @@ static int addto_submit_buffer(struct dev_context *devc,
 {
 	struct submit_buffer *buffer;
 	struct sr_sw_limits *limits;
+	uint64_t remain;
+	gboolean exceeded;
+	size_t fill_count, idx;
+	uint8_t sample_le[sizeof(uint16_t)], *wrptr;
 	int ret;
 
 	buffer = devc->buffer;
 	limits = &devc->limit.submit;
-	if (!devc->use_triggers && sr_sw_limits_check(limits))
-		count = 0;
+
+	/* Clip the count such that enforcement of user limits is exact. */
+	if (!devc->use_triggers) {
+		sr_sw_limits_get_remain(limits, &remain, NULL, NULL, &exceeded);
+		if (exceeded)
+			count = 0;
+		else if (remain && count > remain)
+			count = remain;
+	}
 
 	/*
-	 * Individually accumulate and check each sample, such that
-	 * accumulation between flushes won't exceed local storage, and
-	 * enforcement of user specified limits is exact.
+	 * Accumulate the samples in spans which don't exceed the local
+	 * storage between flushes.
 	 */
-	while (count--) {
-		write_u16le_inc(&buffer->write_pointer, sample);
-		buffer->curr_samples++;
+	write_u16le(sample_le, sample);
+	while (count) {
+		fill_count = buffer->max_samples - buffer->curr_samples;
+		if (fill_count > count)
+			fill_count = count;
+		wrptr = buffer->write_pointer;
+		for (idx = 0; idx < fill_count; idx++)
+			memcpy(&wrptr[idx * sizeof(sample_le)], sample_le,
+				sizeof(sample_le));
+		buffer->write_pointer += fill_count * sizeof(sample_le);
+		buffer->curr_samples += fill_count;
+		count -= fill_count;
+		sr_sw_limits_update_samples_read(limits, fill_count);
 		if (buffer->curr_samples == buffer->max_samples) {
 			ret = flush_submit_buffer(devc);
 			if (ret != SR_OK)
 				return ret;
 		}
-		sr_sw_limits_update_samples_read(limits, 1);
-		if (!devc->use_triggers && sr_sw_limits_check(limits))
-			break;
 	}
 
 	return SR_OK;
@@ -1792,6 +1831,34 @@ static void sigma_location_check(struct dev_context *devc)
 	}
 }
 
+/*
+ * Check whether trigger supervision can change its state while the
+ * next events of a cluster get processed. Which is not the case when
+ * checks are not armed, and the arm position is out of reach. A span of
+ * up to one cluster's events touches at most two clusters.
+ */
+static gboolean sigma_location_check_pending(struct dev_context *devc,
+	size_t events)
+{
+	struct sigma_sample_interp *interp;
+	struct sigma_location last;
+
+	interp = &devc->interp;
+	if (interp->trig_chk.armed)
+		return TRUE;
+	if (interp->trig_chk.matched)
+		return FALSE;
+	if (sigma_location_is_eq(&interp->iter, &interp->trig_arm, FALSE))
+		return TRUE;
+	last = interp->iter;
+	while (events--)
+		sigma_location_increment(&last);
+	if (sigma_location_is_eq(&last, &interp->trig_arm, FALSE))
+		return TRUE;
+
+	return FALSE;
+}
+
 /*
  * Return the timestamp of "DRAM cluster".
  */
@@ -1815,19 +1882,7 @@ static uint16_t sigma_dram_cluster_data(struct sigma_dram_cluster *cl, int idx)
  */
 static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx)
 {
-	uint16_t outdata;
-
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 2 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 2 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 2 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 2 - 3)) & (1 << 3);
-	outdata |= (indata >> (4 * 2 - 4)) & (1 << 4);
-	outdata |= (indata >> (5 * 2 - 5)) & (1 << 5);
-	outdata |= (indata >> (6 * 2 - 6)) & (1 << 6);
-	outdata |= (indata >> (7 * 2 - 7)) & (1 << 7);
-	return outdata;
+	return (sr_transpose_8x2(indata) >> (8 * idx)) & 0xff;
 }
 
 /*
@@ -1837,15 +1892,47 @@ static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx)
  */
 static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx)
 {
-	uint16_t outdata;
-
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 4 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 4 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 4 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 4 - 3)) & (1 << 3);
-	return outdata;
+	return (sr_transpose_4x4(indata) >> (4 * idx)) & 0x0f;
+}
+
+/*
+ * Decode all events of a cluster into a sample array. The array must
+ * hold EVENTS_PER_CLUSTER * 4 items. Returns the number of samples.
+ */
+static size_t sigma_decode_cluster_samples(struct dev_context *devc,
+	struct sigma_dram_cluster *dram_cluster, size_t events_in_cluster,
+	uint16_t *samples)
+{
+	const uint8_t *rdptr;
+	uint16_t item16;
+	size_t evt, count;
+
+	rdptr = (const uint8_t *)&dram_cluster->samples[0];
+	count = 0;
+	switch (devc->interp.samples_per_event) {
+	case 4:
+		for (evt = 0; evt < events_in_cluster; evt++) {
+			item16 = sr_transpose_4x4(read_u16le_inc(&rdptr));
+			samples[count++] = item16 & 0x0f;
+			samples[count++] = (item16 >> 4) & 0x0f;
+			samples[count++] = (item16 >> 8) & 0x0f;
+			samples[count++] = item16 >> 12;
+		}
+		break;
+	case 2:
+		for (evt = 0; evt < events_in_cluster; evt++) {
+			item16 = sr_transpose_8x2(read_u16le_inc(&rdptr));
+			samples[count++] = item16 & 0xff;
+			samples[count++] = item16 >> 8;
+		}
+		break;
+	default:
+		for (evt = 0; evt < events_in_cluster; evt++)
+			samples[count++] = read_u16le_inc(&rdptr);
+		break;
+	}
+
+	return count;
 }
 
 static void sigma_decode_dram_cluster(struct dev_context *devc,
@@ -1853,8 +1940,10 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	size_t events_in_cluster)
 {
 	uint16_t tsdiff, ts, sample, item16;
+	uint16_t samples[EVENTS_PER_CLUSTER * 4];
 	size_t count;
 	size_t evt;
+	int idx, run_start;
 
 	/*
 	 * If this cluster is not adjacent to the previously received
@@ -1875,6 +1964,29 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	}
 	devc->interp.last.ts = ts + EVENTS_PER_CLUSTER;
 
+	/*
+	 * Outside of the trigger supervision period all events of the
+	 * cluster can get decoded at once, and identical samples get
+	 * submitted in runs.
+	 */
+	if (!sigma_location_check_pending(devc, events_in_cluster)) {
+		count = sigma_decode_cluster_samples(devc, dram_cluster,
+			events_in_cluster, samples);
+		run_start = 0;
+		for (idx = 1; idx <= (int)count; idx++) {
+			if (idx < (int)count && samples[idx] == samples[run_start])
+				continue;
+			(void)addto_submit_buffer(devc, samples[run_start],
+				idx - run_start);
+			run_start = idx;
+		}
+		if (count)
+			devc->interp.last.sample = samples[count - 1];
+		for (evt = 0; evt < events_in_cluster; evt++)
+			sigma_location_increment(&devc->interp.iter);
+		return;
+	}
+
 	/*
 	 * Grab sample data from the current cluster and prepare their
 	 * submission to the session feed. Handle samplerate dependent
@@ -1886,25 +1998,19 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	for (evt = 0; evt < events_in_cluster; evt++) {
 		item16 = sigma_dram_cluster_data(dram_cluster, evt);
 		if (devc->interp.samples_per_event == 4) {
-			sample = sigma_deinterlace_data_4x4(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 2);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 3);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
+			item16 = sr_transpose_4x4(item16);
+			for (idx = 0; idx < 4; idx++) {
+				sample = (item16 >> (4 * idx)) & 0x0f;
+				check_and_submit_sample(devc, sample, 1);
+				devc->interp.last.sample = sample;
+			}
 		} else if (devc->interp.samples_per_event == 2) {
-			sample = sigma_deinterlace_data_2x8(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_2x8(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
+			item16 = sr_transpose_8x2(item16);
+			for (idx = 0; idx < 2; idx++) {
+				sample = (item16 >> (8 * idx)) & 0xff;
+				check_and_submit_sample(devc, sample, 1);
+				devc->interp.last.sample = sample;
+			}
 		} else {
 			sample = item16;
 			check_and_submit_sample(devc, sample, 1);
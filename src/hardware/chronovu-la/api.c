@@ -148,7 +148,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	if (conn)
 		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		bus = libusb_get_bus_number(devlist[i]);
 		addr = libusb_get_device_address(devlist[i]);
@@ -181,8 +181,12 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		if (des.idVendor != SCAN_EXPECTED_VENDOR)
 			continue;
 
-		if ((ret = libusb_open(devlist[i], &hdl)) < 0)
+		/* ftdi-la and asix-sigma probe FTDI devices, too. */
+		sr_usb_scan_lock(devlist[i]);
+		if ((ret = libusb_open(devlist[i], &hdl)) < 0) {
+			sr_usb_scan_unlock(devlist[i]);
 			continue;
+		}
 
 		if (des.iProduct == 0) {
 			product[0] = '\0';
@@ -191,6 +195,8 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 				sizeof(product))) < 0) {
 			sr_warn("Failed to get product string descriptor: %s.",
 				libusb_error_name(ret));
+			libusb_close(hdl);
+			sr_usb_scan_unlock(devlist[i]);
 			continue;
 		}
 
@@ -201,10 +207,13 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 				sizeof(serial_num))) < 0) {
 			sr_warn("Failed to get serial number string descriptor: %s.",
 				libusb_error_name(ret));
+			libusb_close(hdl);
+			sr_usb_scan_unlock(devlist[i]);
 			continue;
 		}
 
 		libusb_close(hdl);
+		sr_usb_scan_unlock(devlist[i]);
 
 		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
@@ -69,6 +69,7 @@ static const uint32_t devopts[] = {
 	SR_CONF_AVG_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_BENCHMARK | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t devopts_cg_logic[] = {
@@ -220,6 +221,8 @@ static void clear_helper(struct dev_context *devc)
 	void *value;
 
 	demo_free_analog_pattern(devc);
+	demo_free_logic_pattern(devc);
+	g_free(devc->logic_data);
 
 	/* Analog generators. */
 	g_hash_table_iter_init(&iter, devc->ch_ag);
@@ -315,6 +318,9 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_BENCHMARK:
+		*data = g_variant_new_boolean(devc->benchmark);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -387,11 +393,6 @@ static int config_set(uint32_t key, GVariant *data,
 				sr_dbg("Setting logic pattern to %s",
 						logic_pattern_str[logic_pattern]);
 				devc->logic_pattern = logic_pattern;
-				/* Might as well do this now, these are static. */
-				if (logic_pattern == PATTERN_ALL_LOW)
-					memset(devc->logic_data, 0x00, LOGIC_BUFSIZE);
-				else if (logic_pattern == PATTERN_ALL_HIGH)
-					memset(devc->logic_data, 0xff, LOGIC_BUFSIZE);
 			} else if (ch->type == SR_CHANNEL_ANALOG) {
 				if (analog_pattern == -1)
 					return SR_ERR_ARG;
@@ -428,6 +429,9 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_BENCHMARK:
+		devc->benchmark = g_variant_get_boolean(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -496,6 +500,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	struct sr_channel *ch;
 	int bitpos;
 	uint8_t mask;
+	size_t bufsize;
 	struct sr_trigger *trigger;
 
 	devc = sdi->priv;
@@ -561,7 +566,23 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->first_partial_logic_index,
 		devc->first_partial_logic_mask);
 
-	sr_session_source_add(sdi->session, -1, 0, 100,
+	/* Benchmark mode sends large chunks, and doesn't wait for time to pass. */
+	bufsize = devc->benchmark ? LOGIC_BENCH_BUFSIZE : LOGIC_BUFSIZE;
+	if (devc->logic_bufsize != bufsize) {
+		g_free(devc->logic_data);
+		devc->logic_data = NULL;
+		devc->logic_bufsize = 0;
+	}
+	if (!devc->logic_data) {
+		devc->logic_data = g_try_malloc(bufsize);
+		if (!devc->logic_data)
+			goto err_malloc;
+		devc->logic_bufsize = bufsize;
+	}
+	if (demo_setup_logic_pattern(devc) != SR_OK)
+		goto err_malloc;
+
+	sr_session_source_add(sdi->session, -1, 0, devc->benchmark ? 0 : 100,
 			demo_prepare_data, (struct sr_dev_inst *)sdi);
 
 	std_session_send_df_header(sdi);
@@ -572,9 +593,17 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	/* We use this timestamp to decide how many more samples to send. */
 	devc->start_us = g_get_monotonic_time();
 	devc->spent_us = 0;
-	devc->step = 0;
 
 	return SR_OK;
+
+err_malloc:
+	sr_err("Logic data buffer malloc failed.");
+	if (devc->stl) {
+		soft_trigger_logic_free(devc->stl);
+		devc->stl = NULL;
+	}
+
+	return SR_ERR_MALLOC;
 }
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
@@ -593,6 +622,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 		soft_trigger_logic_free(devc->stl);
 		devc->stl = NULL;
 	}
+	demo_free_logic_pattern(devc);
 
 	return SR_OK;
 }
@@ -274,45 +274,64 @@ static void set_logic_data(uint64_t bits, uint8_t *data, size_t len)
 	}
 }
 
-static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
+/* Pseudo-random numbers, xorshift64 (Marsaglia). */
+static uint64_t logic_random(struct dev_context *devc)
 {
-	struct dev_context *devc;
-	uint64_t i, j;
+	uint64_t x;
+
+	x = devc->rand_state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	devc->rand_state = x;
+
+	return x;
+}
+
+/* Generate 'size' bytes of the logic pattern, sample by sample. */
+static void logic_generator(struct dev_context *devc, uint8_t *data,
+		uint64_t size)
+{
+	uint64_t i, j, r;
 	uint8_t pat;
 	uint8_t *sample;
 	const uint8_t *image_col;
 	size_t col_count, col_height;
 	uint64_t gray;
 
-	devc = sdi->priv;
-
 	switch (devc->logic_pattern) {
 	case PATTERN_SIGROK:
-		memset(devc->logic_data, 0x00, size);
+		memset(data, 0x00, size);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = pattern_sigrok[(devc->step + j) % sizeof(pattern_sigrok)] >> 1;
-				devc->logic_data[i + j] = ~pat;
+				data[i + j] = ~pat;
 			}
 			devc->step++;
 		}
 		break;
 	case PATTERN_RANDOM:
-		for (i = 0; i < size; i++)
-			devc->logic_data[i] = (uint8_t)(rand() & 0xff);
+		for (i = 0; i + sizeof(r) <= size; i += sizeof(r)) {
+			r = logic_random(devc);
+			memcpy(&data[i], &r, sizeof(r));
+		}
+		if (i < size) {
+			r = logic_random(devc);
+			memcpy(&data[i], &r, size - i);
+		}
 		break;
 	case PATTERN_INC:
-		for (i = 0; i < size; i++) {
+		for (i = 0; i < size; i += devc->logic_unitsize) {
 			for (j = 0; j < devc->logic_unitsize; j++)
-				devc->logic_data[i + j] = devc->step;
+				data[i + j] = devc->step;
 			devc->step++;
 		}
 		break;
 	case PATTERN_WALKING_ONE:
 		/* j contains the value of the highest bit */
-		j = 1 << (devc->num_logic_channels - 1);
+		j = UINT64_C(1) << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = devc->step;
+			data[i] = devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -325,9 +344,9 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	case PATTERN_WALKING_ZERO:
 		/* Same as walking one, only with inverted output */
 		/* j contains the value of the highest bit */
-		j = 1 << (devc->num_logic_channels - 1);
+		j = UINT64_C(1) << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = ~devc->step;
+			data[i] = ~devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -338,15 +357,17 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		}
 		break;
 	case PATTERN_ALL_LOW:
+		memset(data, 0x00, size);
+		break;
 	case PATTERN_ALL_HIGH:
-		/* These were set when the pattern mode was selected. */
+		memset(data, 0xff, size);
 		break;
 	case PATTERN_SQUID:
-		memset(devc->logic_data, 0x00, size);
+		memset(data, 0x00, size);
 		col_count = ARRAY_SIZE(pattern_squid);
 		col_height = ARRAY_SIZE(pattern_squid[0]);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
-			sample = &devc->logic_data[i];
+			sample = &data[i];
 			image_col = pattern_squid[devc->step];
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = image_col[j % col_height];
@@ -362,7 +383,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 			devc->step &= devc->all_logic_channels_mask;
 			gray = encode_number_to_gray(devc->step);
 			gray &= devc->all_logic_channels_mask;
-			set_logic_data(gray, &devc->logic_data[i], devc->logic_unitsize);
+			set_logic_data(gray, &data[i], devc->logic_unitsize);
 		}
 		break;
 	default:
@@ -371,6 +392,117 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	}
 }
 
+/*
+ * Get the period of the logic pattern in bytes, or 0 when it doesn't
+ * repeat within LOGIC_PERIOD_MAXSIZE bytes.
+ */
+static size_t logic_period_size(struct dev_context *devc)
+{
+	size_t unitsize, samples, bytes;
+
+	unitsize = devc->logic_unitsize;
+	switch (devc->logic_pattern) {
+	case PATTERN_SIGROK:
+		samples = sizeof(pattern_sigrok);
+		break;
+	case PATTERN_INC:
+		samples = 256;
+		break;
+	case PATTERN_WALKING_ONE:
+	case PATTERN_WALKING_ZERO:
+		/* These advance per byte, not per sample. */
+		if (devc->num_logic_channels > 64)
+			return 0;
+		bytes = devc->num_logic_channels + 1;
+		return bytes * unitsize;
+	case PATTERN_ALL_LOW:
+	case PATTERN_ALL_HIGH:
+		samples = 1;
+		break;
+	case PATTERN_SQUID:
+		samples = ARRAY_SIZE(pattern_squid);
+		break;
+	case PATTERN_GRAYCODE:
+		if (devc->all_logic_channels_mask >= LOGIC_PERIOD_MAXSIZE / unitsize)
+			return 0;
+		samples = devc->all_logic_channels_mask + 1;
+		break;
+	default:
+		return 0;
+	}
+
+	return samples * unitsize;
+}
+
+/**
+ * Precompute the logic pattern for an acquisition.
+ *
+ * Periodic patterns get generated once into a table which holds a
+ * multiple of their period, the acquisition then copies from it.
+ * Other patterns get generated on the fly.
+ */
+SR_PRIV int demo_setup_logic_pattern(struct dev_context *devc)
+{
+	size_t period, size;
+
+	demo_free_logic_pattern(devc);
+
+	devc->step = 0;
+	devc->rand_state = 0x2545f4914f6cdd1dull;
+	devc->logic_period_pattern = devc->logic_pattern;
+	devc->logic_period_pos = 0;
+
+	if (!devc->logic_unitsize)
+		return SR_OK;
+	period = logic_period_size(devc);
+	if (!period || period > LOGIC_PERIOD_MAXSIZE)
+		return SR_OK;
+
+	/* Make short periods cheap to copy. */
+	size = period * MAX(1, LOGIC_PERIOD_MINSIZE / period);
+	devc->logic_period = g_try_malloc(size);
+	if (!devc->logic_period)
+		return SR_ERR_MALLOC;
+	devc->logic_period_size = size;
+	logic_generator(devc, devc->logic_period, size);
+
+	return SR_OK;
+}
+
+SR_PRIV void demo_free_logic_pattern(struct dev_context *devc)
+{
+	g_free(devc->logic_period);
+	devc->logic_period = NULL;
+	devc->logic_period_size = 0;
+}
+
+/* Fill the logic buffer, from the period table where available. */
+static void logic_fill(struct dev_context *devc, uint64_t size)
+{
+	uint8_t *data;
+	size_t len;
+
+	/* The pattern can change during the acquisition. */
+	if (devc->logic_period_pattern != devc->logic_pattern)
+		demo_setup_logic_pattern(devc);
+
+	if (!devc->logic_period) {
+		logic_generator(devc, devc->logic_data, size);
+		return;
+	}
+
+	data = devc->logic_data;
+	while (size) {
+		len = MIN(size, devc->logic_period_size - devc->logic_period_pos);
+		memcpy(data, devc->logic_period + devc->logic_period_pos, len);
+		data += len;
+		size -= len;
+		devc->logic_period_pos += len;
+		if (devc->logic_period_pos == devc->logic_period_size)
+			devc->logic_period_pos = 0;
+	}
+}
+
 /*
  * Fixup a memory image of generated logic data before it gets sent to
  * the session's datafeed. Mask out content from disabled channels.
@@ -613,6 +745,21 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	samples_todo = (todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
 			/ G_USEC_PER_SEC;
 
+	/*
+	 * In benchmark mode, don't pace the data to the samplerate. Send
+	 * a batch of full buffers per round, the time limit then applies
+	 * to the sample time rather than to the wall clock.
+	 */
+	if (devc->benchmark) {
+		samples_todo = LOGIC_BENCH_CHUNKS * devc->logic_bufsize /
+			MAX(devc->logic_unitsize, 1);
+		todo_us = MAX(0, limit_us - devc->spent_us);
+		if (limit_us > 0)
+			samples_todo = MIN(samples_todo,
+				(todo_us * devc->cur_samplerate +
+				G_USEC_PER_SEC - 1) / G_USEC_PER_SEC);
+	}
+
 	if (devc->limit_samples > 0) {
 		if (devc->limit_samples < devc->sent_samples)
 			samples_todo = 0;
@@ -649,8 +796,8 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		/* Logic */
 		if (logic_done < samples_todo) {
 			sending_now = MIN(samples_todo - logic_done,
-					LOGIC_BUFSIZE / devc->logic_unitsize);
-			logic_generator(sdi, sending_now * devc->logic_unitsize);
+					devc->logic_bufsize / devc->logic_unitsize);
+			logic_fill(devc, sending_now * devc->logic_unitsize);
 			/* Check for trigger and send pre-trigger data if needed */
 			if (devc->stl && (!devc->trigger_fired)) {
 				trigger_offset = soft_trigger_logic_check(devc->stl,
@@ -32,6 +32,12 @@
 
 /* The size in bytes of chunks to send through the session bus. */
 #define LOGIC_BUFSIZE			4096
+/* Chunk size in benchmark mode, and the number of chunks per round. */
+#define LOGIC_BENCH_BUFSIZE		(1024 * 1024)
+#define LOGIC_BENCH_CHUNKS		16
+/* Size limits of the precomputed logic pattern period. */
+#define LOGIC_PERIOD_MINSIZE		(64 * 1024)
+#define LOGIC_PERIOD_MAXSIZE		(4 * 1024 * 1024)
 /* Size of the analog pattern space per channel. */
 #define ANALOG_BUFSIZE			4096
 /* This is a development feature: it starts a new frame every n samples. */
@@ -127,7 +133,15 @@ struct dev_context {
 	uint64_t all_logic_channels_mask;
 	/* There is only ever one logic channel group, so its pattern goes here. */
 	enum logic_pattern_type logic_pattern;
-	uint8_t logic_data[LOGIC_BUFSIZE];
+	uint8_t *logic_data;
+	size_t logic_bufsize;
+	/* Precomputed period of the pattern, NULL if not periodic. */
+	enum logic_pattern_type logic_period_pattern;
+	uint8_t *logic_period;
+	size_t logic_period_size;
+	size_t logic_period_pos;
+	uint64_t rand_state;
+	gboolean benchmark;
 	/* Analog */
 	struct analog_pattern *analog_patterns[ARRAY_SIZE(analog_pattern_str)];
 	int32_t num_analog_channels;
@@ -162,6 +176,8 @@ struct analog_gen {
 
 SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc);
 SR_PRIV void demo_free_analog_pattern(struct dev_context *devc);
+SR_PRIV int demo_setup_logic_pattern(struct dev_context *devc);
+SR_PRIV void demo_free_logic_pattern(struct dev_context *devc);
 SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data);
 
 #endif
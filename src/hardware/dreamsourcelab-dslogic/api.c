@@ -65,6 +65,9 @@ static const uint32_t devopts[] = {
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_EXTERNAL_CLOCK | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_CLOCK_EDGE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+	SR_CONF_USB_BUFFER_SIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_QUEUE_DEPTH | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_LATENCY | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const int32_t trigger_matches[] = {
@@ -156,7 +159,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all DSLogic compatible devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -431,6 +434,10 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_USB_BUFFER_SIZE:
+	case SR_CONF_USB_QUEUE_DEPTH:
+	case SR_CONF_USB_LATENCY:
+		return sr_usb_xfer_params_config_get(&devc->xfer, key, data);
 	case SR_CONF_EXTERNAL_CLOCK:
 		*data = g_variant_new_boolean(devc->external_clock);
 		break;
@@ -476,6 +483,10 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_USB_BUFFER_SIZE:
+	case SR_CONF_USB_QUEUE_DEPTH:
+	case SR_CONF_USB_LATENCY:
+		return sr_usb_xfer_params_config_set(&devc->xfer, key, data);
 	case SR_CONF_VOLTAGE_THRESHOLD:
 		if (!strcmp(devc->profile->model, "DSLogic")) {
 			if ((idx = std_double_tuple_idx(data, ARRAY_AND_SIZE(thresholds))) < 0)
@@ -224,12 +224,14 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 {
 	const char *name = NULL;
 	uint64_t sum;
-	struct sr_resource bitstream;
+	GBytes *bitstream;
+	const uint8_t *data;
+	size_t size;
 	struct drv_context *drvc;
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 	unsigned char *buf;
-	ssize_t chunksize;
+	int chunksize;
 	int transferred;
 	int result, ret;
 	const uint8_t cmd[3] = {0, 0, 0};
@@ -258,17 +260,18 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 
 	sr_dbg("Uploading FPGA firmware '%s'.", name);
 
-	result = sr_resource_open(drvc->sr_ctx, &bitstream,
-			SR_RESOURCE_FIRMWARE, name);
-	if (result != SR_OK)
-		return result;
+	bitstream = sr_resource_get(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+			name, G_MAXSIZE);
+	if (!bitstream)
+		return SR_ERR;
+	data = g_bytes_get_data(bitstream, &size);
 
 	/* Tell the device firmware is coming. */
 	if ((ret = libusb_control_transfer(usb->devhdl, LIBUSB_REQUEST_TYPE_VENDOR |
 			LIBUSB_ENDPOINT_OUT, DS_CMD_CONFIG, 0x0000, 0x0000,
 			(unsigned char *)&cmd, sizeof(cmd), USB_TIMEOUT)) < 0) {
 		sr_err("Failed to upload FPGA firmware: %s.", libusb_error_name(ret));
-		sr_resource_close(drvc->sr_ctx, &bitstream);
+		g_bytes_unref(bitstream);
 		return SR_ERR;
 	}
 
@@ -278,13 +281,9 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 	buf = g_malloc(FW_BUFSIZE);
 	sum = 0;
 	result = SR_OK;
-	while (1) {
-		chunksize = sr_resource_read(drvc->sr_ctx, &bitstream,
-				buf, FW_BUFSIZE);
-		if (chunksize < 0)
-			result = SR_ERR;
-		if (chunksize <= 0)
-			break;
+	while (sum < size) {
+		chunksize = MIN(size - sum, FW_BUFSIZE);
+		memcpy(buf, &data[sum], chunksize);
 
 		if ((ret = libusb_bulk_transfer(usb->devhdl, 2 | LIBUSB_ENDPOINT_OUT,
 				buf, chunksize, &transferred, USB_TIMEOUT)) < 0) {
@@ -294,8 +293,7 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 			break;
 		}
 		sum += transferred;
-		sr_spew("Uploaded %" PRIu64 "/%" PRIu64 " bytes.",
-			sum, bitstream.size);
+		sr_spew("Uploaded %" PRIu64 "/%zu bytes.", sum, size);
 
 		if (transferred != chunksize) {
 			sr_err("Short transfer while uploading FPGA firmware.");
@@ -304,7 +302,7 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 		}
 	}
 	g_free(buf);
-	sr_resource_close(drvc->sr_ctx, &bitstream);
+	g_bytes_unref(bitstream);
 
 	if (result == SR_OK)
 		sr_dbg("FPGA firmware upload done.");
@@ -684,7 +682,7 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 
 	devc->num_transfers = 0;
 	g_free(devc->transfers);
-	g_free(devc->deinterleave_buffer);
+	devc->transfers = NULL;
 }
 
 static void free_transfer(struct libusb_transfer *transfer)
@@ -714,8 +712,15 @@ static void free_transfer(struct libusb_transfer *transfer)
 
 static void resubmit_transfer(struct libusb_transfer *transfer)
 {
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
 	int ret;
 
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	/* The timeout grows with the number of transfers. */
+	transfer->timeout = devc->xfer.timeout_ms;
 	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
 		return;
 
@@ -727,44 +732,51 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 static void deinterleave_buffer(const uint8_t *src, size_t length,
 	uint16_t *dst_ptr, size_t channel_count, uint16_t channel_mask)
 {
-	uint16_t sample;
-
-	for (const uint64_t *src_ptr = (uint64_t*)src;
-		src_ptr < (uint64_t*)(src + length);
-		src_ptr += channel_count) {
-		for (int bit = 0; bit != 64; bit++) {
-			const uint64_t *word_ptr = src_ptr;
-			sample = 0;
-			for (unsigned int channel = 0; channel != 16;
-				channel++) {
-				const uint16_t m = channel_mask >> channel;
-				if (!m)
-					break;
-				if ((m & 1) && ((*word_ptr++ >> bit) & UINT64_C(1)))
-					sample |= 1 << channel;
+	const size_t block_size = channel_count * sizeof(uint64_t);
+	const uint8_t *const end = src + length;
+	int offsets[16];
+	uint16_t rows[16];
+	unsigned int channel, slice;
+	int offset;
+
+	/*
+	 * A block holds 64 samples of each enabled channel, in one 64bit
+	 * word per channel. Transpose 16 samples of all channels at a
+	 * time, disabled channels contribute all zero rows.
+	 */
+	offset = 0;
+	for (channel = 0; channel != 16; channel++) {
+		offsets[channel] = -1;
+		if (channel_mask & (1 << channel)) {
+			offsets[channel] = offset;
+			offset += sizeof(uint64_t);
+		}
+		rows[channel] = 0;
+	}
+
+	for (; (size_t)(end - src) >= block_size; src += block_size) {
+		for (slice = 0; slice != 4; slice++) {
+			for (channel = 0; channel != 16; channel++) {
+				if (offsets[channel] < 0)
+					continue;
+				rows[channel] = read_u16le(src +
+					offsets[channel] + 2 * slice);
 			}
-			*dst_ptr++ = sample;
+			sr_transpose_16x16(dst_ptr, rows);
+			dst_ptr += 16;
 		}
 	}
 }
 
-static void send_data(struct sr_dev_inst *sdi,
+static void send_data(struct sr_dev_inst *sdi, struct sr_buffer *buf,
 	uint16_t *data, size_t sample_count)
 {
-	const struct sr_datafeed_logic logic = {
-		.length = sample_count * sizeof(uint16_t),
-		.unitsize = sizeof(uint16_t),
-		.data = data
-	};
-
-	const struct sr_datafeed_packet packet = {
-		.type = SR_DF_LOGIC,
-		.payload = &logic
-	};
-
-	sr_session_send(sdi, &packet);
+	std_session_send_logic_buffer(sdi, buf, data,
+		sample_count * sizeof(uint16_t), sizeof(uint16_t));
 }
 
+static int submit_transfer(const struct sr_dev_inst *sdi);
+
 static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 {
 	struct sr_dev_inst *const sdi = transfer->user_data;
@@ -776,8 +788,10 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		(DSLOGIC_ATOMIC_BYTES * channel_count);
 
 	gboolean packet_has_error = FALSE;
-	unsigned int num_samples;
+	unsigned int num_samples, num_transfers;
 	int trigger_offset;
+	struct sr_buffer *buf;
+	uint16_t *samples;
 
 	/*
 	 * If acquisition has already ended, just free any queued up
@@ -808,7 +822,7 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 
 	if (transfer->actual_length == 0 || packet_has_error) {
 		devc->empty_transfer_count++;
-		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
+		if (devc->empty_transfer_count > 2 * (int)devc->xfer.count) {
 			/*
 			 * The FX2 gave up. End the acquisition, the frontend
 			 * will work out that the samplecount is short.
@@ -842,8 +856,18 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		 */
 		if (transfer->actual_length % (DSLOGIC_ATOMIC_BYTES * channel_count) != 0)
 			sr_err("Invalid transfer length!");
+		buf = std_session_buffer_get(sdi, DSLOGIC_ATOMIC_SAMPLES *
+			sizeof(uint16_t) * ((transfer->actual_length +
+			DSLOGIC_ATOMIC_BYTES * channel_count - 1) /
+			(DSLOGIC_ATOMIC_BYTES * channel_count)));
+		if (!buf) {
+			abort_acquisition(devc);
+			free_transfer(transfer);
+			return;
+		}
+		samples = sr_buffer_data_get(buf);
 		deinterleave_buffer(transfer->buffer, transfer->actual_length,
-			devc->deinterleave_buffer, channel_count, channel_mask);
+			samples, channel_count, channel_mask);
 
 		/* Send the incoming transfer to the session bus. */
 		if (devc->trigger_pos > devc->sent_samples
@@ -851,27 +875,36 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 			/* DSLogic trigger in this block. Send trigger position. */
 			trigger_offset = devc->trigger_pos - devc->sent_samples;
 			/* Pre-trigger samples. */
-			send_data(sdi, devc->deinterleave_buffer, trigger_offset);
+			send_data(sdi, buf, samples, trigger_offset);
 			devc->sent_samples += trigger_offset;
 			/* Trigger position. */
 			devc->trigger_pos = 0;
 			std_session_send_df_trigger(sdi);
 			/* Post trigger samples. */
 			num_samples -= trigger_offset;
-			send_data(sdi, devc->deinterleave_buffer
-				+ trigger_offset, num_samples);
+			send_data(sdi, buf, samples + trigger_offset,
+				num_samples);
 			devc->sent_samples += num_samples;
 		} else {
-			send_data(sdi, devc->deinterleave_buffer, num_samples);
+			send_data(sdi, buf, samples, num_samples);
 			devc->sent_samples += num_samples;
 		}
+		sr_buffer_unref(buf);
 	}
 
 	if (devc->limit_samples && devc->sent_samples >= devc->limit_samples) {
 		abort_acquisition(devc);
 		free_transfer(transfer);
-	} else
-		resubmit_transfer(transfer);
+		return;
+	}
+
+	num_transfers = sr_usb_xfer_params_completed(&devc->xfer,
+		transfer->actual_length);
+	resubmit_transfer(transfer);
+	while (num_transfers--) {
+		if (submit_transfer(sdi) != SR_OK)
+			break;
+	}
 }
 
 static int receive_data(int fd, int revents, void *cb_data)
@@ -905,93 +938,92 @@ static size_t to_bytes_per_ms(const struct sr_dev_inst *sdi)
 	return 35000000 / (1000 * 10);
 }
 
-static size_t get_buffer_size(const struct sr_dev_inst *sdi)
+static void setup_transfers(const struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
 	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of the size of a data atom.
+	 * Each transfer holds data for the latency target (10ms by
+	 * default) and is a multiple of the size of a data atom, all
+	 * transfers together hold about 100ms of data.
 	 */
-	const size_t block_size = enabled_channel_count(sdi) * 512;
-	const size_t s = 10 * to_bytes_per_ms(sdi);
-	if (!block_size)
-		return s;
-	return ((s + block_size - 1) / block_size) * block_size;
+	sr_usb_xfer_params_setup(&devc->xfer, to_bytes_per_ms(sdi),
+		enabled_channel_count(sdi) * 512, 100, NUM_SIMUL_TRANSFERS);
 }
 
-static unsigned int get_number_of_transfers(const struct sr_dev_inst *sdi)
+/*
+ * Allocate and submit another transfer. The transfers array provides
+ * space for the maximum number of transfers.
+ */
+static int submit_transfer(const struct sr_dev_inst *sdi)
 {
-	/* Total buffer size should be able to hold about 100ms of data. */
-	const unsigned int s = get_buffer_size(sdi);
-	const unsigned int n = (100 * to_bytes_per_ms(sdi) + s - 1) / s;
-	return (n > NUM_SIMUL_TRANSFERS) ? NUM_SIMUL_TRANSFERS : n;
-}
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct libusb_transfer *transfer;
+	unsigned int i;
+	int ret;
+	unsigned char *buf;
 
-static unsigned int get_timeout(const struct sr_dev_inst *sdi)
-{
-	const size_t total_size = get_buffer_size(sdi) *
-		get_number_of_transfers(sdi);
-	const unsigned int timeout = total_size / to_bytes_per_ms(sdi);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	if (devc->acq_aborted || !devc->transfers ||
+			devc->num_transfers >= devc->xfer.max_count)
+		return SR_ERR;
+
+	if (!(buf = g_try_malloc(devc->xfer.size))) {
+		sr_err("USB transfer buffer malloc failed.");
+		return SR_ERR_MALLOC;
+	}
+	transfer = libusb_alloc_transfer(0);
+	libusb_fill_bulk_transfer(transfer, usb->devhdl,
+			6 | LIBUSB_ENDPOINT_IN, buf, devc->xfer.size,
+			receive_transfer, (void *)sdi, devc->xfer.timeout_ms);
+	i = devc->num_transfers;
+	sr_info("submitting transfer: %u", i);
+	if ((ret = libusb_submit_transfer(transfer)) != 0) {
+		sr_err("Failed to submit transfer: %s.",
+		       libusb_error_name(ret));
+		libusb_free_transfer(transfer);
+		g_free(buf);
+		return SR_ERR;
+	}
+	devc->transfers[i] = transfer;
+	devc->num_transfers++;
+	devc->submitted_transfers++;
+
+	return SR_OK;
 }
 
 static int start_transfers(const struct sr_dev_inst *sdi)
 {
-	const size_t channel_count = enabled_channel_count(sdi);
-	const size_t size = get_buffer_size(sdi);
-	const unsigned int num_transfers = get_number_of_transfers(sdi);
-	const unsigned int timeout = get_timeout(sdi);
-
 	struct dev_context *devc;
-	struct sr_usb_dev_inst *usb;
-	struct libusb_transfer *transfer;
 	unsigned int i;
 	int ret;
-	unsigned char *buf;
 
 	devc = sdi->priv;
-	usb = sdi->conn;
 
 	devc->sent_samples = 0;
 	devc->acq_aborted = FALSE;
 	devc->empty_transfer_count = 0;
 	devc->submitted_transfers = 0;
+	devc->num_transfers = 0;
 
 	g_free(devc->transfers);
-	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
+	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) *
+		devc->xfer.max_count);
 	if (!devc->transfers) {
 		sr_err("USB transfers malloc failed.");
 		return SR_ERR_MALLOC;
 	}
 
-	devc->deinterleave_buffer = g_try_malloc(DSLOGIC_ATOMIC_SAMPLES *
-		(size / (channel_count * DSLOGIC_ATOMIC_BYTES)) * sizeof(uint16_t));
-	if (!devc->deinterleave_buffer) {
-		sr_err("Deinterleave buffer malloc failed.");
-		g_free(devc->deinterleave_buffer);
-		return SR_ERR_MALLOC;
-	}
-
-	devc->num_transfers = num_transfers;
-	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
-			sr_err("USB transfer buffer malloc failed.");
-			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl,
-				6 | LIBUSB_ENDPOINT_IN, buf, size,
-				receive_transfer, (void *)sdi, timeout);
-		sr_info("submitting transfer: %d", i);
-		if ((ret = libusb_submit_transfer(transfer)) != 0) {
-			sr_err("Failed to submit transfer: %s.",
-			       libusb_error_name(ret));
-			libusb_free_transfer(transfer);
-			g_free(buf);
+	for (i = 0; i < devc->xfer.count; i++) {
+		if ((ret = submit_transfer(sdi)) != SR_OK) {
 			abort_acquisition(devc);
-			return SR_ERR;
+			return ret;
 		}
-		devc->transfers[i] = transfer;
-		devc->submitted_transfers++;
 	}
 
 	std_session_send_df_header(sdi);
@@ -1028,8 +1060,6 @@ static void LIBUSB_CALL trigger_receive(struct libusb_transfer *transfer)
 
 SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 {
-	const unsigned int timeout = get_timeout(sdi);
-
 	struct sr_dev_driver *di;
 	struct drv_context *drvc;
 	struct dev_context *devc;
@@ -1048,7 +1078,9 @@ SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->empty_transfer_count = 0;
 	devc->acq_aborted = FALSE;
 
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	setup_transfers(sdi);
+	usb_source_add(sdi->session, devc->ctx, devc->xfer.timeout_ms,
+		receive_data, drvc);
 
 	if ((ret = command_stop_acquisition(sdi)) != SR_OK)
 		return ret;
@@ -36,7 +36,6 @@
 
 #define MAX_RENUM_DELAY_MS	3000
 #define NUM_SIMUL_TRANSFERS	32
-#define MAX_EMPTY_TRANSFERS	(NUM_SIMUL_TRANSFERS * 2)
 
 #define NUM_CHANNELS		16
 #define NUM_TRIGGER_STAGES	16
@@ -128,12 +127,11 @@ struct dev_context {
 	int submitted_transfers;
 	int empty_transfer_count;
 
+	struct sr_usb_xfer_params xfer;
 	unsigned int num_transfers;
 	struct libusb_transfer **transfers;
 	struct sr_context *ctx;
 
-	uint16_t *deinterleave_buffer;
-
 	uint16_t mode;
 	uint32_t trigger_pos;
 	gboolean external_clock;
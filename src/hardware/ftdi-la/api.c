@@ -148,8 +148,11 @@ static void scan_device(struct ftdi_context *ftdic,
 	vendor = g_malloc(usb_str_maxlen);
 	model = g_malloc(usb_str_maxlen);
 	serial_num = g_malloc(usb_str_maxlen);
+	/* Other FTDI based drivers may probe the device concurrently. */
+	sr_usb_scan_lock(dev);
 	rv = ftdi_usb_get_strings(ftdic, dev, vendor, usb_str_maxlen,
 			model, usb_str_maxlen, serial_num, usb_str_maxlen);
+	sr_usb_scan_unlock(dev);
 	switch (rv) {
 	case 0:
 		break;
@@ -275,7 +278,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	if (conn) {
 		devices = NULL;
-		libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+		sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 		for (i = 0; devlist[i]; i++) {
 			conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
 			for (l = conn_devices; l; l = l->next) {
@@ -132,6 +132,9 @@ static const uint32_t devopts[] = {
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_BUFFER_SIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_QUEUE_DEPTH | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_LATENCY | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const int32_t trigger_matches[] = {
@@ -230,7 +233,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all fx2lafw compatible devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -405,6 +408,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 static void clear_helper(struct dev_context *devc)
 {
 	g_slist_free(devc->enabled_analog_channels);
+	g_mutex_clear(&devc->transfers_mutex);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -538,6 +542,10 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_USB_BUFFER_SIZE:
+	case SR_CONF_USB_QUEUE_DEPTH:
+	case SR_CONF_USB_LATENCY:
+		return sr_usb_xfer_params_config_get(&devc->xfer, key, data);
 	default:
 		return SR_ERR_NA;
 	}
@@ -573,6 +581,10 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_USB_BUFFER_SIZE:
+	case SR_CONF_USB_QUEUE_DEPTH:
+	case SR_CONF_USB_LATENCY:
+		return sr_usb_xfer_params_config_set(&devc->xfer, key, data);
 	default:
 		return SR_ERR_NA;
 	}
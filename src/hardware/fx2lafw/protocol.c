@@ -23,6 +23,15 @@
 #include <glib/gstdio.h>
 #include "protocol.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || \
+	(defined(__i386__) && defined(__SSE2__)))
+#define DEINTERLEAVE_SIMD_X86 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define DEINTERLEAVE_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
 #pragma pack(push, 1)
 
 struct version_info {
@@ -264,6 +273,7 @@ SR_PRIV struct dev_context *fx2lafw_dev_new(void)
 	devc->sample_wide = FALSE;
 	devc->num_frames = 0;
 	devc->stl = NULL;
+	g_mutex_init(&devc->transfers_mutex);
 
 	return devc;
 }
@@ -274,15 +284,18 @@ SR_PRIV void fx2lafw_abort_acquisition(struct dev_context *devc)
 
 	devc->acq_aborted = TRUE;
 
+	g_mutex_lock(&devc->transfers_mutex);
 	for (i = devc->num_transfers - 1; i >= 0; i--) {
 		if (devc->transfers[i])
 			libusb_cancel_transfer(devc->transfers[i]);
 	}
+	g_mutex_unlock(&devc->transfers_mutex);
 }
 
 static void finish_acquisition(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
+	struct libusb_transfer **transfers;
 
 	devc = sdi->priv;
 
@@ -290,14 +303,12 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 
 	usb_source_remove(sdi->session, devc->ctx);
 
+	g_mutex_lock(&devc->transfers_mutex);
+	transfers = devc->transfers;
+	devc->transfers = NULL;
 	devc->num_transfers = 0;
-	g_free(devc->transfers);
-
-	/* Free the deinterlace buffers if we had them. */
-	if (g_slist_length(devc->enabled_analog_channels) > 0) {
-		g_free(devc->logic_buffer);
-		g_free(devc->analog_buffer);
-	}
+	g_mutex_unlock(&devc->transfers_mutex);
+	g_free(transfers);
 
 	if (devc->stl) {
 		soft_trigger_logic_free(devc->stl);
@@ -310,30 +321,42 @@ static void free_transfer(struct libusb_transfer *transfer)
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	unsigned int i;
+	gboolean finished;
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
 
-	g_free(transfer->buffer);
-	transfer->buffer = NULL;
-	libusb_free_transfer(transfer);
-
+	/* Untrack the transfer before it gets released. */
+	g_mutex_lock(&devc->transfers_mutex);
 	for (i = 0; i < devc->num_transfers; i++) {
 		if (devc->transfers[i] == transfer) {
 			devc->transfers[i] = NULL;
 			break;
 		}
 	}
-
 	devc->submitted_transfers--;
-	if (devc->submitted_transfers == 0)
+	finished = devc->submitted_transfers == 0;
+	g_mutex_unlock(&devc->transfers_mutex);
+
+	g_free(transfer->buffer);
+	transfer->buffer = NULL;
+	libusb_free_transfer(transfer);
+
+	if (finished)
 		finish_acquisition(sdi);
 }
 
 static void resubmit_transfer(struct libusb_transfer *transfer)
 {
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
 	int ret;
 
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	/* The timeout grows with the number of transfers. */
+	transfer->timeout = devc->xfer.timeout_ms;
 	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
 		return;
 
@@ -342,15 +365,54 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 
 }
 
+/*
+ * Split (logic, analog) byte pairs into separate logic and analog
+ * sample arrays. The SIMD paths handle 16 pairs at a time.
+ */
+static void deinterleave_mso(const uint8_t *data, size_t count,
+	uint8_t *logic, uint8_t *analog)
+{
+	size_t i;
+#if defined(DEINTERLEAVE_SIMD_X86)
+	__m128i a, b, mask;
+#elif defined(DEINTERLEAVE_SIMD_NEON)
+	uint8x16x2_t v;
+#endif
+
+	i = 0;
+#if defined(DEINTERLEAVE_SIMD_X86)
+	mask = _mm_set1_epi16(0x00ff);
+	for (; i + 16 <= count; i += 16) {
+		a = _mm_loadu_si128((const __m128i *)&data[2 * i]);
+		b = _mm_loadu_si128((const __m128i *)&data[2 * i + 16]);
+		_mm_storeu_si128((__m128i *)&logic[i], _mm_packus_epi16(
+			_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+		_mm_storeu_si128((__m128i *)&analog[i], _mm_packus_epi16(
+			_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+	}
+#elif defined(DEINTERLEAVE_SIMD_NEON)
+	for (; i + 16 <= count; i += 16) {
+		v = vld2q_u8(&data[2 * i]);
+		vst1q_u8(&logic[i], v.val[0]);
+		vst1q_u8(&analog[i], v.val[1]);
+	}
+#endif
+	for (; i < count; i++) {
+		logic[i] = data[2 * i];
+		analog[i] = data[2 * i + 1];
+	}
+}
+
 static void mso_send_data_proc(struct sr_dev_inst *sdi,
 	uint8_t *data, size_t length, size_t sample_width)
 {
-	size_t i;
 	struct dev_context *devc;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
+	struct sr_buffer *logic_buf, *analog_buf;
+	uint8_t *logic_data, *analog_data;
 
 	(void)sample_width;
 
@@ -358,40 +420,47 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 
 	length /= 2;
 
-	/* Send the logic */
-	for (i = 0; i < length; i++) {
-		devc->logic_buffer[i] = data[i * 2];
-		/* Rescale to -10V - +10V from 0-255. */
-		devc->analog_buffer[i] = (data[i * 2 + 1] - 128.0f) / 12.8f;
-	};
-
-	const struct sr_datafeed_logic logic = {
-		.length = length,
-		.unitsize = 1,
-		.data = devc->logic_buffer
-	};
+	/* The deinterlace buffers are recycled through the session's pool. */
+	logic_buf = std_session_buffer_get(sdi, length);
+	analog_buf = std_session_buffer_get(sdi, length);
+	if (!logic_buf || !analog_buf) {
+		sr_buffer_unref(logic_buf);
+		sr_buffer_unref(analog_buf);
+		return;
+	}
+	logic_data = sr_buffer_data_get(logic_buf);
+	analog_data = sr_buffer_data_get(analog_buf);
 
-	const struct sr_datafeed_packet logic_packet = {
-		.type = SR_DF_LOGIC,
-		.payload = &logic
-	};
+	deinterleave_mso(data, length, logic_data, analog_data);
 
-	sr_session_send(sdi, &logic_packet);
+	/* Send the logic */
+	std_session_send_logic_buffer(sdi, logic_buf, logic_data, length, 1);
+	sr_buffer_unref(logic_buf);
 
+	/*
+	 * Pass the raw analog bytes on. They cover -10V to +10V in steps
+	 * of 20V / 256, that's (x - 128) / 12.8 = x * 5 / 64 - 10.
+	 */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+	encoding.unitsize = sizeof(uint8_t);
+	encoding.is_float = FALSE;
+	encoding.is_signed = FALSE;
+	sr_rational_set(&encoding.scale, 5, 64);
+	sr_rational_set(&encoding.offset, -10, 1);
 	analog.meaning->channels = devc->enabled_analog_channels;
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0 /* SR_MQFLAG_DC */;
 	analog.num_samples = length;
-	analog.data = devc->analog_buffer;
+	analog.data = analog_data;
 
 	const struct sr_datafeed_packet analog_packet = {
 		.type = SR_DF_ANALOG,
 		.payload = &analog
 	};
 
-	sr_session_send(sdi, &analog_packet);
+	sr_session_send_buffer(sdi, &analog_packet, analog_buf);
+	sr_buffer_unref(analog_buf);
 }
 
 static void la_send_data_proc(struct sr_dev_inst *sdi,
@@ -411,12 +480,14 @@ static void la_send_data_proc(struct sr_dev_inst *sdi,
 	sr_session_send(sdi, &packet);
 }
 
+static int submit_transfer(const struct sr_dev_inst *sdi);
+
 static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	gboolean packet_has_error = FALSE;
-	unsigned int num_samples;
+	unsigned int num_samples, num_transfers;
 	int trigger_offset, cur_sample_count, unitsize, processed_samples;
 	int pre_trigger_samples;
 
@@ -455,7 +526,7 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 
 	if (transfer->actual_length == 0 || packet_has_error) {
 		devc->empty_transfer_count++;
-		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
+		if (devc->empty_transfer_count > 2 * (int)devc->xfer.count) {
 			/*
 			 * The FX2 gave up. End the acquisition, the frontend
 			 * will work out that the samplecount is short.
@@ -532,8 +603,16 @@ check_trigger:
 	if (frame_ended && final_frame) {
 		fx2lafw_abort_acquisition(devc);
 		free_transfer(transfer);
-	} else
-		resubmit_transfer(transfer);
+		return;
+	}
+
+	num_transfers = sr_usb_xfer_params_completed(&devc->xfer,
+		transfer->actual_length);
+	resubmit_transfer(transfer);
+	while (num_transfers--) {
+		if (submit_transfer(sdi) != SR_OK)
+			break;
+	}
 }
 
 static int configure_channels(const struct sr_dev_inst *sdi)
@@ -575,73 +654,105 @@ static unsigned int to_bytes_per_ms(unsigned int samplerate)
 	return samplerate / 1000;
 }
 
-static size_t get_buffer_size(struct dev_context *devc)
+static void setup_transfers(struct dev_context *devc)
 {
-	size_t s;
+	size_t unitsize;
 
 	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of 512.
+	 * Each transfer holds data for the latency target (10ms by
+	 * default), and all transfers together about 500ms of data.
 	 */
-	s = 10 * to_bytes_per_ms(devc->cur_samplerate);
-	return (s + 511) & ~511;
-}
-
-static unsigned int get_number_of_transfers(struct dev_context *devc)
-{
-	unsigned int n;
-
-	/* Total buffer size should be able to hold about 500ms of data. */
-	n = (500 * to_bytes_per_ms(devc->cur_samplerate) /
-		get_buffer_size(devc));
-
-	if (n > NUM_SIMUL_TRANSFERS)
-		return NUM_SIMUL_TRANSFERS;
-
-	return n;
-}
-
-static unsigned int get_timeout(struct dev_context *devc)
-{
-	size_t total_size;
-	unsigned int timeout;
-
-	total_size = get_buffer_size(devc) *
-			get_number_of_transfers(devc);
-	timeout = total_size / to_bytes_per_ms(devc->cur_samplerate);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
+	unitsize = devc->sample_wide ? 2 : 1;
+	sr_usb_xfer_params_setup(&devc->xfer,
+		unitsize * to_bytes_per_ms(devc->cur_samplerate), 512, 500,
+		NUM_SIMUL_TRANSFERS);
 }
 
 static int receive_data(int fd, int revents, void *cb_data)
 {
 	struct timeval tv;
-	struct drv_context *drvc;
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
 
 	(void)fd;
 	(void)revents;
 
-	drvc = (struct drv_context *)cb_data;
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	/* The USB event thread handles events, if there is one. */
+	if (usb_source_is_threaded(sdi->session, devc->ctx))
+		return TRUE;
 
 	tv.tv_sec = tv.tv_usec = 0;
-	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
+	libusb_handle_events_timeout(devc->ctx->libusb_ctx, &tv);
 
 	return TRUE;
 }
 
-static int start_transfers(const struct sr_dev_inst *sdi)
+/*
+ * Allocate and submit another transfer. The transfers array provides
+ * space for the maximum number of transfers.
+ */
+static int submit_transfer(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	struct sr_trigger *trigger;
 	struct libusb_transfer *transfer;
-	unsigned int i, num_transfers;
-	int timeout, ret;
+	unsigned int i;
 	unsigned char *buf;
-	size_t size;
+	int ret;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
 
+	if (!(buf = g_try_malloc(devc->xfer.size))) {
+		sr_err("USB transfer buffer malloc failed.");
+		return SR_ERR_MALLOC;
+	}
+	transfer = libusb_alloc_transfer(0);
+	libusb_fill_bulk_transfer(transfer, usb->devhdl,
+			2 | LIBUSB_ENDPOINT_IN, buf, devc->xfer.size,
+			receive_transfer, (void *)sdi, devc->xfer.timeout_ms);
+
+	g_mutex_lock(&devc->transfers_mutex);
+	if (devc->acq_aborted || !devc->transfers ||
+			devc->num_transfers >= devc->xfer.max_count) {
+		g_mutex_unlock(&devc->transfers_mutex);
+		libusb_free_transfer(transfer);
+		g_free(buf);
+		return SR_ERR;
+	}
+	i = devc->num_transfers++;
+	devc->transfers[i] = transfer;
+	devc->submitted_transfers++;
+	g_mutex_unlock(&devc->transfers_mutex);
+
+	sr_info("submitting transfer: %u", i);
+	if ((ret = libusb_submit_transfer(transfer)) != 0) {
+		sr_err("Failed to submit transfer: %s.",
+		       libusb_error_name(ret));
+		g_mutex_lock(&devc->transfers_mutex);
+		devc->transfers[i] = NULL;
+		devc->submitted_transfers--;
+		g_mutex_unlock(&devc->transfers_mutex);
+		libusb_free_transfer(transfer);
+		g_free(buf);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static int start_transfers(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_trigger *trigger;
+	unsigned int i;
+	int ret;
+
+	devc = sdi->priv;
+
 	devc->sent_samples = 0;
 	devc->acq_aborted = FALSE;
 	devc->empty_transfer_count = 0;
@@ -659,39 +770,20 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 		devc->trigger_fired = TRUE;
 	}
 
-	num_transfers = get_number_of_transfers(devc);
-
-	size = get_buffer_size(devc);
 	devc->submitted_transfers = 0;
-
-	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
+	devc->num_transfers = 0;
+	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) *
+		devc->xfer.max_count);
 	if (!devc->transfers) {
 		sr_err("USB transfers malloc failed.");
 		return SR_ERR_MALLOC;
 	}
 
-	timeout = get_timeout(devc);
-	devc->num_transfers = num_transfers;
-	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
-			sr_err("USB transfer buffer malloc failed.");
-			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl,
-				2 | LIBUSB_ENDPOINT_IN, buf, size,
-				receive_transfer, (void *)sdi, timeout);
-		sr_info("submitting transfer: %d", i);
-		if ((ret = libusb_submit_transfer(transfer)) != 0) {
-			sr_err("Failed to submit transfer: %s.",
-			       libusb_error_name(ret));
-			libusb_free_transfer(transfer);
-			g_free(buf);
+	for (i = 0; i < devc->xfer.count; i++) {
+		if ((ret = submit_transfer(sdi)) != SR_OK) {
 			fx2lafw_abort_acquisition(devc);
-			return SR_ERR;
+			return ret;
 		}
-		devc->transfers[i] = transfer;
-		devc->submitted_transfers++;
 	}
 
 	/*
@@ -714,8 +806,7 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 	struct sr_dev_driver *di;
 	struct drv_context *drvc;
 	struct dev_context *devc;
-	int timeout, ret;
-	size_t size;
+	int ret;
 
 	di = sdi->driver;
 	drvc = di->context;
@@ -732,17 +823,10 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
-	timeout = get_timeout(devc);
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	setup_transfers(devc);
+	usb_source_add_threaded(sdi->session, devc->ctx, devc->xfer.timeout_ms,
+		receive_data, (void *)sdi);
 
-	size = get_buffer_size(devc);
-	/* Prepare for analog sampling. */
-	if (g_slist_length(devc->enabled_analog_channels) > 0) {
-		/* We need a buffer half the size of a transfer. */
-		devc->logic_buffer = g_try_malloc(size / 2);
-		devc->analog_buffer = g_try_malloc(
-			sizeof(float) * size / 2);
-	}
 	start_transfers(sdi);
 	if ((ret = command_start_acquisition(sdi)) != SR_OK) {
 		fx2lafw_abort_acquisition(devc);
@@ -37,7 +37,6 @@
 
 #define MAX_RENUM_DELAY_MS	3000
 #define NUM_SIMUL_TRANSFERS	32
-#define MAX_EMPTY_TRANSFERS	(NUM_SIMUL_TRANSFERS * 2)
 
 #define NUM_CHANNELS		16
 
@@ -117,13 +116,14 @@ struct dev_context {
 	int submitted_transfers;
 	int empty_transfer_count;
 
+	struct sr_usb_xfer_params xfer;
 	unsigned int num_transfers;
 	struct libusb_transfer **transfers;
+	/* Transfer callbacks can run in the USB event thread. */
+	GMutex transfers_mutex;
 	struct sr_context *ctx;
 	void (*send_data_proc)(struct sr_dev_inst *sdi,
 		uint8_t *data, size_t length, size_t sample_width);
-	uint8_t *logic_buffer;
-	float *analog_buffer;
 };
 
 SR_PRIV int fx2lafw_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di);
@@ -40,6 +40,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_NUM_VDIV | SR_CONF_GET,
+	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
+	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t devopts_cg[] = {
@@ -47,6 +49,14 @@ static const uint32_t devopts_cg[] = {
 	SR_CONF_VDIV | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 };
 
+static const int32_t trigger_matches[] = {
+	SR_TRIGGER_RISING,
+	SR_TRIGGER_FALLING,
+	SR_TRIGGER_EDGE,
+	SR_TRIGGER_OVER,
+	SR_TRIGGER_UNDER,
+};
+
 static const char *channel_names[] = {
 	"CH1", "CH2",
 };
@@ -166,6 +176,7 @@ static struct sr_dev_inst *hantek_6xxx_dev_new(const struct hantek_6xxx_profile
 	devc->profile = prof;
 	devc->dev_state = IDLE;
 	devc->samplerate = DEFAULT_SAMPLERATE;
+	devc->capture_ratio = DEFAULT_CAPTURE_RATIO;
 
 	sdi->priv = devc;
 
@@ -198,6 +209,8 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 static void clear_helper(struct dev_context *devc)
 {
 	g_slist_free(devc->enabled_channels);
+	if (devc->sta)
+		soft_trigger_analog_free(devc->sta);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -238,7 +251,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		conn_devices = NULL;
 
 	/* Find all Hantek 60xx devices and upload firmware to all of them. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -393,6 +406,9 @@ static int config_get(uint32_t key, GVariant **data,
 		case SR_CONF_LIMIT_SAMPLES:
 			*data = g_variant_new_uint64(devc->limit_samples);
 			break;
+		case SR_CONF_CAPTURE_RATIO:
+			*data = g_variant_new_uint64(devc->capture_ratio);
+			break;
 		case SR_CONF_CONN:
 			if (!sdi->conn)
 				return SR_ERR_ARG;
@@ -447,6 +463,9 @@ static int config_set(uint32_t key, GVariant *data,
 		case SR_CONF_LIMIT_SAMPLES:
 			devc->limit_samples = g_variant_get_uint64(data);
 			break;
+		case SR_CONF_CAPTURE_RATIO:
+			devc->capture_ratio = g_variant_get_uint64(data);
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -494,6 +513,9 @@ static int config_list(uint32_t key, GVariant **data,
 		case SR_CONF_SAMPLERATE:
 			*data = std_gvar_samplerates(ARRAY_AND_SIZE(samplerates));
 			break;
+		case SR_CONF_TRIGGER_MATCH:
+			*data = std_gvar_array_i32(ARRAY_AND_SIZE(trigger_matches));
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -546,68 +568,109 @@ static uint32_t data_amount(const struct sr_dev_inst *sdi)
 	return data_left_2;
 }
 
-static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
+/*
+ * Send a chunk of samples to the session bus, or to the soft trigger while
+ * it has not fired yet. Returns the number of samples sent.
+ */
+static int send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 		int num_samples)
 {
 	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
+	struct sr_datafeed_analog analog[NUM_CHANNELS];
+	struct sr_analog_encoding encoding[NUM_CHANNELS];
+	struct sr_analog_meaning meaning[NUM_CHANNELS];
+	struct sr_analog_spec spec[NUM_CHANNELS];
+	const struct sr_datafeed_analog *block[NUM_CHANNELS];
 	struct dev_context *devc = sdi->priv;
 	GSList *channels = devc->enabled_channels;
+	const uint64_t *vdiv;
+	uint8_t *data, *d;
+	int num_block, trigger_offset, pre_trigger_samples, sent, ch, i;
 
-	const float ch_bit[] = { RANGE(0) / 255, RANGE(1) / 255 };
-	const float ch_center[] = { RANGE(0) / 2, RANGE(1) / 2 };
-
-	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
-
-	packet.type = SR_DF_ANALOG;
-	packet.payload = &analog;
-
-	analog.num_samples = num_samples;
-	analog.meaning->mq = SR_MQ_VOLTAGE;
-	analog.meaning->unit = SR_UNIT_VOLT;
-	analog.meaning->mqflags = 0;
-
-	analog.data = g_try_malloc(num_samples * sizeof(float));
-	if (!analog.data) {
+	data = g_try_malloc(num_samples * NUM_CHANNELS);
+	if (!data) {
 		sr_err("Analog data buffer malloc failed.");
 		devc->dev_state = STOPPING;
-		return;
+		return 0;
 	}
 
-	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+	/*
+	 * The device always sends data for both channels. If a channel
+	 * is disabled, it contains a copy of the enabled channel's
+	 * data. However, we only send the requested channels to
+	 * the bus.
+	 *
+	 * Voltage values are encoded as a value 0-255, where the
+	 * value is a point in the range represented by the vdiv
+	 * setting. There are 10 vertical divs, so e.g. 500mV/div
+	 * represents 5V peak-to-peak where 0 = -2.5V and 255 = +2.5V.
+	 * Pass the raw values on, with the matching scale and offset.
+	 */
+	num_block = 0;
+	for (ch = 0; ch < NUM_CHANNELS; ch++, channels = channels->next) {
 		if (!devc->ch_enabled[ch])
 			continue;
 
-		float vdivlog = log10f(ch_bit[ch]);
+		float vdivlog = log10f(RANGE(ch) / 255);
 		int digits = -(int)vdivlog + (vdivlog < 0.0);
-		analog.encoding->digits = digits;
-		analog.spec->spec_digits = digits;
-		analog.meaning->channels = g_slist_append(NULL, channels->data);
-
-		for (int i = 0; i < num_samples; i++) {
-			/*
-			 * The device always sends data for both channels. If a channel
-			 * is disabled, it contains a copy of the enabled channel's
-			 * data. However, we only send the requested channels to
-			 * the bus.
-			 *
-			 * Voltage values are encoded as a value 0-255, where the
-			 * value is a point in the range represented by the vdiv
-			 * setting. There are 10 vertical divs, so e.g. 500mV/div
-			 * represents 5V peak-to-peak where 0 = -2.5V and 255 = +2.5V.
-			 */
-			((float *)analog.data)[i] = ch_bit[ch] * *(buf + i * 2 + ch) - ch_center[ch];
-		}
+		sr_analog_init(&analog[num_block], &encoding[num_block],
+			&meaning[num_block], &spec[num_block], digits);
+		vdiv = devc->vdivs[devc->voltage[ch]];
+		encoding[num_block].unitsize = sizeof(uint8_t);
+		encoding[num_block].is_float = FALSE;
+		encoding[num_block].is_signed = FALSE;
+		sr_rational_set(&encoding[num_block].scale,
+			vdiv[0] * VDIV_MULTIPLIER, vdiv[1] * 255);
+		sr_rational_set(&encoding[num_block].offset,
+			-(int64_t)(vdiv[0] * VDIV_MULTIPLIER), vdiv[1] * 2);
+		meaning[num_block].mq = SR_MQ_VOLTAGE;
+		meaning[num_block].unit = SR_UNIT_VOLT;
+		meaning[num_block].mqflags = 0;
+		meaning[num_block].channels = g_slist_append(NULL, channels->data);
+
+		d = data + num_block * num_samples;
+		for (i = 0; i < num_samples; i++)
+			d[i] = buf[i * NUM_CHANNELS + ch];
+		analog[num_block].data = d;
+		analog[num_block].num_samples = num_samples;
+		block[num_block] = &analog[num_block];
+		num_block++;
+	}
 
-		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
+	sent = 0;
+	trigger_offset = 0;
+	if (devc->sta && !devc->trigger_fired && num_block) {
+		trigger_offset = soft_trigger_analog_check(devc->sta,
+			block, num_block, &pre_trigger_samples);
+		if (trigger_offset == -1) {
+			/* Not triggered yet, nothing to send. */
+			trigger_offset = num_samples;
+		} else if (trigger_offset < 0) {
+			sr_err("Soft trigger check failed.");
+			devc->dev_state = STOPPING;
+			trigger_offset = num_samples;
+		} else {
+			devc->trigger_fired = TRUE;
+			sent += pre_trigger_samples;
+		}
+	}
 
-		channels = channels->next;
+	packet.type = SR_DF_ANALOG;
+	for (i = 0; i < num_block; i++) {
+		if (trigger_offset < num_samples) {
+			analog[i].data = (uint8_t *)analog[i].data + trigger_offset;
+			analog[i].num_samples = num_samples - trigger_offset;
+			packet.payload = &analog[i];
+			sr_session_send(sdi, &packet);
+		}
+		g_slist_free(meaning[i].channels);
 	}
-	g_free(analog.data);
+	if (num_block)
+		sent += num_samples - trigger_offset;
+
+	g_free(data);
+
+	return sent;
 }
 
 /*
@@ -649,8 +712,7 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		return;
 
 	unsigned samples_received = transfer->actual_length / NUM_CHANNELS;
-	send_chunk(sdi, transfer->buffer, samples_received);
-	devc->samp_received += samples_received;
+	devc->samp_received += send_chunk(sdi, transfer->buffer, samples_received);
 
 	g_free(transfer->buffer);
 	libusb_free_transfer(transfer);
@@ -718,6 +780,11 @@ static int handle_event(int fd, int revents, void *cb_data)
 
 		std_session_send_df_end(sdi);
 
+		if (devc->sta) {
+			soft_trigger_analog_free(devc->sta);
+			devc->sta = NULL;
+		}
+
 		devc->dev_state = IDLE;
 
 		return TRUE;
@@ -731,6 +798,10 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	struct dev_context *devc;
 	struct sr_dev_driver *di = sdi->driver;
 	struct drv_context *drvc = di->context;
+	struct sr_trigger *trigger;
+	struct sr_channel *ch;
+	GSList *l;
+	int pre_trigger_samples;
 
 	devc = sdi->priv;
 
@@ -742,6 +813,26 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	if (hantek_6xxx_init(sdi) != SR_OK)
 		return SR_ERR;
 
+	/* Setup triggers */
+	if (devc->sta) {
+		soft_trigger_analog_free(devc->sta);
+		devc->sta = NULL;
+	}
+	if ((trigger = sr_session_trigger_get(sdi->session))) {
+		pre_trigger_samples = 0;
+		if (devc->limit_samples > 0)
+			pre_trigger_samples = (devc->capture_ratio * devc->limit_samples) / 100;
+		devc->sta = soft_trigger_analog_new(sdi, trigger, pre_trigger_samples);
+		/* Ignore noise of two LSB around the trigger level. */
+		for (l = sdi->channels; l; l = l->next) {
+			ch = l->data;
+			if (ch->index < NUM_CHANNELS)
+				soft_trigger_analog_set_hysteresis(devc->sta, ch,
+					2 * RANGE(ch->index) / 255);
+		}
+	}
+	devc->trigger_fired = FALSE;
+
 	std_session_send_df_header(sdi);
 
 	devc->samp_received = 0;
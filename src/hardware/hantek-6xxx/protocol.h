@@ -33,6 +33,7 @@
 #define DEFAULT_VOLTAGE		2
 #define DEFAULT_COUPLING	COUPLING_DC
 #define DEFAULT_SAMPLERATE	SR_MHZ(8)
+#define DEFAULT_CAPTURE_RATIO	10
 
 #define NUM_CHANNELS		2
 
@@ -145,6 +146,10 @@ struct dev_context {
 
 	uint64_t limit_msec;
 	uint64_t limit_samples;
+	uint64_t capture_ratio;
+
+	struct soft_trigger_analog *sta;
+	gboolean trigger_fired;
 };
 
 SR_PRIV int hantek_6xxx_open(struct sr_dev_inst *sdi);
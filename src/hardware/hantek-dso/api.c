@@ -294,7 +294,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		conn_devices = NULL;
 
 	/* Find all Hantek DSO devices and upload firmware to all of them. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
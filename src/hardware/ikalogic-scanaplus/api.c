@@ -57,13 +57,18 @@ static int dev_clear(const struct sr_dev_driver *di)
 
 static GSList *scan(struct sr_dev_driver *di, GSList *options)
 {
+	struct drv_context *drvc;
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
+	libusb_device **locked;
 	unsigned int i;
 	int ret;
 
 	(void)options;
 
+	drvc = di->context;
+	locked = NULL;
+
 	devc = g_malloc0(sizeof(struct dev_context));
 
 	/* Allocate memory for the incoming compressed samples. */
@@ -83,6 +88,9 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		goto err_free_sample_buf;
 	}
 
+	/* Other FTDI based drivers may probe the device concurrently. */
+	locked = sr_usb_scan_lock_vid_pid(drvc->sr_ctx,
+		USB_VENDOR_ID, USB_DEVICE_ID);
 	ret = ftdi_usb_open_desc(devc->ftdic, USB_VENDOR_ID, USB_DEVICE_ID,
 				 USB_IPRODUCT, NULL);
 	if (ret < 0) {
@@ -103,11 +111,13 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		sr_channel_new(sdi, i, SR_CHANNEL_LOGIC, TRUE, channel_names[i]);
 
 	scanaplus_close(devc);
+	sr_usb_scan_unlock_list(locked);
 
 	return std_scan_complete(di, g_slist_append(NULL, sdi));
 
 	scanaplus_close(devc);
 err_free_ftdic:
+	sr_usb_scan_unlock_list(locked);
 	ftdi_free(devc->ftdic);
 err_free_sample_buf:
 	g_free(devc->sample_buf);
@@ -479,7 +479,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devices = NULL;
 	found_devices = NULL;
 	renum_devices = NULL;
-	ret = libusb_get_device_list(ctx->libusb_ctx, &devlist);
+	ret = sr_usb_get_device_list(ctx, &devlist);
 	if (ret < 0) {
 		sr_err("Cannot get device list: %s.", libusb_error_name(ret));
 		return devices;
@@ -1075,6 +1075,15 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			sr_err("Cannot allocate buffer for session feed.");
 			return SR_ERR_MALLOC;
 		}
+		/* Pass the device's (value, repeat count) pairs on as is. */
+		if (!devc->continuous) {
+			ret = feed_queue_logic_rle_set(devc->feed_queue, TRUE);
+			if (ret != SR_OK) {
+				feed_queue_logic_free(devc->feed_queue);
+				devc->feed_queue = NULL;
+				return ret;
+			}
+		}
 		devc->transfer_size = xfersize;
 		devc->sequence_size = seqsize;
 		devc->packets_per_chunk = xfersize;
@@ -289,8 +289,9 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 {
 	struct drv_context *drvc;
 	struct sr_usb_dev_inst *usb;
-	struct sr_resource bitstream;
-	uint32_t bitstream_size;
+	GBytes *bitstream;
+	const uint8_t *bitstream_data;
+	size_t bitstream_size;
 	uint8_t buffer[sizeof(uint32_t)];
 	uint8_t *wrptr;
 	uint8_t block[4096];
@@ -304,20 +305,20 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 
 	sr_info("Uploading FPGA bitstream '%s'.", bitstream_fname);
 
-	ret = sr_resource_open(drvc->sr_ctx, &bitstream,
-		SR_RESOURCE_FIRMWARE, bitstream_fname);
-	if (ret != SR_OK) {
+	bitstream = sr_resource_get(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+		bitstream_fname, UINT32_MAX);
+	if (!bitstream) {
 		sr_err("Cannot find FPGA bitstream %s.", bitstream_fname);
-		return ret;
+		return SR_ERR;
 	}
+	bitstream_data = g_bytes_get_data(bitstream, &bitstream_size);
 
-	bitstream_size = (uint32_t)bitstream.size;
 	wrptr = buffer;
 	write_u32le_inc(&wrptr, bitstream_size);
 	ret = ctrl_out(sdi, CMD_FPGA_INIT, 0x00, 0, buffer, wrptr - buffer);
 	if (ret != SR_OK) {
 		sr_err("Cannot initiate FPGA bitstream upload.");
-		sr_resource_close(drvc->sr_ctx, &bitstream);
+		g_bytes_unref(bitstream);
 		return ret;
 	}
 	zero_pad_to = bitstream_size;
@@ -327,14 +328,9 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 
 	pos = 0;
 	while (1) {
-		if (pos < bitstream.size) {
-			len = (int)sr_resource_read(drvc->sr_ctx, &bitstream,
-				block, sizeof(block));
-			if (len < 0) {
-				sr_err("Cannot read FPGA bitstream.");
-				sr_resource_close(drvc->sr_ctx, &bitstream);
-				return SR_ERR_IO;
-			}
+		if (pos < bitstream_size) {
+			len = MIN(bitstream_size - pos, sizeof(block));
+			memcpy(block, &bitstream_data[pos], len);
 		} else {
 			/*  Zero-pad until 'zero_pad_to'. */
 			len = zero_pad_to - pos;
@@ -361,11 +357,10 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 		}
 		pos += len;
 	}
-	sr_resource_close(drvc->sr_ctx, &bitstream);
+	g_bytes_unref(bitstream);
 	if (ret != SR_OK)
 		return ret;
-	sr_info("FPGA bitstream upload (%" PRIu64 " bytes) done.",
-		bitstream.size);
+	sr_info("FPGA bitstream upload (%zu bytes) done.", bitstream_size);
 
 	return SR_OK;
 }
@@ -581,7 +576,7 @@ static void la2016_prepare_stream(const struct sr_dev_inst *sdi)
 			continue;
 		channel_mask = 1UL << ch->index;
 		stream->enabled_mask |= channel_mask;
-		stream->channel_masks[stream->enabled_count++] = channel_mask;
+		stream->channel_ids[stream->enabled_count++] = ch->index;
 	}
 	stream->channel_index = 0;
 }
@@ -1322,6 +1317,19 @@ static int la2016_start_download(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/* Submit a batch of decoded runs to the session feed. */
+static void send_runs(struct dev_context *devc,
+	const uint8_t *values, const size_t *counts, size_t run_count)
+{
+	size_t unitsize, idx;
+
+	unitsize = devc->model->channel_count / 8;
+	for (idx = 0; idx < run_count; idx++) {
+		feed_queue_logic_submit_one(devc->feed_queue,
+			&values[idx * unitsize], counts[idx]);
+	}
+}
+
 /*
  * A chunk of sample memory was received via USB. These chunks contain
  * transfers of 16 or 32 bytes each (model dependent size and layout).
@@ -1347,11 +1355,13 @@ static void send_chunk(struct sr_dev_inst *sdi,
 	const uint8_t *data_buffer, size_t data_length)
 {
 	struct dev_context *devc;
-	size_t num_xfers, num_pkts, num_seqs;
+	size_t num_xfers, num_pkts, unitsize;
 	const uint8_t *rp;
-	uint32_t sample_value;
-	size_t repetitions;
-	uint8_t sample_buff[sizeof(sample_value)];
+	uint8_t run_values[LA2016_RUN_BATCH * sizeof(uint32_t)];
+	size_t run_counts[LA2016_RUN_BATCH];
+	size_t run_count, idx, split;
+	uint64_t run_samples, chunk_samples, trigger_samples;
+	gboolean trigger_now;
 
 	devc = sdi->priv;
 
@@ -1374,43 +1384,61 @@ static void send_chunk(struct sr_dev_inst *sdi,
 	else
 		devc->n_bytes_to_read -= data_length;
 
-	/* Process the received chunk of capture data. */
-	sample_value = 0;
+	/*
+	 * Process the received chunk of capture data. Parse batches of
+	 * packets into a table of runs, then have the runs expanded into
+	 * the session feed. The sampled pin values are little endian on
+	 * the wire as well as in the session feed, and need no conversion.
+	 * Check for the trigger position once per batch, and update the
+	 * sample count limits once per chunk.
+	 */
+	unitsize = devc->model->channel_count / 8;
 	rp = data_buffer;
 	num_xfers = data_length / devc->transfer_size;
-	while (num_xfers--) {
-		num_pkts = devc->packets_per_chunk;
-		while (num_pkts--) {
-
-			if (devc->model->channel_count == 32)
-				sample_value = read_u32le_inc(&rp);
-			else if (devc->model->channel_count == 16)
-				sample_value = read_u16le_inc(&rp);
-			repetitions = read_u8_inc(&rp);
-
-			devc->total_samples += repetitions;
-
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit_one(devc->feed_queue,
-				sample_buff, repetitions);
-			sr_sw_limits_update_samples_read(&devc->sw_limits,
-				repetitions);
-
-			if (devc->trigger_involved && !devc->trigger_marked) {
-				if (!--devc->n_reps_until_trigger) {
-					feed_queue_logic_send_trigger(devc->feed_queue);
-					devc->trigger_marked = TRUE;
-					sr_dbg("Trigger position after %" PRIu64 " samples, %.6fms.",
-						devc->total_samples,
-						(double)devc->total_samples / devc->samplerate * 1e3);
-				}
+	chunk_samples = 0;
+	while (num_xfers) {
+		run_count = 0;
+		run_samples = 0;
+		while (num_xfers && run_count + devc->packets_per_chunk <= LA2016_RUN_BATCH) {
+			num_pkts = devc->packets_per_chunk;
+			while (num_pkts--) {
+				memcpy(&run_values[run_count * unitsize], rp, unitsize);
+				rp += unitsize;
+				run_counts[run_count] = read_u8_inc(&rp);
+				run_samples += run_counts[run_count];
+				run_count++;
+			}
+			/* Skip the sequence number bytes. */
+			rp += devc->sequence_size;
+			num_xfers--;
+		}
+
+		split = run_count;
+		trigger_now = FALSE;
+		if (devc->trigger_involved && !devc->trigger_marked) {
+			if (devc->n_reps_until_trigger <= run_count) {
+				split = devc->n_reps_until_trigger;
+				trigger_now = TRUE;
 			}
+			devc->n_reps_until_trigger -= split;
 		}
-		/* Skip the sequence number bytes. */
-		num_seqs = devc->sequence_size;
-		while (num_seqs--)
-			(void)read_u8_inc(&rp);
+		if (trigger_now) {
+			send_runs(devc, run_values, run_counts, split);
+			trigger_samples = devc->total_samples + chunk_samples;
+			for (idx = 0; idx < split; idx++)
+				trigger_samples += run_counts[idx];
+			feed_queue_logic_send_trigger(devc->feed_queue);
+			devc->trigger_marked = TRUE;
+			sr_dbg("Trigger position after %" PRIu64 " samples, %.6fms.",
+				trigger_samples,
+				(double)trigger_samples / devc->samplerate * 1e3);
+		}
+		send_runs(devc, &run_values[split * unitsize],
+			&run_counts[split], run_count - split);
+		chunk_samples += run_samples;
 	}
+	devc->total_samples += chunk_samples;
+	sr_sw_limits_update_samples_read(&devc->sw_limits, chunk_samples);
 
 	/*
 	 * Check for several conditions which shall terminate the
@@ -1452,23 +1480,22 @@ static void send_chunk(struct sr_dev_inst *sdi,
  * Implementor's note: This routine is inspired by convert_sample_data()
  * in the https://github.com/AlexUg/sigrok implementation. Which in turn
  * appears to have been derived from the saleae-logic16 sigrok driver.
- * The code is phrased conservatively to verify the layout as discussed
- * above, performance was not a priority. Operation was verified with an
- * LA2016 device. The LA5032 reportedly shares the 16 samples per channel
- * layout, just round-robins through a potentially larger set of enabled
- * channels before returning to the first of the channels.
+ * The per channel entities form a bit matrix which gets transposed when
+ * all channels were seen. Operation was verified with an LA2016 device.
+ * The LA5032 reportedly shares the 16 samples per channel layout, just
+ * round-robins through a potentially larger set of enabled channels
+ * before returning to the first of the channels.
  */
 static void stream_data(struct sr_dev_inst *sdi,
 	const uint8_t *data_buffer, size_t data_length)
 {
 	struct dev_context *devc;
 	struct stream_state_t *stream;
-	size_t bit_count;
+	size_t bit_count, unitsize;
 	const uint8_t *rp;
-	uint32_t sample_value;
-	uint8_t sample_buff[sizeof(sample_value)];
+	uint16_t samples_lo[16], samples_hi[16];
+	uint8_t sample_buff[16 * sizeof(uint32_t)];
 	size_t bit_idx;
-	uint32_t ch_mask;
 
 	devc = sdi->priv;
 	stream = &devc->stream;
@@ -1484,19 +1511,17 @@ static void stream_data(struct sr_dev_inst *sdi,
 	/* All channels' chunks carry 16 samples for one channel. */
 	bit_count = 16;
 	data_length /= sizeof(uint16_t);
+	unitsize = devc->model->channel_count / 8;
 
+	/*
+	 * Collect the entities as rows of a bit matrix, indexed by the
+	 * channel number. Rows of disabled channels remain all zero.
+	 * Transposing the matrix yields the samples.
+	 */
 	rp = data_buffer;
-	sample_value = 0;
 	while (data_length--) {
-		/* Get another entity. */
-		sample_value = read_u16le_inc(&rp);
-
-		/* Map the entity's bits to a channel's samples. */
-		ch_mask = stream->channel_masks[stream->channel_index];
-		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			if (sample_value & (1UL << bit_idx))
-				stream->sample_data[bit_idx] |= ch_mask;
-		}
+		stream->channel_rows[stream->channel_ids[stream->channel_index]] =
+			read_u16le_inc(&rp);
 
 		/*
 		 * Advance to the next channel. Submit a block of
@@ -1505,15 +1530,23 @@ static void stream_data(struct sr_dev_inst *sdi,
 		stream->channel_index++;
 		if (stream->channel_index != stream->enabled_count)
 			continue;
+		sr_transpose_16x16(samples_lo, &stream->channel_rows[0]);
+		if (unitsize > sizeof(uint16_t))
+			sr_transpose_16x16(samples_hi, &stream->channel_rows[16]);
 		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			sample_value = stream->sample_data[bit_idx];
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit_one(devc->feed_queue,
-				sample_buff, 1);
+			if (unitsize > sizeof(uint16_t)) {
+				write_u32le(&sample_buff[bit_idx * unitsize],
+					samples_lo[bit_idx] |
+					(uint32_t)samples_hi[bit_idx] << 16);
+			} else {
+				write_u16le(&sample_buff[bit_idx * unitsize],
+					samples_lo[bit_idx]);
+			}
 		}
+		feed_queue_logic_submit_many(devc->feed_queue,
+			sample_buff, bit_count);
 		sr_sw_limits_update_samples_read(&devc->sw_limits, bit_count);
 		devc->total_samples += bit_count;
-		memset(stream->sample_data, 0, sizeof(stream->sample_data));
 		stream->channel_index = 0;
 	}
 
@@ -1868,21 +1901,41 @@ SR_PRIV int la2016_identify_device(const struct sr_dev_inst *sdi,
 SR_PRIV int la2016_init_hardware(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	const char *bitstream_fn;
+	struct drv_context *drvc;
+	const char *bitstream_fn, *connid;
+	char *device_id;
 	int ret;
 	uint16_t state;
 
 	devc = sdi->priv;
+	drvc = sdi->driver->context;
 	bitstream_fn = devc ? devc->fpga_bitstream : "";
 
+	/*
+	 * Operational registers don't tell which bitstream is running.
+	 * Upload when the file changed since it was last uploaded.
+	 */
+	connid = sr_dev_inst_connid_get(sdi);
+	device_id = NULL;
+	if (connid)
+		device_id = g_strdup_printf("%s/%s", sdi->driver->name, connid);
 	ret = check_fpga_bitstream(sdi);
+	if (ret == SR_OK && sr_resource_upload_check(drvc->sr_ctx, device_id,
+			SR_RESOURCE_FIRMWARE, bitstream_fn) == SR_ERR_DATA) {
+		sr_info("FPGA bitstream file changed, uploading again.");
+		ret = SR_ERR_DATA;
+	}
 	if (ret != SR_OK) {
 		ret = upload_fpga_bitstream(sdi, bitstream_fn);
 		if (ret != SR_OK) {
 			sr_err("Cannot upload FPGA bitstream.");
+			g_free(device_id);
 			return ret;
 		}
+		sr_resource_upload_done(drvc->sr_ctx, device_id,
+			SR_RESOURCE_FIRMWARE, bitstream_fn);
 	}
+	g_free(device_id);
 	ret = enable_fpga_bitstream(sdi);
 	if (ret != SR_OK) {
 		sr_err("Cannot enable FPGA bitstream after upload.");
@@ -80,8 +80,10 @@ static const uint64_t samplerates[] = {
 
 static GSList *scan(struct sr_dev_driver *di, GSList *options)
 {
+	struct drv_context *drvc;
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
+	libusb_device **locked;
 	GSList *devices;
 	int ret, i;
 	char buf[70];
@@ -89,7 +91,9 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	(void)options;
 
+	drvc = di->context;
 	devices = NULL;
+	locked = NULL;
 
 	devc = g_malloc0(sizeof(struct dev_context));
 
@@ -107,6 +111,9 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		goto err_free_ftdi_buf;;
 	}
 
+	/* Other FTDI based drivers may probe the device concurrently. */
+	locked = sr_usb_scan_lock_vid_pid(drvc->sr_ctx,
+		USB_VENDOR_ID, USB_DEVICE_ID);
 	if (p_ols_open(devc) != SR_OK)
 		goto err_free_ftdic;
 
@@ -160,6 +167,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 
 	p_ols_close(devc);
+	sr_usb_scan_unlock_list(locked);
 
 	/* Parse the metadata. */
 	sdi = p_ols_get_metadata((uint8_t *)buf, bytes_read, devc);
@@ -176,6 +184,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 err_close_ftdic:
 	p_ols_close(devc);
 err_free_ftdic:
+	sr_usb_scan_unlock_list(locked);
 	ftdi_free(devc->ftdic);
 err_free_ftdi_buf:
 	g_free(devc->ftdi_buf);
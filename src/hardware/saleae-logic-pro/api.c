@@ -190,7 +190,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (unsigned int i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
 
@@ -42,6 +42,8 @@
 #define REG_LED_BLUE		0x11
 #define REG_STATUS		0x40
 
+#define BITSTREAM_NAME		"saleae-logicpro16-fpga.bitstream"
+
 static void iterate_lfsr(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc = sdi->priv;
@@ -492,17 +494,19 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 			    const char *name)
 {
 	struct drv_context *drvc = sdi->driver->context;
-	unsigned char *bitstream = NULL;
+	GBytes *bitstream;
+	const uint8_t *bs_data;
 	uint8_t req[2];
 	uint8_t rsp[1];
 	uint8_t reg_val;
 	int ret = SR_ERR;
 	size_t bs_size, bs_offset = 0, bs_part_size;
 
-	bitstream = sr_resource_load(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
-				     name, &bs_size, 512 * 1024);
+	bitstream = sr_resource_get(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+				    name, 512 * 1024);
 	if (!bitstream)
-		goto out;
+		return SR_ERR;
+	bs_data = g_bytes_get_data(bitstream, &bs_size);
 
 	sr_info("Uploading bitstream '%s'.", name);
 
@@ -511,7 +515,7 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 
 	ret = transact(sdi, req, sizeof(req), rsp, sizeof(rsp));
 	if (ret != SR_OK)
-		return ret;
+		goto out;
 	if (rsp[0] != 0x00) {
 		sr_err("Failed to start bitstream upload (0x%02x).", rsp[0]);
 		ret = SR_ERR;
@@ -521,7 +525,7 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 	while (bs_offset < bs_size) {
 		bs_part_size = MIN(bs_size - bs_offset, 1020);
 		sr_spew("Uploading %zd bytes.", bs_part_size);
-		ret = upload_bitstream_part(sdi, bitstream + bs_offset, bs_part_size);
+		ret = upload_bitstream_part(sdi, bs_data + bs_offset, bs_part_size);
 		if (ret != SR_OK)
 			goto out;
 		bs_offset += bs_part_size;
@@ -543,7 +547,7 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 	}
 
  out:
-	g_free(bitstream);
+	g_bytes_unref(bitstream);
 
 	return ret;
 }
@@ -590,6 +594,9 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 
 SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi)
 {
+	struct drv_context *drvc = sdi->driver->context;
+	const char *connid;
+	char *device_id;
 	uint8_t reg_val;
 	uint8_t dummy[8];
 	uint8_t serial[8];
@@ -610,17 +617,33 @@ SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi)
 	if (ret != SR_OK)
 		return ret;
 
-	/* Check if we need to upload the bitstream. */
+	/*
+	 * Check if we need to upload the bitstream. The scratch register
+	 * tells that a bitstream runs, but not whether the file changed
+	 * since it was uploaded.
+	 */
+	connid = sr_dev_inst_connid_get(sdi);
+	device_id = NULL;
+	if (connid)
+		device_id = g_strdup_printf("%s/%s", sdi->driver->name, connid);
 	ret = read_reg(sdi, 0x7f, &reg_val);
-	if (ret != SR_OK)
+	if (ret != SR_OK) {
+		g_free(device_id);
 		return ret;
-	if (reg_val == 0xaa) {
+	}
+	if (reg_val == 0xaa && sr_resource_upload_check(drvc->sr_ctx,
+			device_id, SR_RESOURCE_FIRMWARE, BITSTREAM_NAME) != SR_ERR_DATA) {
 		sr_info("Skipping bitstream upload.");
 	} else {
-		ret = upload_bitstream(sdi, "saleae-logicpro16-fpga.bitstream");
-		if (ret != SR_OK)
+		ret = upload_bitstream(sdi, BITSTREAM_NAME);
+		if (ret != SR_OK) {
+			g_free(device_id);
 			return ret;
+		}
+		sr_resource_upload_done(drvc->sr_ctx, device_id,
+			SR_RESOURCE_FIRMWARE, BITSTREAM_NAME);
 	}
+	g_free(device_id);
 
 	/* Reset the ADC? */
 	sr_dbg("reset ADC");
@@ -170,7 +170,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all Logic16 devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
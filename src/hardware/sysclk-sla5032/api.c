@@ -169,7 +169,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 
 	/* List all libusb devices. */
-	num_devs = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	num_devs = sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	if (num_devs < 0) {
 		sr_err("Failed to list USB devices: %s.",
 			libusb_error_name(num_devs));
@@ -191,7 +191,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devices = NULL;
 
 	/* Find all ZEROPLUS analyzers and add them to device list. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist); /* TODO: Errors. */
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist); /* TODO: Errors. */
 	for (i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
 
@@ -0,0 +1,553 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#ifdef HAVE_LIBUSB_1_0
+#include <libusb.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "hotplug"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Incremental device discovery.
+ *
+ * The hotplug monitor watches for USB devices and serial ports which
+ * appear after it was started, and probes only these with the drivers.
+ * USB arrivals are reported by libusb's hotplug callbacks. Serial ports
+ * have no portable notification mechanism, the monitor compares the
+ * port list against the previous one instead. Listing ports is cheap,
+ * probing them is what takes time.
+ *
+ * The monitor thread only collects events. USB notifications arrive on
+ * a libusb context of its own, which keeps the thread away from the
+ * transfers of running acquisitions. Probing and the callbacks happen
+ * in the application's main context.
+ */
+
+/**
+ * @defgroup grp_hotplug Hotplug
+ *
+ * Incremental device discovery.
+ *
+ * @{
+ */
+
+#if defined(HAVE_LIBUSB_1_0) && (LIBUSB_API_VERSION >= 0x01000102)
+#define HAVE_USB_HOTPLUG 1
+#endif
+
+/* Wakeup interval of the monitor thread. */
+#define HOTPLUG_POLL_MS		100
+/* Interval between serial port list comparisons. */
+#define HOTPLUG_SERIAL_POLL_MS	1000
+
+struct hotplug_event {
+	enum sr_hotplug_event type;
+	gboolean is_usb;
+	/* How to address the port in a scan (SR_CONF_CONN). */
+	char *conn;
+	/* How the port shows up in sr_dev_inst_connid_get(). */
+	char *connection_id;
+};
+
+/* A device which was reported as added. */
+struct hotplug_device {
+	struct sr_dev_inst *sdi;
+	char *connection_id;
+};
+
+struct sr_hotplug_monitor {
+	struct sr_context *ctx;
+	struct sr_dev_driver **drivers;
+	sr_hotplug_callback cb;
+	void *cb_data;
+	GThread *thread;
+	GAsyncQueue *queue;
+	/* Drains the queue in the main context of the caller. */
+	GMainContext *main_context;
+	GSource *source;
+	gint quit;
+	GSList *devices;
+#ifdef HAVE_USB_HOTPLUG
+	libusb_context *usb_ctx;
+	gboolean usb_registered;
+	libusb_hotplug_callback_handle usb_handle;
+#endif
+#ifdef HAVE_SERIAL_COMM
+	GSList *serial_ports;
+	gint64 serial_due;
+#endif
+};
+
+static struct hotplug_event *event_new(enum sr_hotplug_event type,
+		gboolean is_usb, const char *conn, const char *connection_id)
+{
+	struct hotplug_event *ev;
+
+	ev = g_malloc0(sizeof(*ev));
+	ev->type = type;
+	ev->is_usb = is_usb;
+	ev->conn = g_strdup(conn);
+	ev->connection_id = g_strdup(connection_id);
+
+	return ev;
+}
+
+static void event_free(struct hotplug_event *ev)
+{
+	g_free(ev->conn);
+	g_free(ev->connection_id);
+	g_free(ev);
+}
+
+/* Queue an event, and wake up the main context to handle it. */
+static void event_push(struct sr_hotplug_monitor *mon,
+		struct hotplug_event *ev)
+{
+	g_async_queue_push(mon->queue, ev);
+	g_source_set_ready_time(mon->source, 0);
+}
+
+static void device_free(struct hotplug_device *dev)
+{
+	g_free(dev->connection_id);
+	g_free(dev);
+}
+
+static struct hotplug_device *device_find(struct sr_hotplug_monitor *mon,
+		const char *connection_id)
+{
+	struct hotplug_device *dev;
+	GSList *l;
+
+	for (l = mon->devices; l; l = l->next) {
+		dev = l->data;
+		if (strcmp(dev->connection_id, connection_id) == 0)
+			return dev;
+	}
+
+	return NULL;
+}
+
+/*
+ * Check whether a driver may be able to talk to a port. USB drivers
+ * accept a conn but no serialcomm, serial drivers accept both.
+ */
+static gboolean driver_accepts(struct sr_dev_driver *driver, gboolean is_usb)
+{
+	GArray *opts;
+	gboolean has_conn, has_serialcomm;
+	uint32_t key;
+	guint i;
+
+	if (!driver->context)
+		return FALSE;
+	if (!(opts = sr_driver_scan_options_list(driver)))
+		return FALSE;
+
+	has_conn = has_serialcomm = FALSE;
+	for (i = 0; i < opts->len; i++) {
+		key = g_array_index(opts, uint32_t, i);
+		if (key == SR_CONF_CONN)
+			has_conn = TRUE;
+		else if (key == SR_CONF_SERIALCOMM)
+			has_serialcomm = TRUE;
+	}
+	g_array_free(opts, TRUE);
+
+	if (!has_conn)
+		return FALSE;
+
+	return is_usb ? !has_serialcomm : has_serialcomm;
+}
+
+static void port_added(struct sr_hotplug_monitor *mon, struct hotplug_event *ev)
+{
+	struct sr_dev_driver *driver;
+	struct hotplug_device *dev;
+	struct sr_config *src;
+	GSList *options, *devices, *l;
+	size_t i;
+
+	/*
+	 * Devices which renumerate after a firmware upload reappear at
+	 * the same port, and are known already.
+	 */
+	if (device_find(mon, ev->connection_id))
+		return;
+
+	src = sr_config_new(SR_CONF_CONN, g_variant_new_string(ev->conn));
+	options = g_slist_append(NULL, src);
+
+	/* The first driver which finds devices on a port gets it. */
+	devices = NULL;
+	for (i = 0; mon->drivers[i] && !devices; i++) {
+		driver = mon->drivers[i];
+		if (!driver_accepts(driver, ev->is_usb))
+			continue;
+		sr_dbg("Probing %s on %s.", driver->name, ev->conn);
+		devices = sr_driver_scan(driver, options);
+	}
+
+	g_slist_free_full(options, (GDestroyNotify)sr_config_free);
+
+	for (l = devices; l; l = l->next) {
+		dev = g_malloc0(sizeof(*dev));
+		dev->sdi = l->data;
+		dev->connection_id = g_strdup(ev->connection_id);
+		mon->devices = g_slist_append(mon->devices, dev);
+		sr_info("Device added on %s.", ev->conn);
+		mon->cb(dev->sdi, SR_HOTPLUG_ADDED, mon->cb_data);
+	}
+	g_slist_free(devices);
+}
+
+static void port_removed(struct sr_hotplug_monitor *mon,
+		struct hotplug_event *ev)
+{
+	struct hotplug_device *dev;
+
+	while ((dev = device_find(mon, ev->connection_id))) {
+		/* Renumerating after a firmware upload, not gone. */
+		if (dev->sdi->status == SR_ST_INITIALIZING)
+			return;
+		mon->devices = g_slist_remove(mon->devices, dev);
+		sr_info("Device removed from %s.", ev->conn);
+		mon->cb(dev->sdi, SR_HOTPLUG_REMOVED, mon->cb_data);
+		device_free(dev);
+	}
+}
+
+#ifdef HAVE_USB_HOTPLUG
+/* Runs in the monitor thread, the main context probes the port. */
+static int LIBUSB_CALL usb_hotplug_cb(libusb_context *usb_ctx,
+		libusb_device *device, libusb_hotplug_event event, void *user_data)
+{
+	struct sr_hotplug_monitor *mon;
+	enum sr_hotplug_event type;
+	char conn[16], connection_id[64];
+
+	(void)usb_ctx;
+
+	mon = user_data;
+	if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED)
+		type = SR_HOTPLUG_ADDED;
+	else if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT)
+		type = SR_HOTPLUG_REMOVED;
+	else
+		return 0;
+
+	if (usb_get_port_path(device, connection_id, sizeof(connection_id)) < 0)
+		return 0;
+	snprintf(conn, sizeof(conn), "%d.%d", libusb_get_bus_number(device),
+		libusb_get_device_address(device));
+
+	event_push(mon, event_new(type, TRUE, conn, connection_id));
+
+	return 0;
+}
+
+static void usb_hotplug_start(struct sr_hotplug_monitor *mon)
+{
+	int ret;
+
+	if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+		sr_info("libusb lacks hotplug support, not watching USB.");
+		return;
+	}
+
+	ret = libusb_init(&mon->usb_ctx);
+	if (ret != LIBUSB_SUCCESS) {
+		sr_err("Failed to initialize USB hotplug context: %s.",
+			libusb_error_name(ret));
+		mon->usb_ctx = NULL;
+		return;
+	}
+
+	ret = libusb_hotplug_register_callback(mon->usb_ctx,
+		LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+		LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, 0,
+		LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+		LIBUSB_HOTPLUG_MATCH_ANY, usb_hotplug_cb, mon,
+		&mon->usb_handle);
+	if (ret != LIBUSB_SUCCESS) {
+		sr_err("Failed to register USB hotplug callback: %s.",
+			libusb_error_name(ret));
+		return;
+	}
+	mon->usb_registered = TRUE;
+}
+
+static void usb_hotplug_stop(struct sr_hotplug_monitor *mon)
+{
+	if (mon->usb_registered)
+		libusb_hotplug_deregister_callback(mon->usb_ctx,
+			mon->usb_handle);
+	mon->usb_registered = FALSE;
+	if (mon->usb_ctx)
+		libusb_exit(mon->usb_ctx);
+	mon->usb_ctx = NULL;
+}
+#endif
+
+#ifdef HAVE_SERIAL_COMM
+static gint find_port(gconstpointer a, gconstpointer b)
+{
+	return strcmp(a, b);
+}
+
+/* Queue events for the differences to the previous port list. */
+static void serial_poll(struct sr_hotplug_monitor *mon, gboolean quiet)
+{
+	GSList *ports, *l;
+
+	ports = sr_serial_list_ports();
+
+	if (!quiet) {
+		for (l = ports; l; l = l->next) {
+			if (g_slist_find_custom(mon->serial_ports, l->data, find_port))
+				continue;
+			event_push(mon, event_new(SR_HOTPLUG_ADDED,
+				FALSE, l->data, l->data));
+		}
+		for (l = mon->serial_ports; l; l = l->next) {
+			if (g_slist_find_custom(ports, l->data, find_port))
+				continue;
+			event_push(mon, event_new(SR_HOTPLUG_REMOVED,
+				FALSE, l->data, l->data));
+		}
+	}
+
+	g_slist_free_full(mon->serial_ports, g_free);
+	mon->serial_ports = ports;
+	mon->serial_due = g_get_monotonic_time() + HOTPLUG_SERIAL_POLL_MS * 1000;
+}
+#endif
+
+static gboolean hotplug_source_dispatch(GSource *source,
+		GSourceFunc callback, gpointer user_data)
+{
+	g_source_set_ready_time(source, -1);
+
+	return callback(user_data);
+}
+
+static GSourceFuncs hotplug_source_funcs = {
+	.dispatch = hotplug_source_dispatch,
+};
+
+/* Probe and report the queued ports, runs in the main context. */
+static gboolean hotplug_events_handle(gpointer data)
+{
+	struct sr_hotplug_monitor *mon;
+	struct hotplug_event *ev;
+
+	mon = data;
+
+	while ((ev = g_async_queue_try_pop(mon->queue))) {
+		if (ev->type == SR_HOTPLUG_ADDED)
+			port_added(mon, ev);
+		else
+			port_removed(mon, ev);
+		event_free(ev);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gpointer hotplug_thread(gpointer data)
+{
+	struct sr_hotplug_monitor *mon;
+#ifdef HAVE_USB_HOTPLUG
+	struct timeval tv;
+#endif
+
+	mon = data;
+
+	while (!g_atomic_int_get(&mon->quit)) {
+#ifdef HAVE_USB_HOTPLUG
+		if (mon->usb_registered) {
+			tv.tv_sec = 0;
+			tv.tv_usec = HOTPLUG_POLL_MS * 1000;
+			libusb_handle_events_timeout_completed(mon->usb_ctx,
+				&tv, &mon->quit);
+		} else {
+			g_usleep(HOTPLUG_POLL_MS * 1000);
+		}
+#else
+		g_usleep(HOTPLUG_POLL_MS * 1000);
+#endif
+#ifdef HAVE_SERIAL_COMM
+		if (g_get_monotonic_time() >= mon->serial_due)
+			serial_poll(mon, FALSE);
+#endif
+	}
+
+	return NULL;
+}
+
+/**
+ * Start watching for devices which get connected.
+ *
+ * USB devices and serial ports which appear after the monitor was
+ * started get probed with the drivers, and the callback is invoked for
+ * each device which was found. When a port disappears, the callback is
+ * invoked for the devices which were found on it. Devices which were
+ * present before don't get reported, use sr_driver_scan() for them.
+ *
+ * Ports get probed and the callback runs in the main context which was
+ * the thread default one of the caller, so the application's main loop
+ * needs to run for devices to get reported. The device instances
+ * belong to their drivers as if they were found by sr_driver_scan(),
+ * and remain valid after removal until the driver's instances get
+ * cleared.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ * @param drivers NULL terminated array of drivers to probe with, NULL
+ *                selects all drivers. Drivers which were not initialized
+ *                with sr_driver_init() get skipped. Drivers need to
+ *                support SR_CONF_CONN in their scan options.
+ * @param cb The callback for added and removed devices. Must not be NULL.
+ * @param cb_data Opaque pointer which gets passed to the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or a monitor is running already.
+ * @retval SR_ERR Failed to start the monitor thread.
+ *
+ * @see sr_hotplug_monitor_stop()
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_hotplug_monitor_start(struct sr_context *ctx,
+		struct sr_dev_driver **drivers, sr_hotplug_callback cb,
+		void *cb_data)
+{
+	struct sr_hotplug_monitor *mon;
+	GError *error;
+	size_t count;
+
+	if (!ctx || !cb)
+		return SR_ERR_ARG;
+	if (ctx->hotplug) {
+		sr_err("Hotplug monitor is running already.");
+		return SR_ERR_ARG;
+	}
+	if (!drivers)
+		drivers = sr_driver_list(ctx);
+	if (!drivers)
+		return SR_ERR_ARG;
+
+	mon = g_malloc0(sizeof(*mon));
+	mon->ctx = ctx;
+	for (count = 0; drivers[count]; count++)
+		;
+	mon->drivers = g_malloc((count + 1) * sizeof(*drivers));
+	memcpy(mon->drivers, drivers, (count + 1) * sizeof(*drivers));
+	mon->cb = cb;
+	mon->cb_data = cb_data;
+	mon->queue = g_async_queue_new();
+	mon->main_context = g_main_context_ref_thread_default();
+	mon->source = g_source_new(&hotplug_source_funcs, sizeof(GSource));
+	g_source_set_callback(mon->source, hotplug_events_handle, mon, NULL);
+	g_source_attach(mon->source, mon->main_context);
+
+#ifdef HAVE_USB_HOTPLUG
+	usb_hotplug_start(mon);
+#endif
+#ifdef HAVE_SERIAL_COMM
+	serial_poll(mon, TRUE);
+#endif
+
+	error = NULL;
+	mon->thread = g_thread_try_new("sr-hotplug", hotplug_thread, mon, &error);
+	if (!mon->thread) {
+		sr_err("Failed to start hotplug monitor: %s.", error->message);
+		g_error_free(error);
+		ctx->hotplug = mon;
+		sr_hotplug_monitor_stop(ctx);
+		return SR_ERR;
+	}
+
+	ctx->hotplug = mon;
+
+	return SR_OK;
+}
+
+/**
+ * Stop watching for devices which get connected.
+ *
+ * Must be called from the thread which runs the main context that the
+ * monitor reports in. The callback doesn't get called after this
+ * routine returns.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ *
+ * @retval SR_OK Success, also when no monitor was running.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_hotplug_monitor_stop(struct sr_context *ctx)
+{
+	struct sr_hotplug_monitor *mon;
+	struct hotplug_event *ev;
+
+	if (!ctx)
+		return SR_ERR_ARG;
+	if (!(mon = ctx->hotplug))
+		return SR_OK;
+
+	g_atomic_int_set(&mon->quit, 1);
+#if defined(HAVE_USB_HOTPLUG) && (LIBUSB_API_VERSION >= 0x01000105)
+	if (mon->usb_ctx)
+		libusb_interrupt_event_handler(mon->usb_ctx);
+#endif
+	if (mon->thread)
+		g_thread_join(mon->thread);
+#ifdef HAVE_USB_HOTPLUG
+	usb_hotplug_stop(mon);
+#endif
+	g_source_destroy(mon->source);
+	g_source_unref(mon->source);
+	g_main_context_unref(mon->main_context);
+
+	while ((ev = g_async_queue_try_pop(mon->queue)))
+		event_free(ev);
+	g_async_queue_unref(mon->queue);
+	g_slist_free_full(mon->devices, (GDestroyNotify)device_free);
+#ifdef HAVE_SERIAL_COMM
+	g_slist_free_full(mon->serial_ports, g_free);
+#endif
+	g_free(mon->drivers);
+	g_free(mon);
+	ctx->hotplug = NULL;
+
+	return SR_OK;
+}
+
+/** @} */
@@ -220,6 +220,14 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Over-current protection delay", NULL},
 	{SR_CONF_INVERTED, SR_T_BOOL, "inverted",
 		"Signal inverted", NULL},
+	{SR_CONF_USB_BUFFER_SIZE, SR_T_UINT64, "usb_buffer_size",
+		"USB transfer size", NULL},
+	{SR_CONF_USB_QUEUE_DEPTH, SR_T_UINT64, "usb_queue_depth",
+		"USB transfer queue depth", NULL},
+	{SR_CONF_USB_LATENCY, SR_T_UINT64, "usb_latency",
+		"USB transfer latency target", NULL},
+	{SR_CONF_BENCHMARK, SR_T_BOOL, "benchmark",
+		"Benchmark mode", NULL},
 
 	/* Special stuff */
 	{SR_CONF_SESSIONFILE, SR_T_STRING, "sessionfile",
@@ -592,6 +600,316 @@ SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options)
 	return l;
 }
 
+/** @cond PRIVATE */
+/* Upper limit for the number of drivers which scan concurrently. */
+#define SCAN_MAX_THREADS	16
+/** @endcond */
+
+/* Shared state of a sr_context_scan() call. */
+struct scan_state {
+	struct sr_context *ctx;
+	GSList *options;
+	const char *conn;
+	const char *serialcomm;
+	struct sr_dev_driver **drivers;
+	GSList **results;
+};
+
+/* Scan drivers [first, first + count) one after another. */
+struct scan_job {
+	struct scan_state *state;
+	size_t first, count;
+};
+
+/* Resources which are being probed, see sr_scan_resource_lock(). */
+static GMutex scan_resource_mutex;
+static GCond scan_resource_cond;
+static GHashTable *scan_resources;
+
+/**
+ * Get exclusive access to a resource during a scan.
+ *
+ * Drivers get scanned concurrently by sr_context_scan(). Code which
+ * probes a resource which several drivers look at (a serial port, a
+ * USBTMC device, an FTDI chip) serializes the probes with this lock.
+ * See sr_usb_scan_lock() for USB devices.
+ *
+ * @param[in] resource The resource's name. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_scan_resource_lock(const char *resource)
+{
+	g_mutex_lock(&scan_resource_mutex);
+	if (!scan_resources)
+		scan_resources = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, NULL);
+	while (g_hash_table_contains(scan_resources, resource))
+		g_cond_wait(&scan_resource_cond, &scan_resource_mutex);
+	g_hash_table_add(scan_resources, g_strdup(resource));
+	g_mutex_unlock(&scan_resource_mutex);
+}
+
+/**
+ * Release a resource which was locked by sr_scan_resource_lock().
+ *
+ * @param[in] resource The resource's name. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_scan_resource_unlock(const char *resource)
+{
+	g_mutex_lock(&scan_resource_mutex);
+	g_hash_table_remove(scan_resources, resource);
+	g_cond_broadcast(&scan_resource_cond);
+	g_mutex_unlock(&scan_resource_mutex);
+}
+
+/* Check whether a probe recently found nothing. */
+static gboolean scan_cache_negative(struct sr_context *ctx, const char *key)
+{
+	gint64 *expiry;
+	gboolean hit;
+
+	hit = FALSE;
+	g_mutex_lock(&ctx->scan_mutex);
+	if (ctx->scan_cache) {
+		expiry = g_hash_table_lookup(ctx->scan_cache, key);
+		if (expiry && g_get_monotonic_time() < *expiry)
+			hit = TRUE;
+		else if (expiry)
+			g_hash_table_remove(ctx->scan_cache, key);
+	}
+	g_mutex_unlock(&ctx->scan_mutex);
+
+	return hit;
+}
+
+/* Remember that a probe found nothing. Takes ownership of the key. */
+static void scan_cache_add_negative(struct sr_context *ctx, char *key)
+{
+	gint64 *expiry;
+
+	g_mutex_lock(&ctx->scan_mutex);
+	if (!ctx->scan_cache_ttl_ms) {
+		g_mutex_unlock(&ctx->scan_mutex);
+		g_free(key);
+		return;
+	}
+	if (!ctx->scan_cache)
+		ctx->scan_cache = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, g_free);
+	expiry = g_malloc(sizeof(*expiry));
+	*expiry = g_get_monotonic_time() + 1000 * ctx->scan_cache_ttl_ms;
+	g_hash_table_replace(ctx->scan_cache, key, expiry);
+	g_mutex_unlock(&ctx->scan_mutex);
+}
+
+static void scan_driver(struct scan_state *state, size_t idx)
+{
+	struct sr_dev_driver *driver;
+	GSList *devices;
+	char *key;
+
+	driver = state->drivers[idx];
+
+	/* Negative results are cached per port, for scans with a conn. */
+	key = NULL;
+	if (state->conn) {
+		key = g_strdup_printf("%s\n%s\n%s", driver->name,
+			state->conn, state->serialcomm ? state->serialcomm : "");
+		if (scan_cache_negative(state->ctx, key)) {
+			sr_dbg("Skipping %s on %s, no device found recently.",
+				driver->name, state->conn);
+			g_free(key);
+			return;
+		}
+	}
+
+	devices = sr_driver_scan(driver, state->options);
+	state->results[idx] = devices;
+
+	if (!devices && key)
+		scan_cache_add_negative(state->ctx, key);
+	else
+		g_free(key);
+}
+
+static void scan_thread(gpointer data, gpointer user_data)
+{
+	struct scan_job *job;
+	size_t i;
+
+	(void)user_data;
+
+	job = data;
+	for (i = 0; i < job->count; i++)
+		scan_driver(job->state, job->first + i);
+	g_free(job);
+}
+
+/**
+ * Scan for devices with several drivers.
+ *
+ * Does what calling sr_driver_scan() for each driver does, but scans
+ * with the drivers concurrently in a pool of threads. The drivers share
+ * one enumeration of USB devices and serial ports which gets taken when
+ * the scan starts.
+ *
+ * A connection (SR_CONF_CONN) in the options names one port, which the
+ * drivers then probe one after another. Ports on which a driver found
+ * no device can be skipped by subsequent scans, see
+ * sr_context_scan_cache_ttl_set().
+ *
+ * The resource callbacks (see sr_resource_set_hooks()) can get called
+ * from several threads at the same time during the scan.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ * @param drivers NULL terminated array of drivers to scan with, NULL
+ *                selects all drivers. Drivers which were not initialized
+ *                with sr_driver_init() get skipped.
+ * @param options A list of 'struct sr_hwopt' options to pass to all the
+ *                drivers' scanners. Drivers which don't support all of
+ *                the options don't find devices. Can be NULL/empty.
+ *
+ * @return A GSList * of 'struct sr_dev_inst', in the order of the
+ *         drivers, or NULL if no devices were found. This list must be
+ *         freed by the caller using g_slist_free(), but without freeing
+ *         the data pointed to in the list.
+ *
+ * @since 0.6.0
+ */
+SR_API GSList *sr_context_scan(struct sr_context *ctx,
+		struct sr_dev_driver **drivers, GSList *options)
+{
+	struct scan_state state;
+	struct scan_job *job;
+	struct sr_config *src;
+	GThreadPool *pool;
+	GError *error;
+	GSList *l, *devices;
+	size_t i, count;
+
+	if (!ctx)
+		return NULL;
+	if (!drivers)
+		drivers = sr_driver_list(ctx);
+	if (!drivers)
+		return NULL;
+
+	memset(&state, 0, sizeof(state));
+	state.ctx = ctx;
+	state.options = options;
+	for (l = options; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_CONN)
+			state.conn = g_variant_get_string(src->data, NULL);
+		else if (src->key == SR_CONF_SERIALCOMM)
+			state.serialcomm = g_variant_get_string(src->data, NULL);
+	}
+
+	for (count = 0; drivers[count]; count++)
+		;
+	state.drivers = g_malloc0(count * sizeof(*state.drivers));
+	state.results = g_malloc0(count * sizeof(*state.results));
+	for (i = 0, count = 0; drivers[i]; i++) {
+		if (!drivers[i]->context) {
+			sr_dbg("Driver %s not initialized, skipping.",
+				drivers[i]->name);
+			continue;
+		}
+		state.drivers[count++] = drivers[i];
+	}
+
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_scan_begin(ctx);
+#endif
+#ifdef HAVE_SERIAL_COMM
+	sr_serial_scan_begin();
+#endif
+
+	/* All drivers probe the same port when a connection was given. */
+	pool = NULL;
+	if (!state.conn && count > 1) {
+		error = NULL;
+		pool = g_thread_pool_new(scan_thread, NULL,
+			MIN(count, SCAN_MAX_THREADS), FALSE, &error);
+		if (!pool) {
+			sr_warn("Cannot scan concurrently: %s.", error->message);
+			g_error_free(error);
+		}
+	}
+	if (pool) {
+		for (i = 0; i < count; i++) {
+			job = g_malloc0(sizeof(*job));
+			job->state = &state;
+			job->first = i;
+			job->count = 1;
+			g_thread_pool_push(pool, job, NULL);
+		}
+		/* Waits for all jobs to complete. */
+		g_thread_pool_free(pool, FALSE, TRUE);
+	} else {
+		job = g_malloc0(sizeof(*job));
+		job->state = &state;
+		job->count = count;
+		scan_thread(job, NULL);
+	}
+
+#ifdef HAVE_SERIAL_COMM
+	sr_serial_scan_end();
+#endif
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_scan_end(ctx);
+#endif
+
+	devices = NULL;
+	for (i = 0; i < count; i++)
+		devices = g_slist_concat(devices, state.results[i]);
+	g_free(state.drivers);
+	g_free(state.results);
+
+	sr_dbg("Scan of %zu drivers found %u devices.", count,
+		g_slist_length(devices));
+
+	return devices;
+}
+
+/**
+ * Set for how long sr_context_scan() remembers ports without devices.
+ *
+ * Probes of serial ports take time, typically a timeout per driver
+ * when no device answers. Subsequent scans skip drivers which found
+ * no device on the same port (and with the same serialcomm options)
+ * until the time to live expires.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ * @param ttl_ms The time to live of negative probe results in ms.
+ *               0 disables the cache, and forgets previous results.
+ *               That's the default.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_context_scan_cache_ttl_set(struct sr_context *ctx,
+		uint64_t ttl_ms)
+{
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ctx->scan_mutex);
+	ctx->scan_cache_ttl_ms = ttl_ms;
+	if (!ttl_ms && ctx->scan_cache) {
+		g_hash_table_destroy(ctx->scan_cache);
+		ctx->scan_cache = NULL;
+	}
+	g_mutex_unlock(&ctx->scan_mutex);
+
+	return SR_OK;
+}
+
 /**
  * Call driver cleanup function for all drivers.
  *
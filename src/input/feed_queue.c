@@ -21,14 +21,45 @@
 #include "libsigrok-internal.h"
 #include <string.h>
 
+/*
+ * Sample data is kept in reference counted buffers, so that datafeed
+ * consumers can hold on to the data without copying it. A buffer which
+ * is still referenced after it was sent gets replaced by another one from
+ * the session's pool, otherwise it is re-used for subsequent samples.
+ */
+static int feed_queue_buffer_recycle(const struct sr_dev_inst *sdi,
+	struct sr_buffer **buf)
+{
+	struct sr_buffer *fresh;
+
+	if (!sr_buffer_is_shared(*buf))
+		return SR_OK;
+
+	fresh = std_session_buffer_get(sdi, sr_buffer_size_get(*buf));
+	if (!fresh)
+		return SR_ERR_MALLOC;
+	sr_buffer_unref(*buf);
+	*buf = fresh;
+
+	return SR_OK;
+}
+
 struct feed_queue_logic {
 	const struct sr_dev_inst *sdi;
 	size_t unit_size;
 	size_t alloc_count;
 	size_t fill_count;
+	struct sr_buffer *buffer;
 	uint8_t *data_bytes;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	/*
+	 * Run-length encoded mode. Run values are kept in the data
+	 * buffer, fill_count is the number of runs then.
+	 */
+	uint64_t *rle_lengths;
+	struct sr_datafeed_packet rle_packet;
+	struct sr_datafeed_logic_rle rle;
 };
 
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
@@ -41,11 +72,12 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	q->sdi = sdi;
 	q->unit_size = unit_size;
 	q->alloc_count = sample_count;
-	q->data_bytes = g_try_malloc(q->alloc_count * q->unit_size);
-	if (!q->data_bytes) {
+	q->buffer = std_session_buffer_get(sdi, q->alloc_count * q->unit_size);
+	if (!q->buffer) {
 		g_free(q);
 		return NULL;
 	}
+	q->data_bytes = sr_buffer_data_get(q->buffer);
 
 	memset(&q->packet, 0, sizeof(q->packet));
 	memset(&q->logic, 0, sizeof(q->logic));
@@ -57,22 +89,95 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	return q;
 }
 
-SR_API int feed_queue_logic_submit_one(struct feed_queue_logic *q,
+/*
+ * Have subsequently submitted samples sent in SR_DF_LOGIC_RLE packets.
+ * This suits devices which provide (value, repeat count) pairs, long
+ * runs of identical samples then need not get expanded.
+ */
+SR_API int feed_queue_logic_rle_set(struct feed_queue_logic *q,
+	gboolean enable)
+{
+	int ret;
+
+	if (!q)
+		return SR_ERR_ARG;
+	if (enable == (q->rle_lengths != NULL))
+		return SR_OK;
+
+	ret = feed_queue_logic_flush(q);
+	if (ret != SR_OK)
+		return ret;
+
+	if (!enable) {
+		g_free(q->rle_lengths);
+		q->rle_lengths = NULL;
+		return SR_OK;
+	}
+
+	q->rle_lengths = g_try_malloc(q->alloc_count * sizeof(q->rle_lengths[0]));
+	if (!q->rle_lengths)
+		return SR_ERR_MALLOC;
+	memset(&q->rle_packet, 0, sizeof(q->rle_packet));
+	memset(&q->rle, 0, sizeof(q->rle));
+	q->rle_packet.type = SR_DF_LOGIC_RLE;
+	q->rle_packet.payload = &q->rle;
+	q->rle.unitsize = q->unit_size;
+	q->rle.lengths = q->rle_lengths;
+
+	return SR_OK;
+}
+
+static int feed_queue_logic_submit_run(struct feed_queue_logic *q,
 	const uint8_t *data, size_t repeat_count)
 {
 	uint8_t *wrptr;
 	int ret;
 
+	if (!repeat_count)
+		return SR_OK;
+
+	/* Extend the last run when the value is unchanged. */
+	if (q->fill_count) {
+		wrptr = &q->data_bytes[(q->fill_count - 1) * q->unit_size];
+		if (memcmp(wrptr, data, q->unit_size) == 0) {
+			q->rle_lengths[q->fill_count - 1] += repeat_count;
+			return SR_OK;
+		}
+	}
+
+	if (q->fill_count == q->alloc_count) {
+		ret = feed_queue_logic_flush(q);
+		if (ret != SR_OK)
+			return ret;
+	}
 	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
-	while (repeat_count--) {
-		memcpy(wrptr, data, q->unit_size);
-		wrptr += q->unit_size;
-		q->fill_count++;
+	memcpy(wrptr, data, q->unit_size);
+	q->rle_lengths[q->fill_count] = repeat_count;
+	q->fill_count++;
+
+	return SR_OK;
+}
+
+SR_API int feed_queue_logic_submit_one(struct feed_queue_logic *q,
+	const uint8_t *data, size_t repeat_count)
+{
+	size_t space, fill_count;
+	int ret;
+
+	if (q->rle_lengths)
+		return feed_queue_logic_submit_run(q, data, repeat_count);
+
+	while (repeat_count) {
+		space = q->alloc_count - q->fill_count;
+		fill_count = MIN(repeat_count, space);
+		sr_logic_fill_samples(&q->data_bytes[q->fill_count * q->unit_size],
+			data, q->unit_size, fill_count);
+		repeat_count -= fill_count;
+		q->fill_count += fill_count;
 		if (q->fill_count == q->alloc_count) {
 			ret = feed_queue_logic_flush(q);
 			if (ret != SR_OK)
 				return ret;
-			wrptr = &q->data_bytes[0];
 		}
 	}
 
@@ -86,6 +191,16 @@ SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
 	size_t space, copy_count;
 	int ret;
 
+	if (q->rle_lengths) {
+		while (samples_count--) {
+			ret = feed_queue_logic_submit_run(q, data, 1);
+			if (ret != SR_OK)
+				return ret;
+			data += q->unit_size;
+		}
+		return SR_OK;
+	}
+
 	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
 	while (samples_count) {
 		space = q->alloc_count - q->fill_count;
@@ -115,12 +230,28 @@ SR_API int feed_queue_logic_flush(struct feed_queue_logic *q)
 	if (!q->fill_count)
 		return SR_OK;
 
+	if (q->rle_lengths) {
+		q->rle.num_runs = q->fill_count;
+		q->rle.data = q->data_bytes;
+		ret = sr_session_send(q->sdi, &q->rle_packet);
+		if (ret != SR_OK)
+			return ret;
+		q->fill_count = 0;
+		return SR_OK;
+	}
+
 	q->logic.length = q->fill_count * q->unit_size;
-	ret = sr_session_send(q->sdi, &q->packet);
+	ret = sr_session_send_buffer(q->sdi, &q->packet, q->buffer);
 	if (ret != SR_OK)
 		return ret;
 	q->fill_count = 0;
 
+	ret = feed_queue_buffer_recycle(q->sdi, &q->buffer);
+	if (ret != SR_OK)
+		return ret;
+	q->data_bytes = sr_buffer_data_get(q->buffer);
+	q->logic.data = q->data_bytes;
+
 	return SR_OK;
 }
 
@@ -145,7 +276,8 @@ SR_API void feed_queue_logic_free(struct feed_queue_logic *q)
 	if (!q)
 		return;
 
-	g_free(q->data_bytes);
+	sr_buffer_unref(q->buffer);
+	g_free(q->rle_lengths);
 	g_free(q);
 }
 
@@ -153,6 +285,7 @@ struct feed_queue_analog {
 	const struct sr_dev_inst *sdi;
 	size_t alloc_count;
 	size_t fill_count;
+	struct sr_buffer *buffer;
 	float *data_values;
 	int digits;
 	struct sr_datafeed_packet packet;
@@ -172,11 +305,12 @@ SR_API struct feed_queue_analog *feed_queue_analog_alloc(
 	q = g_malloc0(sizeof(*q));
 	q->sdi = sdi;
 	q->alloc_count = sample_count;
-	q->data_values = g_try_malloc(q->alloc_count * sizeof(float));
-	if (!q->data_values) {
+	q->buffer = std_session_buffer_get(sdi, q->alloc_count * sizeof(float));
+	if (!q->buffer) {
 		g_free(q);
 		return NULL;
 	}
+	q->data_values = sr_buffer_data_get(q->buffer);
 	q->digits = digits;
 	q->channels = g_slist_append(NULL, ch);
 
@@ -255,11 +389,17 @@ SR_API int feed_queue_analog_flush(struct feed_queue_analog *q)
 		return SR_OK;
 
 	q->analog.num_samples = q->fill_count;
-	ret = sr_session_send(q->sdi, &q->packet);
+	ret = sr_session_send_buffer(q->sdi, &q->packet, q->buffer);
 	if (ret != SR_OK)
 		return ret;
 	q->fill_count = 0;
 
+	ret = feed_queue_buffer_recycle(q->sdi, &q->buffer);
+	if (ret != SR_OK)
+		return ret;
+	q->data_values = sr_buffer_data_get(q->buffer);
+	q->analog.data = q->data_values;
+
 	return SR_OK;
 }
 
@@ -269,7 +409,7 @@ SR_API void feed_queue_analog_free(struct feed_queue_analog *q)
 	if (!q)
 		return;
 
-	g_free(q->data_values);
+	sr_buffer_unref(q->buffer);
 	g_slist_free(q->channels);
 	g_free(q);
 }
@@ -1213,6 +1213,22 @@ struct sr_context {
 	sr_resource_close_callback resource_close_cb;
 	sr_resource_read_callback resource_read_cb;
 	void *resource_cb_data;
+	/* Resource content and uploads, see sr_resource_get(). */
+	GMutex resource_mutex;
+	GHashTable *resource_cache;
+	GHashTable *resource_uploads;
+	/* Protects the scan state below. */
+	GMutex scan_mutex;
+	/* Expiry times of negative probe results, see sr_context_scan(). */
+	GHashTable *scan_cache;
+	uint64_t scan_cache_ttl_ms;
+#ifdef HAVE_LIBUSB_1_0
+	/* USB device list which is shared by concurrent driver scans. */
+	unsigned int usb_scan_depth;
+	libusb_device **usb_snapshot;
+#endif
+	/* Hotplug monitor, see sr_hotplug_monitor_start(). */
+	struct sr_hotplug_monitor *hotplug;
 };
 
 /** Input module metadata keys. */
@@ -1489,11 +1505,21 @@ struct sr_output_module {
 	int (*cleanup) (struct sr_output *o);
 };
 
+/** Processing time bookkeeping, see sr_session_stats_get(). */
+struct sr_timing {
+	uint64_t calls;
+	uint64_t total_us;
+	uint64_t max_us;
+};
+
 /** Transform module instance. */
 struct sr_transform {
 	/** A pointer to this transform's module. */
 	const struct sr_transform_module *module;
 
+	/** Time spent in the module's receive() callback. */
+	struct sr_timing timing;
+
 	/**
 	 * The device for which this transform module is used. This
 	 * can be used by the module to find out channel names and numbers.
@@ -1815,6 +1841,8 @@ SR_PRIV struct sr_config *sr_config_new(uint32_t key, GVariant *data);
 SR_PRIV void sr_config_free(struct sr_config *src);
 SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi);
 SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi);
+SR_PRIV void sr_scan_resource_lock(const char *resource);
+SR_PRIV void sr_scan_resource_unlock(const char *resource);
 
 /*--- session.c -------------------------------------------------------------*/
 
@@ -1827,6 +1855,27 @@ struct sr_session {
 	GSList *owned_devs;
 	/** List of struct datafeed_callback pointers. */
 	GSList *datafeed_callbacks;
+	/** Queue depth for asynchronous datafeed callbacks, 0 if disabled. */
+	unsigned int datafeed_queue_depth;
+	/** Policy for full datafeed queues (enum sr_datafeed_overflow). */
+	int datafeed_overflow;
+	/** Whether USB events get handled in a thread of their own. */
+	gboolean usb_event_thread;
+	/** Recycled sample buffers for the session's devices. */
+	struct sr_buffer_pool *buffer_pool;
+	/** Whether statistics get collected, see sr_session_stats_enable(). */
+	gint stats_enabled;
+	/**
+	 * Mutex protecting the statistics of packets, transforms and
+	 * callbacks, and the lists of transforms and callbacks.
+	 */
+	GMutex stats_mutex;
+	/** Packet counters, indexed by packet type - SR_DF_HEADER. */
+	struct {
+		uint64_t packets;
+		uint64_t bytes;
+		uint64_t samples;
+	} packet_stats[SR_DF_LOGIC_RLE - SR_DF_HEADER + 1];
 	GSList *transforms;
 	struct sr_trigger *trigger;
 
@@ -1839,6 +1888,12 @@ struct sr_session {
 	GMutex main_mutex;
 	/** Context of the session main loop. */
 	GMainContext *main_context;
+	/** Thread which runs the session main loop. */
+	GThread *main_thread;
+	/** Packets which other threads sent, see session_send_defer(). */
+	GAsyncQueue *deferred_packets;
+	/** Event source which delivers the deferred packets. */
+	GSource *deferred_source;
 
 	/** Registered event sources for this session. */
 	GHashTable *event_sources;
@@ -1878,10 +1933,41 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 		uint32_t key, GVariant *var);
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet);
+SR_PRIV int sr_session_send_buffer(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, struct sr_buffer *buf);
 SR_PRIV int sr_sessionfile_check(const char *filename);
 SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 		struct sr_session **session);
 
+/*--- buffer.c --------------------------------------------------------------*/
+
+struct sr_buffer_pool;
+
+SR_PRIV struct sr_buffer *sr_buffer_new(size_t size);
+SR_PRIV gboolean sr_buffer_is_shared(const struct sr_buffer *buf);
+SR_PRIV struct sr_buffer_pool *sr_buffer_pool_new(void);
+SR_PRIV void sr_buffer_pool_free(struct sr_buffer_pool *pool);
+SR_PRIV struct sr_buffer *sr_buffer_pool_get(struct sr_buffer_pool *pool,
+		size_t size);
+
+/*--- logic_rle.c -----------------------------------------------------------*/
+
+typedef int (*sr_logic_rle_packet_cb)(const struct sr_datafeed_packet *packet,
+		void *cb_data);
+
+SR_PRIV void sr_logic_fill_samples(uint8_t *dst, const uint8_t *value,
+		size_t unitsize, uint64_t count);
+SR_PRIV int sr_logic_rle_to_logic(const struct sr_datafeed_logic_rle *rle,
+		sr_logic_rle_packet_cb cb, void *cb_data);
+
+/*--- transpose.c -----------------------------------------------------------*/
+
+SR_PRIV uint16_t sr_transpose_4x4(uint16_t m);
+SR_PRIV uint16_t sr_transpose_8x2(uint16_t m);
+SR_PRIV uint64_t sr_transpose_8x8(uint64_t m);
+SR_PRIV void sr_transpose_16x16(uint16_t *dst, const uint16_t *src);
+SR_PRIV void sr_transpose_64x64(uint64_t *dst, const uint64_t *src);
+
 /*--- session_file.c --------------------------------------------------------*/
 
 #if !HAVE_ZIP_DISCARD
@@ -1921,6 +2007,11 @@ SR_PRIV int std_session_send_df_end(const struct sr_dev_inst *sdi);
 SR_PRIV int std_session_send_df_trigger(const struct sr_dev_inst *sdi);
 SR_PRIV int std_session_send_df_frame_begin(const struct sr_dev_inst *sdi);
 SR_PRIV int std_session_send_df_frame_end(const struct sr_dev_inst *sdi);
+SR_PRIV struct sr_buffer *std_session_buffer_get(const struct sr_dev_inst *sdi,
+		size_t size);
+SR_PRIV int std_session_send_logic_buffer(const struct sr_dev_inst *sdi,
+		struct sr_buffer *buf, void *data, size_t length,
+		uint16_t unitsize);
 SR_PRIV int std_dev_clear_with_callback(const struct sr_dev_driver *driver,
 		std_dev_clear_callback clear_private);
 SR_PRIV int std_dev_clear(const struct sr_dev_driver *driver);
@@ -1991,6 +2082,12 @@ SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 SR_PRIV void *sr_resource_load(struct sr_context *ctx, int type,
 		const char *name, size_t *size, size_t max_size)
 		G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+SR_PRIV GBytes *sr_resource_get(struct sr_context *ctx, int type,
+		const char *name, size_t max_size) G_GNUC_WARN_UNUSED_RESULT;
+SR_PRIV int sr_resource_upload_check(struct sr_context *ctx,
+		const char *device_id, int type, const char *name);
+SR_PRIV void sr_resource_upload_done(struct sr_context *ctx,
+		const char *device_id, int type, const char *name);
 
 /*--- strutil.c -------------------------------------------------------------*/
 
@@ -2012,17 +2109,75 @@ SR_PRIV void sr_hexdump_free(GString *s);
 
 /*--- soft-trigger.c --------------------------------------------------------*/
 
+/* Circular buffer holding the most recent data before a soft trigger. */
+struct soft_trigger_pre_trigger {
+	uint8_t *buffer;
+	size_t size;
+	size_t head;
+	size_t fill;
+	size_t unitsize;
+};
+
+/*
+ * A trigger stage compiled to per-bit condition masks. Each mask holds
+ * one bit per logic channel, split into 64-bit words (least significant
+ * byte of the sample first).
+ */
+struct soft_trigger_logic_stage {
+	uint64_t *ones;
+	uint64_t *zeros;
+	uint64_t *rising;
+	uint64_t *falling;
+	uint64_t *edge;
+	gboolean has_matches;
+	gboolean has_edges;
+	gboolean never;
+};
+
 struct soft_trigger_logic {
 	const struct sr_dev_inst *sdi;
 	const struct sr_trigger *trigger;
-	int count;
 	int unitsize;
 	int cur_stage;
+	int num_stages;
+	int num_words;
+	struct soft_trigger_logic_stage *stages;
+	gboolean have_prev;
 	uint8_t *prev_sample;
-	uint8_t *pre_trigger_buffer;
-	uint8_t *pre_trigger_head;
-	int pre_trigger_size;
-	int pre_trigger_fill;
+	struct soft_trigger_pre_trigger pre_trigger;
+};
+
+/* A condition on an analog channel, part of a trigger stage. */
+struct soft_trigger_analog_cond {
+	struct sr_channel *channel;
+	int match;
+	/* Window match, value over level or under low. */
+	gboolean outside;
+	float level;
+	float high;
+	float low;
+	gboolean armed_rising;
+	gboolean armed_falling;
+	int packet;
+};
+
+struct soft_trigger_analog_stage {
+	struct soft_trigger_analog_cond *conds;
+	int num_conds;
+};
+
+struct soft_trigger_analog {
+	const struct sr_dev_inst *sdi;
+	const struct sr_trigger *trigger;
+	int cur_stage;
+	int num_stages;
+	struct soft_trigger_analog_stage *stages;
+	uint8_t *flags;
+	size_t flags_size;
+	int pre_trigger_samples;
+	/* One pre-trigger buffer per analog packet. */
+	int num_pre_trigger;
+	struct soft_trigger_pre_trigger *pre_trigger;
 };
 
 SR_PRIV int logic_channel_unitsize(GSList *channels);
@@ -2032,6 +2187,15 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *st);
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *st, uint8_t *buf,
 		int len, int *pre_trigger_samples);
+SR_PRIV struct soft_trigger_analog *soft_trigger_analog_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples);
+SR_PRIV void soft_trigger_analog_free(struct soft_trigger_analog *sta);
+SR_PRIV void soft_trigger_analog_set_hysteresis(struct soft_trigger_analog *sta,
+		const struct sr_channel *ch, float hysteresis);
+SR_PRIV int soft_trigger_analog_check(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog **analog, int num_analog,
+		int *pre_trigger_samples);
 
 /*--- serial.c --------------------------------------------------------------*/
 
@@ -2083,6 +2247,9 @@ SR_PRIV int serial_source_add(struct sr_session *session,
 SR_PRIV int serial_source_remove(struct sr_session *session,
 		struct sr_serial_dev_inst *serial);
 SR_PRIV GSList *sr_serial_find_usb(uint16_t vendor_id, uint16_t product_id);
+SR_PRIV GSList *sr_serial_list_ports(void);
+SR_PRIV void sr_serial_scan_begin(void);
+SR_PRIV void sr_serial_scan_end(void);
 SR_PRIV int serial_timeout(struct sr_serial_dev_inst *port, int num_bytes);
 
 SR_PRIV void sr_ser_discard_queued_data(struct sr_serial_dev_inst *serial);
@@ -2120,6 +2287,8 @@ struct ser_lib_functions {
 	int (*get_frame_format)(struct sr_serial_dev_inst *serial,
 			int *baud, int *bits);
 	size_t (*get_rx_avail)(struct sr_serial_dev_inst *serial);
+	void (*scan_begin)(void);
+	void (*scan_end)(void);
 };
 extern SR_PRIV struct ser_lib_functions *ser_lib_funcs_libsp;
 SR_PRIV int ser_name_is_hid(struct sr_serial_dev_inst *serial);
@@ -2220,10 +2389,54 @@ SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb);
 SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb);
 SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 		int timeout, sr_receive_data_callback cb, void *cb_data);
-SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx);
+/* Exported for the test suite, which has no USB hardware. */
+SR_API int usb_source_add_threaded(struct sr_session *session,
+		struct sr_context *ctx, int timeout,
+		sr_receive_data_callback cb, void *cb_data);
+SR_PRIV gboolean usb_source_is_threaded(struct sr_session *session,
+		struct sr_context *ctx);
+SR_API int usb_source_invoke(struct sr_session *session,
+		struct sr_context *ctx, GSourceFunc func, void *data);
+SR_API int usb_source_remove(struct sr_session *session, struct sr_context *ctx);
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len);
+SR_PRIV void sr_usb_scan_begin(struct sr_context *ctx);
+SR_PRIV void sr_usb_scan_end(struct sr_context *ctx);
+SR_PRIV ssize_t sr_usb_get_device_list(struct sr_context *ctx,
+		libusb_device ***list);
+SR_PRIV void sr_usb_scan_lock(libusb_device *dev);
+SR_PRIV void sr_usb_scan_unlock(libusb_device *dev);
+SR_PRIV libusb_device **sr_usb_scan_lock_vid_pid(struct sr_context *ctx,
+		uint16_t vid, uint16_t pid);
+SR_PRIV void sr_usb_scan_unlock_list(libusb_device **locked);
 SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 		const char *manufacturer, const char *product);
+
+/** Parameters of streaming USB bulk transfers, see usb.c. */
+struct sr_usb_xfer_params {
+	/* User settings, 0 selects automatic values. */
+	uint64_t buffer_size;
+	uint64_t queue_depth;
+	uint64_t latency_ms;
+	/* Parameters which were chosen for an acquisition. */
+	size_t size;
+	unsigned int count;
+	unsigned int max_count;
+	unsigned int timeout_ms;
+	/* Adaptation state. */
+	size_t bytes_per_ms;
+	int64_t last_completion_us;
+	unsigned int backlog;
+};
+
+SR_PRIV int sr_usb_xfer_params_config_get(const struct sr_usb_xfer_params *p,
+		uint32_t key, GVariant **data);
+SR_PRIV int sr_usb_xfer_params_config_set(struct sr_usb_xfer_params *p,
+		uint32_t key, GVariant *data);
+SR_PRIV void sr_usb_xfer_params_setup(struct sr_usb_xfer_params *p,
+		size_t bytes_per_ms, size_t block_size, unsigned int total_ms,
+		unsigned int max_count);
+SR_PRIV unsigned int sr_usb_xfer_params_completed(struct sr_usb_xfer_params *p,
+		size_t length);
 #endif
 
 /*--- tcp.c -----------------------------------------------------------------*/
@@ -2867,6 +3080,8 @@ struct feed_queue_analog;
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	const struct sr_dev_inst *sdi,
 	size_t sample_count, size_t unit_size);
+SR_API int feed_queue_logic_rle_set(struct feed_queue_logic *q,
+	gboolean enable);
 SR_API int feed_queue_logic_submit_one(struct feed_queue_logic *q,
 	const uint8_t *data, size_t repeat_count);
 SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
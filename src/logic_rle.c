@@ -0,0 +1,280 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "logic-rle"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Run-length encoded logic data.
+ */
+
+/**
+ * @defgroup grp_logic_rle Run-length encoded logic data
+ *
+ * Helpers for SR_DF_LOGIC_RLE packets.
+ *
+ * Devices which capture (value, repeat count) pairs can send them in
+ * SR_DF_LOGIC_RLE packets, which avoids the expansion of long idle
+ * periods. Consumers can iterate over the runs, or expand the samples
+ * on demand into buffers of limited size.
+ *
+ * @{
+ */
+
+/* Size of the SR_DF_LOGIC packets which RLE packets get expanded to. */
+#define EXPAND_CHUNK_SIZE	(1024 * 1024)
+
+/**
+ * Fill a buffer with 'count' copies of a sample value.
+ *
+ * Common unit sizes use word stores of the replicated value, which
+ * compilers can vectorize. Other sizes copy ever larger blocks of the
+ * already written data, to keep the number of calls low for long runs.
+ *
+ * @param[out] dst The buffer, 'count' * 'unitsize' bytes.
+ * @param[in] value The sample value, 'unitsize' bytes.
+ * @param[in] unitsize The size of a sample in bytes.
+ * @param[in] count The number of samples to write.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_fill_samples(uint8_t *dst, const uint8_t *value,
+		size_t unitsize, uint64_t count)
+{
+	uint16_t v16;
+	uint32_t v32;
+	uint64_t v64;
+	size_t done, total, len;
+
+	if (!count)
+		return;
+
+	switch (unitsize) {
+	case sizeof(uint8_t):
+		memset(dst, value[0], count);
+		return;
+	case sizeof(uint16_t):
+		memcpy(&v16, value, sizeof(v16));
+		v32 = (uint32_t)v16 << 16 | v16;
+		v64 = (uint64_t)v32 << 32 | v32;
+		for (; count >= 4; count -= 4, dst += sizeof(v64))
+			memcpy(dst, &v64, sizeof(v64));
+		for (; count; count--, dst += sizeof(v16))
+			memcpy(dst, &v16, sizeof(v16));
+		return;
+	case sizeof(uint32_t):
+		memcpy(&v32, value, sizeof(v32));
+		v64 = (uint64_t)v32 << 32 | v32;
+		for (; count >= 2; count -= 2, dst += sizeof(v64))
+			memcpy(dst, &v64, sizeof(v64));
+		if (count)
+			memcpy(dst, &v32, sizeof(v32));
+		return;
+	default:
+		total = count * unitsize;
+		memcpy(dst, value, unitsize);
+		for (done = unitsize; done < total; done += len) {
+			len = MIN(done, total - done);
+			memcpy(dst + done, dst, len);
+		}
+		return;
+	}
+}
+
+/**
+ * Get the number of samples in a run-length encoded logic payload.
+ *
+ * @param[in] rle The payload. Must not be NULL.
+ *
+ * @return The sum of all run lengths.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_logic_rle_num_samples(
+		const struct sr_datafeed_logic_rle *rle)
+{
+	uint64_t i, count;
+
+	count = 0;
+	for (i = 0; i < rle->num_runs; i++)
+		count += rle->lengths[i];
+
+	return count;
+}
+
+/**
+ * Start the iteration over a run-length encoded logic payload.
+ *
+ * @param[out] iter The iterator. Must not be NULL.
+ * @param[in] rle The payload. Must not be NULL, and must remain valid
+ *                while the iterator is in use.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_logic_rle_iter_init(struct sr_logic_rle_iter *iter,
+		const struct sr_datafeed_logic_rle *rle)
+{
+	iter->rle = rle;
+	iter->run = 0;
+	iter->done = 0;
+}
+
+/**
+ * Get the next run of a run-length encoded logic payload.
+ *
+ * Empty runs are skipped. If the current run was partially consumed by
+ * sr_logic_rle_expand(), only its remaining samples are returned.
+ *
+ * @param[in,out] iter The iterator. Must not be NULL.
+ * @param[out] value Pointer to the run's sample value. Must not be NULL.
+ * @param[out] count The number of samples in the run. Must not be NULL.
+ *
+ * @retval TRUE A run was returned.
+ * @retval FALSE The end of the payload was reached.
+ *
+ * @since 0.6.0
+ */
+SR_API gboolean sr_logic_rle_iter_next(struct sr_logic_rle_iter *iter,
+		const uint8_t **value, uint64_t *count)
+{
+	const struct sr_datafeed_logic_rle *rle;
+
+	rle = iter->rle;
+	while (iter->run < rle->num_runs) {
+		*count = rle->lengths[iter->run] - iter->done;
+		*value = (const uint8_t *)rle->data + iter->run * rle->unitsize;
+		iter->run++;
+		iter->done = 0;
+		if (*count)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * Expand samples of a run-length encoded logic payload.
+ *
+ * Writes the samples at the iterator's position to a buffer, in the
+ * layout of SR_DF_LOGIC packets, and advances the iterator. Can be
+ * called repeatedly to expand a payload in chunks of limited size.
+ *
+ * @param[in,out] iter The iterator. Must not be NULL.
+ * @param[out] buf The output buffer, must provide space for
+ *                 max_samples * unitsize bytes. Must not be NULL.
+ * @param[in] max_samples The maximum number of samples to write.
+ *
+ * @return The number of samples written, 0 at the end of the payload.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_logic_rle_expand(struct sr_logic_rle_iter *iter,
+		uint8_t *buf, uint64_t max_samples)
+{
+	const struct sr_datafeed_logic_rle *rle;
+	const uint8_t *value;
+	uint64_t written, count;
+
+	rle = iter->rle;
+	written = 0;
+	while (written < max_samples && iter->run < rle->num_runs) {
+		count = rle->lengths[iter->run] - iter->done;
+		count = MIN(count, max_samples - written);
+		value = (const uint8_t *)rle->data + iter->run * rle->unitsize;
+		sr_logic_fill_samples(buf + written * rle->unitsize, value,
+			rle->unitsize, count);
+		written += count;
+		iter->done += count;
+		if (iter->done == rle->lengths[iter->run]) {
+			iter->run++;
+			iter->done = 0;
+		}
+	}
+
+	return written;
+}
+
+/**
+ * Expand a run-length encoded logic payload to SR_DF_LOGIC packets.
+ *
+ * This serves consumers which don't handle SR_DF_LOGIC_RLE packets.
+ * The packets are of limited size, and get passed to a callback one
+ * after another. Their data is only valid during the callback.
+ *
+ * @param[in] rle The payload. Must not be NULL.
+ * @param[in] cb The callback which receives the packets.
+ * @param[in] cb_data Opaque data for the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid payload.
+ * @retval SR_ERR_MALLOC Out of memory.
+ * @retval other The callback's error code.
+ *
+ * @private
+ */
+SR_PRIV int sr_logic_rle_to_logic(const struct sr_datafeed_logic_rle *rle,
+		sr_logic_rle_packet_cb cb, void *cb_data)
+{
+	struct sr_logic_rle_iter iter;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t max_samples, count;
+	uint8_t *buf;
+	int ret;
+
+	if (!rle->unitsize)
+		return SR_ERR_ARG;
+
+	max_samples = MIN(sr_logic_rle_num_samples(rle),
+		EXPAND_CHUNK_SIZE / rle->unitsize);
+	if (!max_samples)
+		return SR_OK;
+	buf = g_try_malloc(max_samples * rle->unitsize);
+	if (!buf)
+		return SR_ERR_MALLOC;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	packet.buffer = NULL;
+	logic.unitsize = rle->unitsize;
+	logic.data = buf;
+
+	ret = SR_OK;
+	sr_logic_rle_iter_init(&iter, rle);
+	while ((count = sr_logic_rle_expand(&iter, buf, max_samples))) {
+		logic.length = count * rle->unitsize;
+		ret = cb(&packet, cb_data);
+		if (ret != SR_OK)
+			break;
+	}
+	g_free(buf);
+
+	return ret;
+}
+
+/** @} */
@@ -325,18 +325,60 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	return op;
 }
 
+struct output_expand {
+	const struct sr_output *o;
+	GString *out;
+};
+
+static int output_send_expanded(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	struct output_expand *ex;
+	GString *out;
+	int ret;
+
+	ex = cb_data;
+	out = NULL;
+	ret = ex->o->module->receive(ex->o, packet, &out);
+	if (out) {
+		if (ex->out) {
+			g_string_append_len(ex->out, out->str, out->len);
+			g_string_free(out, TRUE);
+		} else {
+			ex->out = out;
+		}
+	}
+
+	return ret;
+}
+
 /**
  * Send a packet to the specified output instance.
  *
  * The instance's output is returned as a newly allocated GString,
  * which must be freed by the caller.
  *
+ * SR_DF_LOGIC_RLE packets get expanded to SR_DF_LOGIC packets for
+ * output modules which don't handle them (see SR_OUTPUT_LOGIC_RLE).
+ *
  * @since 0.4.0
  */
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out)
 {
-	return o->module->receive(o, packet, out);
+	struct output_expand ex;
+	int ret;
+
+	if (packet->type != SR_DF_LOGIC_RLE ||
+			(o->module->flags & SR_OUTPUT_LOGIC_RLE))
+		return o->module->receive(o, packet, out);
+
+	ex.o = o;
+	ex.out = NULL;
+	ret = sr_logic_rle_to_logic(packet->payload, output_send_expanded, &ex);
+	*out = ex.out;
+
+	return ret;
 }
 
 /**
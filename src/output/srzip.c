@@ -24,11 +24,87 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <zip.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "output/srzip"
 #define CHUNK_SIZE (4 * 1024 * 1024)
+#define DEFAULT_LEVEL 6
+
+/*
+ * Summaries of the sample data, at decimations by powers of two. The
+ * first level has a record per SUMMARY_BASE samples, each further
+ * level merges SUMMARY_FACTOR records of the previous one.
+ *
+ * A logic record holds the first and the last sample, the OR and the
+ * AND of all samples, then per channel the number of transitions
+ * within the record as 32bit value (saturated). An analog record holds
+ * the minimum, maximum and mean as float values. All little endian.
+ */
+#define SUMMARY_VERSION 1
+#define SUMMARY_BASE 1024
+#define SUMMARY_FACTOR 4
+#define SUMMARY_ANALOG_SIZE (3 * sizeof(float))
+
+#ifdef HAVE_ZLIB
+/*
+ * Streaming archive writer. libzip rewrites the archive on every
+ * zip_close(), which gets expensive for long captures. This writer
+ * keeps the file open, appends members as they come in, and writes
+ * the central directory once at the end.
+ */
+
+#define ZIP_LOCAL_HEADER_SIG	0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG	0x02014b50
+#define ZIP_EOCD_SIG		0x06054b50
+#define ZIP64_EOCD_SIG		0x06064b50
+#define ZIP64_LOCATOR_SIG	0x07064b50
+#define ZIP64_EXTRA_ID		0x0001
+#define ZIP_METHOD_STORE	0
+#define ZIP_METHOD_DEFLATE	8
+#define ZIP_VERSION		20
+#define ZIP64_VERSION		45
+
+struct zip_writer_entry {
+	char *name;
+	uint32_t crc;
+	uint32_t comp_size;
+	uint32_t size;
+	uint64_t offset;
+	uint16_t method;
+};
+
+/* A member which gets compressed, possibly by a worker thread. */
+struct zip_writer_job {
+	struct zip_writer_entry entry;
+	const uint8_t *data;
+	/* Copy of the data for queued jobs, NULL otherwise. */
+	uint8_t *data_copy;
+	uint8_t *comp;
+	int ret;
+	gboolean done;
+};
+
+struct zip_writer {
+	FILE *file;
+	uint64_t offset;
+	GArray *entries;
+	uint16_t dos_time, dos_date;
+	uint16_t method;
+	int level;
+	/* Compression workers, and jobs in the archive's member order. */
+	GThreadPool *pool;
+	GQueue *pending;
+	guint max_pending;
+	/* Idle deflate streams, one per concurrent compression at most. */
+	GAsyncQueue *streams;
+	GMutex mutex;
+	GCond cond;
+};
+#endif
 
 struct out_context {
 	gboolean zip_created;
@@ -48,13 +124,39 @@ struct out_context {
 		float *samples;
 		size_t fill_size;
 	} *analog_buff;
+	/* Streaming mode: open archive, chunk numbers, pending metadata. */
+	gboolean streaming;
+	struct zip_writer *writer;
+	GKeyFile *meta;
+	unsigned int logic_chunk_num;
+	unsigned int *analog_chunk_num;
+	/* Compression method, level and number of worker threads. */
+	gboolean store;
+	int level;
+	guint threads;
+	/* Summary levels, accumulated while data gets written. */
+	gboolean summary;
+	struct logic_summary {
+		size_t unitsize;
+		uint64_t samples;
+		GByteArray *records;
+		uint64_t fill;
+		uint8_t *state;
+		uint32_t *transitions;
+	} logic_summary;
+	struct analog_summary {
+		uint64_t samples;
+		GByteArray *records;
+		uint64_t fill;
+		float min, max;
+		double sum;
+	} *analog_summary;
 };
 
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct out_context *outc;
-
-	(void)options;
+	const char *method;
 
 	if (!o->filename || o->filename[0] == '\0') {
 		sr_info("srzip output module requires a file name, cannot save.");
@@ -63,10 +165,532 @@ static int init(struct sr_output *o, GHashTable *options)
 
 	outc = g_malloc0(sizeof(*outc));
 	outc->filename = g_strdup(o->filename);
+	outc->streaming = g_variant_get_boolean(
+		g_hash_table_lookup(options, "streaming"));
+	method = g_variant_get_string(
+		g_hash_table_lookup(options, "compression"), NULL);
+	if (g_ascii_strcasecmp(method, "deflate") == 0) {
+		outc->store = FALSE;
+	} else if (g_ascii_strcasecmp(method, "store") == 0) {
+		outc->store = TRUE;
+	} else {
+		sr_err("Unsupported compression method '%s'.", method);
+		goto err_out;
+	}
+	outc->level = g_variant_get_uint32(
+		g_hash_table_lookup(options, "level"));
+	if (outc->level < 1 || outc->level > 9) {
+		sr_err("Compression level %d out of range 1-9.", outc->level);
+		goto err_out;
+	}
+	outc->summary = g_variant_get_boolean(
+		g_hash_table_lookup(options, "summary"));
+	outc->threads = g_variant_get_uint32(
+		g_hash_table_lookup(options, "threads"));
+	if (!outc->threads) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+		outc->threads = g_get_num_processors();
+#else
+		outc->threads = 1;
+#endif
+	}
+#ifndef HAVE_ZLIB
+	if (outc->streaming) {
+		sr_info("Streaming needs zlib support, using libzip.");
+		outc->streaming = FALSE;
+	}
+#endif
 	o->priv = outc;
 
 	return SR_OK;
+
+err_out:
+	g_free(outc->filename);
+	g_free(outc);
+	return SR_ERR_ARG;
+}
+
+#ifdef HAVE_ZLIB
+static int zip_writer_write(struct zip_writer *zw, const void *data, size_t len)
+{
+	if (!len)
+		return SR_OK;
+	if (fwrite(data, len, 1, zw->file) != 1) {
+		sr_err("Failed to write archive: %s.", g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	zw->offset += len;
+
+	return SR_OK;
+}
+
+static void zip_writer_stream_free(z_stream *zs)
+{
+	deflateEnd(zs);
+	g_free(zs);
+}
+
+/* Take an idle deflate stream, or set up another one. */
+static z_stream *zip_writer_stream_get(struct zip_writer *zw)
+{
+	z_stream *zs;
+
+	if ((zs = g_async_queue_try_pop(zw->streams)))
+		return zs;
+
+	zs = g_malloc0(sizeof(*zs));
+	if (deflateInit2(zs, zw->level, Z_DEFLATED, -MAX_WBITS, 8,
+			Z_DEFAULT_STRATEGY) != Z_OK) {
+		g_free(zs);
+		return NULL;
+	}
+
+	return zs;
+}
+
+static void zip_writer_stream_put(struct zip_writer *zw, z_stream *zs)
+{
+	deflateReset(zs);
+	g_async_queue_push(zw->streams, zs);
+}
+
+/* Determine the member's checksum and compressed content. */
+static void zip_writer_compress(struct zip_writer *zw,
+	struct zip_writer_job *job)
+{
+	z_stream *zs;
+	size_t len, bound;
+
+	len = job->entry.size;
+	job->entry.crc = crc32(crc32(0, Z_NULL, 0), job->data, len);
+	job->entry.comp_size = len;
+	job->ret = SR_OK;
+	if (job->entry.method != ZIP_METHOD_DEFLATE)
+		return;
+
+	if (!(zs = zip_writer_stream_get(zw))) {
+		job->ret = SR_ERR;
+		return;
+	}
+	bound = deflateBound(zs, len);
+	job->comp = g_try_malloc(bound);
+	if (!job->comp) {
+		zip_writer_stream_put(zw, zs);
+		job->ret = SR_ERR_MALLOC;
+		return;
+	}
+	zs->next_in = (Bytef *)job->data;
+	zs->avail_in = len;
+	zs->next_out = job->comp;
+	zs->avail_out = bound;
+	if (deflate(zs, Z_FINISH) == Z_STREAM_END && zs->total_out < len)
+		job->entry.comp_size = zs->total_out;
+	zip_writer_stream_put(zw, zs);
+
+	/* Store the member when compression doesn't pay off. */
+	if (job->entry.comp_size == len) {
+		job->entry.method = ZIP_METHOD_STORE;
+		g_free(job->comp);
+		job->comp = NULL;
+	}
+}
+
+static void zip_writer_worker(gpointer data, gpointer user_data)
+{
+	struct zip_writer_job *job;
+	struct zip_writer *zw;
+
+	job = data;
+	zw = user_data;
+
+	zip_writer_compress(zw, job);
+
+	g_mutex_lock(&zw->mutex);
+	job->done = TRUE;
+	g_cond_broadcast(&zw->cond);
+	g_mutex_unlock(&zw->mutex);
+}
+
+static void zip_writer_job_free(struct zip_writer_job *job)
+{
+	g_free(job->entry.name);
+	g_free(job->data_copy);
+	g_free(job->comp);
+	g_free(job);
+}
+
+/**
+ * Create an archive for sequential writes.
+ *
+ * @param[in] filename The archive's file name.
+ * @param[in] method ZIP_METHOD_DEFLATE or ZIP_METHOD_STORE.
+ * @param[in] level The deflate compression level.
+ * @param[in] threads The number of compression threads, or 0 to have
+ *                    the session thread compress members.
+ *
+ * @returns The archive writer, or NULL on failure.
+ */
+static struct zip_writer *zip_writer_open(const char *filename,
+	uint16_t method, int level, guint threads)
+{
+	struct zip_writer *zw;
+	GDateTime *now;
+	GError *error;
+
+	zw = g_malloc0(sizeof(*zw));
+	zw->file = g_fopen(filename, "wb");
+	if (!zw->file) {
+		sr_err("Failed to create '%s': %s.", filename, g_strerror(errno));
+		g_free(zw);
+		return NULL;
+	}
+	zw->entries = g_array_new(FALSE, FALSE, sizeof(struct zip_writer_entry));
+	zw->method = method;
+	zw->level = level;
+	zw->pending = g_queue_new();
+	zw->streams = g_async_queue_new_full(
+		(GDestroyNotify)zip_writer_stream_free);
+	g_mutex_init(&zw->mutex);
+	g_cond_init(&zw->cond);
+
+	if (threads && method == ZIP_METHOD_DEFLATE) {
+		error = NULL;
+		zw->pool = g_thread_pool_new(zip_writer_worker, zw,
+			threads, FALSE, &error);
+		if (!zw->pool) {
+			sr_warn("Cannot compress in threads: %s.", error->message);
+			g_error_free(error);
+		}
+		/* Bound the memory which queued chunks take. */
+		zw->max_pending = 2 * threads;
+	}
+
+	/* All members get the archive's creation time, in DOS format. */
+	now = g_date_time_new_now_local();
+	zw->dos_time = g_date_time_get_hour(now) << 11;
+	zw->dos_time |= g_date_time_get_minute(now) << 5;
+	zw->dos_time |= g_date_time_get_second(now) / 2;
+	zw->dos_date = MAX(g_date_time_get_year(now) - 1980, 0) << 9;
+	zw->dos_date |= g_date_time_get_month(now) << 5;
+	zw->dos_date |= g_date_time_get_day_of_month(now);
+	g_date_time_unref(now);
+
+	return zw;
+}
+
+/* Write a member's local header and content. */
+static int zip_writer_write_job(struct zip_writer *zw,
+	struct zip_writer_job *job)
+{
+	struct zip_writer_entry *entry;
+	uint8_t header[30], *wrptr;
+	const char *name;
+	int ret;
+
+	if (job->ret != SR_OK) {
+		sr_err("Failed to compress '%s'.", job->entry.name);
+		return job->ret;
+	}
+
+	entry = &job->entry;
+	entry->offset = zw->offset;
+	name = entry->name;
+
+	wrptr = header;
+	write_u32le_inc(&wrptr, ZIP_LOCAL_HEADER_SIG);
+	write_u16le_inc(&wrptr, ZIP_VERSION);
+	write_u16le_inc(&wrptr, 0);
+	write_u16le_inc(&wrptr, entry->method);
+	write_u16le_inc(&wrptr, zw->dos_time);
+	write_u16le_inc(&wrptr, zw->dos_date);
+	write_u32le_inc(&wrptr, entry->crc);
+	write_u32le_inc(&wrptr, entry->comp_size);
+	write_u32le_inc(&wrptr, entry->size);
+	write_u16le_inc(&wrptr, strlen(name));
+	write_u16le_inc(&wrptr, 0);
+	ret = zip_writer_write(zw, header, wrptr - header);
+	if (ret == SR_OK)
+		ret = zip_writer_write(zw, name, strlen(name));
+	if (ret == SR_OK)
+		ret = zip_writer_write(zw, job->comp ? job->comp : job->data,
+			entry->comp_size);
+	if (ret != SR_OK)
+		return ret;
+
+	/* The central directory takes ownership of the name. */
+	g_array_append_val(zw->entries, *entry);
+	entry->name = NULL;
+
+	return SR_OK;
+}
+
+/* Write completed members in order, wait while too many are queued. */
+static int zip_writer_drain(struct zip_writer *zw, guint keep)
+{
+	struct zip_writer_job *job;
+	gboolean done;
+	int ret;
+
+	while ((job = g_queue_peek_head(zw->pending))) {
+		g_mutex_lock(&zw->mutex);
+		if (g_queue_get_length(zw->pending) > keep) {
+			while (!job->done)
+				g_cond_wait(&zw->cond, &zw->mutex);
+		}
+		done = job->done;
+		g_mutex_unlock(&zw->mutex);
+		if (!done)
+			break;
+
+		g_queue_pop_head(zw->pending);
+		ret = zip_writer_write_job(zw, job);
+		zip_writer_job_free(job);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Add a member to the archive.
+ *
+ * Compression runs in the worker threads when there are some, members
+ * still get written in the order in which they were added. Data which
+ * is queued for the workers gets copied, otherwise it is compressed and
+ * written from the caller's buffer. Either way the caller can reuse the
+ * buffer when this returns.
+ *
+ * @param[in] zw The archive writer.
+ * @param[in] name The member's name.
+ * @param[in] data The member's content.
+ * @param[in] len The content's length in bytes.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_writer_add(struct zip_writer *zw, const char *name,
+	const void *data, size_t len)
+{
+	struct zip_writer_job *job;
+	int ret;
+
+	if (len > G_MAXUINT32) {
+		sr_err("Archive member '%s' too large.", name);
+		return SR_ERR_ARG;
+	}
+
+	job = g_malloc0(sizeof(*job));
+	job->entry.name = g_strdup(name);
+	job->entry.size = len;
+	job->entry.method = zw->method;
+	job->data = data;
+
+	if (!zw->pool) {
+		zip_writer_compress(zw, job);
+		ret = zip_writer_write_job(zw, job);
+		zip_writer_job_free(job);
+		return ret;
+	}
+
+	job->data_copy = g_try_malloc(len ? len : 1);
+	if (!job->data_copy) {
+		zip_writer_job_free(job);
+		return SR_ERR_MALLOC;
+	}
+	memcpy(job->data_copy, data, len);
+	job->data = job->data_copy;
+
+	g_queue_push_tail(zw->pending, job);
+	g_thread_pool_push(zw->pool, job, NULL);
+
+	return zip_writer_drain(zw, zw->max_pending);
+}
+
+/* Write the central directory, use ZIP64 records where needed. */
+static int zip_writer_finish(struct zip_writer *zw)
+{
+	struct zip_writer_entry *entry;
+	uint8_t header[56], *wrptr;
+	uint64_t cd_offset, cd_size, eocd64_offset;
+	gboolean zip64, entry64;
+	guint i;
+	int ret;
+
+	ret = zip_writer_drain(zw, 0);
+	if (ret != SR_OK)
+		return ret;
+
+	cd_offset = zw->offset;
+	zip64 = FALSE;
+	for (i = 0; i < zw->entries->len && ret == SR_OK; i++) {
+		entry = &g_array_index(zw->entries, struct zip_writer_entry, i);
+		entry64 = entry->offset >= G_MAXUINT32;
+		wrptr = header;
+		write_u32le_inc(&wrptr, ZIP_CENTRAL_HEADER_SIG);
+		write_u16le_inc(&wrptr, ZIP64_VERSION);
+		write_u16le_inc(&wrptr, entry64 ? ZIP64_VERSION : ZIP_VERSION);
+		write_u16le_inc(&wrptr, 0);
+		write_u16le_inc(&wrptr, entry->method);
+		write_u16le_inc(&wrptr, zw->dos_time);
+		write_u16le_inc(&wrptr, zw->dos_date);
+		write_u32le_inc(&wrptr, entry->crc);
+		write_u32le_inc(&wrptr, entry->comp_size);
+		write_u32le_inc(&wrptr, entry->size);
+		write_u16le_inc(&wrptr, strlen(entry->name));
+		write_u16le_inc(&wrptr, entry64 ? 12 : 0);
+		write_u16le_inc(&wrptr, 0);
+		write_u16le_inc(&wrptr, 0);
+		write_u16le_inc(&wrptr, 0);
+		write_u32le_inc(&wrptr, 0);
+		write_u32le_inc(&wrptr, entry64 ? G_MAXUINT32 : entry->offset);
+		ret = zip_writer_write(zw, header, wrptr - header);
+		if (ret == SR_OK)
+			ret = zip_writer_write(zw, entry->name, strlen(entry->name));
+		if (ret == SR_OK && entry64) {
+			wrptr = header;
+			write_u16le_inc(&wrptr, ZIP64_EXTRA_ID);
+			write_u16le_inc(&wrptr, sizeof(uint64_t));
+			write_u64le_inc(&wrptr, entry->offset);
+			ret = zip_writer_write(zw, header, wrptr - header);
+			zip64 = TRUE;
+		}
+	}
+	if (ret != SR_OK)
+		return ret;
+	cd_size = zw->offset - cd_offset;
+	if (cd_offset >= G_MAXUINT32 || cd_size >= G_MAXUINT32)
+		zip64 = TRUE;
+	if (zw->entries->len >= G_MAXUINT16)
+		zip64 = TRUE;
+
+	if (zip64) {
+		eocd64_offset = zw->offset;
+		wrptr = header;
+		write_u32le_inc(&wrptr, ZIP64_EOCD_SIG);
+		write_u64le_inc(&wrptr, 44);
+		write_u16le_inc(&wrptr, ZIP64_VERSION);
+		write_u16le_inc(&wrptr, ZIP64_VERSION);
+		write_u32le_inc(&wrptr, 0);
+		write_u32le_inc(&wrptr, 0);
+		write_u64le_inc(&wrptr, zw->entries->len);
+		write_u64le_inc(&wrptr, zw->entries->len);
+		write_u64le_inc(&wrptr, cd_size);
+		write_u64le_inc(&wrptr, cd_offset);
+		ret = zip_writer_write(zw, header, wrptr - header);
+		if (ret != SR_OK)
+			return ret;
+
+		wrptr = header;
+		write_u32le_inc(&wrptr, ZIP64_LOCATOR_SIG);
+		write_u32le_inc(&wrptr, 0);
+		write_u64le_inc(&wrptr, eocd64_offset);
+		write_u32le_inc(&wrptr, 1);
+		ret = zip_writer_write(zw, header, wrptr - header);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	wrptr = header;
+	write_u32le_inc(&wrptr, ZIP_EOCD_SIG);
+	write_u16le_inc(&wrptr, 0);
+	write_u16le_inc(&wrptr, 0);
+	write_u16le_inc(&wrptr, MIN(zw->entries->len, G_MAXUINT16));
+	write_u16le_inc(&wrptr, MIN(zw->entries->len, G_MAXUINT16));
+	write_u32le_inc(&wrptr, MIN(cd_size, G_MAXUINT32));
+	write_u32le_inc(&wrptr, MIN(cd_offset, G_MAXUINT32));
+	write_u16le_inc(&wrptr, 0);
+
+	return zip_writer_write(zw, header, wrptr - header);
+}
+
+static int zip_writer_close(struct zip_writer *zw)
+{
+	struct zip_writer_entry *entry;
+	guint i;
+	int ret;
+
+	/* Wait for workers, discard what was not written after errors. */
+	if (zw->pool)
+		g_thread_pool_free(zw->pool, FALSE, TRUE);
+	g_queue_free_full(zw->pending, (GDestroyNotify)zip_writer_job_free);
+	g_async_queue_unref(zw->streams);
+	g_mutex_clear(&zw->mutex);
+	g_cond_clear(&zw->cond);
+
+	ret = SR_OK;
+	if (fclose(zw->file) != 0) {
+		sr_err("Failed to close archive: %s.", g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+	for (i = 0; i < zw->entries->len; i++) {
+		entry = &g_array_index(zw->entries, struct zip_writer_entry, i);
+		g_free(entry->name);
+	}
+	g_array_free(zw->entries, TRUE);
+	g_free(zw);
+
+	return ret;
+}
+
+static int stream_append(struct out_context *outc,
+	const uint8_t *buf, size_t unitsize, size_t length)
+{
+	char *chunkname;
+	int ret;
+
+	if (length % unitsize != 0) {
+		sr_warn("Chunk size %zu not a multiple of the"
+			" unit size %zu.", length, unitsize);
+	}
+	if (!outc->logic_chunk_num)
+		g_key_file_set_integer(outc->meta, "device 1",
+			"unitsize", unitsize);
+
+	chunkname = g_strdup_printf("logic-1-%u", ++outc->logic_chunk_num);
+	ret = zip_writer_add(outc->writer, chunkname, buf, length);
+	g_free(chunkname);
+
+	return ret;
+}
+
+static int stream_append_analog(struct out_context *outc,
+	const float *values, size_t count, size_t ch_nr)
+{
+	unsigned int *chunk_num;
+	char *chunkname;
+	int ret;
+
+	chunk_num = &outc->analog_chunk_num[ch_nr - outc->first_analog_index];
+	chunkname = g_strdup_printf("analog-1-%zu-%u", ch_nr, ++*chunk_num);
+	ret = zip_writer_add(outc->writer, chunkname,
+		values, sizeof(values[0]) * count);
+	g_free(chunkname);
+
+	return ret;
+}
+
+/* Write the metadata and the central directory, close the archive. */
+static int stream_finish(struct out_context *outc)
+{
+	char *metabuf;
+	gsize metalen;
+	int ret;
+
+	ret = SR_ERR;
+	if (outc->meta) {
+		metabuf = g_key_file_to_data(outc->meta, &metalen, NULL);
+		ret = zip_writer_add(outc->writer, "metadata", metabuf, metalen);
+		g_free(metabuf);
+	}
+	if (ret == SR_OK)
+		ret = zip_writer_finish(outc->writer);
+	if (zip_writer_close(outc->writer) != SR_OK && ret == SR_OK)
+		ret = SR_ERR_IO;
+	outc->writer = NULL;
+
+	return ret;
 }
+#endif
 
 static int zip_create(const struct sr_output *o)
 {
@@ -94,20 +718,35 @@ static int zip_create(const struct sr_output *o)
 		g_variant_unref(gvar);
 	}
 
-	/* Quietly delete it first, libzip wants replace ops otherwise. */
-	g_unlink(outc->filename);
-	zipfile = zip_open(outc->filename, ZIP_CREATE, NULL);
-	if (!zipfile)
-		return SR_ERR;
+	zipfile = NULL;
+#ifdef HAVE_ZLIB
+	if (outc->streaming) {
+		/* A single thread is best spent compressing inline. */
+		outc->writer = zip_writer_open(outc->filename,
+			outc->store ? ZIP_METHOD_STORE : ZIP_METHOD_DEFLATE,
+			outc->level, outc->threads > 1 ? outc->threads : 0);
+		if (!outc->writer)
+			return SR_ERR_IO;
+		if (zip_writer_add(outc->writer, "version", "2", 1) != SR_OK)
+			return SR_ERR_IO;
+	}
+#endif
+	if (!outc->writer) {
+		/* Quietly delete it first, libzip wants replace ops otherwise. */
+		g_unlink(outc->filename);
+		zipfile = zip_open(outc->filename, ZIP_CREATE, NULL);
+		if (!zipfile)
+			return SR_ERR;
 
-	/* "version" */
-	versrc = zip_source_buffer(zipfile, "2", 1, FALSE);
-	if (zip_file_add(zipfile, "version", versrc, 0) < 0) {
-		sr_err("Error saving version into zipfile: %s",
-			zip_strerror(zipfile));
-		zip_source_free(versrc);
-		zip_discard(zipfile);
-		return SR_ERR;
+		/* "version" */
+		versrc = zip_source_buffer(zipfile, "2", 1, FALSE);
+		if (zip_file_add(zipfile, "version", versrc, 0) < 0) {
+			sr_err("Error saving version into zipfile: %s",
+				zip_strerror(zipfile));
+			zip_source_free(versrc);
+			zip_discard(zipfile);
+			return SR_ERR;
+		}
 	}
 
 	/* init "metadata" */
@@ -226,6 +865,20 @@ static int zip_create(const struct sr_output *o)
 		outc->analog_buff[index].alloc_size = alloc_size;
 		outc->analog_buff[index].fill_size = 0;
 	}
+	if (outc->summary) {
+		outc->analog_summary = g_malloc0(sizeof(outc->analog_summary[0])
+			* outc->analog_ch_count + 1);
+	}
+
+#ifdef HAVE_ZLIB
+	if (outc->writer) {
+		/* The metadata gets written last, it's not complete yet. */
+		outc->meta = meta;
+		outc->analog_chunk_num = g_malloc0(sizeof(outc->analog_chunk_num[0])
+			* outc->analog_ch_count + 1);
+		return SR_OK;
+	}
+#endif
 
 	metabuf = g_key_file_to_data(meta, &metalen, NULL);
 	g_key_file_free(meta);
@@ -251,6 +904,356 @@ static int zip_create(const struct sr_output *o)
 	return SR_OK;
 }
 
+/* Apply the configured compression to a member the legacy way. */
+static void zip_set_compression(struct zip *archive, int64_t idx,
+	const struct out_context *outc)
+{
+	if (zip_set_file_compression(archive, idx,
+			outc->store ? ZIP_CM_STORE : ZIP_CM_DEFLATE,
+			outc->level) < 0)
+		sr_warn("Cannot set member compression: %s",
+			zip_strerror(archive));
+}
+
+/* Account a record's transitions, saturate at the field's capacity. */
+static void summary_add_u32le(uint8_t *p, uint64_t count)
+{
+	count += read_u32le(p);
+	write_u32le(p, MIN(count, G_MAXUINT32));
+}
+
+/* Count transitions between two samples per channel. */
+static void summary_add_transitions(uint8_t *transitions,
+	const uint8_t *prev, const uint8_t *next, size_t unitsize)
+{
+	size_t b;
+	uint8_t diff;
+	int bit;
+
+	for (b = 0; b < unitsize; b++) {
+		diff = prev[b] ^ next[b];
+		for (bit = 0; diff; bit++, diff >>= 1) {
+			if (diff & 1)
+				summary_add_u32le(&transitions[4 * (8 * b + bit)], 1);
+		}
+	}
+}
+
+static void summary_logic_flush(struct logic_summary *ls)
+{
+	uint8_t *record;
+	size_t i, u;
+
+	if (!ls->fill)
+		return;
+
+	u = ls->unitsize;
+	g_byte_array_set_size(ls->records, ls->records->len + 36 * u);
+	record = &ls->records->data[ls->records->len - 36 * u];
+	memcpy(record, ls->state, 4 * u);
+	for (i = 0; i < 8 * u; i++)
+		write_u32le(&record[4 * u + 4 * i], ls->transitions[i]);
+
+	memset(ls->transitions, 0, 8 * u * sizeof(ls->transitions[0]));
+	ls->fill = 0;
+}
+
+/* Accumulate logic data into first level records. */
+static void summary_logic_add(struct logic_summary *ls,
+	const uint8_t *buf, size_t unitsize, size_t length)
+{
+	uint8_t *first, *last, *or_mask, *and_mask, diff;
+	const uint8_t *sample;
+	size_t i, b;
+	int bit;
+
+	if (!ls->unitsize) {
+		ls->unitsize = unitsize;
+		ls->records = g_byte_array_new();
+		ls->state = g_malloc0(4 * unitsize);
+		ls->transitions = g_malloc0_n(8 * unitsize,
+			sizeof(ls->transitions[0]));
+	}
+	if (unitsize != ls->unitsize)
+		return;
+
+	first = ls->state;
+	last = &first[unitsize];
+	or_mask = &last[unitsize];
+	and_mask = &or_mask[unitsize];
+	for (i = 0; i + unitsize <= length; i += unitsize) {
+		sample = &buf[i];
+		if (!ls->fill) {
+			memcpy(first, sample, unitsize);
+			memcpy(or_mask, sample, unitsize);
+			memcpy(and_mask, sample, unitsize);
+		}
+		for (b = 0; b < unitsize; b++) {
+			or_mask[b] |= sample[b];
+			and_mask[b] &= sample[b];
+			diff = ls->fill ? last[b] ^ sample[b] : 0;
+			for (bit = 0; diff; bit++, diff >>= 1)
+				ls->transitions[8 * b + bit] += diff & 1;
+		}
+		memcpy(last, sample, unitsize);
+		ls->samples++;
+		if (++ls->fill == SUMMARY_BASE)
+			summary_logic_flush(ls);
+	}
+}
+
+/* Merge a level's records into the next level's. */
+static GByteArray *summary_logic_merge(const GByteArray *src,
+	size_t unitsize)
+{
+	GByteArray *dst;
+	const uint8_t *in;
+	uint8_t *out;
+	size_t size, count, i, j, b;
+
+	size = 36 * unitsize;
+	count = src->len / size;
+	dst = g_byte_array_new();
+	for (i = 0; i < count; i += SUMMARY_FACTOR) {
+		g_byte_array_set_size(dst, dst->len + size);
+		out = &dst->data[dst->len - size];
+		memcpy(out, &src->data[i * size], size);
+		for (j = i + 1; j < MIN(i + SUMMARY_FACTOR, count); j++) {
+			in = &src->data[j * size];
+			/* Transitions at the boundary between records. */
+			summary_add_transitions(&out[4 * unitsize],
+				&out[unitsize], in, unitsize);
+			memcpy(&out[unitsize], &in[unitsize], unitsize);
+			for (b = 0; b < unitsize; b++) {
+				out[2 * unitsize + b] |= in[2 * unitsize + b];
+				out[3 * unitsize + b] &= in[3 * unitsize + b];
+			}
+			for (b = 0; b < 8 * unitsize; b++) {
+				summary_add_u32le(&out[4 * unitsize + 4 * b],
+					read_u32le(&in[4 * unitsize + 4 * b]));
+			}
+		}
+	}
+
+	return dst;
+}
+
+static void summary_analog_flush(struct analog_summary *as)
+{
+	uint8_t *record;
+
+	if (!as->fill)
+		return;
+
+	g_byte_array_set_size(as->records,
+		as->records->len + SUMMARY_ANALOG_SIZE);
+	record = &as->records->data[as->records->len - SUMMARY_ANALOG_SIZE];
+	write_fltle_inc(&record, as->min);
+	write_fltle_inc(&record, as->max);
+	write_fltle_inc(&record, as->sum / as->fill);
+	as->fill = 0;
+}
+
+/* Accumulate an analog channel's data into first level records. */
+static void summary_analog_add(struct analog_summary *as,
+	const float *values, size_t count)
+{
+	size_t i;
+
+	if (!as->records)
+		as->records = g_byte_array_new();
+
+	for (i = 0; i < count; i++) {
+		if (!as->fill) {
+			as->min = as->max = values[i];
+			as->sum = 0;
+		}
+		as->min = MIN(as->min, values[i]);
+		as->max = MAX(as->max, values[i]);
+		as->sum += values[i];
+		as->samples++;
+		if (++as->fill == SUMMARY_BASE)
+			summary_analog_flush(as);
+	}
+}
+
+/*
+ * Merge a level's records into the next level's. The means get weighted
+ * by the records' sample counts, only the last one can be partial.
+ */
+static GByteArray *summary_analog_merge(const GByteArray *src,
+	uint64_t record_samples, uint64_t total)
+{
+	GByteArray *dst;
+	const uint8_t *in;
+	uint8_t *out;
+	size_t count, i, j;
+	uint64_t samples, weight;
+	float min, max;
+	double sum;
+
+	count = src->len / SUMMARY_ANALOG_SIZE;
+	dst = g_byte_array_new();
+	for (i = 0; i < count; i += SUMMARY_FACTOR) {
+		samples = 0;
+		sum = 0;
+		min = max = 0;
+		for (j = i; j < MIN(i + SUMMARY_FACTOR, count); j++) {
+			in = &src->data[j * SUMMARY_ANALOG_SIZE];
+			weight = MIN(record_samples, total - j * record_samples);
+			if (j == i || read_fltle(&in[0]) < min)
+				min = read_fltle(&in[0]);
+			if (j == i || read_fltle(&in[4]) > max)
+				max = read_fltle(&in[4]);
+			sum += (double)read_fltle(&in[8]) * weight;
+			samples += weight;
+		}
+		g_byte_array_set_size(dst, dst->len + SUMMARY_ANALOG_SIZE);
+		out = &dst->data[dst->len - SUMMARY_ANALOG_SIZE];
+		write_fltle_inc(&out, min);
+		write_fltle_inc(&out, max);
+		write_fltle_inc(&out, samples ? sum / samples : 0);
+	}
+
+	return dst;
+}
+
+/*
+ * Determine all of a stream's levels, up to a single record. Collect
+ * the archive members, and return the number of levels.
+ */
+static int summary_collect(GPtrArray *names, GPtrArray *members,
+	const char *basename, GByteArray *records, size_t record_size,
+	size_t unitsize, uint64_t total)
+{
+	uint64_t record_samples;
+	int level;
+
+	record_samples = SUMMARY_BASE;
+	for (level = 0; ; level++) {
+		g_ptr_array_add(names, g_strdup_printf("summary-%s-%d",
+			basename, level));
+		g_ptr_array_add(members, records);
+		if (records->len <= record_size)
+			break;
+		if (unitsize)
+			records = summary_logic_merge(records, unitsize);
+		else
+			records = summary_analog_merge(records,
+				record_samples, total);
+		record_samples *= SUMMARY_FACTOR;
+	}
+
+	return level + 1;
+}
+
+/* Write the summary levels of all channels, and their parameters. */
+static int summary_write(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct logic_summary *ls;
+	struct analog_summary *as;
+	struct zip *archive;
+	struct zip_source *src;
+	GPtrArray *names, *members;
+	GByteArray *data;
+	GKeyFile *kf;
+	char *basename, *keybuf;
+	gsize keylen;
+	size_t idx;
+	int64_t i;
+	int levels, ret;
+
+	outc = o->priv;
+	if (!outc->summary)
+		return SR_OK;
+	outc->summary = FALSE;
+
+	names = g_ptr_array_new_with_free_func(g_free);
+	members = g_ptr_array_new_with_free_func(
+		(GDestroyNotify)g_byte_array_unref);
+	levels = 0;
+
+	ls = &outc->logic_summary;
+	if (ls->samples) {
+		summary_logic_flush(ls);
+		levels = summary_collect(names, members, "logic-1",
+			ls->records, 36 * ls->unitsize, ls->unitsize,
+			ls->samples);
+		ls->records = NULL;
+	}
+	for (idx = 0; idx < outc->analog_ch_count; idx++) {
+		as = &outc->analog_summary[idx];
+		if (!as->samples)
+			continue;
+		summary_analog_flush(as);
+		basename = g_strdup_printf("analog-1-%zu",
+			outc->first_analog_index + idx);
+		levels = MAX(levels, summary_collect(names, members, basename,
+			as->records, SUMMARY_ANALOG_SIZE, 0, as->samples));
+		g_free(basename);
+		as->records = NULL;
+	}
+
+	kf = g_key_file_new();
+	g_key_file_set_integer(kf, "summary", "version", SUMMARY_VERSION);
+	g_key_file_set_integer(kf, "summary", "base", SUMMARY_BASE);
+	g_key_file_set_integer(kf, "summary", "factor", SUMMARY_FACTOR);
+	g_key_file_set_integer(kf, "summary", "levels", levels);
+	keybuf = g_key_file_to_data(kf, &keylen, NULL);
+	g_key_file_free(kf);
+	data = g_byte_array_new();
+	g_byte_array_append(data, (const guint8 *)keybuf, keylen);
+	g_free(keybuf);
+	g_ptr_array_add(names, g_strdup("summary"));
+	g_ptr_array_add(members, data);
+
+	ret = SR_OK;
+#ifdef HAVE_ZLIB
+	if (outc->writer) {
+		for (idx = 0; ret == SR_OK && idx < names->len; idx++) {
+			data = g_ptr_array_index(members, idx);
+			ret = zip_writer_add(outc->writer,
+				g_ptr_array_index(names, idx),
+				data->data, data->len);
+		}
+		g_ptr_array_free(names, TRUE);
+		g_ptr_array_free(members, TRUE);
+		return ret;
+	}
+#endif
+
+	if (!(archive = zip_open(outc->filename, 0, NULL))) {
+		g_ptr_array_free(names, TRUE);
+		g_ptr_array_free(members, TRUE);
+		return SR_ERR;
+	}
+	for (idx = 0; idx < names->len; idx++) {
+		data = g_ptr_array_index(members, idx);
+		src = zip_source_buffer(archive, data->data, data->len, FALSE);
+		i = zip_file_add(archive, g_ptr_array_index(names, idx), src,
+			ZIP_FL_OVERWRITE);
+		if (i < 0) {
+			sr_err("Failed to add summary: %s", zip_strerror(archive));
+			zip_source_free(src);
+			ret = SR_ERR;
+			break;
+		}
+		zip_set_compression(archive, i, outc);
+	}
+	if (ret != SR_OK) {
+		zip_discard(archive);
+	} else if (zip_close(archive) < 0) {
+		sr_err("Error saving session file: %s", zip_strerror(archive));
+		zip_discard(archive);
+		ret = SR_ERR;
+	}
+	g_ptr_array_free(names, TRUE);
+	g_ptr_array_free(members, TRUE);
+
+	return ret;
+}
+
 /**
  * Append a block of logic data to an srzip archive.
  *
@@ -283,6 +1286,14 @@ static int zip_append(const struct sr_output *o,
 		return SR_OK;
 
 	outc = o->priv;
+
+	if (outc->summary)
+		summary_logic_add(&outc->logic_summary, buf, unitsize, length);
+
+#ifdef HAVE_ZLIB
+	if (outc->writer)
+		return stream_append(outc, buf, unitsize, length);
+#endif
 	if (!(archive = zip_open(outc->filename, 0, NULL)))
 		return SR_ERR;
 
@@ -373,6 +1384,7 @@ static int zip_append(const struct sr_output *o,
 		g_free(metabuf);
 		return SR_ERR;
 	}
+	zip_set_compression(archive, i, outc);
 	if (zip_close(archive) < 0) {
 		sr_err("Error saving session file: %s", zip_strerror(archive));
 		zip_discard(archive);
@@ -499,6 +1511,65 @@ static int zip_append_queue(const struct sr_output *o,
 	return SR_OK;
 }
 
+/**
+ * Queue a run of identical logic samples for srzip archive writes.
+ *
+ * Fills the local buffer with copies of the sample, so that long runs
+ * need not get expanded in the session feed.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] value The sample value.
+ * @param[in] feed_unitsize Logic data unit size (bytes per sample).
+ * @param[in] count Number of samples in the run.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_append_queue_run(const struct sr_output *o,
+	const uint8_t *value, size_t feed_unitsize, uint64_t count)
+{
+	struct out_context *outc;
+	struct logic_buff *buff;
+	size_t unit_size, fill_count, done, total, len;
+	uint8_t *wrptr;
+	int ret;
+
+	outc = o->priv;
+	buff = &outc->logic_buff;
+	unit_size = buff->zip_unit_size;
+	if (!unit_size)
+		return SR_OK;
+
+	while (count) {
+		if (buff->fill_size == buff->alloc_size) {
+			ret = zip_append(o, buff->samples, unit_size,
+				buff->fill_size * unit_size);
+			if (ret != SR_OK)
+				return ret;
+			buff->fill_size = 0;
+		}
+		fill_count = MIN(count, buff->alloc_size - buff->fill_size);
+		wrptr = &buff->samples[buff->fill_size * unit_size];
+
+		/* Adjust the unit size, then copy ever larger blocks. */
+		memset(wrptr, 0, unit_size);
+		memcpy(wrptr, value, MIN(feed_unitsize, unit_size));
+		total = fill_count * unit_size;
+		if (unit_size == 1) {
+			memset(wrptr, wrptr[0], total);
+		} else {
+			for (done = unit_size; done < total; done += len) {
+				len = MIN(done, total - done);
+				memcpy(wrptr + done, wrptr, len);
+			}
+		}
+
+		buff->fill_size += fill_count;
+		count -= fill_count;
+	}
+
+	return SR_OK;
+}
+
 /**
  * Append analog data of a channel to an srzip archive.
  *
@@ -527,6 +1598,16 @@ static int zip_append_analog(const struct sr_output *o,
 
 	outc = o->priv;
 
+	if (outc->summary) {
+		summary_analog_add(&outc->analog_summary[
+			ch_nr - outc->first_analog_index], values, count);
+	}
+
+#ifdef HAVE_ZLIB
+	if (outc->writer)
+		return stream_append_analog(outc, values, count, ch_nr);
+#endif
+
 	if (!(archive = zip_open(outc->filename, 0, NULL)))
 		return SR_ERR;
 
@@ -564,6 +1645,7 @@ static int zip_append_analog(const struct sr_output *o,
 		return SR_ERR;
 	}
 	g_free(chunkname);
+	zip_set_compression(archive, i, outc);
 	if (zip_close(archive) < 0) {
 		sr_err("Error saving session file: %s", zip_strerror(archive));
 		g_free(basename);
@@ -688,7 +1770,11 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
+	struct sr_logic_rle_iter iter;
 	const struct sr_config *src;
+	const uint8_t *value;
+	uint64_t count;
 	GSList *l;
 	int ret;
 
@@ -719,6 +1805,20 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		if (ret != SR_OK)
 			return ret;
 		break;
+	case SR_DF_LOGIC_RLE:
+		if (!outc->zip_created) {
+			if ((ret = zip_create(o)) != SR_OK)
+				return ret;
+			outc->zip_created = TRUE;
+		}
+		rle = packet->payload;
+		sr_logic_rle_iter_init(&iter, rle);
+		while (sr_logic_rle_iter_next(&iter, &value, &count)) {
+			ret = zip_append_queue_run(o, value, rle->unitsize, count);
+			if (ret != SR_OK)
+				return ret;
+		}
+		break;
 	case SR_DF_ANALOG:
 		if (!outc->zip_created) {
 			if ((ret = zip_create(o)) != SR_OK)
@@ -738,6 +1838,16 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			ret = zip_append_analog_queue(o, NULL, TRUE);
 			if (ret != SR_OK)
 				return ret;
+			ret = summary_write(o);
+			if (ret != SR_OK)
+				return ret;
+#ifdef HAVE_ZLIB
+			if (outc->writer) {
+				ret = stream_finish(outc);
+				if (ret != SR_OK)
+					return ret;
+			}
+#endif
 		}
 		break;
 	}
@@ -746,11 +1856,28 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 }
 
 static struct sr_option options[] = {
+	{"streaming", "Streaming", "Keep the archive open and write it sequentially", NULL, NULL},
+	{"compression", "Compression", "Compression method for archive members", NULL, NULL},
+	{"level", "Level", "Deflate compression level (1-9)", NULL, NULL},
+	{"threads", "Threads", "Number of compression threads (0 = all cores)", NULL, NULL},
+	{"summary", "Summary", "Store min/max summaries at several zoom levels", NULL, NULL},
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_boolean(TRUE));
+		options[1].def = g_variant_ref_sink(g_variant_new_string("deflate"));
+		options[1].values = g_slist_append(options[1].values,
+				g_variant_ref_sink(g_variant_new_string("deflate")));
+		options[1].values = g_slist_append(options[1].values,
+				g_variant_ref_sink(g_variant_new_string("store")));
+		options[2].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_LEVEL));
+		options[3].def = g_variant_ref_sink(g_variant_new_uint32(0));
+		options[4].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+	}
+
 	return options;
 }
 
@@ -761,6 +1888,27 @@ static int cleanup(struct sr_output *o)
 
 	outc = o->priv;
 
+#ifdef HAVE_ZLIB
+	/* Keep what was received when the session didn't end regularly. */
+	if (outc->writer) {
+		zip_append_queue(o, NULL, 0, 0, TRUE);
+		zip_append_analog_queue(o, NULL, TRUE);
+		summary_write(o);
+		stream_finish(outc);
+	}
+#endif
+	if (outc->logic_summary.records)
+		g_byte_array_unref(outc->logic_summary.records);
+	g_free(outc->logic_summary.state);
+	g_free(outc->logic_summary.transitions);
+	for (idx = 0; outc->analog_summary && idx < outc->analog_ch_count; idx++) {
+		if (outc->analog_summary[idx].records)
+			g_byte_array_unref(outc->analog_summary[idx].records);
+	}
+	g_free(outc->analog_summary);
+	if (outc->meta)
+		g_key_file_free(outc->meta);
+	g_free(outc->analog_chunk_num);
 	g_free(outc->analog_index_map);
 	g_free(outc->filename);
 	g_free(outc->logic_buff.samples);
@@ -779,7 +1927,7 @@ SR_PRIV struct sr_output_module output_srzip = {
 	.name = "srzip",
 	.desc = "srzip session file format data",
 	.exts = (const char*[]){"sr", NULL},
-	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING | SR_OUTPUT_LOGIC_RLE,
 	.options = get_options,
 	.init = init,
 	.receive = receive,
@@ -979,6 +979,77 @@ static int write_completed_changes(struct context *ctx, GString *out)
 	return SR_OK;
 }
 
+/*
+ * Track the value changes of the logic channels in a sample, and queue
+ * or emit the text for them.
+ */
+static void logic_sample(struct context *ctx, GString *out,
+	const uint8_t *sample, size_t unit_size, uint64_t snum_curr)
+{
+	struct vcd_channel_desc *desc;
+	size_t index, p;
+	gboolean changed;
+	GString *s_val;
+	uint8_t prevbit, curbit;
+	double ts;
+
+	/* Check whether any logic value has changed. */
+	changed = memcmp(ctx->last_logic, sample, unit_size) != 0;
+	changed |= snum_curr == 0;
+	if (!changed)
+		return;
+	memcpy(ctx->last_logic, sample, unit_size);
+
+	/*
+	 * Start or continue tracking that sample number.
+	 * Avoid string copies for logic-only setups.
+	 */
+	if (ctx->immediate_write) {
+		ts = snum_to_ts(ctx, snum_curr);
+		append_vcd_timestamp(out, ts, FALSE);
+	} else {
+		queue_samplenum(ctx, snum_curr);
+	}
+
+	/* Iterate over individual logic channels. */
+	for (p = 0; p < ctx->enabled_count; p++) {
+		/*
+		 * TODO Check whether the mapping from
+		 * data image positions to channel numbers
+		 * is required. Experiments suggest that
+		 * the data image "is dense", and packs
+		 * bits of enabled channels, and leaves no
+		 * room for positions of disabled channels.
+		 */
+		desc = &ctx->channels[p];
+		if (desc->type != SR_CHANNEL_LOGIC)
+			continue;
+		index = desc->index;
+		prevbit = desc->last.logic;
+
+		/* Skip over unchanged values. */
+		curbit = sample[index / 8];
+		curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
+		if (snum_curr != 0 && prevbit == curbit)
+			continue;
+		desc->last.logic = curbit;
+
+		/*
+		 * Queue, or immediately emit the text for
+		 * the observed value change.
+		 */
+		if (ctx->immediate_write) {
+			g_string_append_c(out, ' ');
+			s_val = out;
+		} else {
+			s_val = queue_value_text_prep(ctx);
+			if (!s_val)
+				break;
+		}
+		format_vcd_value_bit(s_val, curbit, desc->name);
+	}
+}
+
 /* Get packets from the session feed, generate output text. */
 static int receive(const struct sr_output *o,
 	const struct sr_datafeed_packet *packet, GString **out)
@@ -987,14 +1058,16 @@ static int receive(const struct sr_output *o,
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
+	struct sr_logic_rle_iter iter;
 	const struct sr_config *src;
 	GSList *l;
 	struct vcd_channel_desc *desc;
-	uint64_t snum_curr;
-	size_t count, index, p, unit_size;
+	uint64_t snum_curr, run_count;
+	size_t count, index, unit_size;
 	gboolean changed;
 	GString *s_val;
-	uint8_t *sample, *last_logic, prevbit, curbit;
+	const uint8_t *sample, *run_value;
 	GSList *channels;
 	struct sr_channel *channel;
 	int rc;
@@ -1026,71 +1099,28 @@ static int receive(const struct sr_output *o,
 		snum_curr = get_last_snum_logic(ctx);
 		upd_last_snum_logic(ctx, count);
 
-		last_logic = ctx->last_logic;
 		while (count--) {
-			/* Check whether any logic value has changed. */
-			changed = memcmp(last_logic, sample, unit_size) != 0;
-			changed |= snum_curr == 0;
-			if (changed)
-				memcpy(last_logic, sample, unit_size);
-
-			/*
-			 * Start or continue tracking that sample number.
-			 * Avoid string copies for logic-only setups.
-			 */
-			if (changed) {
-				if (ctx->immediate_write) {
-					ts = snum_to_ts(ctx, snum_curr);
-					append_vcd_timestamp(*out, ts, FALSE);
-				} else {
-					queue_samplenum(ctx, snum_curr);
-				}
-			}
-
-			/* Iterate over individual logic channels. */
-			for (p = 0; changed && p < ctx->enabled_count; p++) {
-				/*
-				 * TODO Check whether the mapping from
-				 * data image positions to channel numbers
-				 * is required. Experiments suggest that
-				 * the data image "is dense", and packs
-				 * bits of enabled channels, and leaves no
-				 * room for positions of disabled channels.
-				 */
-				desc = &ctx->channels[p];
-				if (desc->type != SR_CHANNEL_LOGIC)
-					continue;
-				index = desc->index;
-				prevbit = desc->last.logic;
-
-				/* Skip over unchanged values. */
-				curbit = sample[index / 8];
-				curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
-				if (snum_curr != 0 && prevbit == curbit)
-					continue;
-				desc->last.logic = curbit;
-
-				/*
-				 * Queue, or immediately emit the text for
-				 * the observed value change.
-				 */
-				if (ctx->immediate_write) {
-					g_string_append_c(*out, ' ');
-					s_val = *out;
-				} else {
-					s_val = queue_value_text_prep(ctx);
-					if (!s_val)
-						break;
-				}
-				format_vcd_value_bit(s_val, curbit, desc->name);
-			}
-
-			/* Advance to next set of logic samples. */
+			logic_sample(ctx, *out, sample, unit_size, snum_curr);
 			snum_curr++;
 			sample += unit_size;
 		}
 		write_completed_changes(ctx, *out);
 		break;
+	case SR_DF_LOGIC_RLE:
+		*out = chk_header(o);
+
+		/* Only the first sample of a run can change values. */
+		rle = packet->payload;
+		unit_size = rle->unitsize;
+		snum_curr = get_last_snum_logic(ctx);
+		upd_last_snum_logic(ctx, sr_logic_rle_num_samples(rle));
+		sr_logic_rle_iter_init(&iter, rle);
+		while (sr_logic_rle_iter_next(&iter, &run_value, &run_count)) {
+			logic_sample(ctx, *out, run_value, unit_size, snum_curr);
+			snum_curr += run_count;
+		}
+		write_completed_changes(ctx, *out);
+		break;
 	case SR_DF_ANALOG:
 		*out = chk_header(o);
 
@@ -1208,7 +1238,7 @@ struct sr_output_module output_vcd = {
 	.name = "VCD",
 	.desc = "Value Change Dump data",
 	.exts = (const char*[]){"vcd", NULL},
-	.flags = 0,
+	.flags = SR_OUTPUT_LOGIC_RLE,
 	.options = NULL,
 	.init = init,
 	.receive = receive,
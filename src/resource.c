@@ -20,6 +20,7 @@
 #include <config.h>
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
@@ -33,8 +34,32 @@
  * @file
  *
  * Access to resource files.
+ *
+ * Firmware images get uploaded whenever a device is opened. Their
+ * content is kept in memory for the lifetime of the libsigrok context,
+ * files which are found in the default locations are read again when
+ * they change.
+ * The context also remembers which image was uploaded to which device,
+ * so drivers can skip uploads of images which are in place already.
  */
 
+/* Identifies a version of a file, see resource_file_id_get(). */
+struct resource_file_id {
+	guint64 dev;
+	guint64 ino;
+	gint64 mtime_ns;
+	gint64 size;
+};
+
+/* A resource which is kept in memory, see sr_resource_get(). */
+struct resource_cache_entry {
+	GBytes *bytes;
+	char *checksum;
+	/* File in a default location, to notice when it changes. */
+	char *filename;
+	struct resource_file_id file_id;
+};
+
 /**
  * Get a list of paths where we look for resource (e.g. firmware) files.
  *
@@ -156,6 +181,29 @@ static FILE *try_open_file(const char *datadir, const char *subdir,
 	return file;
 }
 
+/* Find a resource file in the default locations. */
+static char *resource_find_default(int type, const char *name)
+{
+	GSList *paths, *p;
+	char *filename;
+
+	if (type != SR_RESOURCE_FIRMWARE)
+		return NULL;
+
+	filename = NULL;
+	paths = sr_resourcepaths_get(type);
+	for (p = paths; p && !filename; p = p->next) {
+		filename = g_build_filename(p->data, name, NULL);
+		if (!g_file_test(filename, G_FILE_TEST_IS_REGULAR)) {
+			g_free(filename);
+			filename = NULL;
+		}
+	}
+	g_slist_free_full(paths, g_free);
+
+	return filename;
+}
+
 static int resource_open_default(struct sr_resource *res,
 		const char *name, void *cb_data)
 {
@@ -283,6 +331,13 @@ SR_API int sr_resource_set_hooks(struct sr_context *ctx,
 		sr_err("%s: inconsistent callback pointers.", __func__);
 		return SR_ERR_ARG;
 	}
+
+	/* Resources which were read through other hooks are stale. */
+	g_mutex_lock(&ctx->resource_mutex);
+	if (ctx->resource_cache)
+		g_hash_table_remove_all(ctx->resource_cache);
+	g_mutex_unlock(&ctx->resource_mutex);
+
 	return SR_OK;
 }
 
@@ -369,21 +424,8 @@ SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 	return n_read;
 }
 
-/**
- * Load a resource into memory.
- *
- * @param ctx libsigrok context. Must not be NULL.
- * @param type Resource type ID.
- * @param name Name of the resource. Must not be NULL.
- * @param[out] size Size in bytes of the returned buffer. Must not be NULL.
- * @param max_size Size limit. Error out if the resource is larger than this.
- *
- * @return A buffer containing the resource data, or NULL on failure. Must
- *         be freed by the caller using g_free().
- *
- * @private
- */
-SR_PRIV void *sr_resource_load(struct sr_context *ctx,
+/* Read a resource through the hooks. */
+static void *resource_load_uncached(struct sr_context *ctx,
 		int type, const char *name, size_t *size, size_t max_size)
 {
 	struct sr_resource res;
@@ -423,3 +465,295 @@ SR_PRIV void *sr_resource_load(struct sr_context *ctx,
 	*size = res_size;
 	return buf;
 }
+
+static void resource_cache_entry_free(struct resource_cache_entry *entry)
+{
+	g_bytes_unref(entry->bytes);
+	g_free(entry->checksum);
+	g_free(entry->filename);
+	g_free(entry);
+}
+
+/*
+ * Files get replaced by writing a new one and renaming it, or rewritten
+ * in place. The inode and the modification time catch either, even when
+ * the size doesn't change within a second.
+ */
+static gboolean resource_file_id_get(const char *filename,
+		struct resource_file_id *id)
+{
+	GStatBuf st;
+
+	if (g_stat(filename, &st) < 0)
+		return FALSE;
+
+	memset(id, 0, sizeof(*id));
+	id->dev = st.st_dev;
+	id->ino = st.st_ino;
+	id->mtime_ns = (gint64)st.st_mtime * 1000000000;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+	id->mtime_ns += st.st_mtim.tv_nsec;
+#endif
+	id->size = st.st_size;
+
+	return TRUE;
+}
+
+static gboolean resource_cache_entry_stale(struct resource_cache_entry *entry)
+{
+	struct resource_file_id id;
+
+	if (!entry->filename)
+		return FALSE;
+	if (!resource_file_id_get(entry->filename, &id))
+		return TRUE;
+
+	return memcmp(&id, &entry->file_id, sizeof(id)) != 0;
+}
+
+static struct resource_cache_entry *resource_cache_fill(struct sr_context *ctx,
+		int type, const char *name, size_t max_size)
+{
+	struct resource_cache_entry *entry;
+	void *data;
+	size_t size;
+
+	entry = g_malloc0(sizeof(*entry));
+
+	/*
+	 * Files in the default locations are checked for changes. Their
+	 * identity is taken before reading, a change while reading gets
+	 * noticed on the next lookup. The content is copied into memory,
+	 * a mapping would fault when the file gets truncated.
+	 */
+	if (ctx->resource_open_cb == &resource_open_default) {
+		entry->filename = resource_find_default(type, name);
+		if (entry->filename && !resource_file_id_get(entry->filename,
+				&entry->file_id)) {
+			g_free(entry->filename);
+			entry->filename = NULL;
+		}
+	}
+
+	data = resource_load_uncached(ctx, type, name, &size, max_size);
+	if (!data) {
+		g_free(entry->filename);
+		g_free(entry);
+		return NULL;
+	}
+	entry->bytes = g_bytes_new_take(data, size);
+	entry->checksum = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+		data, size);
+
+	return entry;
+}
+
+/* Look up a loaded resource, drop it if changed. Call with the mutex held. */
+static struct resource_cache_entry *resource_cache_lookup(
+		struct sr_context *ctx, int type, const char *name)
+{
+	struct resource_cache_entry *entry;
+	char *key;
+
+	if (!ctx->resource_cache)
+		return NULL;
+
+	key = g_strdup_printf("%d/%s", type, name);
+	entry = g_hash_table_lookup(ctx->resource_cache, key);
+	if (entry && resource_cache_entry_stale(entry)) {
+		sr_dbg("Resource '%s' changed, reloading.", name);
+		g_hash_table_remove(ctx->resource_cache, key);
+		entry = NULL;
+	}
+	g_free(key);
+
+	return entry;
+}
+
+/* Look up a resource, load it if necessary. Call with the mutex held. */
+static struct resource_cache_entry *resource_cache_get(struct sr_context *ctx,
+		int type, const char *name, size_t max_size)
+{
+	struct resource_cache_entry *entry;
+
+	entry = resource_cache_lookup(ctx, type, name);
+	if (entry)
+		return entry;
+
+	if (!ctx->resource_cache)
+		ctx->resource_cache = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free,
+			(GDestroyNotify)resource_cache_entry_free);
+
+	entry = resource_cache_fill(ctx, type, name, max_size);
+	if (entry)
+		g_hash_table_insert(ctx->resource_cache,
+			g_strdup_printf("%d/%s", type, name), entry);
+
+	return entry;
+}
+
+/**
+ * Get the content of a resource.
+ *
+ * The content is kept in memory for the lifetime of the context, and
+ * gets shared by all callers. Files in the default locations are read
+ * again when they change.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ * @param max_size Size limit. Error out if the resource is larger than this.
+ *
+ * @return The read-only resource data, or NULL on failure. Must be
+ *         released by the caller using g_bytes_unref().
+ *
+ * @private
+ */
+SR_PRIV GBytes *sr_resource_get(struct sr_context *ctx,
+		int type, const char *name, size_t max_size)
+{
+	struct resource_cache_entry *entry;
+	GBytes *bytes;
+
+	g_mutex_lock(&ctx->resource_mutex);
+	entry = resource_cache_get(ctx, type, name, max_size);
+	bytes = entry ? g_bytes_ref(entry->bytes) : NULL;
+	g_mutex_unlock(&ctx->resource_mutex);
+
+	if (bytes && g_bytes_get_size(bytes) > max_size) {
+		sr_err("Size %zu of '%s' exceeds limit %zu.",
+			g_bytes_get_size(bytes), name, max_size);
+		g_bytes_unref(bytes);
+		return NULL;
+	}
+
+	return bytes;
+}
+
+/**
+ * Load a resource into memory.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ * @param[out] size Size in bytes of the returned buffer. Must not be NULL.
+ * @param max_size Size limit. Error out if the resource is larger than this.
+ *
+ * @return A buffer containing the resource data, or NULL on failure. Must
+ *         be freed by the caller using g_free().
+ *
+ * @private
+ */
+SR_PRIV void *sr_resource_load(struct sr_context *ctx,
+		int type, const char *name, size_t *size, size_t max_size)
+{
+	GBytes *bytes;
+	const void *data;
+	size_t res_size;
+	void *buf;
+
+	bytes = sr_resource_get(ctx, type, name, max_size);
+	if (!bytes)
+		return NULL;
+	data = g_bytes_get_data(bytes, &res_size);
+
+	/* Callers may modify the buffer, hand out a copy. */
+	buf = g_try_malloc(res_size ? res_size : 1);
+	if (!buf) {
+		sr_err("Failed to allocate buffer for '%s'.", name);
+		g_bytes_unref(bytes);
+		return NULL;
+	}
+	if (res_size)
+		memcpy(buf, data, res_size);
+	g_bytes_unref(bytes);
+
+	*size = res_size;
+	return buf;
+}
+
+/**
+ * Check whether a resource was uploaded to a device.
+ *
+ * Drivers combine this with the state which the device reports. A
+ * device which claims to be configured may still run an image which
+ * differs from the resource's current content.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param device_id Identifies the device, unique across drivers.
+ *                  Can be NULL if the device cannot be identified.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ *
+ * @retval SR_OK The resource's current content was uploaded.
+ * @retval SR_ERR_DATA Another resource, or different content was uploaded.
+ *                     Also when the resource is not loaded, or changed.
+ * @retval SR_ERR_NA No upload is known.
+ *
+ * @private
+ */
+SR_PRIV int sr_resource_upload_check(struct sr_context *ctx,
+		const char *device_id, int type, const char *name)
+{
+	struct resource_cache_entry *entry;
+	const char *uploaded;
+	char *current;
+	int ret;
+
+	if (!device_id)
+		return SR_ERR_NA;
+
+	g_mutex_lock(&ctx->resource_mutex);
+	ret = SR_ERR_NA;
+	uploaded = NULL;
+	if (ctx->resource_uploads)
+		uploaded = g_hash_table_lookup(ctx->resource_uploads, device_id);
+	if (uploaded) {
+		/* Don't load it here, the caller's size limit is unknown. */
+		ret = SR_ERR_DATA;
+		entry = resource_cache_lookup(ctx, type, name);
+		if (entry) {
+			current = g_strdup_printf("%d/%s/%s", type, name,
+				entry->checksum);
+			if (strcmp(uploaded, current) == 0)
+				ret = SR_OK;
+			g_free(current);
+		}
+	}
+	g_mutex_unlock(&ctx->resource_mutex);
+
+	return ret;
+}
+
+/**
+ * Remember that a resource was uploaded to a device.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param device_id Identifies the device, unique across drivers.
+ *                  Can be NULL if the device cannot be identified.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_resource_upload_done(struct sr_context *ctx,
+		const char *device_id, int type, const char *name)
+{
+	struct resource_cache_entry *entry;
+
+	if (!device_id)
+		return;
+
+	g_mutex_lock(&ctx->resource_mutex);
+	if (!ctx->resource_uploads)
+		ctx->resource_uploads = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, g_free);
+	entry = resource_cache_lookup(ctx, type, name);
+	if (entry)
+		g_hash_table_replace(ctx->resource_uploads, g_strdup(device_id),
+			g_strdup_printf("%d/%s/%s", type, name, entry->checksum));
+	else
+		g_hash_table_remove(ctx->resource_uploads, device_id);
+	g_mutex_unlock(&ctx->resource_mutex);
+}
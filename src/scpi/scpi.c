@@ -116,7 +116,11 @@ static struct sr_dev_inst *sr_scpi_scan_resource(struct drv_context *drvc,
 	if (!(scpi = scpi_dev_inst_new(drvc, resource, serialcomm)))
 		return NULL;
 
+	/* Other drivers may probe the same resource concurrently. */
+	sr_scan_resource_lock(resource);
+
 	if (sr_scpi_open(scpi) != SR_OK) {
+		sr_scan_resource_unlock(resource);
 		sr_info("Couldn't open SCPI device.");
 		sr_scpi_free(scpi);
 		return NULL;
@@ -125,6 +129,7 @@ static struct sr_dev_inst *sr_scpi_scan_resource(struct drv_context *drvc,
 	sdi = probe_device(scpi);
 
 	sr_scpi_close(scpi);
+	sr_scan_resource_unlock(resource);
 
 	if (sdi)
 		sdi->status = SR_ST_INACTIVE;
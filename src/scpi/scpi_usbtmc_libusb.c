@@ -130,7 +130,7 @@ static GSList *scpi_usbtmc_libusb_scan(struct drv_context *drvc)
 	int confidx, intfidx, ret, i;
 	char *res;
 
-	ret = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	ret = sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	if (ret < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(ret));
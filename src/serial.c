@@ -1096,6 +1096,39 @@ SR_API GSList *sr_serial_list(const struct sr_dev_driver *driver)
 	return tty_devs;
 }
 
+/**
+ * List the names of local serial ports.
+ *
+ * Unlike sr_serial_list() this skips Bluetooth devices, which take
+ * seconds to discover.
+ *
+ * @return A GSList of port names, to be freed with g_free().
+ *
+ * @private
+ */
+SR_PRIV GSList *sr_serial_list_ports(void)
+{
+	GSList *tty_devs, *names, *l;
+	struct sr_serial_port *port;
+
+	tty_devs = NULL;
+	if (ser_lib_funcs_libsp && ser_lib_funcs_libsp->list)
+		tty_devs = ser_lib_funcs_libsp->list(tty_devs, append_port_list);
+	if (ser_lib_funcs_hid && ser_lib_funcs_hid->list)
+		tty_devs = ser_lib_funcs_hid->list(tty_devs, append_port_list);
+
+	names = NULL;
+	for (l = tty_devs; l; l = l->next) {
+		port = l->data;
+		names = g_slist_append(names, port->name);
+		port->name = NULL;
+		sr_serial_free(port);
+	}
+	g_slist_free(tty_devs);
+
+	return names;
+}
+
 static GSList *append_port_find(GSList *devs, const char *name)
 {
 	if (!name || !*name)
@@ -1137,6 +1170,37 @@ SR_PRIV GSList *sr_serial_find_usb(uint16_t vendor_id, uint16_t product_id)
 	return tty_devs;
 }
 
+/**
+ * Start a scan of several drivers. Serial port lookups share one
+ * enumeration of the system's ports until sr_serial_scan_end().
+ *
+ * @private
+ */
+SR_PRIV void sr_serial_scan_begin(void)
+{
+	if (ser_lib_funcs_libsp && ser_lib_funcs_libsp->scan_begin)
+		ser_lib_funcs_libsp->scan_begin();
+	if (ser_lib_funcs_hid && ser_lib_funcs_hid->scan_begin)
+		ser_lib_funcs_hid->scan_begin();
+	if (ser_lib_funcs_bt && ser_lib_funcs_bt->scan_begin)
+		ser_lib_funcs_bt->scan_begin();
+}
+
+/**
+ * End a scan of several drivers, see sr_serial_scan_begin().
+ *
+ * @private
+ */
+SR_PRIV void sr_serial_scan_end(void)
+{
+	if (ser_lib_funcs_libsp && ser_lib_funcs_libsp->scan_end)
+		ser_lib_funcs_libsp->scan_end();
+	if (ser_lib_funcs_hid && ser_lib_funcs_hid->scan_end)
+		ser_lib_funcs_hid->scan_end();
+	if (ser_lib_funcs_bt && ser_lib_funcs_bt->scan_end)
+		ser_lib_funcs_bt->scan_end();
+}
+
 /** @private */
 SR_PRIV int serial_timeout(struct sr_serial_dev_inst *port, int num_bytes)
 {
@@ -21,6 +21,7 @@
  */
 
 #include <config.h>
+#include <stdlib.h>
 #include <glib.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -411,6 +412,64 @@ static int sr_ser_libsp_source_remove(struct sr_session *session,
 	return sr_session_source_remove_internal(session, key);
 }
 
+/*
+ * During scans of several drivers, port lookups share one snapshot of
+ * the system's serial ports instead of enumerating them over and over.
+ */
+static GMutex ports_mutex;
+static unsigned int ports_scan_depth;
+static struct sp_port **ports_snapshot;
+
+static void sr_ser_libsp_scan_begin(void)
+{
+	g_mutex_lock(&ports_mutex);
+	if (!ports_scan_depth++ && sp_list_ports(&ports_snapshot) != SP_OK)
+		ports_snapshot = NULL;
+	g_mutex_unlock(&ports_mutex);
+}
+
+static void sr_ser_libsp_scan_end(void)
+{
+	g_mutex_lock(&ports_mutex);
+	if (!--ports_scan_depth && ports_snapshot) {
+		sp_free_port_list(ports_snapshot);
+		ports_snapshot = NULL;
+	}
+	g_mutex_unlock(&ports_mutex);
+}
+
+/* Like sp_list_ports(), but copies the snapshot during scans. */
+static enum sp_return list_ports(struct sp_port ***list)
+{
+	struct sp_port **ports;
+	size_t i, count;
+	enum sp_return ret;
+
+	g_mutex_lock(&ports_mutex);
+	if (!ports_snapshot) {
+		g_mutex_unlock(&ports_mutex);
+		return sp_list_ports(list);
+	}
+
+	for (count = 0; ports_snapshot[count]; count++)
+		;
+	/* sp_free_port_list() releases the list with free(). */
+	ports = calloc(count + 1, sizeof(*ports));
+	ret = ports ? SP_OK : SP_ERR_MEM;
+	for (i = 0; ret == SP_OK && i < count; i++)
+		ret = sp_copy_port(ports_snapshot[i], &ports[i]);
+	g_mutex_unlock(&ports_mutex);
+
+	if (ret != SP_OK) {
+		if (ports)
+			sp_free_port_list(ports);
+		return ret;
+	}
+	*list = ports;
+
+	return SP_OK;
+}
+
 static GSList *sr_ser_libsp_list(GSList *list, sr_ser_list_append_t append)
 {
 	struct sp_port **ports;
@@ -418,7 +477,7 @@ static GSList *sr_ser_libsp_list(GSList *list, sr_ser_list_append_t append)
 	const char *name;
 	const char *desc;
 
-	if (sp_list_ports(&ports) != SP_OK)
+	if (list_ports(&ports) != SP_OK)
 		return list;
 
 	for (i = 0; ports[i]; i++) {
@@ -438,7 +497,7 @@ static GSList *sr_ser_libsp_find_usb(GSList *list, sr_ser_find_append_t append,
 	struct sp_port **ports;
 	int i, vid, pid;
 
-	if (sp_list_ports(&ports) != SP_OK)
+	if (list_ports(&ports) != SP_OK)
 		return list;
 
 	for (i = 0; ports[i]; i++) {
@@ -532,6 +591,8 @@ static struct ser_lib_functions serlib_sp = {
 	.find_usb = sr_ser_libsp_find_usb,
 	.get_frame_format = sr_ser_libsp_get_frame_format,
 	.get_rx_avail = sr_ser_libsp_get_rx_avail,
+	.scan_begin = sr_ser_libsp_scan_begin,
+	.scan_end = sr_ser_libsp_scan_end,
 };
 SR_PRIV struct ser_lib_functions *ser_lib_funcs_libsp = &serlib_sp;
 
@@ -46,11 +46,136 @@
  * @{
  */
 
+/* Upper limit of datafeed queue depths, a power of two. */
+#define DATAFEED_QUEUE_MAX_DEPTH (1 << 16)
+
+struct datafeed_worker;
+
 struct datafeed_callback {
 	sr_datafeed_callback cb;
 	void *cb_data;
+	/* Whether the callback accepts SR_DF_LOGIC_RLE packets. */
+	gboolean rle;
+	/* Consumer thread, only while running in asynchronous mode. */
+	struct datafeed_worker *worker;
+	/* Statistics, protected by the session's stats_mutex. */
+	struct sr_timing timing;
+	uint64_t dropped;
+};
+
+/**
+ * Reference counted copy of a packet, shared by all consumer threads.
+ * Also holds the packets of other threads until the session thread
+ * delivers them.
+ */
+struct datafeed_packet_ref {
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+	gint refcount;
 };
 
+/**
+ * Consumer thread of a datafeed callback in asynchronous mode.
+ *
+ * The sending thread is the single producer, the callback's thread is the
+ * single consumer of a bounded ring of packet references. Ring positions
+ * are free running counters which each side updates atomically, the ring
+ * size is a power of two. The mutex and the condition are only used when
+ * either side needs to sleep (empty ring, or full ring in blocking mode).
+ */
+struct datafeed_worker {
+	struct sr_session *session;
+	struct datafeed_callback *cb_struct;
+	GThread *thread;
+	struct datafeed_packet_ref **ring;
+	unsigned int ring_mask;
+	/* Next position to write, only modified by the producer. */
+	gint head;
+	/* Next position to read, only modified by the consumer. */
+	gint tail;
+	gint consumer_waiting;
+	gint producer_waiting;
+	gint quit;
+	GMutex mutex;
+	GCond cond;
+	uint64_t dropped;
+};
+
+static void datafeed_packet_ref_release(struct datafeed_packet_ref *ref)
+{
+	if (!g_atomic_int_dec_and_test(&ref->refcount))
+		return;
+
+	sr_packet_free(ref->packet);
+	g_free(ref);
+}
+
+/* Get the start time of an invocation, 0 when statistics are disabled. */
+static int64_t session_timing_start(struct sr_session *session)
+{
+	if (!g_atomic_int_get(&session->stats_enabled))
+		return 0;
+
+	return g_get_monotonic_time();
+}
+
+/* Account the wall time of a transform or callback invocation. */
+static void session_timing_update(struct sr_session *session,
+		struct sr_timing *timing, int64_t start_us)
+{
+	uint64_t elapsed_us;
+
+	if (!start_us)
+		return;
+
+	elapsed_us = g_get_monotonic_time() - start_us;
+
+	g_mutex_lock(&session->stats_mutex);
+	timing->calls++;
+	timing->total_us += elapsed_us;
+	if (elapsed_us > timing->max_us)
+		timing->max_us = elapsed_us;
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+static void session_stats_count_packet(struct sr_session *session,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
+	uint64_t bytes, samples;
+	unsigned int idx;
+
+	if (!g_atomic_int_get(&session->stats_enabled))
+		return;
+	if (packet->type < SR_DF_HEADER || packet->type > SR_DF_LOGIC_RLE)
+		return;
+	idx = packet->type - SR_DF_HEADER;
+
+	bytes = samples = 0;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		bytes = logic->length;
+		if (logic->unitsize)
+			samples = logic->length / logic->unitsize;
+	} else if (packet->type == SR_DF_ANALOG) {
+		analog = packet->payload;
+		samples = analog->num_samples;
+		bytes = samples * analog->encoding->unitsize;
+	} else if (packet->type == SR_DF_LOGIC_RLE) {
+		rle = packet->payload;
+		bytes = rle->num_runs * (rle->unitsize + sizeof(uint64_t));
+		samples = sr_logic_rle_num_samples(rle);
+	}
+
+	g_mutex_lock(&session->stats_mutex);
+	session->packet_stats[idx].packets++;
+	session->packet_stats[idx].bytes += bytes;
+	session->packet_stats[idx].samples += samples;
+	g_mutex_unlock(&session->stats_mutex);
+}
+
 /** Custom GLib event source for generic descriptor I/O.
  * @see https://developer.gnome.org/glib/stable/glib-The-Main-Event-Loop.html
  */
@@ -225,6 +350,12 @@ SR_API int sr_session_new(struct sr_context *ctx,
 	session->ctx = ctx;
 
 	g_mutex_init(&session->main_mutex);
+	session->deferred_packets = g_async_queue_new_full(
+		(GDestroyNotify)datafeed_packet_ref_release);
+
+	session->datafeed_overflow = SR_DF_OVERFLOW_BLOCK;
+	session->buffer_pool = sr_buffer_pool_new();
+	g_mutex_init(&session->stats_mutex);
 
 	/* To maintain API compatibility, we need a lookup table
 	 * which maps poll_object IDs to GSource* pointers.
@@ -261,6 +392,10 @@ SR_API int sr_session_destroy(struct sr_session *session)
 
 	g_hash_table_unref(session->event_sources);
 
+	g_async_queue_unref(session->deferred_packets);
+	sr_buffer_pool_free(session->buffer_pool);
+
+	g_mutex_clear(&session->stats_mutex);
 	g_mutex_clear(&session->main_mutex);
 
 	g_free(session);
@@ -444,6 +579,175 @@ SR_API int sr_session_dev_remove(struct sr_session *session,
 	return SR_OK;
 }
 
+/* Wake up the other side of a ring, if it announced that it sleeps. */
+static void datafeed_worker_wake(struct datafeed_worker *worker,
+		gint *waiting)
+{
+	if (!g_atomic_int_get(waiting))
+		return;
+
+	g_mutex_lock(&worker->mutex);
+	g_cond_broadcast(&worker->cond);
+	g_mutex_unlock(&worker->mutex);
+}
+
+static gpointer datafeed_worker_thread(gpointer data)
+{
+	struct datafeed_worker *worker;
+	struct datafeed_callback *cb_struct;
+	struct datafeed_packet_ref *ref;
+	unsigned int tail;
+	int64_t start_us;
+
+	worker = data;
+	cb_struct = worker->cb_struct;
+
+	while (1) {
+		tail = g_atomic_int_get(&worker->tail);
+		if ((unsigned int)g_atomic_int_get(&worker->head) == tail) {
+			/* Only terminate when the ring has been drained. */
+			if (g_atomic_int_get(&worker->quit))
+				break;
+			g_mutex_lock(&worker->mutex);
+			g_atomic_int_set(&worker->consumer_waiting, 1);
+			while ((unsigned int)g_atomic_int_get(&worker->head) == tail
+					&& !g_atomic_int_get(&worker->quit))
+				g_cond_wait(&worker->cond, &worker->mutex);
+			g_atomic_int_set(&worker->consumer_waiting, 0);
+			g_mutex_unlock(&worker->mutex);
+			continue;
+		}
+
+		ref = worker->ring[tail & worker->ring_mask];
+		start_us = session_timing_start(worker->session);
+		cb_struct->cb(ref->sdi, ref->packet, cb_struct->cb_data);
+		session_timing_update(worker->session, &cb_struct->timing,
+			start_us);
+		g_atomic_int_set(&worker->tail, tail + 1);
+		datafeed_worker_wake(worker, &worker->producer_waiting);
+		datafeed_packet_ref_release(ref);
+	}
+
+	return NULL;
+}
+
+/*
+ * Queue a packet reference for a consumer thread. When the ring is full
+ * the packet is either dropped (if permitted) or the caller blocks until
+ * the consumer made room.
+ */
+static void datafeed_worker_push(struct datafeed_worker *worker,
+		struct datafeed_packet_ref *ref, gboolean may_drop)
+{
+	unsigned int head;
+
+	head = g_atomic_int_get(&worker->head);
+	if (head - g_atomic_int_get(&worker->tail) > worker->ring_mask) {
+		if (may_drop) {
+			worker->dropped++;
+			g_mutex_lock(&worker->session->stats_mutex);
+			worker->cb_struct->dropped++;
+			g_mutex_unlock(&worker->session->stats_mutex);
+			return;
+		}
+		g_mutex_lock(&worker->mutex);
+		g_atomic_int_set(&worker->producer_waiting, 1);
+		while (head - g_atomic_int_get(&worker->tail) > worker->ring_mask)
+			g_cond_wait(&worker->cond, &worker->mutex);
+		g_atomic_int_set(&worker->producer_waiting, 0);
+		g_mutex_unlock(&worker->mutex);
+	}
+
+	g_atomic_int_inc(&ref->refcount);
+	worker->ring[head & worker->ring_mask] = ref;
+	g_atomic_int_set(&worker->head, head + 1);
+	datafeed_worker_wake(worker, &worker->consumer_waiting);
+}
+
+static void datafeed_worker_free(struct datafeed_worker *worker)
+{
+	g_mutex_clear(&worker->mutex);
+	g_cond_clear(&worker->cond);
+	g_free(worker->ring);
+	g_free(worker);
+}
+
+/*
+ * Terminate all consumer threads. Packets which are still queued get
+ * delivered before the respective thread exits.
+ */
+static void datafeed_workers_stop(struct sr_session *session)
+{
+	struct datafeed_callback *cb_struct;
+	struct datafeed_worker *worker;
+	GSList *l;
+
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		worker = cb_struct->worker;
+		if (!worker)
+			continue;
+
+		g_mutex_lock(&worker->mutex);
+		g_atomic_int_set(&worker->quit, 1);
+		g_cond_broadcast(&worker->cond);
+		g_mutex_unlock(&worker->mutex);
+		g_thread_join(worker->thread);
+
+		if (worker->dropped)
+			sr_warn("Datafeed queue overflow, dropped %" PRIu64
+				" packets.", worker->dropped);
+		cb_struct->worker = NULL;
+		datafeed_worker_free(worker);
+	}
+}
+
+/* Create one consumer thread per datafeed callback, if so configured. */
+static int datafeed_workers_start(struct sr_session *session)
+{
+	struct datafeed_callback *cb_struct;
+	struct datafeed_worker *worker;
+	unsigned int ring_size;
+	GError *error;
+	GSList *l;
+
+	if (!session->datafeed_queue_depth)
+		return SR_OK;
+
+	ring_size = 1;
+	while (ring_size < session->datafeed_queue_depth)
+		ring_size <<= 1;
+
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		worker = g_malloc0(sizeof(*worker));
+		worker->session = session;
+		worker->cb_struct = cb_struct;
+		worker->ring = g_malloc0(ring_size * sizeof(worker->ring[0]));
+		worker->ring_mask = ring_size - 1;
+		g_mutex_init(&worker->mutex);
+		g_cond_init(&worker->cond);
+
+		error = NULL;
+		worker->thread = g_thread_try_new("sr-datafeed",
+			datafeed_worker_thread, worker, &error);
+		if (!worker->thread) {
+			sr_err("Cannot create datafeed thread: %s.",
+				error->message);
+			g_error_free(error);
+			datafeed_worker_free(worker);
+			datafeed_workers_stop(session);
+			return SR_ERR;
+		}
+		cb_struct->worker = worker;
+	}
+	sr_dbg("Running %u datafeed callback(s) in separate threads, "
+		"queue depth %u.", g_slist_length(session->datafeed_callbacks),
+		ring_size);
+
+	return SR_OK;
+}
+
 /**
  * Remove all datafeed callbacks in a session.
  *
@@ -461,8 +765,39 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
 		return SR_ERR_ARG;
 	}
 
+	datafeed_workers_stop(session);
+	g_mutex_lock(&session->stats_mutex);
 	g_slist_free_full(session->datafeed_callbacks, g_free);
 	session->datafeed_callbacks = NULL;
+	g_mutex_unlock(&session->stats_mutex);
+
+	return SR_OK;
+}
+
+static int datafeed_callback_add(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, gboolean rle)
+{
+	struct datafeed_callback *cb_struct;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_BUG;
+	}
+
+	if (!cb) {
+		sr_err("%s: cb was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	cb_struct = g_malloc0(sizeof(struct datafeed_callback));
+	cb_struct->cb = cb;
+	cb_struct->cb_data = cb_data;
+	cb_struct->rle = rle;
+
+	g_mutex_lock(&session->stats_mutex);
+	session->datafeed_callbacks =
+	    g_slist_append(session->datafeed_callbacks, cb_struct);
+	g_mutex_unlock(&session->stats_mutex);
 
 	return SR_OK;
 }
@@ -470,6 +805,9 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
 /**
  * Add a datafeed callback to a session.
  *
+ * The callback does not receive SR_DF_LOGIC_RLE packets. Their data is
+ * passed to it in SR_DF_LOGIC packets instead.
+ *
  * @param session The session to use. Must not be NULL.
  * @param cb Function to call when a chunk of data is received.
  *           Must not be NULL.
@@ -483,24 +821,284 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data)
 {
-	struct datafeed_callback *cb_struct;
+	return datafeed_callback_add(session, cb, cb_data, FALSE);
+}
+
+/**
+ * Add a datafeed callback which accepts run-length encoded logic data.
+ *
+ * This works like sr_session_datafeed_callback_add(), but the callback
+ * receives SR_DF_LOGIC_RLE packets as they were sent by the device.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cb Function to call when a chunk of data is received.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_BUG No session exists.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_callback_add_rle(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data)
+{
+	return datafeed_callback_add(session, cb, cb_data, TRUE);
+}
 
+/**
+ * Configure asynchronous delivery of datafeed packets.
+ *
+ * By default, datafeed callbacks run synchronously in the thread which
+ * sends a packet, which usually is the session thread that also services
+ * the devices. A slow callback then delays the device driver, which can
+ * result in overruns at high samplerates.
+ *
+ * With a non-zero queue depth, each datafeed callback that is registered
+ * when sr_session_start() gets called runs in a thread of its own. Every
+ * packet is copied once, and is passed to these threads through bounded
+ * queues which hold up to @a depth packets each. All queued packets are
+ * delivered before the session stop is signalled.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param depth Number of packets per queue (rounded up to a power of
+ *              two, at most 65536), or 0 to invoke callbacks
+ *              synchronously (default).
+ * @param overflow Policy to apply when a queue is full.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_queue_set(struct sr_session *session,
+		unsigned int depth, enum sr_datafeed_overflow overflow)
+{
 	if (!session) {
 		sr_err("%s: session was NULL", __func__);
-		return SR_ERR_BUG;
+		return SR_ERR_ARG;
 	}
 
-	if (!cb) {
-		sr_err("%s: cb was NULL", __func__);
+	if (overflow != SR_DF_OVERFLOW_BLOCK && overflow != SR_DF_OVERFLOW_DROP)
 		return SR_ERR_ARG;
+
+	if (session->running) {
+		sr_err("Cannot change datafeed queue while running.");
+		return SR_ERR;
 	}
 
-	cb_struct = g_malloc0(sizeof(struct datafeed_callback));
-	cb_struct->cb = cb;
-	cb_struct->cb_data = cb_data;
+	session->datafeed_queue_depth = MIN(depth, DATAFEED_QUEUE_MAX_DEPTH);
+	session->datafeed_overflow = overflow;
 
-	session->datafeed_callbacks =
-	    g_slist_append(session->datafeed_callbacks, cb_struct);
+	return SR_OK;
+}
+
+/**
+ * Configure the handling of USB events in a thread of its own.
+ *
+ * By default, USB transfer completions are handled in the session main
+ * loop, where they compete with all other event sources, and with the
+ * work that embedding applications do in that loop. Delayed handling
+ * of completions results in overruns of the device's FIFO at high
+ * samplerates.
+ *
+ * When enabled, drivers which support it have their USB events handled
+ * by a dedicated thread at raised priority. Datafeed packets of these
+ * devices then get sent from that thread. Other drivers keep using the
+ * session main loop.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to use an event thread, FALSE to use the session
+ *               main loop (default).
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_usb_event_thread_set(struct sr_session *session,
+		gboolean enable)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot change USB event handling while running.");
+		return SR_ERR;
+	}
+
+	session->usb_event_thread = enable;
+
+	return SR_OK;
+}
+
+static struct sr_session_stats_timing *stats_timing_new(const char *id,
+		const struct sr_timing *timing)
+{
+	struct sr_session_stats_timing *st;
+
+	st = g_malloc0(sizeof(*st));
+	st->id = g_strdup(id);
+	st->calls = timing->calls;
+	st->total_us = timing->total_us;
+	st->max_us = timing->max_us;
+
+	return st;
+}
+
+/**
+ * Enable or disable the collection of datafeed statistics.
+ *
+ * Collecting statistics takes a lock and reads the clock for every
+ * packet, transform and callback invocation. It is disabled by default.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to collect statistics, FALSE to stop collecting.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_enable(struct sr_session *session,
+		gboolean enable)
+{
+	if (!session)
+		return SR_ERR_ARG;
+
+	g_atomic_int_set(&session->stats_enabled, enable ? 1 : 0);
+
+	return SR_OK;
+}
+
+/**
+ * Get the datafeed statistics of a session.
+ *
+ * Statistics only get collected after sr_session_stats_enable() was
+ * called. They cover the current or most recent session run, or the
+ * time since the last sr_session_stats_reset() call. Packets are counted
+ * as they are sent by the devices, before any transform module ran. The
+ * time spent in transforms and datafeed callbacks is wall time, which
+ * helps to tell a slow device driver from a slow consumer.
+ *
+ * This function may be called from any thread, also while the session
+ * is running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param stats Pointer where the statistics will be stored. Must not be
+ *              NULL. The caller must free it with sr_session_stats_free().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_get(struct sr_session *session,
+		struct sr_session_stats **stats)
+{
+	struct sr_session_stats_packets *sp;
+	struct sr_session_stats_timing *st;
+	struct datafeed_callback *cb_struct;
+	struct sr_transform *t;
+	unsigned int i;
+	GSList *l;
+
+	if (!session || !stats)
+		return SR_ERR_ARG;
+
+	*stats = g_malloc0(sizeof(**stats));
+
+	g_mutex_lock(&session->stats_mutex);
+	for (i = 0; i < G_N_ELEMENTS(session->packet_stats); i++) {
+		sp = g_malloc0(sizeof(*sp));
+		sp->type = SR_DF_HEADER + i;
+		sp->packets = session->packet_stats[i].packets;
+		sp->bytes = session->packet_stats[i].bytes;
+		sp->samples = session->packet_stats[i].samples;
+		(*stats)->packets = g_slist_append((*stats)->packets, sp);
+	}
+	for (l = session->transforms; l; l = l->next) {
+		t = l->data;
+		st = stats_timing_new(t->module->id, &t->timing);
+		(*stats)->transforms = g_slist_append((*stats)->transforms, st);
+	}
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		st = stats_timing_new(NULL, &cb_struct->timing);
+		st->dropped = cb_struct->dropped;
+		(*stats)->callbacks = g_slist_append((*stats)->callbacks, st);
+	}
+	g_mutex_unlock(&session->stats_mutex);
+
+	return SR_OK;
+}
+
+static void stats_timing_free(void *data)
+{
+	struct sr_session_stats_timing *st;
+
+	st = data;
+	g_free(st->id);
+	g_free(st);
+}
+
+/**
+ * Free datafeed statistics.
+ *
+ * @param stats The statistics returned by sr_session_stats_get(). Can be
+ *              NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_session_stats_free(struct sr_session_stats *stats)
+{
+	if (!stats)
+		return;
+
+	g_slist_free_full(stats->packets, g_free);
+	g_slist_free_full(stats->transforms, stats_timing_free);
+	g_slist_free_full(stats->callbacks, stats_timing_free);
+	g_free(stats);
+}
+
+/**
+ * Reset the datafeed statistics of a session.
+ *
+ * This happens implicitly when a session gets started.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_reset(struct sr_session *session)
+{
+	struct datafeed_callback *cb_struct;
+	struct sr_transform *t;
+	GSList *l;
+
+	if (!session)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&session->stats_mutex);
+	memset(session->packet_stats, 0, sizeof(session->packet_stats));
+	for (l = session->transforms; l; l = l->next) {
+		t = l->data;
+		memset(&t->timing, 0, sizeof(t->timing));
+	}
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		memset(&cb_struct->timing, 0, sizeof(cb_struct->timing));
+		cb_struct->dropped = 0;
+	}
+	g_mutex_unlock(&session->stats_mutex);
 
 	return SR_OK;
 }
@@ -580,6 +1178,48 @@ static int verify_trigger(struct sr_trigger *trigger)
 	return SR_OK;
 }
 
+static void session_deferred_deliver(struct sr_session *session);
+
+static gboolean deferred_source_dispatch(GSource *source,
+		GSourceFunc callback, gpointer user_data)
+{
+	g_source_set_ready_time(source, -1);
+
+	return callback(user_data);
+}
+
+static GSourceFuncs deferred_source_funcs = {
+	.dispatch = deferred_source_dispatch,
+};
+
+/* Deliver the packets which other threads sent, in the session thread. */
+static gboolean deferred_packets_handle(gpointer data)
+{
+	session_deferred_deliver(data);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/*
+ * Stop the deferred delivery of packets, and deliver what is still
+ * queued. Must be called before the datafeed workers get stopped.
+ */
+static void deferred_packets_stop(struct sr_session *session)
+{
+	GSource *source;
+
+	g_mutex_lock(&session->main_mutex);
+	source = session->deferred_source;
+	session->deferred_source = NULL;
+	g_mutex_unlock(&session->main_mutex);
+
+	if (source) {
+		g_source_destroy(source);
+		g_source_unref(source);
+	}
+	session_deferred_deliver(session);
+}
+
 /** Set up the main context the session will be executing in.
  *
  * Must be called just before the session starts, by the thread which
@@ -619,6 +1259,14 @@ static int set_main_context(struct sr_session *session)
 		main_context = g_main_context_new();
 	}
 	session->main_context = main_context;
+	session->main_thread = g_thread_self();
+
+	session->deferred_source = g_source_new(&deferred_source_funcs,
+		sizeof(GSource));
+	g_source_set_name(session->deferred_source, "sr-deferred-packets");
+	g_source_set_callback(session->deferred_source,
+		deferred_packets_handle, session, NULL);
+	g_source_attach(session->deferred_source, main_context);
 
 	g_mutex_unlock(&session->main_mutex);
 
@@ -642,6 +1290,7 @@ static int unset_main_context(struct sr_session *session)
 	if (session->main_context) {
 		g_main_context_unref(session->main_context);
 		session->main_context = NULL;
+		session->main_thread = NULL;
 		ret = SR_OK;
 	} else {
 		/* May happen if the set/unset calls are not matched.
@@ -690,6 +1339,8 @@ static gboolean delayed_stop_check(void *data)
 		return G_SOURCE_REMOVE;
 
 	session->running = FALSE;
+	deferred_packets_stop(session);
+	datafeed_workers_stop(session);
 	unset_main_context(session);
 
 	sr_info("Stopped.");
@@ -806,6 +1457,15 @@ SR_API int sr_session_start(struct sr_session *session)
 	if (ret != SR_OK)
 		return ret;
 
+	sr_session_stats_reset(session);
+
+	ret = datafeed_workers_start(session);
+	if (ret != SR_OK) {
+		deferred_packets_stop(session);
+		unset_main_context(session);
+		return ret;
+	}
+
 	sr_info("Starting.");
 
 	session->running = TRUE;
@@ -837,6 +1497,8 @@ SR_API int sr_session_start(struct sr_session *session)
 		 * sources... */
 		session->running = FALSE;
 
+		deferred_packets_stop(session);
+		datafeed_workers_stop(session);
 		unset_main_context(session);
 		return ret;
 	}
@@ -1035,6 +1697,7 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
 
 	/* Please use the same order as in libsigrok.h. */
 	switch (packet->type) {
@@ -1066,6 +1729,11 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 		sr_dbg("bus: Received SR_DF_ANALOG packet (%d samples).",
 		       analog->num_samples);
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC_RLE packet (%" PRIu64 " runs, "
+		       "unitsize = %d).", rle->num_runs, rle->unitsize);
+		break;
 	default:
 		sr_dbg("bus: Received unknown packet type: %d.", packet->type);
 		break;
@@ -1108,42 +1776,77 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 	return ret;
 }
 
-/**
- * Send a packet to whatever is listening on the datafeed bus.
- *
- * Hardware drivers use this to send a data packet to the frontend.
- *
- * @param sdi TODO.
- * @param packet The datafeed packet to send to the session bus.
- *
- * @retval SR_OK Success.
- * @retval SR_ERR_ARG Invalid argument.
+/*
+ * Pass a packet to the datafeed callbacks. Callbacks which run in a
+ * thread of their own receive a reference to a copy of the packet,
+ * which is shared among them.
  *
- * @private
+ * SR_DF_LOGIC_RLE packets only go to the callbacks which accept them.
+ * The others receive the expanded data, which is passed in with
+ * 'expanded' set.
  */
-SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
-		const struct sr_datafeed_packet *packet)
+static int datafeed_deliver(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, gboolean expanded)
 {
 	GSList *l;
 	struct datafeed_callback *cb_struct;
-	struct sr_datafeed_packet *packet_in, *packet_out;
-	struct sr_transform *t;
-	int ret;
-
-	if (!sdi) {
-		sr_err("%s: sdi was NULL", __func__);
-		return SR_ERR_ARG;
+	struct datafeed_packet_ref *ref;
+	gboolean may_drop;
+	int64_t start_us;
+
+	ref = NULL;
+	may_drop = sdi->session->datafeed_overflow == SR_DF_OVERFLOW_DROP &&
+		(packet->type == SR_DF_LOGIC || packet->type == SR_DF_ANALOG ||
+		packet->type == SR_DF_LOGIC_RLE);
+	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (expanded && cb_struct->rle)
+			continue;
+		if (packet->type == SR_DF_LOGIC_RLE && !cb_struct->rle)
+			continue;
+		if (sr_log_loglevel_get() >= SR_LOG_DBG)
+			datafeed_dump(packet);
+		if (!cb_struct->worker) {
+			start_us = session_timing_start(sdi->session);
+			cb_struct->cb(sdi, packet, cb_struct->cb_data);
+			session_timing_update(sdi->session, &cb_struct->timing,
+				start_us);
+			continue;
+		}
+		if (!ref) {
+			ref = g_malloc0(sizeof(*ref));
+			ref->sdi = sdi;
+			ref->refcount = 1;
+			if (sr_packet_copy(packet, &ref->packet) != SR_OK) {
+				sr_err("Cannot copy packet for datafeed queue.");
+				g_free(ref->packet);
+				g_free(ref);
+				return SR_ERR;
+			}
+		}
+		datafeed_worker_push(cb_struct->worker, ref, may_drop);
 	}
+	if (ref)
+		datafeed_packet_ref_release(ref);
 
-	if (!packet) {
-		sr_err("%s: packet was NULL", __func__);
-		return SR_ERR_ARG;
-	}
+	return SR_OK;
+}
 
-	if (!sdi->session) {
-		sr_err("%s: session was NULL", __func__);
-		return SR_ERR_BUG;
-	}
+static int datafeed_deliver_expanded(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	return datafeed_deliver(cb_data, packet, TRUE);
+}
+
+/* Run a packet through the transforms, and pass it to the callbacks. */
+static int session_send_transformed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	GSList *l;
+	struct sr_datafeed_packet *packet_in, *packet_out;
+	struct sr_transform *t;
+	int64_t start_us;
+	int ret;
 
 	/*
 	 * Pass the packet to the first transform module. If that returns
@@ -1154,7 +1857,9 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 	for (l = sdi->session->transforms; l; l = l->next) {
 		t = l->data;
 		sr_spew("Running transform module '%s'.", t->module->id);
+		start_us = session_timing_start(sdi->session);
 		ret = t->module->receive(t, packet_in, &packet_out);
+		session_timing_update(sdi->session, &t->timing, start_us);
 		if (ret < 0) {
 			sr_err("Error while running transform module: %d.", ret);
 			return SR_ERR;
@@ -1174,20 +1879,209 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 			packet_in = packet_out;
 		}
 	}
-	packet = packet_in;
 
 	/*
 	 * If the last transform did output a packet, pass it to all datafeed
 	 * callbacks.
 	 */
-	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
-		if (sr_log_loglevel_get() >= SR_LOG_DBG)
-			datafeed_dump(packet);
+	return datafeed_deliver(sdi, packet_in, FALSE);
+}
+
+static int session_send_transformed_cb(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	return session_send_transformed(cb_data, packet);
+}
+
+static gboolean session_has_legacy_callbacks(struct sr_session *session)
+{
+	GSList *l;
+	struct datafeed_callback *cb_struct;
+
+	for (l = session->datafeed_callbacks; l; l = l->next) {
 		cb_struct = l->data;
-		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+		if (!cb_struct->rle)
+			return TRUE;
 	}
 
-	return SR_OK;
+	return FALSE;
+}
+
+/* Pass a packet to the transforms and callbacks, in the session thread. */
+static int session_dispatch(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	int ret;
+
+	session_stats_count_packet(sdi->session, packet);
+
+	if (packet->type != SR_DF_LOGIC_RLE)
+		return session_send_transformed(sdi, packet);
+
+	/* Transforms only handle expanded data. */
+	if (sdi->session->transforms)
+		return sr_logic_rle_to_logic(packet->payload,
+			session_send_transformed_cb, (void *)sdi);
+
+	ret = datafeed_deliver(sdi, packet, FALSE);
+	if (ret == SR_OK && session_has_legacy_callbacks(sdi->session))
+		ret = sr_logic_rle_to_logic(packet->payload,
+			datafeed_deliver_expanded, (void *)sdi);
+
+	return ret;
+}
+
+/*
+ * Queue a copy of a packet which was sent by a thread other than the
+ * session thread, like the USB event thread. The session main loop
+ * delivers it, so that transforms, triggers, statistics and datafeed
+ * callbacks only ever run in the session thread.
+ *
+ * Returns FALSE when the packet must be delivered immediately, because
+ * the caller is the session thread, or the session doesn't run.
+ */
+static gboolean session_send_defer(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, int *ret)
+{
+	struct sr_session *session;
+	struct datafeed_packet_ref *ref;
+	gboolean deferred;
+
+	session = sdi->session;
+	g_mutex_lock(&session->main_mutex);
+	deferred = session->deferred_source &&
+		session->main_thread != g_thread_self();
+	if (deferred) {
+		ref = g_malloc0(sizeof(*ref));
+		ref->sdi = sdi;
+		ref->refcount = 1;
+		*ret = sr_packet_copy(packet, &ref->packet);
+		if (*ret == SR_OK) {
+			g_async_queue_push(session->deferred_packets, ref);
+			g_source_set_ready_time(session->deferred_source, 0);
+		} else {
+			sr_err("Cannot copy packet for deferred delivery.");
+			g_free(ref->packet);
+			g_free(ref);
+		}
+	}
+	g_mutex_unlock(&session->main_mutex);
+
+	return deferred;
+}
+
+/* Deliver the queued packets of other threads, in the order they came. */
+static void session_deferred_deliver(struct sr_session *session)
+{
+	struct datafeed_packet_ref *ref;
+
+	while ((ref = g_async_queue_try_pop(session->deferred_packets))) {
+		session_dispatch(ref->sdi, ref->packet);
+		datafeed_packet_ref_release(ref);
+	}
+}
+
+/* Send a packet, its buffer field was set up by libsigrok. */
+static int session_send(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	int ret;
+
+	if (!sdi) {
+		sr_err("%s: sdi was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!sdi->session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_BUG;
+	}
+
+	if (session_send_defer(sdi, packet, &ret))
+		return ret;
+
+	/* Packets of other threads which are still queued come first. */
+	session_deferred_deliver(sdi->session);
+
+	return session_dispatch(sdi, packet);
+}
+
+/**
+ * Send a packet to whatever is listening on the datafeed bus.
+ *
+ * Hardware drivers use this to send a data packet to the frontend.
+ *
+ * SR_DF_LOGIC_RLE packets are passed unmodified to the callbacks which
+ * were registered with sr_session_datafeed_callback_add_rle(). All other
+ * callbacks, and transform modules, receive the data expanded to
+ * SR_DF_LOGIC packets.
+ *
+ * Packets which threads other than the session thread send get copied,
+ * and are delivered by the session main loop.
+ *
+ * @param sdi TODO.
+ * @param packet The datafeed packet to send to the session bus.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_datafeed_packet p;
+
+	if (!packet) {
+		sr_err("%s: packet was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	/* Drivers don't initialize the buffer field. */
+	p.type = packet->type;
+	p.payload = packet->payload;
+	p.buffer = NULL;
+
+	return session_send(sdi, &p);
+}
+
+/**
+ * Send a packet whose data is backed by a reference counted buffer.
+ *
+ * This works like sr_session_send(), but datafeed callbacks can take a
+ * reference to @a buf (see sr_packet_buffer_ref()) and keep the data
+ * after the callback has returned. Packet copies share the buffer as
+ * well. The caller must not modify the buffer after the call returned
+ * when sr_buffer_is_shared() says it is still in use.
+ *
+ * @param sdi The device instance to send the packet from. Must not be NULL.
+ * @param packet The logic or analog packet to send. Its data must be
+ *               located in @a buf. Must not be NULL.
+ * @param buf The buffer holding the packet's data. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_buffer(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, struct sr_buffer *buf)
+{
+	struct sr_datafeed_packet p;
+
+	if (!packet || !buf)
+		return SR_ERR_ARG;
+
+	if (packet->type != SR_DF_LOGIC && packet->type != SR_DF_ANALOG) {
+		sr_err("%s: unsupported packet type %d", __func__, packet->type);
+		return SR_ERR_ARG;
+	}
+
+	p.type = packet->type;
+	p.payload = packet->payload;
+	p.buffer = buf;
+
+	return session_send(sdi, &p);
 }
 
 /**
@@ -1503,17 +2397,25 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	struct sr_datafeed_logic *logic_copy;
 	const struct sr_datafeed_analog *analog;
 	struct sr_datafeed_analog *analog_copy;
+	const struct sr_datafeed_logic_rle *rle;
+	struct sr_datafeed_logic_rle *rle_copy;
 	struct sr_analog_encoding *encoding_copy;
 	struct sr_analog_meaning *meaning_copy;
 	struct sr_analog_spec *spec_copy;
+	struct sr_buffer *buf;
 	uint8_t *payload;
 
 	*copy = g_malloc0(sizeof(struct sr_datafeed_packet));
 	(*copy)->type = packet->type;
 
+	/* Copies of buffer backed packets share the buffer. */
+	buf = packet->buffer;
+
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1524,7 +2426,7 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	case SR_DF_META:
 		meta = packet->payload;
 		meta_copy = g_malloc0(sizeof(struct sr_datafeed_meta));
-		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy->config);
+		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy);
 		(*copy)->payload = meta_copy;
 		break;
 	case SR_DF_LOGIC:
@@ -1534,6 +2436,12 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 			return SR_ERR;
 		logic_copy->length = logic->length;
 		logic_copy->unitsize = logic->unitsize;
+		if (buf) {
+			logic_copy->data = logic->data;
+			(*copy)->payload = logic_copy;
+			(*copy)->buffer = sr_buffer_ref(buf);
+			break;
+		}
 		logic_copy->data = g_malloc(logic->length * logic->unitsize);
 		if (!logic_copy->data) {
 			g_free(logic_copy);
@@ -1545,10 +2453,15 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	case SR_DF_ANALOG:
 		analog = packet->payload;
 		analog_copy = g_malloc(sizeof(*analog_copy));
-		analog_copy->data = g_malloc(
+		if (buf) {
+			analog_copy->data = analog->data;
+			(*copy)->buffer = sr_buffer_ref(buf);
+		} else {
+			analog_copy->data = g_malloc(
 				analog->encoding->unitsize * analog->num_samples);
-		memcpy(analog_copy->data, analog->data,
+			memcpy(analog_copy->data, analog->data,
 				analog->encoding->unitsize * analog->num_samples);
+		}
 		analog_copy->num_samples = analog->num_samples;
 #if GLIB_CHECK_VERSION(2, 67, 3)
 		encoding_copy = g_memdup2(analog->encoding, sizeof(*analog->encoding));
@@ -1566,6 +2479,24 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		analog_copy->spec = spec_copy;
 		(*copy)->payload = analog_copy;
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		rle_copy = g_malloc(sizeof(*rle_copy));
+		rle_copy->num_runs = rle->num_runs;
+		rle_copy->unitsize = rle->unitsize;
+#if GLIB_CHECK_VERSION(2, 67, 3)
+		rle_copy->data = g_memdup2(rle->data,
+			rle->num_runs * rle->unitsize);
+		rle_copy->lengths = g_memdup2(rle->lengths,
+			rle->num_runs * sizeof(rle->lengths[0]));
+#else
+		rle_copy->data = g_memdup(rle->data,
+			rle->num_runs * rle->unitsize);
+		rle_copy->lengths = g_memdup(rle->lengths,
+			rle->num_runs * sizeof(rle->lengths[0]));
+#endif
+		(*copy)->payload = rle_copy;
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 		return SR_ERR;
@@ -1574,17 +2505,48 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	return SR_OK;
 }
 
+/**
+ * Get the buffer which holds the data of a logic or analog packet.
+ *
+ * Datafeed callbacks can use this to keep the packet's samples beyond
+ * the duration of the callback without copying them. The data remains
+ * valid and unmodified until the reference is dropped with
+ * sr_buffer_unref(). The packet itself must not be accessed after the
+ * callback returned, only the data pointer is covered by the buffer.
+ *
+ * @param packet The packet. Must not be NULL.
+ *
+ * @return A new reference to the buffer, or NULL if the packet's data
+ *         is not backed by a buffer. The data must be copied then.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_buffer *sr_packet_buffer_ref(
+		const struct sr_datafeed_packet *packet)
+{
+	if (!packet || !packet->buffer)
+		return NULL;
+
+	return sr_buffer_ref(packet->buffer);
+}
+
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
+	struct sr_buffer *buf;
 	struct sr_config *src;
 	GSList *l;
 
+	buf = packet->buffer;
+
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1603,21 +2565,30 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 		break;
 	case SR_DF_LOGIC:
 		logic = packet->payload;
-		g_free(logic->data);
+		if (!buf)
+			g_free(logic->data);
 		g_free((void *)packet->payload);
 		break;
 	case SR_DF_ANALOG:
 		analog = packet->payload;
-		g_free(analog->data);
+		if (!buf)
+			g_free(analog->data);
 		g_free(analog->encoding);
 		g_slist_free(analog->meaning->channels);
 		g_free(analog->meaning);
 		g_free(analog->spec);
 		g_free((void *)packet->payload);
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		g_free(rle->data);
+		g_free(rle->lengths);
+		g_free((void *)packet->payload);
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 	}
+	sr_buffer_unref(buf);
 	g_free(packet);
 }
 
@@ -34,22 +34,58 @@
 #define CHUNKSIZE (4 * 1024 * 1024)
 /** @endcond */
 
+/* Number of recycled buffers which the reader decompresses into. */
+#define PREFETCH_BUFFERS 4
+
+#define ZIP_LOCAL_HEADER_SIG	0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG	0x02014b50
+#define ZIP_EOCD_SIG		0x06054b50
+#define ZIP64_EOCD_SIG		0x06064b50
+#define ZIP64_LOCATOR_SIG	0x07064b50
+#define ZIP64_EXTRA_ID		0x0001
+
 SR_PRIV struct sr_dev_driver session_driver_info;
 
+/* An archive member with capture data, in the order of submission. */
+struct capture_entry {
+	char *name;
+	/* 0 for logic data, analog channel index plus one otherwise. */
+	int channel;
+};
+
+/* A block of capture data which the reader thread provides. */
+struct capture_chunk {
+	int channel;
+	const uint8_t *data;
+	size_t length;
+	/* Recycled buffer, NULL when data points into the file mapping. */
+	uint8_t *buf;
+	/* Set on the last chunk, which carries no data. */
+	gboolean end;
+	/* The reader's result, on the last chunk. */
+	int ret;
+};
+
 struct session_vdev {
 	char *sessionfile;
 	char *capturefile;
 	struct zip *archive;
-	struct zip_file *capfile;
 	int bytes_read;
 	uint64_t samplerate;
 	int unitsize;
 	int num_logic_channels;
 	int num_analog_channels;
-	int cur_analog_channel;
 	GArray *analog_channels;
-	int cur_chunk;
 	gboolean finished;
+	/* Prefetching reader, and uncompressed members in the file mapping. */
+	GSList *entries;
+	GMappedFile *mapping;
+	GHashTable *stored;
+	GThread *thread;
+	GAsyncQueue *ready_chunks;
+	GAsyncQueue *free_chunks;
+	gint abort;
+	gboolean thread_done;
 };
 
 static const uint32_t devopts[] = {
@@ -61,6 +97,348 @@ static const uint32_t devopts[] = {
 	SR_CONF_SESSIONFILE | SR_CONF_SET,
 };
 
+/* Locate the content of uncompressed members in the mapped archive. */
+static GHashTable *scan_stored_entries(const uint8_t *map, uint64_t size)
+{
+	GHashTable *stored;
+	GBytes *content;
+	const uint8_t *p, *eocd, *extra, *local;
+	uint64_t count, cd_offset, cd_size, pos;
+	uint64_t comp_size, data_size, offset, data_pos;
+	uint16_t flags, method, name_len, extra_len, comment_len, id, len;
+	char *name;
+
+	/* Find the end of central directory record, skip a comment. */
+	if (size < 22)
+		return NULL;
+	eocd = NULL;
+	for (pos = size - 22; ; pos--) {
+		if (read_u32le(&map[pos]) == ZIP_EOCD_SIG) {
+			eocd = &map[pos];
+			break;
+		}
+		if (pos == 0 || size - pos > 22 + G_MAXUINT16)
+			break;
+	}
+	if (!eocd)
+		return NULL;
+	count = read_u16le(&eocd[10]);
+	cd_size = read_u32le(&eocd[12]);
+	cd_offset = read_u32le(&eocd[16]);
+	if (count == G_MAXUINT16 || cd_size == G_MAXUINT32 ||
+			cd_offset == G_MAXUINT32) {
+		pos = eocd - map;
+		if (pos < 20 || read_u32le(&eocd[-20]) != ZIP64_LOCATOR_SIG)
+			return NULL;
+		pos = read_u64le(&eocd[-12]);
+		if (size < 56 || pos > size - 56 ||
+				read_u32le(&map[pos]) != ZIP64_EOCD_SIG)
+			return NULL;
+		count = read_u64le(&map[pos + 32]);
+		cd_size = read_u64le(&map[pos + 40]);
+		cd_offset = read_u64le(&map[pos + 48]);
+	}
+	if (cd_offset > size || cd_size > size - cd_offset)
+		return NULL;
+
+	stored = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, (GDestroyNotify)g_bytes_unref);
+	pos = cd_offset;
+	while (count--) {
+		if (cd_offset + cd_size - pos < 46)
+			break;
+		p = &map[pos];
+		if (read_u32le(p) != ZIP_CENTRAL_HEADER_SIG)
+			break;
+		flags = read_u16le(&p[8]);
+		method = read_u16le(&p[10]);
+		comp_size = read_u32le(&p[20]);
+		data_size = read_u32le(&p[24]);
+		name_len = read_u16le(&p[28]);
+		extra_len = read_u16le(&p[30]);
+		comment_len = read_u16le(&p[32]);
+		offset = read_u32le(&p[42]);
+		pos += 46 + name_len + extra_len + comment_len;
+		if (pos > cd_offset + cd_size)
+			break;
+
+		/* ZIP64 fields are present for saturated values only. */
+		extra = &p[46 + name_len];
+		while (extra + 4 <= &p[46 + name_len + extra_len]) {
+			id = read_u16le(&extra[0]);
+			len = read_u16le(&extra[2]);
+			if (extra + 4 + len > &p[46 + name_len + extra_len])
+				break;
+			if (id == ZIP64_EXTRA_ID) {
+				local = &extra[4];
+				if (data_size == G_MAXUINT32 && local + 8 <= &extra[4 + len]) {
+					data_size = read_u64le(local);
+					local += 8;
+				}
+				if (comp_size == G_MAXUINT32 && local + 8 <= &extra[4 + len]) {
+					comp_size = read_u64le(local);
+					local += 8;
+				}
+				if (offset == G_MAXUINT32 && local + 8 <= &extra[4 + len])
+					offset = read_u64le(local);
+			}
+			extra += 4 + len;
+		}
+
+		/* Only plain uncompressed members can be used in place. */
+		if (method != 0 || (flags & 0x0001) || comp_size != data_size)
+			continue;
+		if (size < 30 || offset > size - 30)
+			continue;
+		local = &map[offset];
+		if (read_u32le(local) != ZIP_LOCAL_HEADER_SIG)
+			continue;
+		data_pos = offset + 30 + read_u16le(&local[26]) + read_u16le(&local[28]);
+		if (data_pos > size || data_size > size - data_pos)
+			continue;
+
+		name = g_strndup((const char *)&p[46], name_len);
+		content = g_bytes_new_static(&map[data_pos], data_size);
+		g_hash_table_insert(stored, name, content);
+	}
+
+	return stored;
+}
+
+/* Determine the members to read, logic data first, then analog channels. */
+static void collect_entries(struct session_vdev *vdev)
+{
+	struct capture_entry *entry;
+	char *basename, *name;
+	int ch, chunk;
+
+	for (ch = 0; ch <= vdev->num_analog_channels; ch++) {
+		if (ch == 0 && !vdev->capturefile)
+			continue;
+		if (ch == 0)
+			basename = g_strdup(vdev->capturefile);
+		else
+			basename = g_strdup_printf("analog-1-%d",
+				vdev->num_logic_channels + ch);
+
+		/* Either a single member, or numbered chunks. */
+		if (zip_name_locate(vdev->archive, basename, 0) >= 0) {
+			entry = g_malloc0(sizeof(*entry));
+			entry->name = basename;
+			entry->channel = ch;
+			vdev->entries = g_slist_append(vdev->entries, entry);
+			continue;
+		}
+		for (chunk = 1; ; chunk++) {
+			name = g_strdup_printf("%s-%d", basename, chunk);
+			if (zip_name_locate(vdev->archive, name, 0) < 0) {
+				g_free(name);
+				break;
+			}
+			entry = g_malloc0(sizeof(*entry));
+			entry->name = name;
+			entry->channel = ch;
+			vdev->entries = g_slist_append(vdev->entries, entry);
+		}
+		if (chunk == 1 && ch == 0) {
+			sr_err("No capture file '%s' in session file '%s'.",
+				vdev->capturefile, vdev->sessionfile);
+		}
+		g_free(basename);
+	}
+}
+
+static void free_entry(void *data)
+{
+	struct capture_entry *entry;
+
+	entry = data;
+	g_free(entry->name);
+	g_free(entry);
+}
+
+/* Return a chunk to the reader after its data was sent. */
+static void release_chunk(struct session_vdev *vdev,
+	struct capture_chunk *chunk)
+{
+	if (chunk->buf)
+		g_async_queue_push(vdev->free_chunks, chunk);
+	else
+		g_free(chunk);
+}
+
+/*
+ * Read the capture data ahead of the session's consumption. Compressed
+ * members get inflated into a bounded set of recycled buffers, which
+ * throttles the thread. Stored members are sliced from the mapping.
+ */
+static gpointer prefetch_thread(gpointer data)
+{
+	struct session_vdev *vdev;
+	struct capture_entry *entry;
+	struct capture_chunk *chunk;
+	struct zip_file *capfile;
+	GBytes *content;
+	const uint8_t *mapped;
+	gsize mapped_size, pos, step;
+	zip_int64_t ret;
+	GSList *l;
+	int err;
+
+	vdev = data;
+	err = SR_OK;
+	for (l = vdev->entries; l && err == SR_OK; l = l->next) {
+		entry = l->data;
+
+		/* unitsize is not defined for purely analog session files. */
+		if (entry->channel == 0 && vdev->unitsize)
+			step = CHUNKSIZE / vdev->unitsize * vdev->unitsize;
+		else
+			step = CHUNKSIZE;
+
+		/* Analog consumers access floats, which need alignment. */
+		content = NULL;
+		if (vdev->stored)
+			content = g_hash_table_lookup(vdev->stored, entry->name);
+		if (content) {
+			mapped = g_bytes_get_data(content, &mapped_size);
+			if (entry->channel && ((uintptr_t)mapped % sizeof(float)))
+				content = NULL;
+		}
+		if (content) {
+			sr_dbg("Mapped %s.", entry->name);
+			for (pos = 0; pos < mapped_size; pos += step) {
+				if (g_atomic_int_get(&vdev->abort))
+					break;
+				chunk = g_malloc0(sizeof(*chunk));
+				chunk->channel = entry->channel;
+				chunk->data = &mapped[pos];
+				chunk->length = MIN(step, mapped_size - pos);
+				g_async_queue_push(vdev->ready_chunks, chunk);
+			}
+			continue;
+		}
+
+		if (!(capfile = zip_fopen(vdev->archive, entry->name, 0))) {
+			sr_err("Failed to open %s: %s.", entry->name,
+				zip_strerror(vdev->archive));
+			err = SR_ERR_IO;
+			break;
+		}
+		sr_dbg("Opened %s.", entry->name);
+		while (!g_atomic_int_get(&vdev->abort)) {
+			chunk = g_async_queue_pop(vdev->free_chunks);
+			ret = zip_fread(capfile, chunk->buf, step);
+			if (ret <= 0) {
+				g_async_queue_push(vdev->free_chunks, chunk);
+				if (ret < 0) {
+					sr_err("Failed to read %s: %s.", entry->name,
+						zip_file_strerror(capfile));
+					err = SR_ERR_IO;
+				}
+				break;
+			}
+			chunk->channel = entry->channel;
+			chunk->data = chunk->buf;
+			chunk->length = ret;
+			g_async_queue_push(vdev->ready_chunks, chunk);
+		}
+		zip_fclose(capfile);
+		if (g_atomic_int_get(&vdev->abort))
+			break;
+	}
+
+	chunk = g_malloc0(sizeof(*chunk));
+	chunk->end = TRUE;
+	chunk->ret = err;
+	g_async_queue_push(vdev->ready_chunks, chunk);
+
+	return NULL;
+}
+
+static int prefetch_start(struct session_vdev *vdev)
+{
+	struct capture_chunk *chunk;
+	GError *error;
+	int i;
+
+	/*
+	 * Map privately writable: transforms modify logic packets in place,
+	 * and their writes must neither fault nor reach the session file.
+	 */
+	error = NULL;
+	vdev->mapping = g_mapped_file_new(vdev->sessionfile, TRUE, &error);
+	if (vdev->mapping) {
+		vdev->stored = scan_stored_entries(
+			(const uint8_t *)g_mapped_file_get_contents(vdev->mapping),
+			g_mapped_file_get_length(vdev->mapping));
+	} else {
+		sr_dbg("Cannot map %s: %s.", vdev->sessionfile, error->message);
+		g_error_free(error);
+	}
+
+	vdev->ready_chunks = g_async_queue_new();
+	vdev->free_chunks = g_async_queue_new();
+	for (i = 0; i < PREFETCH_BUFFERS; i++) {
+		chunk = g_malloc0(sizeof(*chunk));
+		chunk->buf = g_malloc(CHUNKSIZE);
+		g_async_queue_push(vdev->free_chunks, chunk);
+	}
+	vdev->abort = 0;
+	vdev->thread_done = FALSE;
+
+	error = NULL;
+	vdev->thread = g_thread_try_new("sr-session-read",
+		prefetch_thread, vdev, &error);
+	if (!vdev->thread) {
+		sr_err("Failed to start session reader: %s.", error->message);
+		g_error_free(error);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static void prefetch_stop(struct session_vdev *vdev)
+{
+	struct capture_chunk *chunk;
+
+	/* Unblock the reader by returning buffers until it has ended. */
+	if (vdev->thread) {
+		g_atomic_int_set(&vdev->abort, 1);
+		while (!vdev->thread_done) {
+			chunk = g_async_queue_pop(vdev->ready_chunks);
+			vdev->thread_done = chunk->end;
+			release_chunk(vdev, chunk);
+		}
+		g_thread_join(vdev->thread);
+		vdev->thread = NULL;
+	}
+
+	if (vdev->free_chunks) {
+		while ((chunk = g_async_queue_try_pop(vdev->free_chunks))) {
+			g_free(chunk->buf);
+			g_free(chunk);
+		}
+		g_async_queue_unref(vdev->free_chunks);
+		vdev->free_chunks = NULL;
+	}
+	if (vdev->ready_chunks) {
+		g_async_queue_unref(vdev->ready_chunks);
+		vdev->ready_chunks = NULL;
+	}
+	if (vdev->stored) {
+		g_hash_table_destroy(vdev->stored);
+		vdev->stored = NULL;
+	}
+	if (vdev->mapping) {
+		g_mapped_file_unref(vdev->mapping);
+		vdev->mapping = NULL;
+	}
+	g_slist_free_full(vdev->entries, free_entry);
+	vdev->entries = NULL;
+}
+
 static gboolean stream_session_data(struct sr_dev_inst *sdi)
 {
 	struct session_vdev *vdev;
@@ -70,134 +448,63 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
-	struct zip_stat zs;
-	int ret, got_data;
-	char capturefile[128];
-	void *buf;
+	struct capture_chunk *chunk;
+	gboolean got_data;
 
-	got_data = FALSE;
 	vdev = sdi->priv;
 
-	if (!vdev->capfile) {
-		/* No capture file opened yet, or finished with the last
-		 * chunked one. */
-		if (vdev->capturefile && (vdev->cur_chunk == 0)) {
-			/* capturefile is always the unchunked base name. */
-			if (zip_stat(vdev->archive, vdev->capturefile, 0, &zs) != -1) {
-				/* No chunks, just a single capture file. */
-				vdev->cur_chunk = 0;
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						vdev->capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", vdev->capturefile);
-			} else {
-				/* Try as first chunk filename. */
-				snprintf(capturefile, sizeof(capturefile) - 1, "%s-1", vdev->capturefile);
-				if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-					vdev->cur_chunk = 1;
-					if (!(vdev->capfile = zip_fopen(vdev->archive,
-							capturefile, 0)))
-						return FALSE;
-					sr_dbg("Opened %s.", capturefile);
-				} else {
-					sr_err("No capture file '%s' in " "session file '%s'.",
-							vdev->capturefile, vdev->sessionfile);
-					return FALSE;
-				}
-			}
-		} else {
-			/* Capture data is chunked, advance to the next chunk. */
-			vdev->cur_chunk++;
-			snprintf(capturefile, sizeof(capturefile) - 1, "%s-%d", vdev->capturefile,
-					vdev->cur_chunk);
-			if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", capturefile);
-			} else if (vdev->cur_analog_channel < vdev->num_analog_channels) {
-				vdev->capturefile = g_strdup_printf("analog-1-%d",
-						vdev->num_logic_channels + vdev->cur_analog_channel + 1);
-				vdev->cur_analog_channel++;
-				vdev->cur_chunk = 0;
-				return TRUE;
-			} else {
-				/* We got all the chunks, finish up. */
-				g_free(vdev->capturefile);
-
-				/* If the file has logic channels, the initial value for
-				 * capturefile is set by stream_session_data() - however only
-				 * once. In order to not mess this mechanism up, we simulate
-				 * this here if needed. For purely analog files, capturefile
-				 * is not set.
-				 */
-				if (vdev->num_logic_channels)
-					vdev->capturefile = g_strdup("logic-1");
-				else
-					vdev->capturefile = NULL;
-				return FALSE;
-			}
-		}
+	chunk = g_async_queue_pop(vdev->ready_chunks);
+	if (chunk->end) {
+		/* The session still ends regularly, with what was read. */
+		if (chunk->ret != SR_OK)
+			sr_err("Session file %s is incomplete: %s.",
+				vdev->sessionfile, sr_strerror(chunk->ret));
+		vdev->thread_done = TRUE;
+		g_free(chunk);
+		return FALSE;
 	}
 
-	buf = g_malloc(CHUNKSIZE);
-
-	/* unitsize is not defined for purely analog session files. */
-	if (vdev->unitsize)
-		ret = zip_fread(vdev->capfile, buf,
-				CHUNKSIZE / vdev->unitsize * vdev->unitsize);
-	else
-		ret = zip_fread(vdev->capfile, buf, CHUNKSIZE);
-
-	if (ret > 0) {
-		if (vdev->cur_analog_channel != 0) {
-			got_data = TRUE;
-			packet.type = SR_DF_ANALOG;
-			packet.payload = &analog;
-			/* TODO: Use proper 'digits' value for this device (and its modes). */
-			sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-			analog.meaning->channels = g_slist_prepend(NULL,
-					g_array_index(vdev->analog_channels,
-						struct sr_channel *, vdev->cur_analog_channel - 1));
-			analog.num_samples = ret / sizeof(float);
-			analog.meaning->mq = SR_MQ_VOLTAGE;
-			analog.meaning->unit = SR_UNIT_VOLT;
-			analog.meaning->mqflags = SR_MQFLAG_DC;
-			analog.data = (float *) buf;
-		} else if (vdev->unitsize) {
-			got_data = TRUE;
-			if (ret % vdev->unitsize != 0)
-				sr_warn("Read size %d not a multiple of the"
-					" unit size %d.", ret, vdev->unitsize);
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = ret;
-			logic.unitsize = vdev->unitsize;
-			logic.data = buf;
-		} else {
-			/*
-			 * Neither analog data, nor logic which has
-			 * unitsize, must be an unexpected API use.
-			 */
-			sr_warn("Neither analog nor logic data. Ignoring.");
-		}
-		if (got_data) {
-			vdev->bytes_read += ret;
-			sr_session_send(sdi, &packet);
-		}
+	got_data = FALSE;
+	if (chunk->channel != 0) {
+		got_data = TRUE;
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &analog;
+		/* TODO: Use proper 'digits' value for this device (and its modes). */
+		sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+		analog.meaning->channels = g_slist_prepend(NULL,
+				g_array_index(vdev->analog_channels,
+					struct sr_channel *, chunk->channel - 1));
+		analog.num_samples = chunk->length / sizeof(float);
+		analog.meaning->mq = SR_MQ_VOLTAGE;
+		analog.meaning->unit = SR_UNIT_VOLT;
+		analog.meaning->mqflags = SR_MQFLAG_DC;
+		analog.data = (void *)chunk->data;
+	} else if (vdev->unitsize) {
+		got_data = TRUE;
+		if (chunk->length % vdev->unitsize != 0)
+			sr_warn("Read size %zu not a multiple of the"
+				" unit size %d.", chunk->length, vdev->unitsize);
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		logic.length = chunk->length;
+		logic.unitsize = vdev->unitsize;
+		logic.data = (void *)chunk->data;
 	} else {
-		/* done with this capture file */
-		zip_fclose(vdev->capfile);
-		vdev->capfile = NULL;
-		if (vdev->cur_chunk != 0) {
-			/* There might be more chunks, so don't fall through
-			 * to the SR_DF_END here. */
-			got_data = TRUE;
-		}
+		/*
+		 * Neither analog data, nor logic which has
+		 * unitsize, must be an unexpected API use.
+		 */
+		sr_warn("Neither analog nor logic data. Ignoring.");
+	}
+	if (got_data) {
+		vdev->bytes_read += chunk->length;
+		sr_session_send(sdi, &packet);
+		if (packet.type == SR_DF_ANALOG)
+			g_slist_free(analog.meaning->channels);
 	}
-	g_free(buf);
+	release_chunk(vdev, chunk);
 
-	return got_data;
+	return TRUE;
 }
 
 static int receive_data(int fd, int revents, void *cb_data)
@@ -216,14 +523,15 @@ static int receive_data(int fd, int revents, void *cb_data)
 	if (!vdev->finished)
 		return G_SOURCE_CONTINUE;
 
-	if (vdev->capfile) {
-		zip_fclose(vdev->capfile);
-		vdev->capfile = NULL;
-	}
+	prefetch_stop(vdev);
 	if (vdev->archive) {
 		zip_discard(vdev->archive);
 		vdev->archive = NULL;
 	}
+	if (vdev->analog_channels) {
+		g_array_free(vdev->analog_channels, TRUE);
+		vdev->analog_channels = NULL;
+	}
 
 	std_session_send_df_end(sdi);
 
@@ -340,7 +648,6 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	vdev = sdi->priv;
 	vdev->bytes_read = 0;
-	vdev->cur_analog_channel = 0;
 	vdev->analog_channels = g_array_sized_new(FALSE, FALSE,
 			sizeof(struct sr_channel *), vdev->num_analog_channels);
 	for (l = sdi->channels; l; l = l->next) {
@@ -348,7 +655,6 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		if (ch->type == SR_CHANNEL_ANALOG)
 			g_array_append_val(vdev->analog_channels, ch);
 	}
-	vdev->cur_chunk = 0;
 	vdev->finished = FALSE;
 
 	sr_info("Opening archive %s file %s", vdev->sessionfile,
@@ -360,6 +666,14 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
+	collect_entries(vdev);
+	if (prefetch_start(vdev) != SR_OK) {
+		prefetch_stop(vdev);
+		zip_discard(vdev->archive);
+		vdev->archive = NULL;
+		return SR_ERR;
+	}
+
 	std_session_send_df_header(sdi);
 
 	/* freewheeling source */
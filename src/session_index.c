@@ -0,0 +1,1026 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <zip.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-index"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Random access to the sample data of session files.
+ */
+
+/**
+ * @addtogroup grp_session
+ *
+ * @{
+ */
+
+/* Archive member which keeps a persisted index. */
+#define INDEX_MEMBER "index"
+#define INDEX_VERSION 1
+
+/* Buffer size for skipping data within compressed members. */
+#define SKIP_SIZE (64 * 1024)
+
+/* Summary levels, see the srzip output module for their format. */
+#define SUMMARY_MEMBER "summary"
+#define SUMMARY_VERSION 1
+#define SUMMARY_ANALOG_SIZE (3 * sizeof(float))
+
+/* An archive member with a contiguous range of samples. */
+struct index_chunk {
+	zip_uint64_t member;
+	uint64_t first;
+	uint64_t samples;
+};
+
+/* The logic data, or an analog channel's data. */
+struct index_stream {
+	char *basename;
+	size_t sample_size;
+	uint64_t samples;
+	GArray *chunks;
+	/* Summary members, one per level. */
+	size_t record_size;
+	GArray *summary;
+};
+
+struct summary_level {
+	zip_uint64_t member;
+	uint64_t records;
+};
+
+struct sr_session_index {
+	struct zip *archive;
+	int unitsize;
+	int num_logic;
+	int num_analog;
+	/* NULL when the file has no logic data. */
+	struct index_stream *logic;
+	struct index_stream *analog;
+	/* The member which was read last, continue there if possible. */
+	struct zip_file *cur_file;
+	zip_uint64_t cur_member;
+	uint64_t cur_offset;
+	uint8_t *skip_buf;
+	/* Samples per record of the first summary level, level factor. */
+	uint64_t summary_base;
+	uint64_t summary_factor;
+};
+
+static void stream_init(struct index_stream *stream, char *basename,
+	size_t sample_size)
+{
+	stream->basename = basename;
+	stream->sample_size = sample_size;
+	stream->samples = 0;
+	stream->chunks = g_array_new(FALSE, FALSE, sizeof(struct index_chunk));
+	stream->summary = g_array_new(FALSE, FALSE, sizeof(struct summary_level));
+}
+
+static void stream_clear(struct index_stream *stream)
+{
+	g_free(stream->basename);
+	if (stream->chunks)
+		g_array_free(stream->chunks, TRUE);
+	if (stream->summary)
+		g_array_free(stream->summary, TRUE);
+}
+
+static int stream_add_chunk(struct index_stream *stream,
+	struct zip *archive, zip_uint64_t member)
+{
+	struct zip_stat zs;
+	struct index_chunk chunk;
+
+	if (zip_stat_index(archive, member, 0, &zs) < 0)
+		return SR_ERR_DATA;
+	if (zs.size % stream->sample_size)
+		sr_warn("Member %s has a partial sample.", zs.name);
+
+	chunk.member = member;
+	chunk.first = stream->samples;
+	chunk.samples = zs.size / stream->sample_size;
+	g_array_append_val(stream->chunks, chunk);
+	stream->samples += chunk.samples;
+
+	return SR_OK;
+}
+
+/* Find the stream's members, either a single one or numbered chunks. */
+static int stream_build(struct index_stream *stream, struct zip *archive)
+{
+	zip_int64_t member;
+	char *name;
+	int chunk, ret;
+
+	member = zip_name_locate(archive, stream->basename, 0);
+	if (member >= 0)
+		return stream_add_chunk(stream, archive, member);
+
+	for (chunk = 1; ; chunk++) {
+		name = g_strdup_printf("%s-%d", stream->basename, chunk);
+		member = zip_name_locate(archive, name, 0);
+		g_free(name);
+		if (member < 0)
+			break;
+		if ((ret = stream_add_chunk(stream, archive, member)) != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/* Check that a member holds the stream's data, as a whole or a chunk. */
+static gboolean stream_has_member(const struct index_stream *stream,
+	const char *name)
+{
+	const char *p;
+
+	if (!g_str_has_prefix(name, stream->basename))
+		return FALSE;
+	p = name + strlen(stream->basename);
+	if (!*p)
+		return TRUE;
+	if (*p++ != '-' || !*p)
+		return FALSE;
+	while (g_ascii_isdigit(*p))
+		p++;
+
+	return *p == '\0';
+}
+
+/* Take the stream's chunks from a persisted index, verify them. */
+static int stream_load(struct index_stream *stream, struct zip *archive,
+	GKeyFile *kf)
+{
+	struct zip_stat zs;
+	struct index_chunk chunk;
+	gint *members;
+	gchar **samples;
+	gsize num_members, i;
+	int ret;
+
+	/* Streams without data have no group. */
+	if (!g_key_file_has_group(kf, stream->basename))
+		return SR_OK;
+
+	members = g_key_file_get_integer_list(kf, stream->basename,
+		"members", &num_members, NULL);
+	samples = g_key_file_get_string_list(kf, stream->basename,
+		"samples", NULL, NULL);
+	ret = (members && samples) ? SR_OK : SR_ERR_DATA;
+	for (i = 0; ret == SR_OK && i < num_members; i++) {
+		if (!samples[i] || members[i] < 0) {
+			ret = SR_ERR_DATA;
+			break;
+		}
+		chunk.member = members[i];
+		chunk.first = stream->samples;
+		chunk.samples = g_ascii_strtoull(samples[i], NULL, 10);
+		if (zip_stat_index(archive, chunk.member, 0, &zs) < 0 ||
+				!stream_has_member(stream, zs.name) ||
+				zs.size / stream->sample_size != chunk.samples) {
+			ret = SR_ERR_DATA;
+			break;
+		}
+		g_array_append_val(stream->chunks, chunk);
+		stream->samples += chunk.samples;
+	}
+	g_free(members);
+	g_strfreev(samples);
+
+	return ret;
+}
+
+static void stream_save(const struct index_stream *stream, GKeyFile *kf)
+{
+	const struct index_chunk *chunk;
+	gint *members;
+	gchar **samples;
+	guint i;
+
+	if (!stream->chunks->len)
+		return;
+
+	members = g_malloc0_n(stream->chunks->len + 1, sizeof(*members));
+	samples = g_malloc0_n(stream->chunks->len + 1, sizeof(*samples));
+	for (i = 0; i < stream->chunks->len; i++) {
+		chunk = &g_array_index(stream->chunks, struct index_chunk, i);
+		members[i] = chunk->member;
+		samples[i] = g_strdup_printf("%" PRIu64, chunk->samples);
+	}
+	g_key_file_set_integer_list(kf, stream->basename, "members",
+		members, stream->chunks->len);
+	g_key_file_set_string_list(kf, stream->basename, "samples",
+		(const gchar * const *)samples, stream->chunks->len);
+	g_free(members);
+	g_strfreev(samples);
+}
+
+/* Use the archive's persisted index, if there is a valid one. */
+static int index_load(struct sr_session_index *index)
+{
+	struct zip_stat zs;
+	GKeyFile *kf;
+	int i, ret;
+
+	if (zip_stat(index->archive, INDEX_MEMBER, 0, &zs) < 0)
+		return SR_ERR_NA;
+	if (!(kf = sr_sessionfile_read_metadata(index->archive, &zs)))
+		return SR_ERR_DATA;
+
+	/* Members which were added later invalidate the index. */
+	ret = SR_OK;
+	if (g_key_file_get_integer(kf, "index", "version", NULL) != INDEX_VERSION)
+		ret = SR_ERR_DATA;
+	if (g_key_file_get_uint64(kf, "index", "members", NULL) !=
+			(guint64)zip_get_num_entries(index->archive, 0) - 1)
+		ret = SR_ERR_DATA;
+	if (ret == SR_OK && index->logic)
+		ret = stream_load(index->logic, index->archive, kf);
+	for (i = 0; ret == SR_OK && i < index->num_analog; i++)
+		ret = stream_load(&index->analog[i], index->archive, kf);
+	g_key_file_free(kf);
+
+	return ret;
+}
+
+/* Add the index to the archive, which libzip rewrites upon close. */
+static int index_save(struct sr_session_index *index, const char *filename)
+{
+	struct zip_source *src;
+	GKeyFile *kf;
+	gchar *buf;
+	gsize len;
+	zip_int64_t members;
+	int i, ret;
+
+	/* The number of members, not counting the index itself. */
+	members = zip_get_num_entries(index->archive, 0);
+	if (zip_name_locate(index->archive, INDEX_MEMBER, 0) >= 0)
+		members--;
+
+	kf = g_key_file_new();
+	g_key_file_set_integer(kf, "index", "version", INDEX_VERSION);
+	g_key_file_set_uint64(kf, "index", "members", members);
+	if (index->logic)
+		stream_save(index->logic, kf);
+	for (i = 0; i < index->num_analog; i++)
+		stream_save(&index->analog[i], kf);
+	buf = g_key_file_to_data(kf, &len, NULL);
+	g_key_file_free(kf);
+
+	ret = SR_OK;
+	src = zip_source_buffer(index->archive, buf, len, FALSE);
+	if (zip_file_add(index->archive, INDEX_MEMBER, src, ZIP_FL_OVERWRITE) < 0) {
+		sr_err("Failed to add index: %s", zip_strerror(index->archive));
+		zip_source_free(src);
+		zip_discard(index->archive);
+		ret = SR_ERR;
+	} else if (zip_close(index->archive) < 0) {
+		sr_err("Failed to save index: %s", zip_strerror(index->archive));
+		zip_discard(index->archive);
+		ret = SR_ERR_IO;
+	}
+	g_free(buf);
+
+	/* Member indices are kept, the index remains valid. */
+	index->archive = zip_open(filename, 0, NULL);
+	if (!index->archive) {
+		sr_err("Failed to reopen session file '%s'.", filename);
+		return SR_ERR_IO;
+	}
+
+	return ret;
+}
+
+/* Get the file's layout from its first device section. */
+static int index_read_metadata(struct sr_session_index *index)
+{
+	struct zip_stat zs;
+	GKeyFile *kf;
+	gchar **sections, *capturefile;
+	int i;
+
+	if (zip_stat(index->archive, "metadata", 0, &zs) < 0)
+		return SR_ERR_DATA;
+	if (!(kf = sr_sessionfile_read_metadata(index->archive, &zs)))
+		return SR_ERR_DATA;
+
+	capturefile = NULL;
+	sections = g_key_file_get_groups(kf, NULL);
+	for (i = 0; sections[i]; i++) {
+		if (strncmp(sections[i], "device ", 7))
+			continue;
+		capturefile = g_key_file_get_string(kf, sections[i],
+			"capturefile", NULL);
+		index->unitsize = g_key_file_get_integer(kf, sections[i],
+			"unitsize", NULL);
+		index->num_logic = g_key_file_get_integer(kf, sections[i],
+			"total probes", NULL);
+		index->num_analog = g_key_file_get_integer(kf, sections[i],
+			"total analog", NULL);
+		break;
+	}
+	g_strfreev(sections);
+	g_key_file_free(kf);
+
+	if (index->num_logic < 0 || index->num_analog < 0 ||
+			(capturefile && index->unitsize <= 0)) {
+		g_free(capturefile);
+		return SR_ERR_DATA;
+	}
+
+	if (capturefile) {
+		index->logic = g_malloc0(sizeof(*index->logic));
+		stream_init(index->logic, capturefile, index->unitsize);
+		index->logic->record_size = 36 * index->unitsize;
+	}
+	index->analog = g_malloc0_n(index->num_analog, sizeof(*index->analog));
+	for (i = 0; i < index->num_analog; i++) {
+		stream_init(&index->analog[i],
+			g_strdup_printf("analog-1-%d", index->num_logic + i + 1),
+			sizeof(float));
+		index->analog[i].record_size = SUMMARY_ANALOG_SIZE;
+	}
+
+	return SR_OK;
+}
+
+static void index_clear_streams(struct sr_session_index *index)
+{
+	int i;
+
+	if (index->logic) {
+		g_array_set_size(index->logic->chunks, 0);
+		index->logic->samples = 0;
+	}
+	for (i = 0; i < index->num_analog; i++) {
+		g_array_set_size(index->analog[i].chunks, 0);
+		index->analog[i].samples = 0;
+	}
+}
+
+/* Find a stream's summary levels, which must be contiguous. */
+static void stream_load_summary(struct index_stream *stream,
+	struct zip *archive, int levels)
+{
+	struct summary_level level;
+	struct zip_stat zs;
+	zip_int64_t member;
+	char *name;
+	int i;
+
+	for (i = 0; i < levels; i++) {
+		name = g_strdup_printf("summary-%s-%d", stream->basename, i);
+		member = zip_name_locate(archive, name, 0);
+		g_free(name);
+		if (member < 0 || zip_stat_index(archive, member, 0, &zs) < 0)
+			break;
+		level.member = member;
+		level.records = zs.size / stream->record_size;
+		g_array_append_val(stream->summary, level);
+	}
+}
+
+/* Use the summary levels which the archive has, if any. */
+static void index_load_summary(struct sr_session_index *index)
+{
+	struct zip_stat zs;
+	GKeyFile *kf;
+	int levels, i;
+
+	if (zip_stat(index->archive, SUMMARY_MEMBER, 0, &zs) < 0)
+		return;
+	if (!(kf = sr_sessionfile_read_metadata(index->archive, &zs)))
+		return;
+	levels = g_key_file_get_integer(kf, "summary", "levels", NULL);
+	index->summary_base = g_key_file_get_uint64(kf, "summary", "base", NULL);
+	index->summary_factor = g_key_file_get_uint64(kf, "summary",
+		"factor", NULL);
+	if (g_key_file_get_integer(kf, "summary", "version", NULL) != SUMMARY_VERSION ||
+			levels <= 0 || levels > 64 || !index->summary_base ||
+			index->summary_factor < 2) {
+		sr_warn("Ignoring unsupported summary.");
+		levels = 0;
+	}
+	g_key_file_free(kf);
+
+	if (index->logic)
+		stream_load_summary(index->logic, index->archive, levels);
+	for (i = 0; i < index->num_analog; i++)
+		stream_load_summary(&index->analog[i], index->archive, levels);
+}
+
+/**
+ * Open a session file for random access to its sample data.
+ *
+ * The index maps sample numbers to archive members, it is built from
+ * the archive's directory without reading sample data. A reference to
+ * any sample then takes a lookup and at most one member's partial
+ * decompression.
+ *
+ * @param[in] filename The name of the session file.
+ * @param[in] persist Whether to store the index within the archive
+ *                    when it doesn't have a valid one yet. This
+ *                    rewrites the file, libzip copies all members.
+ * @param[out] index The session file's index.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_DATA Malformed session file.
+ * @retval SR_ERR This is not a session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_index_open(const char *filename, gboolean persist,
+	struct sr_session_index **index)
+{
+	struct sr_session_index *idx;
+	int i, ret;
+
+	if (!filename || !index)
+		return SR_ERR_ARG;
+	*index = NULL;
+
+	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+		return ret;
+
+	idx = g_malloc0(sizeof(*idx));
+	if (!(idx->archive = zip_open(filename, 0, NULL))) {
+		g_free(idx);
+		return SR_ERR;
+	}
+	if ((ret = index_read_metadata(idx)) != SR_OK) {
+		sr_session_index_close(idx);
+		return ret;
+	}
+
+	ret = index_load(idx);
+	if (ret == SR_OK) {
+		sr_dbg("Using the index of '%s'.", filename);
+	} else {
+		if (ret == SR_ERR_DATA)
+			sr_warn("Ignoring invalid index of '%s'.", filename);
+		index_clear_streams(idx);
+		ret = SR_OK;
+		if (idx->logic)
+			ret = stream_build(idx->logic, idx->archive);
+		for (i = 0; ret == SR_OK && i < idx->num_analog; i++)
+			ret = stream_build(&idx->analog[i], idx->archive);
+		if (ret == SR_OK && persist)
+			ret = index_save(idx, filename);
+		if (ret != SR_OK) {
+			sr_session_index_close(idx);
+			return ret;
+		}
+	}
+	index_load_summary(idx);
+
+	*index = idx;
+
+	return SR_OK;
+}
+
+/**
+ * Close a session file which was opened for random access.
+ *
+ * @param[in] index The session file's index.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_index_close(struct sr_session_index *index)
+{
+	int i;
+
+	if (!index)
+		return SR_ERR_ARG;
+
+	if (index->cur_file)
+		zip_fclose(index->cur_file);
+	if (index->archive)
+		zip_discard(index->archive);
+	if (index->logic) {
+		stream_clear(index->logic);
+		g_free(index->logic);
+	}
+	for (i = 0; i < index->num_analog; i++)
+		stream_clear(&index->analog[i]);
+	g_free(index->analog);
+	g_free(index->skip_buf);
+	g_free(index);
+
+	return SR_OK;
+}
+
+/* Get the stream which holds a channel's samples. */
+static struct index_stream *index_stream_get(struct sr_session_index *index,
+	int channel)
+{
+	if (channel < 0)
+		return NULL;
+	if (channel < index->num_logic)
+		return index->logic;
+	if (channel < index->num_logic + index->num_analog)
+		return &index->analog[channel - index->num_logic];
+
+	return NULL;
+}
+
+/**
+ * Get a channel's number of samples in a session file.
+ *
+ * @param[in] index The session file's index.
+ * @param[in] channel The channel's index, as created by sr_session_load().
+ *                    All logic channels share the same samples.
+ * @param[out] samples The number of samples.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no such channel.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_index_get_samples(struct sr_session_index *index,
+	int channel, uint64_t *samples)
+{
+	struct index_stream *stream;
+
+	if (!index || !samples)
+		return SR_ERR_ARG;
+	if (!(stream = index_stream_get(index, channel)))
+		return SR_ERR_ARG;
+
+	*samples = stream->samples;
+
+	return SR_OK;
+}
+
+/**
+ * Get the size of logic samples in a session file.
+ *
+ * @param[in] index The session file's index.
+ * @param[out] unitsize The number of bytes per logic sample.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file has no logic data.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_index_get_unitsize(struct sr_session_index *index,
+	int *unitsize)
+{
+	if (!index || !unitsize)
+		return SR_ERR_ARG;
+	if (!index->logic)
+		return SR_ERR_NA;
+
+	*unitsize = index->unitsize;
+
+	return SR_OK;
+}
+
+/* Read from a member, continue or skip ahead in the current one. */
+static int index_read_member(struct sr_session_index *index,
+	zip_uint64_t member, uint64_t offset, uint8_t *buf, uint64_t len)
+{
+	zip_int64_t ret;
+
+	if (index->cur_file && (index->cur_member != member ||
+			index->cur_offset > offset)) {
+		zip_fclose(index->cur_file);
+		index->cur_file = NULL;
+	}
+	if (!index->cur_file) {
+		index->cur_file = zip_fopen_index(index->archive, member, 0);
+		if (!index->cur_file) {
+			sr_err("Failed to open member: %s",
+				zip_strerror(index->archive));
+			return SR_ERR_IO;
+		}
+		index->cur_member = member;
+		index->cur_offset = 0;
+#if HAVE_ZIP_FSEEK
+		/* Stored members can seek, compressed ones decompress. */
+		if (offset && zip_fseek(index->cur_file, offset, SEEK_SET) == 0)
+			index->cur_offset = offset;
+#endif
+	}
+
+	if (index->cur_offset < offset && !index->skip_buf)
+		index->skip_buf = g_malloc(SKIP_SIZE);
+	ret = 1;
+	while (ret > 0 && index->cur_offset < offset) {
+		ret = zip_fread(index->cur_file, index->skip_buf,
+			MIN(SKIP_SIZE, offset - index->cur_offset));
+		if (ret > 0)
+			index->cur_offset += ret;
+	}
+	while (ret > 0 && len) {
+		ret = zip_fread(index->cur_file, buf, len);
+		if (ret > 0) {
+			index->cur_offset += ret;
+			buf += ret;
+			len -= ret;
+		}
+	}
+	if (len) {
+		sr_err("Failed to read member: %s",
+			zip_file_strerror(index->cur_file));
+		zip_fclose(index->cur_file);
+		index->cur_file = NULL;
+		return SR_ERR_IO;
+	}
+
+	return SR_OK;
+}
+
+static int index_read(struct sr_session_index *index,
+	struct index_stream *stream, uint64_t start, uint64_t count,
+	uint8_t *buf, uint64_t *samples_read)
+{
+	const struct index_chunk *chunks, *chunk;
+	guint lo, hi, mid;
+	uint64_t skip, num;
+	int ret;
+
+	if (start > stream->samples)
+		return SR_ERR_ARG;
+	count = MIN(count, stream->samples - start);
+	*samples_read = 0;
+	if (!count)
+		return SR_OK;
+
+	/* Find the chunk which holds the first sample. */
+	chunks = (const struct index_chunk *)stream->chunks->data;
+	lo = 0;
+	hi = stream->chunks->len - 1;
+	while (lo < hi) {
+		mid = lo + (hi - lo + 1) / 2;
+		if (chunks[mid].first <= start)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	for (chunk = &chunks[lo]; count; chunk++) {
+		skip = start - chunk->first;
+		num = MIN(count, chunk->samples - skip);
+		if (num) {
+			ret = index_read_member(index, chunk->member,
+				skip * stream->sample_size, buf,
+				num * stream->sample_size);
+			if (ret != SR_OK)
+				return ret;
+		}
+		buf += num * stream->sample_size;
+		start += num;
+		count -= num;
+		*samples_read += num;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Read a range of logic samples from a session file.
+ *
+ * Consecutive reads continue where the previous read stopped, without
+ * decompressing the start of the member again.
+ *
+ * @param[in] index The session file's index.
+ * @param[in] start The number of the first sample to read.
+ * @param[in] count The number of samples to read.
+ * @param[out] buf Receives the samples, must hold @a count times
+ *                 the unit size bytes.
+ * @param[out] samples_read The number of samples which were read, less
+ *                          than @a count at the end of the data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or start beyond the end.
+ * @retval SR_ERR_NA The file has no logic data.
+ * @retval SR_ERR_IO Failed to read the file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_index_read_logic(struct sr_session_index *index,
+	uint64_t start, uint64_t count, uint8_t *buf, uint64_t *samples_read)
+{
+	if (!index || !buf || !samples_read)
+		return SR_ERR_ARG;
+	if (!index->logic)
+		return SR_ERR_NA;
+
+	return index_read(index, index->logic, start, count, buf,
+		samples_read);
+}
+
+/**
+ * Read a range of an analog channel's samples from a session file.
+ *
+ * @param[in] index The session file's index.
+ * @param[in] channel The channel's index, as created by sr_session_load().
+ * @param[in] start The number of the first sample to read.
+ * @param[in] count The number of samples to read.
+ * @param[out] buf Receives the samples, must hold @a count values.
+ * @param[out] samples_read The number of samples which were read, less
+ *                          than @a count at the end of the data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, no such analog channel, or
+ *                    start beyond the end.
+ * @retval SR_ERR_IO Failed to read the file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_index_read_analog(struct sr_session_index *index,
+	int channel, uint64_t start, uint64_t count, float *buf,
+	uint64_t *samples_read)
+{
+	if (!index || !buf || !samples_read)
+		return SR_ERR_ARG;
+	if (channel < index->num_logic ||
+			channel >= index->num_logic + index->num_analog)
+		return SR_ERR_ARG;
+
+	return index_read(index, &index->analog[channel - index->num_logic],
+		start, count, (uint8_t *)buf, samples_read);
+}
+
+/**
+ * Get the number of summary levels in a session file.
+ *
+ * Summaries are stored by the srzip output module when its "summary"
+ * option is set. Each level has a record per range of samples, the
+ * ranges grow by a constant factor per level.
+ *
+ * @param[in] index The session file's index.
+ * @param[out] levels The number of levels.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file has no summary.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_index_get_summary_levels(struct sr_session_index *index,
+	int *levels)
+{
+	struct index_stream *stream;
+	guint max;
+	int i;
+
+	if (!index || !levels)
+		return SR_ERR_ARG;
+
+	max = 0;
+	for (i = 0; i < index->num_logic + index->num_analog; i++) {
+		stream = index_stream_get(index, i);
+		if (stream)
+			max = MAX(max, stream->summary->len);
+	}
+	if (!max)
+		return SR_ERR_NA;
+
+	*levels = max;
+
+	return SR_OK;
+}
+
+/**
+ * Get the layout of a channel's summary level.
+ *
+ * @param[in] index The session file's index.
+ * @param[in] channel The channel's index, as created by sr_session_load().
+ * @param[in] level The summary level, 0 is the finest.
+ * @param[out] record_samples The number of samples per record. The last
+ *                            record can cover less.
+ * @param[out] records The number of records.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no such channel.
+ * @retval SR_ERR_NA The channel has no such summary level.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_index_get_summary(struct sr_session_index *index,
+	int channel, int level, uint64_t *record_samples, uint64_t *records)
+{
+	struct index_stream *stream;
+	uint64_t samples;
+	int i;
+
+	if (!index || !record_samples || !records)
+		return SR_ERR_ARG;
+	if (!(stream = index_stream_get(index, channel)))
+		return SR_ERR_ARG;
+	if (level < 0 || (guint)level >= stream->summary->len)
+		return SR_ERR_NA;
+
+	samples = index->summary_base;
+	for (i = 0; i < level; i++)
+		samples *= index->summary_factor;
+	*record_samples = samples;
+	*records = g_array_index(stream->summary, struct summary_level,
+		level).records;
+
+	return SR_OK;
+}
+
+/* Read a range of a summary level's raw records. */
+static uint8_t *index_read_summary(struct sr_session_index *index,
+	struct index_stream *stream, int level, uint64_t start,
+	uint64_t *count, int *ret)
+{
+	const struct summary_level *sl;
+	uint8_t *buf;
+
+	if (level < 0 || (guint)level >= stream->summary->len) {
+		*ret = SR_ERR_NA;
+		return NULL;
+	}
+	sl = &g_array_index(stream->summary, struct summary_level, level);
+	if (start > sl->records) {
+		*ret = SR_ERR_ARG;
+		return NULL;
+	}
+	*count = MIN(*count, sl->records - start);
+	buf = g_malloc(*count * stream->record_size + 1);
+	*ret = SR_OK;
+	if (*count) {
+		*ret = index_read_member(index, sl->member,
+			start * stream->record_size, buf,
+			*count * stream->record_size);
+	}
+	if (*ret != SR_OK) {
+		g_free(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+
+/* Get the number of samples which a summary record covers. */
+static uint64_t summary_record_samples(struct sr_session_index *index,
+	struct index_stream *stream, int level, uint64_t record)
+{
+	uint64_t samples, first;
+	int i;
+
+	samples = index->summary_base;
+	for (i = 0; i < level; i++)
+		samples *= index->summary_factor;
+	first = record * samples;
+	if (first >= stream->samples)
+		return 0;
+
+	return MIN(samples, stream->samples - first);
+}
+
+/**
+ * Read a range of a logic channel's summary records.
+ *
+ * A viewer can render a zoomed out range from these records, without
+ * reading the samples which they cover.
+ *
+ * @param[in] index The session file's index.
+ * @param[in] channel The logic channel's index.
+ * @param[in] level The summary level, 0 is the finest.
+ * @param[in] start The number of the first record to read.
+ * @param[in] count The number of records to read.
+ * @param[out] summary Receives the records, must hold @a count items.
+ * @param[out] records_read The number of records which were read.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, no such logic channel, or
+ *                    start beyond the end.
+ * @retval SR_ERR_NA The channel has no such summary level.
+ * @retval SR_ERR_IO Failed to read the file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_index_read_logic_summary(struct sr_session_index *index,
+	int channel, int level, uint64_t start, uint64_t count,
+	struct sr_summary_logic *summary, uint64_t *records_read)
+{
+	const uint8_t *record;
+	uint8_t *buf, mask;
+	size_t u, byte;
+	uint64_t i;
+	int ret;
+
+	if (!index || !summary || !records_read)
+		return SR_ERR_ARG;
+	if (!index->logic || channel < 0 || channel >= index->num_logic ||
+			channel >= 8 * index->unitsize)
+		return SR_ERR_ARG;
+
+	buf = index_read_summary(index, index->logic, level, start,
+		&count, &ret);
+	if (!buf)
+		return ret;
+
+	u = index->unitsize;
+	byte = channel / 8;
+	mask = 1 << (channel % 8);
+	for (i = 0; i < count; i++) {
+		record = &buf[i * index->logic->record_size];
+		summary[i].samples = summary_record_samples(index,
+			index->logic, level, start + i);
+		summary[i].first = (record[byte] & mask) != 0;
+		summary[i].last = (record[u + byte] & mask) != 0;
+		summary[i].any_high = (record[2 * u + byte] & mask) != 0;
+		summary[i].all_high = (record[3 * u + byte] & mask) != 0;
+		summary[i].transitions = read_u32le(&record[4 * u + 4 * channel]);
+	}
+	g_free(buf);
+	*records_read = count;
+
+	return SR_OK;
+}
+
+/**
+ * Read a range of an analog channel's summary records.
+ *
+ * @param[in] index The session file's index.
+ * @param[in] channel The analog channel's index.
+ * @param[in] level The summary level, 0 is the finest.
+ * @param[in] start The number of the first record to read.
+ * @param[in] count The number of records to read.
+ * @param[out] summary Receives the records, must hold @a count items.
+ * @param[out] records_read The number of records which were read.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, no such analog channel, or
+ *                    start beyond the end.
+ * @retval SR_ERR_NA The channel has no such summary level.
+ * @retval SR_ERR_IO Failed to read the file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_index_read_analog_summary(struct sr_session_index *index,
+	int channel, int level, uint64_t start, uint64_t count,
+	struct sr_summary_analog *summary, uint64_t *records_read)
+{
+	struct index_stream *stream;
+	const uint8_t *record;
+	uint8_t *buf;
+	uint64_t i;
+	int ret;
+
+	if (!index || !summary || !records_read)
+		return SR_ERR_ARG;
+	if (channel < index->num_logic ||
+			channel >= index->num_logic + index->num_analog)
+		return SR_ERR_ARG;
+	stream = &index->analog[channel - index->num_logic];
+
+	buf = index_read_summary(index, stream, level, start, &count, &ret);
+	if (!buf)
+		return ret;
+
+	for (i = 0; i < count; i++) {
+		record = &buf[i * SUMMARY_ANALOG_SIZE];
+		summary[i].samples = summary_record_samples(index, stream,
+			level, start + i);
+		summary[i].min = read_fltle(&record[0]);
+		summary[i].max = read_fltle(&record[4]);
+		summary[i].mean = read_fltle(&record[8]);
+	}
+	g_free(buf);
+	*records_read = count;
+
+	return SR_OK;
+}
+
+/** @} */
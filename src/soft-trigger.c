@@ -18,6 +18,7 @@
  */
 
 #include <config.h>
+#include <math.h>
 #include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -41,6 +42,184 @@ SR_PRIV int logic_channel_unitsize(GSList *channels)
 	return (number + 7) / 8;
 }
 
+/*
+ * Pre-trigger data is kept in a circular buffer of whole samples, which
+ * only ever receives the most recent data: appending never moves data
+ * that is already buffered. When the trigger fires, the buffered data
+ * is sent as at most two packets (the oldest data up to the end of the
+ * buffer, and the wrap around), followed by the data which preceded the
+ * trigger in the caller's buffer, straight from there.
+ */
+typedef void (*pre_trigger_send_cb)(const uint8_t *data, size_t len,
+		void *cb_data);
+
+static int pre_trigger_init(struct soft_trigger_pre_trigger *pt,
+		size_t unitsize, int samples)
+{
+	memset(pt, 0, sizeof(*pt));
+	pt->unitsize = unitsize;
+	if (samples <= 0 || !unitsize)
+		return SR_OK;
+	pt->size = unitsize * samples;
+	pt->buffer = g_try_malloc(pt->size);
+	if (!pt->buffer)
+		return SR_ERR_MALLOC;
+
+	return SR_OK;
+}
+
+static void pre_trigger_clear(struct soft_trigger_pre_trigger *pt)
+{
+	g_free(pt->buffer);
+	memset(pt, 0, sizeof(*pt));
+}
+
+static void pre_trigger_append(struct soft_trigger_pre_trigger *pt,
+		const uint8_t *data, size_t len)
+{
+	size_t size;
+
+	if (!pt->size)
+		return;
+
+	/* Avoid uselessly copying more than the pre-trigger size. */
+	if (len > pt->size) {
+		data += len - pt->size;
+		len = pt->size;
+	}
+
+	/* Update the filling level of the pre-trigger circular buffer. */
+	pt->fill = MIN(pt->fill + len, pt->size);
+
+	/* Actually copy data to the pre-trigger circular buffer. */
+	while (len > 0) {
+		size = MIN(pt->size - pt->head, len);
+		memcpy(pt->buffer + pt->head, data, size);
+		pt->head += size;
+		if (pt->head == pt->size)
+			pt->head = 0;
+		data += size;
+		len -= size;
+	}
+}
+
+/*
+ * Send the pre-trigger data: what is needed from the circular buffer,
+ * then the data from the caller's buffer which immediately preceded the
+ * trigger. Empties the circular buffer. Returns the number of samples
+ * sent.
+ */
+static int pre_trigger_flush(struct soft_trigger_pre_trigger *pt,
+		const uint8_t *prefix, size_t prefix_len,
+		pre_trigger_send_cb send, void *cb_data)
+{
+	size_t keep, tail, size, total;
+
+	if (!pt->size)
+		return 0;
+
+	/* The most recent data supersedes the oldest buffered data. */
+	if (prefix_len > pt->size) {
+		prefix += prefix_len - pt->size;
+		prefix_len = pt->size;
+	}
+	keep = MIN(pt->fill, pt->size - prefix_len);
+	total = keep + prefix_len;
+
+	tail = (pt->head + pt->size - keep) % pt->size;
+	while (keep > 0) {
+		size = MIN(pt->size - tail, keep);
+		send(pt->buffer + tail, size, cb_data);
+		tail = 0;
+		keep -= size;
+	}
+	if (prefix_len > 0)
+		send(prefix, prefix_len, cb_data);
+
+	pt->head = pt->fill = 0;
+
+	return total / pt->unitsize;
+}
+
+static void stage_masks_free(struct soft_trigger_logic *stl)
+{
+	int i;
+
+	for (i = 0; i < stl->num_stages; i++)
+		g_free(stl->stages[i].ones);
+	g_free(stl->stages);
+	stl->stages = NULL;
+	stl->num_stages = 0;
+}
+
+/*
+ * Translate the trigger's stages into per-bit condition masks. Checking
+ * a sample against a stage then takes a few logic operations per 64
+ * channels, instead of a walk over the stage's list of matches.
+ */
+static int stage_masks_compile(struct soft_trigger_logic *stl)
+{
+	struct soft_trigger_logic_stage *cs;
+	struct sr_trigger_stage *stage;
+	struct sr_trigger_match *match;
+	struct sr_channel *ch;
+	GSList *l, *m;
+	uint64_t *mask;
+	int words;
+
+	words = stl->num_words;
+	stl->num_stages = g_slist_length(stl->trigger->stages);
+	stl->stages = g_malloc0(stl->num_stages * sizeof(*stl->stages));
+	for (l = stl->trigger->stages, cs = stl->stages; l; l = l->next, cs++) {
+		stage = l->data;
+		cs->ones = g_malloc0(5 * words * sizeof(uint64_t));
+		cs->zeros = cs->ones + words;
+		cs->rising = cs->zeros + words;
+		cs->falling = cs->rising + words;
+		cs->edge = cs->falling + words;
+		cs->has_matches = stage->matches != NULL;
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			ch = match->channel;
+			if (!ch->enabled)
+				/* Ignore disabled channels with a trigger. */
+				continue;
+			if (ch->type != SR_CHANNEL_LOGIC
+					|| ch->index >= stl->unitsize * 8) {
+				sr_err("Cannot soft trigger on channel %s.",
+					ch->name);
+				return SR_ERR_ARG;
+			}
+			switch (match->match) {
+			case SR_TRIGGER_ZERO:
+				mask = cs->zeros;
+				break;
+			case SR_TRIGGER_ONE:
+				mask = cs->ones;
+				break;
+			case SR_TRIGGER_RISING:
+				mask = cs->rising;
+				break;
+			case SR_TRIGGER_FALLING:
+				mask = cs->falling;
+				break;
+			case SR_TRIGGER_EDGE:
+				mask = cs->edge;
+				break;
+			default:
+				/* Analog conditions never match logic data. */
+				cs->never = TRUE;
+				continue;
+			}
+			mask[ch->index / 64] |= UINT64_C(1) << (ch->index % 64);
+			if (mask != cs->ones && mask != cs->zeros)
+				cs->has_edges = TRUE;
+		}
+	}
+
+	return SR_OK;
+}
+
 SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples)
@@ -51,21 +230,11 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 	stl->sdi = sdi;
 	stl->trigger = trigger;
 	stl->unitsize = logic_channel_unitsize(sdi->channels);
+	stl->num_words = (stl->unitsize + 7) / 8;
 	stl->prev_sample = g_malloc0(stl->unitsize);
-	stl->pre_trigger_size = stl->unitsize * pre_trigger_samples;
-	stl->pre_trigger_buffer = g_try_malloc(stl->pre_trigger_size);
-	if (pre_trigger_samples > 0 && !stl->pre_trigger_buffer) {
-		/*
-		 * Error out if g_try_malloc() failed (or was invoked as
-		 * g_try_malloc(0)) *and* more than 0 pretrigger samples
-		 * were requested.
-		 */
-		soft_trigger_logic_free(stl);
-		return NULL;
-	}
-	stl->pre_trigger_head = stl->pre_trigger_buffer;
-
-	if (stl->pre_trigger_size > 0 && !stl->pre_trigger_buffer) {
+	if (stage_masks_compile(stl) != SR_OK ||
+			pre_trigger_init(&stl->pre_trigger, stl->unitsize,
+			pre_trigger_samples) != SR_OK) {
 		soft_trigger_logic_free(stl);
 		return NULL;
 	}
@@ -75,99 +244,163 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *stl)
 {
-	g_free(stl->pre_trigger_buffer);
+	stage_masks_free(stl);
+	pre_trigger_clear(&stl->pre_trigger);
 	g_free(stl->prev_sample);
 	g_free(stl);
 }
 
-static void pre_trigger_append(struct soft_trigger_logic *stl,
-		uint8_t *buf, int len)
-{
-	/* Avoid uselessly copying more than the pre-trigger size. */
-	if (len > stl->pre_trigger_size) {
-		buf += len - stl->pre_trigger_size;
-		len = stl->pre_trigger_size;
-	}
-
-	/* Update the filling level of the pre-trigger circular buffer. */
-	stl->pre_trigger_fill = MIN(stl->pre_trigger_fill + len,
-	                            stl->pre_trigger_size);
-
-	/* Actually copy data to the pre-trigger circular buffer. */
-	while (len > 0) {
-		size_t size = MIN(stl->pre_trigger_buffer + stl->pre_trigger_size
-		                  - stl->pre_trigger_head, len);
-		memcpy(stl->pre_trigger_head, buf, size);
-		stl->pre_trigger_head += size;
-		if (stl->pre_trigger_head >= stl->pre_trigger_buffer
-		                             + stl->pre_trigger_size)
-			stl->pre_trigger_head = stl->pre_trigger_buffer;
-		buf += size;
-		len -= size;
-	}
-}
-
-static void pre_trigger_send(struct soft_trigger_logic *stl,
-		int *pre_trigger_samples)
+static void logic_pre_trigger_send(const uint8_t *data, size_t len,
+		void *cb_data)
 {
+	struct soft_trigger_logic *stl;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
 
+	stl = cb_data;
 	packet.type = SR_DF_LOGIC;
 	packet.payload = &logic;
 	logic.unitsize = stl->unitsize;
+	logic.length = len;
+	logic.data = (void *)data;
+	sr_session_send(stl->sdi, &packet);
+}
 
-	if (pre_trigger_samples)
-		*pre_trigger_samples = 0;
+/* Get 64 channels' worth of a sample, least significant byte first. */
+static inline uint64_t sample_word(const uint8_t *sample, int unitsize,
+		int word)
+{
+	const uint8_t *p;
+	uint64_t value;
+	int count, i;
 
-	/* If pre-trigger buffer not full, rewind head to the first valid sample. */
-	if (stl->pre_trigger_fill < stl->pre_trigger_size)
-		stl->pre_trigger_head = stl->pre_trigger_buffer;
-
-	/* Send logic packets for the pre-trigger circular buffer content. */
-	while (stl->pre_trigger_fill > 0) {
-		size_t size = MIN(stl->pre_trigger_buffer + stl->pre_trigger_size
-		                  - stl->pre_trigger_head, stl->pre_trigger_fill);
-		logic.length = size;
-		logic.data = stl->pre_trigger_head;
-		sr_session_send(stl->sdi, &packet);
-		stl->pre_trigger_head = stl->pre_trigger_buffer;
-		stl->pre_trigger_fill -= size;
-		if (pre_trigger_samples)
-			*pre_trigger_samples += size / stl->unitsize;
+	p = sample + word * sizeof(uint64_t);
+	count = MIN(unitsize - word * (int)sizeof(uint64_t), 8);
+	switch (count) {
+	case 8:
+		return read_u64le(p);
+	case 4:
+		return read_u32le(p);
+	case 2:
+		return read_u16le(p);
+	case 1:
+		return read_u8(p);
 	}
+	value = 0;
+	for (i = 0; i < count; i++)
+		value |= (uint64_t)p[i] << (8 * i);
+
+	return value;
+}
+
+/*
+ * Returns the set of bits which violate the stage's conditions, given
+ * the current and the previous sample. Zero means the stage matched.
+ */
+static inline uint64_t stage_miss(uint64_t ones, uint64_t zeros,
+		uint64_t rising, uint64_t falling, uint64_t edge,
+		uint64_t sample, uint64_t prev)
+{
+	return (ones & ~sample) | (zeros & sample)
+		| (rising & (prev | ~sample))
+		| (falling & (~prev | sample))
+		| (edge & ~(prev ^ sample));
 }
 
-static gboolean logic_check_match(struct soft_trigger_logic *stl,
-		uint8_t *sample, struct sr_trigger_match *match)
+static gboolean stage_match(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_logic_stage *cs,
+		const uint8_t *sample, const uint8_t *prev)
 {
-	int bit, prev_bit;
-	gboolean result;
+	uint64_t s, p;
+	int w;
 
-	stl->count++;
-	result = FALSE;
-	bit = *(sample + match->channel->index / 8)
-			& (1 << (match->channel->index % 8));
-	if (match->match == SR_TRIGGER_ZERO)
-		result = bit == 0;
-	else if (match->match == SR_TRIGGER_ONE)
-		result = bit != 0;
-	else {
-		/* Edge matches. */
-		if (stl->count == 1)
-			/* First sample, don't have enough for an edge match yet. */
+	if (cs->never)
+		return FALSE;
+	if (cs->has_edges && !prev)
+		/* First sample, don't have enough for an edge match yet. */
+		return FALSE;
+
+	for (w = 0; w < stl->num_words; w++) {
+		s = sample_word(sample, stl->unitsize, w);
+		p = prev ? sample_word(prev, stl->unitsize, w) : 0;
+		if (stage_miss(cs->ones[w], cs->zeros[w], cs->rising[w],
+				cs->falling[w], cs->edge[w], s, p))
 			return FALSE;
-		prev_bit = *(stl->prev_sample + match->channel->index / 8)
-				& (1 << (match->channel->index % 8));
-		if (match->match == SR_TRIGGER_RISING)
-			result = prev_bit == 0 && bit != 0;
-		else if (match->match == SR_TRIGGER_FALLING)
-			result = prev_bit != 0 && bit == 0;
-		else if (match->match == SR_TRIGGER_EDGE)
-			result = prev_bit != bit;
 	}
 
-	return result;
+	return TRUE;
+}
+
+/*
+ * Find the first sample in the range [first, count) of buf which matches
+ * the stage, or return count if there is none. The sample before the
+ * first one must be available.
+ *
+ * This checks all the samples which fit in a 64-bit word at once: each
+ * sample occupies a lane of the word, the stage masks are replicated to
+ * every lane, and the previous sample of each lane is obtained by
+ * shifting the word up by one lane. Only usable when the unit size is a
+ * power of two no larger than 8.
+ */
+static int stage_scan(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_logic_stage *cs,
+		const uint8_t *buf, int first, int count)
+{
+	uint64_t low, high, ones, zeros, rising, falling, edge;
+	uint64_t s, p, prev, miss, hit;
+	int unitsize, lane_bits, lanes, lane, i;
+
+	if (cs->never)
+		return count;
+
+	unitsize = stl->unitsize;
+	lane_bits = unitsize * 8;
+	lanes = 64 / lane_bits;
+	if (lane_bits == 64)
+		low = 1;
+	else
+		low = UINT64_MAX / ((UINT64_C(1) << lane_bits) - 1);
+	high = low << (lane_bits - 1);
+	ones = cs->ones[0] * low;
+	zeros = cs->zeros[0] * low;
+	rising = cs->rising[0] * low;
+	falling = cs->falling[0] * low;
+	edge = cs->edge[0] * low;
+
+	if (first > 0)
+		prev = sample_word(buf + (first - 1) * unitsize, unitsize, 0);
+	else
+		prev = sample_word(stl->prev_sample, unitsize, 0);
+
+	for (i = first; i + lanes <= count; i += lanes) {
+		s = read_u64le(buf + i * unitsize);
+		p = (lane_bits == 64) ? prev : (s << lane_bits) | prev;
+		miss = stage_miss(ones, zeros, rising, falling, edge, s, p);
+		/*
+		 * Flag the lanes where miss is zero. Borrows can only cause
+		 * false flags above a lane which really is zero, so the
+		 * lowest flagged lane is exact.
+		 */
+		hit = (miss - low) & ~miss & high;
+		if (hit) {
+			hit >>= lane_bits - 1;
+			for (lane = 0; !(hit & 1); lane++)
+				hit >>= lane_bits;
+			return i + lane;
+		}
+		prev = (lane_bits == 64) ? s : s >> (64 - lane_bits);
+	}
+
+	/* Check the remaining samples one at a time. */
+	for (; i < count; i++) {
+		s = sample_word(buf + i * unitsize, unitsize, 0);
+		if (!stage_miss(cs->ones[0], cs->zeros[0], cs->rising[0],
+				cs->falling[0], cs->edge[0], s, prev))
+			return i;
+		prev = s;
+	}
+
+	return count;
 }
 
 /* Returns the offset (in samples) within buf of where the trigger
@@ -175,69 +408,577 @@ static gboolean logic_check_match(struct soft_trigger_logic *stl,
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 		uint8_t *buf, int len, int *pre_trigger_samples)
 {
-	struct sr_trigger_stage *stage;
-	struct sr_trigger_match *match;
-	GSList *l, *l_stage;
-	int offset;
-	int i;
-	gboolean match_found;
+	struct soft_trigger_logic_stage *cs;
+	const uint8_t *prev;
+	int unitsize, count, offset, last, ret, i;
+	gboolean scan;
+
+	if (!stl->num_stages)
+		return SR_ERR_ARG;
 
+	unitsize = stl->unitsize;
+	count = len / unitsize;
+	scan = stl->num_words == 1 && !(unitsize & (unitsize - 1));
 	offset = -1;
-	for (i = 0; i < len; i += stl->unitsize) {
-		l_stage = g_slist_nth(stl->trigger->stages, stl->cur_stage);
-		stage = l_stage->data;
-		if (!stage->matches)
+	for (i = 0; i < count; i++) {
+		cs = &stl->stages[stl->cur_stage];
+		if (!cs->has_matches)
 			/* No matches supplied, client error. */
 			return SR_ERR_ARG;
 
-		match_found = TRUE;
-		for (l = stage->matches; l; l = l->next) {
-			match = l->data;
-			if (!match->channel->enabled)
-				/* Ignore disabled channels with a trigger. */
-				continue;
-			if (!logic_check_match(stl, buf + i, match)) {
-				match_found = FALSE;
+		if (i > 0)
+			prev = buf + (i - 1) * unitsize;
+		else
+			prev = stl->have_prev ? stl->prev_sample : NULL;
+
+		if (stl->cur_stage == 0 && scan && prev) {
+			/* Skip ahead to the next candidate for the first stage. */
+			i = stage_scan(stl, cs, buf, i, count);
+			if (i == count)
 				break;
+		} else if (!stage_match(stl, cs, buf + i * unitsize, prev)) {
+			if (stl->cur_stage > 0) {
+				/*
+				 * We had a match at an earlier stage, but failed
+				 * on the current stage. However, we may have a
+				 * match on this stage in the next bit -- trigger
+				 * on 0001 will fail on seeing 00001, so we need
+				 * to go back to stage 0 -- but at the next sample
+				 * from the one that matched originally, which the
+				 * counter increment at the end of the loop takes
+				 * care of.
+				 */
+				i -= stl->cur_stage;
+				if (i < -1)
+					i = -1; /* Oops, went back past this buffer. */
+				/* Reset trigger stage. */
+				stl->cur_stage = 0;
 			}
+			continue;
+		}
+
+		/* Matched on the current stage. */
+		if (stl->cur_stage + 1 < stl->num_stages) {
+			/* Advance to next stage. */
+			stl->cur_stage++;
+			continue;
 		}
-		memcpy(stl->prev_sample, buf + i, stl->unitsize);
-		if (match_found) {
-			/* Matched on the current stage. */
-			if (l_stage->next) {
-				/* Advance to next stage. */
-				stl->cur_stage++;
-			} else {
-				/* Matched on last stage, send pre-trigger data. */
-				pre_trigger_append(stl, buf, i);
-				pre_trigger_send(stl, pre_trigger_samples);
-
-				/* Fire trigger. */
-				offset = i / stl->unitsize;
-
-				std_session_send_df_trigger(stl->sdi);
+
+		/* Matched on last stage, send pre-trigger data. */
+		ret = pre_trigger_flush(&stl->pre_trigger, buf, i * unitsize,
+				logic_pre_trigger_send, stl);
+		if (pre_trigger_samples)
+			*pre_trigger_samples = ret;
+
+		/* Fire trigger. */
+		offset = i;
+
+		std_session_send_df_trigger(stl->sdi);
+		break;
+	}
+
+	/* Keep the last inspected sample for edge matches. */
+	last = (offset >= 0) ? offset : count - 1;
+	if (last >= 0) {
+		memcpy(stl->prev_sample, buf + last * unitsize, unitsize);
+		stl->have_prev = TRUE;
+	}
+
+	if (offset == -1)
+		pre_trigger_append(&stl->pre_trigger, buf, count * unitsize);
+
+	return offset;
+}
+
+/*
+ * Analog soft triggers.
+ *
+ * The conditions of a stage are evaluated on the raw sample data of the
+ * analog packets a driver is about to send, before any conversion to
+ * float. The trigger levels are translated to the raw domain of every
+ * packet instead, and a branch free loop computes a set of comparison
+ * flags for all samples in one go. Edge conditions then merely walk the
+ * flags, skipping over runs of samples which can't change their state.
+ *
+ * OVER and UNDER match while the value is above or below the level.
+ * RISING, FALLING and EDGE match when the value crosses the level, after
+ * it had been on the other side of the level by more than the channel's
+ * hysteresis. OVER and UNDER on the same channel in the same stage form a
+ * window: the stage matches inside the window when the OVER level is the
+ * lower one, and outside of it when the OVER level is the higher one.
+ *
+ * Unlike logic stages which must match on consecutive samples, analog
+ * stages must match in sequence, each at some sample after the previous
+ * stage matched.
+ */
+
+/* Comparison flags of a sample against the levels of a condition. */
+#define FLAG_ABOVE	(1 << 0)
+#define FLAG_BELOW	(1 << 1)
+#define FLAG_HIGH	(1 << 2)
+#define FLAG_LOW	(1 << 3)
+
+SR_PRIV struct soft_trigger_analog *soft_trigger_analog_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples)
+{
+	struct soft_trigger_analog *sta;
+	struct soft_trigger_analog_stage *cs;
+	struct soft_trigger_analog_cond *cond, *under;
+	struct sr_trigger_stage *stage;
+	struct sr_trigger_match *match;
+	struct sr_channel *ch;
+	GSList *l, *m;
+	int i, j;
+
+	sta = g_malloc0(sizeof(struct soft_trigger_analog));
+	sta->sdi = sdi;
+	sta->trigger = trigger;
+	sta->pre_trigger_samples = MAX(pre_trigger_samples, 0);
+	sta->num_stages = g_slist_length(trigger->stages);
+	sta->stages = g_malloc0(sta->num_stages * sizeof(*sta->stages));
+	for (l = trigger->stages, cs = sta->stages; l; l = l->next, cs++) {
+		stage = l->data;
+		cs->conds = g_malloc0(g_slist_length(stage->matches)
+				* sizeof(*cs->conds));
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			ch = match->channel;
+			/* Logic channels are handled by the logic trigger. */
+			if (!ch->enabled || ch->type != SR_CHANNEL_ANALOG)
+				continue;
+			cond = &cs->conds[cs->num_conds++];
+			cond->channel = ch;
+			cond->match = match->match;
+			cond->level = cond->high = cond->low = match->value;
+		}
+
+		/* Combine an outside window from OVER and a lower UNDER. */
+		for (i = 0; i < cs->num_conds; i++) {
+			cond = &cs->conds[i];
+			if (cond->match != SR_TRIGGER_OVER || cond->outside)
+				continue;
+			for (j = 0; j < cs->num_conds; j++) {
+				under = &cs->conds[j];
+				if (under->match != SR_TRIGGER_UNDER
+						|| under->channel != cond->channel
+						|| under->level > cond->level)
+					continue;
+				cond->outside = TRUE;
+				cond->low = under->level;
+				memmove(under, under + 1, (cs->num_conds - j - 1)
+						* sizeof(*under));
+				cs->num_conds--;
+				if (j < i)
+					i--;
 				break;
 			}
-		} else if (stl->cur_stage > 0) {
-			/*
-			 * We had a match at an earlier stage, but failed on the
-			 * current stage. However, we may have a match on this
-			 * stage in the next bit -- trigger on 0001 will fail on
-			 * seeing 00001, so we need to go back to stage 0 -- but
-			 * at the next sample from the one that matched originally,
-			 * which the counter increment at the end of the loop
-			 * takes care of.
-			 */
-			i -= stl->cur_stage * stl->unitsize;
-			if (i < -1)
-				i = -1; /* Oops, went back past this buffer. */
-			/* Reset trigger stage. */
-			stl->cur_stage = 0;
 		}
 	}
 
-	if (offset == -1)
-		pre_trigger_append(stl, buf, len);
+	return sta;
+}
+
+SR_PRIV void soft_trigger_analog_free(struct soft_trigger_analog *sta)
+{
+	int i;
+
+	for (i = 0; i < sta->num_stages; i++)
+		g_free(sta->stages[i].conds);
+	g_free(sta->stages);
+	for (i = 0; i < sta->num_pre_trigger; i++)
+		pre_trigger_clear(&sta->pre_trigger[i]);
+	g_free(sta->pre_trigger);
+	g_free(sta->flags);
+	g_free(sta);
+}
+
+/*
+ * Set the amount by which a channel's value must have been on the other
+ * side of the level, for an edge condition to match. In units of the
+ * channel's measured quantity.
+ */
+SR_PRIV void soft_trigger_analog_set_hysteresis(struct soft_trigger_analog *sta,
+		const struct sr_channel *ch, float hysteresis)
+{
+	struct soft_trigger_analog_cond *cond;
+	int i, j;
+
+	hysteresis = fabsf(hysteresis);
+	for (i = 0; i < sta->num_stages; i++) {
+		for (j = 0; j < sta->stages[i].num_conds; j++) {
+			cond = &sta->stages[i].conds[j];
+			if (cond->channel != ch || cond->outside)
+				continue;
+			cond->high = cond->level + hysteresis;
+			cond->low = cond->level - hysteresis;
+		}
+	}
+}
+
+#define ANALOG_FLAGS_LOOP(read, size) \
+	for (i = 0; i < count; i++) { \
+		x = sign * (float)read(data + i * (size)); \
+		flags[i] = (x > level) | (x < level) << 1 \
+			| (x > high) << 2 | (x < low) << 3; \
+	}
+
+/*
+ * Compute the comparison flags of a condition for the samples in the
+ * range [first, count) of an analog packet.
+ */
+static int analog_flags(uint8_t *flags,
+		const struct sr_datafeed_analog *analog,
+		const struct soft_trigger_analog_cond *cond, int first, int count)
+{
+	const struct sr_analog_encoding *enc;
+	const uint8_t *data;
+	double scale, offset;
+	float sign, level, high, low, x;
+	int i;
+
+	/*
+	 * Translate the levels to the raw domain. With negative scale
+	 * factors, the sample values are negated so that the comparisons
+	 * keep their direction.
+	 */
+	enc = analog->encoding;
+	scale = (double)enc->scale.p / enc->scale.q;
+	offset = (double)enc->offset.p / enc->offset.q;
+	if (scale == 0.0)
+		return SR_ERR_ARG;
+	sign = (scale < 0.0) ? -1.0 : 1.0;
+	level = sign * (cond->level - offset) / scale;
+	high = sign * (cond->high - offset) / scale;
+	low = sign * (cond->low - offset) / scale;
+
+	data = (const uint8_t *)analog->data + first * enc->unitsize;
+	flags += first;
+	count -= first;
+
+	if (enc->is_float) {
+		if (enc->unitsize != sizeof(float))
+			return SR_ERR_ARG;
+		if (enc->is_bigendian)
+			ANALOG_FLAGS_LOOP(read_fltbe, sizeof(float))
+		else
+			ANALOG_FLAGS_LOOP(read_fltle, sizeof(float))
+		return SR_OK;
+	}
+
+	switch (enc->unitsize) {
+	case sizeof(uint8_t):
+		if (enc->is_signed)
+			ANALOG_FLAGS_LOOP(read_i8, sizeof(int8_t))
+		else
+			ANALOG_FLAGS_LOOP(read_u8, sizeof(uint8_t))
+		break;
+	case sizeof(uint16_t):
+		if (enc->is_signed && enc->is_bigendian)
+			ANALOG_FLAGS_LOOP(read_i16be, sizeof(int16_t))
+		else if (enc->is_signed)
+			ANALOG_FLAGS_LOOP(read_i16le, sizeof(int16_t))
+		else if (enc->is_bigendian)
+			ANALOG_FLAGS_LOOP(read_u16be, sizeof(uint16_t))
+		else
+			ANALOG_FLAGS_LOOP(read_u16le, sizeof(uint16_t))
+		break;
+	case sizeof(uint32_t):
+		if (enc->is_signed && enc->is_bigendian)
+			ANALOG_FLAGS_LOOP(read_i32be, sizeof(int32_t))
+		else if (enc->is_signed)
+			ANALOG_FLAGS_LOOP(read_i32le, sizeof(int32_t))
+		else if (enc->is_bigendian)
+			ANALOG_FLAGS_LOOP(read_u32be, sizeof(uint32_t))
+		else
+			ANALOG_FLAGS_LOOP(read_u32le, sizeof(uint32_t))
+		break;
+	default:
+		return SR_ERR_ARG;
+	}
+
+	return SR_OK;
+}
+
+/* Flags which can make a difference for the condition in its state. */
+static uint8_t analog_cond_wanted(const struct soft_trigger_analog_cond *cond)
+{
+	uint8_t wanted;
+
+	if (cond->outside)
+		return FLAG_ABOVE | FLAG_LOW;
+
+	wanted = 0;
+	switch (cond->match) {
+	case SR_TRIGGER_OVER:
+		return FLAG_ABOVE;
+	case SR_TRIGGER_UNDER:
+		return FLAG_BELOW;
+	case SR_TRIGGER_EDGE:
+		wanted |= cond->armed_falling ? FLAG_BELOW : FLAG_HIGH;
+		/* Fall through. */
+	case SR_TRIGGER_RISING:
+		wanted |= cond->armed_rising ? FLAG_ABOVE : FLAG_LOW;
+		break;
+	case SR_TRIGGER_FALLING:
+		wanted |= cond->armed_falling ? FLAG_BELOW : FLAG_HIGH;
+		break;
+	}
+
+	return wanted;
+}
+
+/* Update the condition's state with a sample's flags, check for a match. */
+static gboolean analog_cond_step(struct soft_trigger_analog_cond *cond,
+		uint8_t flags)
+{
+	gboolean hit;
+
+	if (cond->outside)
+		return (flags & (FLAG_ABOVE | FLAG_LOW)) != 0;
+
+	hit = FALSE;
+	switch (cond->match) {
+	case SR_TRIGGER_OVER:
+		return (flags & FLAG_ABOVE) != 0;
+	case SR_TRIGGER_UNDER:
+		return (flags & FLAG_BELOW) != 0;
+	case SR_TRIGGER_EDGE:
+	case SR_TRIGGER_RISING:
+		if (cond->armed_rising && (flags & FLAG_ABOVE)) {
+			cond->armed_rising = FALSE;
+			hit = TRUE;
+		} else if (flags & FLAG_LOW) {
+			cond->armed_rising = TRUE;
+		}
+		if (cond->match == SR_TRIGGER_RISING)
+			break;
+		/* Fall through. */
+	case SR_TRIGGER_FALLING:
+		if (cond->armed_falling && (flags & FLAG_BELOW)) {
+			cond->armed_falling = FALSE;
+			hit = TRUE;
+		} else if (flags & FLAG_HIGH) {
+			cond->armed_falling = TRUE;
+		}
+		break;
+	}
+
+	return hit;
+}
+
+/* Find the next sample in [first, count) which has any of the flags set. */
+static int analog_flags_find(const uint8_t *flags, int first, int count,
+		uint8_t mask)
+{
+	uint64_t word, pattern;
+	int i;
+
+	/* Skip over eight samples at a time while there's nothing to do. */
+	pattern = mask * UINT64_C(0x0101010101010101);
+	for (i = first; i + 8 <= count; i += 8) {
+		memcpy(&word, flags + i, sizeof(word));
+		if (word & pattern)
+			break;
+	}
+	for (; i < count; i++) {
+		if (flags[i] & mask)
+			return i;
+	}
+
+	return count;
+}
+
+/* Find the sample in [first, count) on which the stage matches. */
+static int analog_stage_find(struct soft_trigger_analog_stage *cs,
+		const uint8_t *flags, int first, int count)
+{
+	struct soft_trigger_analog_cond *cond;
+	gboolean hit;
+	int i, c;
+
+	if (cs->num_conds == 1) {
+		cond = &cs->conds[0];
+		i = first;
+		while (i < count) {
+			i = analog_flags_find(flags, i, count,
+					analog_cond_wanted(cond));
+			if (i < count && analog_cond_step(cond, flags[i]))
+				return i;
+			i++;
+		}
+		return count;
+	}
+
+	for (i = first; i < count; i++) {
+		/* Step all conditions, to keep their edge states current. */
+		hit = TRUE;
+		for (c = 0; c < cs->num_conds; c++) {
+			if (!analog_cond_step(&cs->conds[c], flags[c * count + i]))
+				hit = FALSE;
+		}
+		if (hit)
+			return i;
+	}
+
+	return count;
+}
+
+struct analog_pre_trigger_packet {
+	const struct sr_dev_inst *sdi;
+	const struct sr_datafeed_analog *tmpl;
+};
+
+/* Send pre-trigger data using the encoding and meaning of a packet. */
+static void analog_pre_trigger_send(const uint8_t *data, size_t len,
+		void *cb_data)
+{
+	struct analog_pre_trigger_packet *pp;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+
+	pp = cb_data;
+	analog = *pp->tmpl;
+	analog.data = (void *)data;
+	analog.num_samples = len / analog.encoding->unitsize;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(pp->sdi, &packet);
+}
+
+/*
+ * Check a block of analog packets for the trigger. Every packet holds the
+ * raw data of a single channel, and all packets have the same number of
+ * samples. The packets must be the same, in the same order, across calls.
+ *
+ * Returns the offset (in samples) within the packets of where the trigger
+ * occurred, or -1 if not triggered. The data up to the trigger is kept or
+ * sent as pre-trigger data, the caller sends the data from the offset on.
+ */
+SR_PRIV int soft_trigger_analog_check(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog **analog, int num_analog,
+		int *pre_trigger_samples)
+{
+	struct soft_trigger_analog_stage *cs;
+	struct soft_trigger_analog_cond *cond;
+	struct soft_trigger_pre_trigger *pt;
+	struct analog_pre_trigger_packet pp;
+	size_t size, unitsize;
+	int count, offset, max_conds, sent, ret, i, p, c;
+
+	if (!sta->num_stages || num_analog < 1)
+		return SR_ERR_ARG;
+
+	count = analog[0]->num_samples;
+	for (p = 0; p < num_analog; p++) {
+		if (analog[p]->num_samples != (uint32_t)count
+				|| g_slist_length(analog[p]->meaning->channels) != 1)
+			return SR_ERR_ARG;
+	}
+
+	/* Locate the packet for each condition. */
+	max_conds = 0;
+	for (i = 0; i < sta->num_stages; i++) {
+		cs = &sta->stages[i];
+		max_conds = MAX(max_conds, cs->num_conds);
+		for (c = 0; c < cs->num_conds; c++) {
+			cond = &cs->conds[c];
+			for (p = 0; p < num_analog; p++) {
+				if (analog[p]->meaning->channels->data == cond->channel)
+					break;
+			}
+			if (p == num_analog) {
+				sr_err("No data for trigger channel %s.",
+					cond->channel->name);
+				return SR_ERR_ARG;
+			}
+			cond->packet = p;
+		}
+	}
+
+	size = (size_t)max_conds * count;
+	if (size > sta->flags_size) {
+		sta->flags = g_realloc(sta->flags, size);
+		sta->flags_size = size;
+	}
+
+	offset = -1;
+	i = 0;
+	while (i < count) {
+		cs = &sta->stages[sta->cur_stage];
+		if (!cs->num_conds)
+			/* No analog matches supplied, client error. */
+			return SR_ERR_ARG;
+
+		for (c = 0; c < cs->num_conds; c++) {
+			cond = &cs->conds[c];
+			ret = analog_flags(sta->flags + c * count,
+					analog[cond->packet], cond, i, count);
+			if (ret != SR_OK) {
+				sr_err("Unsupported analog encoding.");
+				return ret;
+			}
+		}
+
+		i = analog_stage_find(cs, sta->flags, i, count);
+		if (i == count)
+			break;
+
+		if (sta->cur_stage + 1 < sta->num_stages) {
+			/* Advance to next stage, from the next sample on. */
+			cs = &sta->stages[++sta->cur_stage];
+			for (c = 0; c < cs->num_conds; c++)
+				cs->conds[c].armed_rising = cs->conds[c].armed_falling = FALSE;
+			i++;
+			continue;
+		}
+
+		offset = i;
+		break;
+	}
+
+	if (sta->num_pre_trigger < num_analog) {
+		sta->pre_trigger = g_realloc(sta->pre_trigger,
+				num_analog * sizeof(*sta->pre_trigger));
+		memset(sta->pre_trigger + sta->num_pre_trigger, 0,
+			(num_analog - sta->num_pre_trigger)
+			* sizeof(*sta->pre_trigger));
+		sta->num_pre_trigger = num_analog;
+	}
+	for (p = 0; p < num_analog; p++) {
+		/* (Re-)allocate the buffer when the encoding changes. */
+		pt = &sta->pre_trigger[p];
+		unitsize = analog[p]->encoding->unitsize;
+		if (pt->unitsize == unitsize)
+			continue;
+		pre_trigger_clear(pt);
+		if (pre_trigger_init(pt, unitsize,
+				sta->pre_trigger_samples) != SR_OK)
+			return SR_ERR_MALLOC;
+	}
+
+	if (offset == -1) {
+		for (p = 0; p < num_analog; p++)
+			pre_trigger_append(&sta->pre_trigger[p], analog[p]->data,
+					count * analog[p]->encoding->unitsize);
+		return -1;
+	}
+
+	/* Matched on last stage, send pre-trigger data. */
+	if (pre_trigger_samples)
+		*pre_trigger_samples = 0;
+	for (p = 0; p < num_analog; p++) {
+		pp.sdi = sta->sdi;
+		pp.tmpl = analog[p];
+		sent = pre_trigger_flush(&sta->pre_trigger[p], analog[p]->data,
+				offset * analog[p]->encoding->unitsize,
+				analog_pre_trigger_send, &pp);
+		if (pre_trigger_samples)
+			*pre_trigger_samples = MAX(*pre_trigger_samples, sent);
+	}
+
+	/* Fire trigger. */
+	std_session_send_df_trigger(sta->sdi);
 
 	return offset;
 }
@@ -284,6 +284,58 @@ SR_PRIV int std_session_send_df_frame_end(const struct sr_dev_inst *sdi)
 	return send_df_without_payload(sdi, SR_DF_FRAME_END);
 }
 
+/**
+ * Standard API helper for getting a sample buffer.
+ *
+ * The buffer is taken from the session's buffer pool, and returns there
+ * when the last reference to it is dropped. This avoids heap allocations
+ * during steady state acquisition. Drivers send the buffer's content
+ * with sr_session_send_buffer() and release it with sr_buffer_unref().
+ *
+ * @param[in] sdi The device instance to use. Must not be NULL.
+ * @param[in] size The number of bytes which the caller needs.
+ *
+ * @return A buffer of (at least) @a size bytes, or NULL when memory could
+ *         not be allocated.
+ */
+SR_PRIV struct sr_buffer *std_session_buffer_get(const struct sr_dev_inst *sdi,
+		size_t size)
+{
+	if (!sdi || !sdi->session || !sdi->session->buffer_pool)
+		return sr_buffer_new(size);
+
+	return sr_buffer_pool_get(sdi->session->buffer_pool, size);
+}
+
+/**
+ * Standard API helper for sending logic data from a sample buffer.
+ *
+ * @param[in] sdi The device instance to use. Must not be NULL.
+ * @param[in] buf The buffer which holds the samples. Must not be NULL.
+ * @param[in] data The first sample to send, located in @a buf.
+ * @param[in] length The number of bytes to send.
+ * @param[in] unitsize The number of bytes per sample.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Other error.
+ */
+SR_PRIV int std_session_send_logic_buffer(const struct sr_dev_inst *sdi,
+		struct sr_buffer *buf, void *data, size_t length,
+		uint16_t unitsize)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	logic.length = length;
+	logic.unitsize = unitsize;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	return sr_session_send_buffer(sdi, &packet, buf);
+}
+
 #ifdef HAVE_SERIAL_COMM
 
 /**
@@ -259,7 +259,9 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
 		g_hash_table_destroy(new_opts);
 
 	/* Add the transform to the session's list of transforms. */
+	g_mutex_lock(&sdi->session->stats_mutex);
 	sdi->session->transforms = g_slist_append(sdi->session->transforms, t);
+	g_mutex_unlock(&sdi->session->stats_mutex);
 
 	return t;
 }
@@ -0,0 +1,218 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/**
+ * @file
+ *
+ * Bit-matrix transposition.
+ *
+ * Devices which sample into per-channel bitplanes (one word holds several
+ * samples of a channel) need their data transposed to sample-major logic
+ * data (one word holds all channels of a sample), and vice versa.
+ *
+ * All routines share the same matrix layout: Row r is word r (or the
+ * r-th bit group of a word), and column c is bit c of that row, counting
+ * from the least significant bit. Transposition moves bit c of row r to
+ * bit r of row c.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || \
+	(defined(__i386__) && defined(__SSE2__)))
+#define TRANSPOSE_SIMD_X86 1
+#include <emmintrin.h>
+#endif
+
+/*
+ * The SWAR kernels below swap the off-diagonal halves of ever smaller
+ * blocks of the matrix, see "Hacker's Delight", chapter 7-3.
+ */
+
+/**
+ * Transpose a 4x4 bit matrix. Row r is bits [4r, 4r + 3].
+ *
+ * @param m The matrix.
+ *
+ * @return The transposed matrix.
+ *
+ * @private
+ */
+SR_PRIV uint16_t sr_transpose_4x4(uint16_t m)
+{
+	uint16_t t;
+
+	t = (m ^ (m >> 3)) & 0x0a0a;
+	m ^= t ^ (t << 3);
+	t = (m ^ (m >> 6)) & 0x00cc;
+	m ^= t ^ (t << 6);
+
+	return m;
+}
+
+/**
+ * Transpose an 8x2 bit matrix into a 2x8 bit matrix. Input row r is
+ * bits [2r, 2r + 1], output row r is bits [8r, 8r + 7].
+ *
+ * That's splitting the even and the odd bits of a word.
+ *
+ * @param m The matrix.
+ *
+ * @return The transposed matrix.
+ *
+ * @private
+ */
+SR_PRIV uint16_t sr_transpose_8x2(uint16_t m)
+{
+	uint16_t t;
+
+	t = (m ^ (m >> 1)) & 0x2222;
+	m ^= t ^ (t << 1);
+	t = (m ^ (m >> 2)) & 0x0c0c;
+	m ^= t ^ (t << 2);
+	t = (m ^ (m >> 4)) & 0x00f0;
+	m ^= t ^ (t << 4);
+
+	return m;
+}
+
+/**
+ * Transpose an 8x8 bit matrix. Row r is byte r (bits [8r, 8r + 7]).
+ *
+ * @param m The matrix.
+ *
+ * @return The transposed matrix.
+ *
+ * @private
+ */
+SR_PRIV uint64_t sr_transpose_8x8(uint64_t m)
+{
+	uint64_t t;
+
+	t = (m ^ (m >> 7)) & 0x00aa00aa00aa00aaull;
+	m ^= t ^ (t << 7);
+	t = (m ^ (m >> 14)) & 0x0000cccc0000ccccull;
+	m ^= t ^ (t << 14);
+	t = (m ^ (m >> 28)) & 0x00000000f0f0f0f0ull;
+	m ^= t ^ (t << 28);
+
+	return m;
+}
+
+#ifdef TRANSPOSE_SIMD_X86
+
+/*
+ * Gather the low and the high bytes of all 16 rows in one register
+ * each. The sign bits of the bytes then are one column of the matrix,
+ * which _mm_movemask_epi8() extracts. Doubling the bytes moves the
+ * next column to the sign bits.
+ */
+static void transpose_16x16_sse2(uint16_t *dst, const uint16_t *src)
+{
+	__m128i a, b, mask, lo, hi;
+	int c;
+
+	a = _mm_loadu_si128((const __m128i *)&src[0]);
+	b = _mm_loadu_si128((const __m128i *)&src[8]);
+	mask = _mm_set1_epi16(0x00ff);
+	lo = _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+	hi = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+
+	for (c = 7; c >= 0; c--) {
+		dst[c] = _mm_movemask_epi8(lo);
+		dst[8 + c] = _mm_movemask_epi8(hi);
+		lo = _mm_add_epi8(lo, lo);
+		hi = _mm_add_epi8(hi, hi);
+	}
+}
+
+#else
+
+/* Transpose the four 8x8 blocks, and swap the off-diagonal blocks. */
+static void transpose_16x16_swar(uint16_t *dst, const uint16_t *src)
+{
+	uint64_t block[2][2], m;
+	int r, c, br, bc;
+
+	for (br = 0; br < 2; br++) {
+		for (bc = 0; bc < 2; bc++) {
+			m = 0;
+			for (r = 0; r < 8; r++)
+				m |= (uint64_t)((src[8 * br + r] >> (8 * bc))
+					& 0xff) << (8 * r);
+			block[bc][br] = sr_transpose_8x8(m);
+		}
+	}
+	for (br = 0; br < 2; br++) {
+		for (c = 0; c < 8; c++) {
+			dst[8 * br + c] = ((block[br][0] >> (8 * c)) & 0xff) |
+				((block[br][1] >> (8 * c)) & 0xff) << 8;
+		}
+	}
+}
+
+#endif
+
+/**
+ * Transpose a 16x16 bit matrix. Row r is word r.
+ *
+ * @param[out] dst The transposed matrix. May be the same as src.
+ * @param[in] src The matrix.
+ *
+ * @private
+ */
+SR_PRIV void sr_transpose_16x16(uint16_t *dst, const uint16_t *src)
+{
+#ifdef TRANSPOSE_SIMD_X86
+	transpose_16x16_sse2(dst, src);
+#else
+	transpose_16x16_swar(dst, src);
+#endif
+}
+
+/**
+ * Transpose a 64x64 bit matrix. Row r is word r.
+ *
+ * @param[out] dst The transposed matrix. May be the same as src.
+ * @param[in] src The matrix.
+ *
+ * @private
+ */
+SR_PRIV void sr_transpose_64x64(uint64_t *dst, const uint64_t *src)
+{
+	uint64_t m, t;
+	unsigned int j, k;
+
+	if (dst != src)
+		memcpy(dst, src, 64 * sizeof(*dst));
+
+	/* Rows k and k | j swap their other half of each j-wide block. */
+	m = 0x00000000ffffffffull;
+	for (j = 32; j; j >>= 1, m ^= m << j) {
+		for (k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+			t = ((dst[k] >> j) ^ dst[k | j]) & m;
+			dst[k] ^= t << j;
+			dst[k | j] ^= t;
+		}
+	}
+}
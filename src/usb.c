@@ -26,6 +26,16 @@
 #include <libusb.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
+#ifdef _WIN32
+#include <windows.h> /* for SetThreadPriority() */
+#else
+#include <unistd.h>
+#if defined(_POSIX_THREAD_PRIORITY_SCHEDULING) && (_POSIX_THREAD_PRIORITY_SCHEDULING > 0)
+#include <pthread.h>
+#include <sched.h>
+#define HAVE_USB_THREAD_SCHED 1
+#endif
+#endif
 
 /* SR_CONF_CONN takes one of these: */
 #define CONN_USB_VIDPID  "^([0-9a-fA-F]{4})\\.([0-9a-fA-F]{4})$"
@@ -37,6 +47,26 @@
 typedef int libusb_os_handle;
 #endif
 
+/* Poll interval of the USB event thread, while it is not interrupted. */
+#define USB_EVENT_THREAD_TIMEOUT_MS	100
+
+/** Thread which handles libusb events, see usb_source_add_threaded().
+ */
+struct usb_event_thread {
+	GThread *thread;
+	struct libusb_context *usb_ctx;
+	gint stop;
+	gboolean detached;
+	/* Pending struct usb_event_call items, see usb_source_invoke(). */
+	GAsyncQueue *calls;
+};
+
+/* A function to run in a USB event thread. */
+struct usb_event_call {
+	GSourceFunc func;
+	void *data;
+};
+
 /** Custom GLib event source for libusb I/O.
  */
 struct usb_source {
@@ -50,8 +80,122 @@ struct usb_source {
 
 	struct libusb_context *usb_ctx;
 	GPtrArray *pollfds;
+
+	/* Handles libusb events instead of the session main loop. */
+	struct usb_event_thread *event_thread;
 };
 
+/* Points to the usb_event_thread in USB event threads, NULL otherwise. */
+static GPrivate usb_event_thread_self;
+
+/** Raise the calling thread's scheduling priority, if permitted.
+ */
+static void usb_event_thread_raise_priority(void)
+{
+#ifdef _WIN32
+	if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+		sr_dbg("Cannot raise USB event thread priority.");
+#elif defined(HAVE_USB_THREAD_SCHED)
+	struct sched_param param;
+	int ret;
+
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = sched_get_priority_min(SCHED_RR);
+	ret = pthread_setschedparam(pthread_self(), SCHED_RR, &param);
+	if (ret != 0)
+		sr_dbg("Cannot raise USB event thread priority: %s.",
+			g_strerror(ret));
+#endif
+}
+
+static void usb_event_thread_free(struct usb_event_thread *et)
+{
+	g_async_queue_unref(et->calls);
+	g_free(et);
+}
+
+/** USB event thread main routine.
+ */
+static gpointer usb_event_thread_run(gpointer data)
+{
+	struct usb_event_thread *et;
+	struct usb_event_call *call;
+	struct timeval tv;
+	int ret;
+
+	et = data;
+	g_private_set(&usb_event_thread_self, et);
+	usb_event_thread_raise_priority();
+
+	while (!g_atomic_int_get(&et->stop)) {
+		tv.tv_sec = 0;
+		tv.tv_usec = USB_EVENT_THREAD_TIMEOUT_MS * 1000;
+		ret = libusb_handle_events_timeout_completed(et->usb_ctx,
+			&tv, &et->stop);
+		if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED) {
+			sr_err("Failed to handle USB events: %s.",
+				libusb_error_name(ret));
+			break;
+		}
+		while (!g_atomic_int_get(&et->stop) &&
+				(call = g_async_queue_try_pop(et->calls))) {
+			call->func(call->data);
+			g_free(call);
+		}
+	}
+
+	/* The source was destroyed from within this thread. */
+	if (et->detached)
+		usb_event_thread_free(et);
+
+	return NULL;
+}
+
+/** Start a thread which handles the events of a libusb context.
+ */
+static struct usb_event_thread *usb_event_thread_start(
+		struct libusb_context *usb_ctx)
+{
+	struct usb_event_thread *et;
+	GError *error;
+
+	et = g_malloc0(sizeof(*et));
+	et->usb_ctx = usb_ctx;
+	et->calls = g_async_queue_new_full(g_free);
+
+	error = NULL;
+	et->thread = g_thread_try_new("usb-events",
+		usb_event_thread_run, et, &error);
+	if (!et->thread) {
+		sr_warn("Cannot start USB event thread: %s.", error->message);
+		g_error_free(error);
+		usb_event_thread_free(et);
+		return NULL;
+	}
+
+	return et;
+}
+
+/** Stop a USB event thread, and release its resources.
+ */
+static void usb_event_thread_stop(struct usb_event_thread *et)
+{
+	g_atomic_int_set(&et->stop, 1);
+#if (LIBUSB_API_VERSION >= 0x01000105)
+	libusb_interrupt_event_handler(et->usb_ctx);
+#endif
+
+	/* Cannot join the calling thread, have it terminate itself. */
+	if (g_private_get(&usb_event_thread_self) == et) {
+		et->detached = TRUE;
+		g_thread_unref(et->thread);
+		return;
+	}
+
+	g_thread_join(et->thread);
+	usb_event_thread_free(et);
+}
+
 /** USB event source prepare() method.
  */
 static gboolean usb_source_prepare(GSource *source, int *timeout)
@@ -64,7 +208,10 @@ static gboolean usb_source_prepare(GSource *source, int *timeout)
 
 	usource = (struct usb_source *)source;
 
-	ret = libusb_get_next_timeout(usource->usb_ctx, &usb_timeout);
+	/* libusb timeouts are handled in the USB event thread if present. */
+	ret = 0;
+	if (!usource->event_thread)
+		ret = libusb_get_next_timeout(usource->usb_ctx, &usb_timeout);
 	if (G_UNLIKELY(ret < 0)) {
 		sr_err("Failed to get libusb timeout: %s",
 			libusb_error_name(ret));
@@ -160,7 +307,12 @@ static void usb_source_finalize(GSource *source)
 
 	sr_spew("%s", __func__);
 
-	libusb_set_pollfd_notifiers(usource->usb_ctx, NULL, NULL, NULL);
+	if (usource->event_thread) {
+		usb_event_thread_stop(usource->event_thread);
+		usource->event_thread = NULL;
+	} else {
+		libusb_set_pollfd_notifiers(usource->usb_ctx, NULL, NULL, NULL);
+	}
 
 	g_ptr_array_unref(usource->pollfds);
 	usource->pollfds = NULL;
@@ -243,13 +395,18 @@ static void usb_source_free_pollfd(void *data)
  * API at some point. Instead, drivers should install separate timer
  * event sources for their polling needs.
  *
+ * With an event thread, libusb events are handled by that thread, and
+ * the event source only provides the user timeout.
+ *
  * @param session The session the event source belongs to.
  * @param usb_ctx The libusb context for which to handle events.
  * @param timeout_ms The timeout interval in ms, or -1 to wait indefinitely.
+ * @param threaded Whether to handle libusb events in a thread of its own.
  * @return A new event source object, or NULL on failure.
  */
 static GSource *usb_source_new(struct sr_session *session,
-		struct libusb_context *usb_ctx, int timeout_ms)
+		struct libusb_context *usb_ctx, int timeout_ms,
+		gboolean threaded)
 {
 	static GSourceFuncs usb_source_funcs = {
 		.prepare  = &usb_source_prepare,
@@ -282,6 +439,18 @@ static GSource *usb_source_new(struct sr_session *session,
 	usource->usb_ctx = usb_ctx;
 	usource->pollfds = g_ptr_array_new_full(8, &usb_source_free_pollfd);
 
+	if (threaded)
+		usource->event_thread = usb_event_thread_start(usb_ctx);
+	if (usource->event_thread) {
+		sr_dbg("Handling USB events in a separate thread.");
+#if (LIBUSB_API_VERSION >= 0x01000104)
+		libusb_free_pollfds(upollfds);
+#else
+		free(upollfds);
+#endif
+		return source;
+	}
+
 	for (upfd = upollfds; *upfd != NULL; upfd++)
 		usb_pollfd_added((*upfd)->fd, (*upfd)->events, usource);
 
@@ -441,6 +610,207 @@ SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
 	return devices;
 }
 
+/**
+ * Take a snapshot of the USB device list for a scan of several drivers.
+ *
+ * Calls nest, the snapshot lives until the last sr_usb_scan_end().
+ *
+ * @param[in] ctx The libsigrok context.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_scan_begin(struct sr_context *ctx)
+{
+	g_mutex_lock(&ctx->scan_mutex);
+	if (!ctx->usb_scan_depth++) {
+		if (libusb_get_device_list(ctx->libusb_ctx, &ctx->usb_snapshot) < 0)
+			ctx->usb_snapshot = NULL;
+	}
+	g_mutex_unlock(&ctx->scan_mutex);
+}
+
+/**
+ * Release the snapshot of the USB device list.
+ *
+ * @param[in] ctx The libsigrok context.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_scan_end(struct sr_context *ctx)
+{
+	g_mutex_lock(&ctx->scan_mutex);
+	if (!--ctx->usb_scan_depth && ctx->usb_snapshot) {
+		libusb_free_device_list(ctx->usb_snapshot, 1);
+		ctx->usb_snapshot = NULL;
+	}
+	g_mutex_unlock(&ctx->scan_mutex);
+}
+
+/**
+ * Get the list of USB devices, like libusb_get_device_list() does.
+ *
+ * During a scan of several drivers, this returns a copy of the list
+ * which was taken when the scan started, so that the system's devices
+ * get enumerated only once.
+ *
+ * @param[in] ctx The libsigrok context.
+ * @param[out] list The list of devices. The caller must release it with
+ *                  libusb_free_device_list(list, 1).
+ *
+ * @return The number of devices, or a libusb error code.
+ *
+ * @private
+ */
+SR_PRIV ssize_t sr_usb_get_device_list(struct sr_context *ctx,
+		libusb_device ***list)
+{
+	libusb_device **devs;
+	ssize_t i, count;
+
+	g_mutex_lock(&ctx->scan_mutex);
+	if (!ctx->usb_snapshot) {
+		g_mutex_unlock(&ctx->scan_mutex);
+		return libusb_get_device_list(ctx->libusb_ctx, list);
+	}
+
+	for (count = 0; ctx->usb_snapshot[count]; count++)
+		;
+	/* libusb_free_device_list() releases the list with free(). */
+	devs = calloc(count + 1, sizeof(*devs));
+	if (!devs) {
+		g_mutex_unlock(&ctx->scan_mutex);
+		return LIBUSB_ERROR_NO_MEM;
+	}
+	for (i = 0; i < count; i++)
+		devs[i] = libusb_ref_device(ctx->usb_snapshot[i]);
+	g_mutex_unlock(&ctx->scan_mutex);
+
+	*list = devs;
+
+	return count;
+}
+
+/* The device's name for sr_scan_resource_lock(). */
+static char *usb_scan_resource(libusb_device *dev)
+{
+	return g_strdup_printf("usb/%d.%d", libusb_get_bus_number(dev),
+		libusb_get_device_address(dev));
+}
+
+/**
+ * Get exclusive access to a USB device while probing it during a scan.
+ *
+ * Drivers with overlapping VID:PID tables (the FTDI based ones) must not
+ * open the same device at the same time, see sr_scan_resource_lock().
+ *
+ * @param[in] dev The USB device. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_scan_lock(libusb_device *dev)
+{
+	char *resource;
+
+	resource = usb_scan_resource(dev);
+	sr_scan_resource_lock(resource);
+	g_free(resource);
+}
+
+/**
+ * Release a USB device which was locked by sr_usb_scan_lock().
+ *
+ * @param[in] dev The USB device. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_scan_unlock(libusb_device *dev)
+{
+	char *resource;
+
+	resource = usb_scan_resource(dev);
+	sr_scan_resource_unlock(resource);
+	g_free(resource);
+}
+
+static int usb_dev_cmp(const void *a, const void *b)
+{
+	libusb_device *da, *db;
+	int diff;
+
+	da = *(libusb_device * const *)a;
+	db = *(libusb_device * const *)b;
+	diff = libusb_get_bus_number(da) - libusb_get_bus_number(db);
+	if (diff)
+		return diff;
+
+	return libusb_get_device_address(da) - libusb_get_device_address(db);
+}
+
+/**
+ * Lock all USB devices with a given VID:PID, see sr_usb_scan_lock().
+ *
+ * For drivers which let libftdi pick the device by VID:PID and product
+ * string, so the device which gets opened is not known in advance. The
+ * devices get locked in the order of their bus and address, callers
+ * which lock several devices can't deadlock each other.
+ *
+ * @param[in] ctx The libsigrok context.
+ * @param[in] vid The USB vendor ID.
+ * @param[in] pid The USB product ID.
+ *
+ * @return The locked devices, to be released with
+ *         sr_usb_scan_unlock_list(). NULL upon error.
+ *
+ * @private
+ */
+SR_PRIV libusb_device **sr_usb_scan_lock_vid_pid(struct sr_context *ctx,
+		uint16_t vid, uint16_t pid)
+{
+	struct libusb_device_descriptor des;
+	libusb_device **devlist, **locked;
+	ssize_t i, count, n;
+
+	if ((count = sr_usb_get_device_list(ctx, &devlist)) < 0)
+		return NULL;
+
+	locked = g_malloc0_n(count + 1, sizeof(*locked));
+	n = 0;
+	for (i = 0; i < count; i++) {
+		libusb_get_device_descriptor(devlist[i], &des);
+		if (des.idVendor != vid || des.idProduct != pid)
+			continue;
+		locked[n++] = libusb_ref_device(devlist[i]);
+	}
+	libusb_free_device_list(devlist, 1);
+
+	qsort(locked, n, sizeof(*locked), usb_dev_cmp);
+	for (i = 0; i < n; i++)
+		sr_usb_scan_lock(locked[i]);
+
+	return locked;
+}
+
+/**
+ * Release the devices which were locked by sr_usb_scan_lock_vid_pid().
+ *
+ * @param[in] locked The locked devices. Can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_scan_unlock_list(libusb_device **locked)
+{
+	size_t i;
+
+	if (!locked)
+		return;
+
+	for (i = 0; locked[i]; i++) {
+		sr_usb_scan_unlock(locked[i]);
+		libusb_unref_device(locked[i]);
+	}
+	g_free(locked);
+}
+
 SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb)
 {
 	struct libusb_device **devlist;
@@ -493,13 +863,14 @@ SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb)
 	sr_dbg("Closed USB device %d.%d.", usb->bus, usb->address);
 }
 
-SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
-		int timeout, sr_receive_data_callback cb, void *cb_data)
+static int usb_source_add_internal(struct sr_session *session,
+		struct sr_context *ctx, int timeout,
+		sr_receive_data_callback cb, void *cb_data, gboolean threaded)
 {
 	GSource *source;
 	int ret;
 
-	source = usb_source_new(session, ctx->libusb_ctx, timeout);
+	source = usb_source_new(session, ctx->libusb_ctx, timeout, threaded);
 	if (!source)
 		return SR_ERR;
 
@@ -511,8 +882,136 @@ SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 	return ret;
 }
 
-SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx)
+SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
+		int timeout, sr_receive_data_callback cb, void *cb_data)
 {
+	return usb_source_add_internal(session, ctx, timeout, cb, cb_data, FALSE);
+}
+
+/**
+ * Add an event source for libusb I/O, which may use an event thread.
+ *
+ * This works like usb_source_add(). When the session is configured to
+ * use a USB event thread (see sr_session_usb_event_thread_set()), then
+ * libusb events get handled in that thread, and transfer completion
+ * callbacks run there. Drivers must only use this routine when their
+ * callbacks can run concurrently to the session main loop, and must
+ * synchronize accesses to state which both share.
+ *
+ * Packets which the completion callbacks send are queued, and get
+ * delivered by the session main loop. Transforms and datafeed callbacks
+ * don't run in the event thread.
+ *
+ * The @a cb callback still runs in the session main loop, on timeouts.
+ *
+ * @private
+ */
+SR_API int usb_source_add_threaded(struct sr_session *session,
+		struct sr_context *ctx, int timeout,
+		sr_receive_data_callback cb, void *cb_data)
+{
+	return usb_source_add_internal(session, ctx, timeout, cb, cb_data,
+		session->usb_event_thread);
+}
+
+/**
+ * Check whether libusb events of a session get handled in a thread.
+ *
+ * Receive callbacks of drivers which use usb_source_add_threaded() must
+ * not handle libusb events themselves when this returns TRUE.
+ *
+ * @private
+ */
+SR_PRIV gboolean usb_source_is_threaded(struct sr_session *session,
+		struct sr_context *ctx)
+{
+	struct usb_source *usource;
+
+	usource = g_hash_table_lookup(session->event_sources, ctx->libusb_ctx);
+
+	return usource && usource->event_thread;
+}
+
+/**
+ * Run a function in the USB event thread of a session.
+ *
+ * The function runs where transfer completion callbacks run, after the
+ * current round of libusb event handling. This allows the test suite
+ * to exercise the event thread without USB hardware.
+ *
+ * @param session The session. Must not be NULL.
+ * @param ctx The libsigrok context whose libusb events the thread handles.
+ * @param func The function to run. Its return value is ignored.
+ * @param data User data for @a func.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_NA The session has no USB event thread for @a ctx.
+ *
+ * @private
+ */
+SR_API int usb_source_invoke(struct sr_session *session,
+		struct sr_context *ctx, GSourceFunc func, void *data)
+{
+	struct usb_source *usource;
+	struct usb_event_call *call;
+
+	usource = g_hash_table_lookup(session->event_sources, ctx->libusb_ctx);
+	if (!usource || !usource->event_thread)
+		return SR_ERR_NA;
+
+	call = g_malloc0(sizeof(*call));
+	call->func = func;
+	call->data = data;
+	g_async_queue_push(usource->event_thread->calls, call);
+#if (LIBUSB_API_VERSION >= 0x01000105)
+	libusb_interrupt_event_handler(ctx->libusb_ctx);
+#endif
+
+	return SR_OK;
+}
+
+struct usb_source_removal {
+	struct sr_session *session;
+	void *key;
+};
+
+static gboolean usb_source_remove_deferred(void *data)
+{
+	struct usb_source_removal *removal;
+
+	removal = data;
+	sr_session_source_remove_internal(removal->session, removal->key);
+
+	return G_SOURCE_REMOVE;
+}
+
+SR_API int usb_source_remove(struct sr_session *session, struct sr_context *ctx)
+{
+	struct usb_source_removal *removal;
+	gboolean deferred;
+
+	/*
+	 * Session event sources must only be manipulated by the session
+	 * thread. Defer the removal when a transfer completion callback
+	 * in the USB event thread ends the acquisition.
+	 */
+	deferred = FALSE;
+	if (g_private_get(&usb_event_thread_self)) {
+		g_mutex_lock(&session->main_mutex);
+		if (session->main_context) {
+			removal = g_malloc0(sizeof(*removal));
+			removal->session = session;
+			removal->key = ctx->libusb_ctx;
+			g_main_context_invoke_full(session->main_context,
+				G_PRIORITY_DEFAULT, usb_source_remove_deferred,
+				removal, g_free);
+			deferred = TRUE;
+		}
+		g_mutex_unlock(&session->main_mutex);
+	}
+	if (deferred)
+		return SR_OK;
+
 	return sr_session_source_remove_internal(session, ctx->libusb_ctx);
 }
 
@@ -572,6 +1071,7 @@ SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 
 	hdl = NULL;
 	ret = FALSE;
+	sr_usb_scan_lock(dev);
 	while (!ret) {
 		/* Assume the FW has not been loaded, unless proven wrong. */
 		libusb_get_device_descriptor(dev, &des);
@@ -595,6 +1095,221 @@ SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 	}
 	if (hdl)
 		libusb_close(hdl);
+	sr_usb_scan_unlock(dev);
 
 	return ret;
 }
+
+/* Defaults and limits of the USB bulk transfer parameters. */
+#define USB_XFER_DEFAULT_LATENCY_MS	10
+#define USB_XFER_MAX_COUNT		256
+#define USB_XFER_MAX_GROWTH		4
+
+/*
+ * Transfer parameters get updated from completion callbacks, which can
+ * run in the USB event thread, and get read by config_get() calls.
+ */
+static GMutex xfer_params_mutex;
+
+/**
+ * Get a USB transfer parameter.
+ *
+ * Returns the value which was chosen for the most recent acquisition
+ * when the parameter is selected automatically.
+ *
+ * @param[in] p The transfer parameters.
+ * @param[in] key The config key.
+ * @param[out] data The parameter's value.
+ *
+ * @return SR_ERR_NA if @a key is not a transfer parameter, SR_OK otherwise.
+ *
+ * @private
+ */
+SR_PRIV int sr_usb_xfer_params_config_get(const struct sr_usb_xfer_params *p,
+		uint32_t key, GVariant **data)
+{
+	uint64_t value;
+
+	g_mutex_lock(&xfer_params_mutex);
+	switch (key) {
+	case SR_CONF_USB_BUFFER_SIZE:
+		value = p->buffer_size ? p->buffer_size : p->size;
+		break;
+	case SR_CONF_USB_QUEUE_DEPTH:
+		value = p->queue_depth ? p->queue_depth : p->count;
+		break;
+	case SR_CONF_USB_LATENCY:
+		value = p->latency_ms ? p->latency_ms : USB_XFER_DEFAULT_LATENCY_MS;
+		break;
+	default:
+		g_mutex_unlock(&xfer_params_mutex);
+		return SR_ERR_NA;
+	}
+	g_mutex_unlock(&xfer_params_mutex);
+	*data = g_variant_new_uint64(value);
+
+	return SR_OK;
+}
+
+/**
+ * Set a USB transfer parameter. Takes effect with the next acquisition.
+ *
+ * @param[in,out] p The transfer parameters.
+ * @param[in] key The config key.
+ * @param[in] data The parameter's value, 0 selects automatic values.
+ *
+ * @return SR_ERR_NA if @a key is not a transfer parameter, SR_ERR_ARG
+ *         for invalid values, SR_OK otherwise.
+ *
+ * @private
+ */
+SR_PRIV int sr_usb_xfer_params_config_set(struct sr_usb_xfer_params *p,
+		uint32_t key, GVariant *data)
+{
+	uint64_t value;
+	int ret;
+
+	value = g_variant_get_uint64(data);
+	ret = SR_OK;
+	g_mutex_lock(&xfer_params_mutex);
+	switch (key) {
+	case SR_CONF_USB_BUFFER_SIZE:
+		if (value > G_MAXINT)
+			ret = SR_ERR_ARG;
+		else
+			p->buffer_size = value;
+		break;
+	case SR_CONF_USB_QUEUE_DEPTH:
+		if (value > USB_XFER_MAX_COUNT)
+			ret = SR_ERR_ARG;
+		else
+			p->queue_depth = value;
+		break;
+	case SR_CONF_USB_LATENCY:
+		if (value > 10000)
+			ret = SR_ERR_ARG;
+		else
+			p->latency_ms = value;
+		break;
+	default:
+		ret = SR_ERR_NA;
+		break;
+	}
+	g_mutex_unlock(&xfer_params_mutex);
+
+	return ret;
+}
+
+/**
+ * Choose the USB transfer parameters for an acquisition.
+ *
+ * Transfers hold data for the latency target, and there are enough of
+ * them to hold data for a total period. User settings take precedence.
+ *
+ * @param[in,out] p The transfer parameters.
+ * @param[in] bytes_per_ms The expected data rate.
+ * @param[in] block_size Transfer sizes are a multiple of it.
+ * @param[in] total_ms The period which all transfers together cover.
+ * @param[in] max_count The maximum number of transfers to start with.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_xfer_params_setup(struct sr_usb_xfer_params *p,
+		size_t bytes_per_ms, size_t block_size, unsigned int total_ms,
+		unsigned int max_count)
+{
+	uint64_t size, count, latency_ms, timeout_ms;
+
+	bytes_per_ms = MAX(bytes_per_ms, 1);
+	block_size = MAX(block_size, 1);
+
+	g_mutex_lock(&xfer_params_mutex);
+	latency_ms = p->latency_ms;
+	if (!latency_ms)
+		latency_ms = USB_XFER_DEFAULT_LATENCY_MS;
+	size = p->buffer_size;
+	if (!size)
+		size = latency_ms * bytes_per_ms;
+	size = (size + block_size - 1) / block_size * block_size;
+	size = MAX(size, block_size);
+
+	if (p->queue_depth) {
+		count = p->queue_depth;
+		p->max_count = count;
+	} else {
+		count = (uint64_t)total_ms * bytes_per_ms / size;
+		count = CLAMP(count, 1, max_count);
+		p->max_count = MIN(count * USB_XFER_MAX_GROWTH,
+			USB_XFER_MAX_COUNT);
+	}
+
+	/*
+	 * Leave a headroom of 25% for the timeout. Small buffers can round
+	 * it down to 0, which libusb would take as no timeout at all.
+	 */
+	timeout_ms = size * count / bytes_per_ms;
+	timeout_ms += timeout_ms / 4;
+	timeout_ms = MAX(timeout_ms, 1);
+
+	p->size = size;
+	p->count = count;
+	p->timeout_ms = MIN(timeout_ms, G_MAXUINT);
+	p->bytes_per_ms = bytes_per_ms;
+	p->last_completion_us = 0;
+	p->backlog = 0;
+	g_mutex_unlock(&xfer_params_mutex);
+
+	sr_info("USB transfers: %u x %zu bytes (%" PRIu64 "ms), timeout %ums.",
+		p->count, p->size, size / bytes_per_ms, p->timeout_ms);
+}
+
+/**
+ * Account for the completion of a USB transfer during an acquisition.
+ *
+ * Transfers which complete in quick succession indicate a backlog of
+ * completions, the host did not keep up with the device. When half the
+ * queue completed that way, and the queue depth is selected
+ * automatically, the queue grows to reduce the risk of overruns.
+ *
+ * @param[in,out] p The transfer parameters.
+ * @param[in] length The number of bytes which were received.
+ *
+ * @return The number of transfers to add to the queue. The timeout for
+ *         submissions gets updated accordingly.
+ *
+ * @private
+ */
+SR_PRIV unsigned int sr_usb_xfer_params_completed(struct sr_usb_xfer_params *p,
+		size_t length)
+{
+	int64_t now_us, period_us;
+	unsigned int grow, count;
+
+	now_us = g_get_monotonic_time();
+	g_mutex_lock(&xfer_params_mutex);
+	period_us = (int64_t)p->size * 1000 / p->bytes_per_ms;
+	if (length == p->size && p->last_completion_us &&
+			now_us - p->last_completion_us < period_us / 4)
+		p->backlog++;
+	else if (p->backlog)
+		p->backlog--;
+	p->last_completion_us = now_us;
+
+	if (p->queue_depth || p->count >= p->max_count ||
+			p->backlog < MAX(p->count / 2, 2)) {
+		g_mutex_unlock(&xfer_params_mutex);
+		return 0;
+	}
+
+	grow = MIN(p->count, p->max_count - p->count);
+	p->count += grow;
+	p->timeout_ms = p->size * p->count / p->bytes_per_ms;
+	p->timeout_ms += p->timeout_ms / 4;
+	p->timeout_ms = MAX(p->timeout_ms, 1);
+	p->backlog = 0;
+	count = p->count;
+	g_mutex_unlock(&xfer_params_mutex);
+	sr_info("USB completion backlog, using %u transfers.", count);
+
+	return grow;
+}
@@ -345,6 +345,7 @@ START_TEST(test_analog_to_float_conv)
 	size_t byte_count, value_idx;
 	uint8_t f_in[max_floats * sizeof(double)], *byte_ptr;
 	float f_out[max_floats];
+	double d_out[max_floats];
 	int ret;
 	float want, have;
 
@@ -395,6 +396,9 @@ START_TEST(test_analog_to_float_conv)
 		if (!item->want) {
 			ck_assert_msg(ret != SR_OK,
 				"%s: sr_analog_to_float() passed", item_text);
+			ret = sr_analog_to_double(&analog, &d_out[0]);
+			ck_assert_msg(ret != SR_OK,
+				"%s: sr_analog_to_double() passed", item_text);
 			if (with_diag) {
 				fprintf(stderr, " -- expected fail, OK\n");
 				fflush(stderr);
@@ -425,7 +429,210 @@ START_TEST(test_analog_to_float_conv)
 				"%s: input %f != output %f",
 				item_text, want, have);
 		}
+
+		/*
+		 * The double precision conversion must not lose anything,
+		 * trimming its result must yield the float conversion's.
+		 */
+		ret = sr_analog_to_double(&analog, &d_out[0]);
+		ck_assert_msg(ret == SR_OK,
+			"%s: sr_analog_to_double() failed: %d", item_text, ret);
+		for (value_idx = 0; value_idx < item->nums; value_idx++) {
+			want = item->want[value_idx];
+			have = (float)d_out[value_idx];
+			ck_assert_msg(want == have,
+				"%s: input %f != double output %f",
+				item_text, want, have);
+		}
+	}
+}
+END_TEST
+
+/* Check bulk conversion, of more samples than a vector unit holds. */
+START_TEST(test_analog_to_float_bulk)
+{
+	const size_t count = 1003;
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	int16_t *in;
+	float *f_out;
+	double *d_out, want;
+	size_t i;
+	int ret, is_be;
+
+	in = g_malloc(count * sizeof(*in));
+	f_out = g_malloc(count * sizeof(*f_out));
+	d_out = g_malloc(count * sizeof(*d_out));
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = count;
+	analog.data = in;
+	meaning.channels = g_slist_append(NULL, &ch);
+	encoding.unitsize = sizeof(int16_t);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.scale.p = 1;
+	encoding.scale.q = 4;
+	encoding.offset.p = 3;
+
+	for (is_be = 0; is_be <= 1; is_be++) {
+		encoding.is_bigendian = is_be;
+		for (i = 0; i < count; i++) {
+			in[i] = (int16_t)(i * 37 - 18000);
+			if (is_be != host_be)
+				swap_bytes((uint8_t *)&in[i], sizeof(in[i]));
+		}
+
+		ret = sr_analog_to_float(&analog, f_out);
+		ck_assert_msg(ret == SR_OK,
+			"sr_analog_to_float() failed: %d.", ret);
+		ret = sr_analog_to_double(&analog, d_out);
+		ck_assert_msg(ret == SR_OK,
+			"sr_analog_to_double() failed: %d.", ret);
+		for (i = 0; i < count; i++) {
+			want = (int16_t)(i * 37 - 18000) * 0.25 + 3;
+			ck_assert_msg(f_out[i] == want, "%zu: %f != %f",
+				i, f_out[i], want);
+			ck_assert_msg(d_out[i] == want, "%zu: %f != %f",
+				i, d_out[i], want);
+		}
+	}
+
+	g_slist_free(meaning.channels);
+	g_free(d_out);
+	g_free(f_out);
+	g_free(in);
+}
+END_TEST
+
+START_TEST(test_analog_to_double_null)
+{
+	int ret;
+	float f;
+	double dout;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	f = G_PI;
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = 1;
+	analog.data = &f;
+
+	ret = sr_analog_to_double(NULL, &dout);
+	ck_assert(ret == SR_ERR_ARG);
+	ret = sr_analog_to_double(&analog, NULL);
+	ck_assert(ret == SR_ERR_ARG);
+
+	analog.meaning = NULL;
+	ret = sr_analog_to_double(&analog, &dout);
+	ck_assert(ret == SR_ERR_ARG);
+}
+END_TEST
+
+START_TEST(test_analog_to_logic_packed)
+{
+	const size_t count = 5003;
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	int16_t *in;
+	uint8_t *out, *bytes, state, want_state;
+	double value;
+	size_t i;
+	int ret, bit;
+
+	in = g_malloc(count * sizeof(*in));
+	out = g_malloc(count * 2);
+	bytes = g_malloc(count);
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = count;
+	analog.data = in;
+	meaning.channels = g_slist_append(NULL, &ch);
+	encoding.unitsize = sizeof(int16_t);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = host_be;
+	encoding.scale.p = -1;
+	encoding.scale.q = 4;
+	encoding.offset.p = 3;
+	for (i = 0; i < count; i++)
+		in[i] = (int16_t)((i * 7919) % 2001 - 1000);
+	memset(out, 0xa5, count * 2);
+
+	/* Threshold into channel 9, Schmitt-trigger into channel 0. */
+	ret = sr_a2l_threshold_packed(&analog, 100.1, out, 2, 9, count);
+	ck_assert_msg(ret == SR_OK, "threshold failed: %d.", ret);
+	state = 1;
+	ret = sr_a2l_schmitt_trigger_packed(&analog, -50.1, 50.1, &state,
+		out, 2, 0, count);
+	ck_assert_msg(ret == SR_OK, "Schmitt-trigger failed: %d.", ret);
+	ret = sr_a2l_threshold(&analog, 100.1, bytes, count);
+	ck_assert_msg(ret == SR_OK, "sr_a2l_threshold() failed: %d.", ret);
+
+	want_state = 1;
+	for (i = 0; i < count; i++) {
+		value = in[i] * -0.25 + 3;
+		if (value < -50.1)
+			want_state = 0;
+		else if (value > 50.1)
+			want_state = 1;
+		bit = value >= 100.1;
+		ck_assert_msg(out[2 * i] == (0xa4 | want_state),
+			"%zu: 0x%02x, value %f", i, out[2 * i], value);
+		ck_assert_msg(out[2 * i + 1] == (0xa5 | bit << 1),
+			"%zu: 0x%02x, value %f", i, out[2 * i + 1], value);
+		ck_assert_msg(bytes[i] == bit, "%zu: %d, value %f",
+			i, bytes[i], value);
 	}
+	ck_assert(state == want_state);
+
+	g_slist_free(meaning.channels);
+	g_free(bytes);
+	g_free(out);
+	g_free(in);
+}
+END_TEST
+
+START_TEST(test_analog_to_logic_null)
+{
+	int ret;
+	float f;
+	uint8_t out[2], state;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	f = G_PI;
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = 1;
+	analog.data = &f;
+	state = 0;
+
+	ret = sr_a2l_threshold_packed(NULL, 1.0, out, 1, 0, 1);
+	ck_assert(ret == SR_ERR_ARG);
+	ret = sr_a2l_threshold_packed(&analog, 1.0, NULL, 1, 0, 1);
+	ck_assert(ret == SR_ERR_ARG);
+	ret = sr_a2l_threshold_packed(&analog, 1.0, out, 1, 8, 1);
+	ck_assert(ret == SR_ERR_ARG);
+	ret = sr_a2l_threshold_packed(&analog, 1.0, out, 2, 15, 1);
+	ck_assert(ret == SR_OK);
+	ret = sr_a2l_schmitt_trigger_packed(&analog, 1.0, 2.0, NULL,
+		out, 1, 0, 1);
+	ck_assert(ret == SR_ERR_ARG);
+	ret = sr_a2l_schmitt_trigger_packed(&analog, 1.0, 2.0, &state,
+		out, 1, 0, 1);
+	ck_assert(ret == SR_OK && state == 1);
+
+	encoding.unitsize = 3;
+	ret = sr_a2l_threshold_packed(&analog, 1.0, out, 1, 0, 1);
+	ck_assert(ret == SR_ERR_ARG);
 }
 END_TEST
 
@@ -698,6 +905,13 @@ Suite *suite_analog(void)
 	tcase_add_test(tc, test_analog_to_float);
 	tcase_add_test(tc, test_analog_to_float_null);
 	tcase_add_test(tc, test_analog_to_float_conv);
+	tcase_add_test(tc, test_analog_to_float_bulk);
+	tcase_add_test(tc, test_analog_to_double_null);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("analog_to_logic");
+	tcase_add_test(tc, test_analog_to_logic_packed);
+	tcase_add_test(tc, test_analog_to_logic_null);
 	suite_add_tcase(s, tc);
 
 	tc = tcase_create("analog_si_unit");
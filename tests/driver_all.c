@@ -18,7 +18,9 @@
  */
 
 #include <config.h>
+#include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -40,6 +42,176 @@ START_TEST(test_driver_init_all)
 }
 END_TEST
 
+/* Find the position of a device's driver in a driver list. */
+static int driver_index(struct sr_dev_driver **drivers,
+		struct sr_dev_inst *sdi)
+{
+	int i;
+
+	for (i = 0; drivers[i]; i++) {
+		if (drivers[i] == sr_dev_inst_driver_get(sdi))
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Check whether scanning with several drivers at once works. The
+ * result must match scans with the drivers one after another.
+ */
+START_TEST(test_context_scan)
+{
+	struct sr_dev_driver **drivers;
+	GSList *devices, *l;
+	guint expected, demo_devices;
+	int i, prev;
+
+	drivers = sr_driver_list(srtest_ctx);
+	srtest_driver_init_all(srtest_ctx);
+
+	expected = 0;
+	for (i = 0; drivers[i]; i++) {
+		devices = sr_driver_scan(drivers[i], NULL);
+		expected += g_slist_length(devices);
+		g_slist_free(devices);
+	}
+
+	devices = sr_context_scan(srtest_ctx, NULL, NULL);
+	ck_assert_msg(g_slist_length(devices) == expected,
+		"Found %u devices, expected %u.",
+		g_slist_length(devices), expected);
+
+	/* Devices come in the order of their drivers. */
+	prev = 0;
+	demo_devices = 0;
+	for (l = devices; l; l = l->next) {
+		i = driver_index(drivers, l->data);
+		ck_assert_msg(i >= prev, "Devices out of driver order.");
+		prev = i;
+		if (!strcmp(drivers[i]->name, "demo"))
+			demo_devices++;
+	}
+	ck_assert_msg(demo_devices == 1, "Demo scan failed.");
+	g_slist_free(devices);
+
+	ck_assert(sr_context_scan_cache_ttl_set(srtest_ctx, 1000) == SR_OK);
+	ck_assert(sr_context_scan_cache_ttl_set(srtest_ctx, 0) == SR_OK);
+	ck_assert(sr_context_scan_cache_ttl_set(NULL, 0) == SR_ERR_ARG);
+}
+END_TEST
+
+/* Counts the scans which got skipped due to a cached negative probe. */
+static int count_skipped(void *cb_data, int loglevel, const char *format,
+		va_list args)
+{
+	(void)loglevel;
+	(void)args;
+
+	if (strstr(format, "Skipping "))
+		(*(int *)cb_data)++;
+
+	return SR_OK;
+}
+
+/* Pick a driver which can take a serial port, demo if none was built. */
+static struct sr_dev_driver *conn_driver_get(void)
+{
+	struct sr_dev_driver **drivers, *driver;
+	GArray *opts;
+	guint i;
+	int d;
+
+	drivers = sr_driver_list(srtest_ctx);
+	driver = NULL;
+	for (d = 0; drivers[d] && !driver; d++) {
+		opts = sr_driver_scan_options_list(drivers[d]);
+		if (!opts)
+			continue;
+		for (i = 0; i < opts->len; i++) {
+			if (g_array_index(opts, uint32_t, i) == SR_CONF_SERIALCOMM)
+				driver = drivers[d];
+		}
+		g_array_free(opts, TRUE);
+	}
+
+	return driver ? driver : srtest_driver_get("demo");
+}
+
+/*
+ * Check whether a scan skips a driver which recently found nothing on
+ * a port, and whether it probes the port again after the cache's TTL.
+ * Demo doesn't take a connection, its scans with one find nothing.
+ */
+START_TEST(test_context_scan_cache)
+{
+	struct sr_dev_driver *drivers[2];
+	struct sr_config src;
+	GSList *options;
+	int skipped, loglevel;
+
+	drivers[0] = conn_driver_get();
+	drivers[1] = NULL;
+	srtest_driver_init(srtest_ctx, drivers[0]);
+
+	src.key = SR_CONF_CONN;
+	src.data = g_variant_ref_sink(g_variant_new_string(
+		"/nonexistent/sigrok-test-port"));
+	options = g_slist_append(NULL, &src);
+
+	skipped = 0;
+	loglevel = sr_log_loglevel_get();
+	sr_log_loglevel_set(SR_LOG_DBG);
+	sr_log_callback_set(count_skipped, &skipped);
+
+	ck_assert(sr_context_scan_cache_ttl_set(srtest_ctx, 500) == SR_OK);
+	ck_assert(!sr_context_scan(srtest_ctx, drivers, options));
+	ck_assert_msg(skipped == 0, "First scan was skipped.");
+	ck_assert(!sr_context_scan(srtest_ctx, drivers, options));
+	ck_assert_msg(skipped == 1, "Cached probe was not skipped.");
+
+	/* The entry expires, the port gets probed and cached again. */
+	g_usleep(600 * 1000);
+	ck_assert(!sr_context_scan(srtest_ctx, drivers, options));
+	ck_assert_msg(skipped == 1, "Expired probe was skipped.");
+	ck_assert(!sr_context_scan(srtest_ctx, drivers, options));
+	ck_assert(skipped == 2);
+
+	/* Disabling the cache forgets the entries. */
+	ck_assert(sr_context_scan_cache_ttl_set(srtest_ctx, 0) == SR_OK);
+	ck_assert(!sr_context_scan(srtest_ctx, drivers, options));
+	ck_assert(skipped == 2);
+
+	sr_log_callback_set_default();
+	sr_log_loglevel_set(loglevel);
+	g_slist_free(options);
+	g_variant_unref(src.data);
+}
+END_TEST
+
+static void hotplug_cb(struct sr_dev_inst *sdi, enum sr_hotplug_event event,
+		void *cb_data)
+{
+	(void)sdi;
+	(void)event;
+	(void)cb_data;
+}
+
+/* Check whether the hotplug monitor starts and stops. */
+START_TEST(test_hotplug_monitor)
+{
+	int ret;
+
+	ret = sr_hotplug_monitor_start(srtest_ctx, NULL, hotplug_cb, NULL);
+	ck_assert_msg(ret == SR_OK, "Failed to start hotplug monitor.");
+	ret = sr_hotplug_monitor_start(srtest_ctx, NULL, hotplug_cb, NULL);
+	ck_assert_msg(ret == SR_ERR_ARG, "Started hotplug monitor twice.");
+	ret = sr_hotplug_monitor_stop(srtest_ctx);
+	ck_assert_msg(ret == SR_OK, "Failed to stop hotplug monitor.");
+	ck_assert(sr_hotplug_monitor_stop(srtest_ctx) == SR_OK);
+}
+END_TEST
+
 /*
  * Check whether setting a samplerate works.
  *
@@ -70,6 +242,9 @@ Suite *suite_driver_all(void)
 	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
 	tcase_add_test(tc, test_driver_available);
 	tcase_add_test(tc, test_driver_init_all);
+	tcase_add_test(tc, test_context_scan);
+	tcase_add_test(tc, test_context_scan_cache);
+	tcase_add_test(tc, test_hotplug_monitor);
 	// TODO: Currently broken.
 	// tcase_add_test(tc, test_config_get_set_samplerate);
 	suite_add_tcase(s, tc);
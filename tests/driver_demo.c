@@ -0,0 +1,200 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+/* Two bytes per sample, to check the stride of the incremental pattern. */
+#define NUM_LOGIC_CHANNELS 16
+
+struct bench_state {
+	struct sr_session *session;
+	unsigned int headers, ends;
+	uint64_t samples;
+	unsigned int unitsize;
+	/* Value of the previous sample's bytes. */
+	uint8_t last;
+	unsigned int wrong_data;
+};
+
+static void bench_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct bench_state *st;
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *sample;
+	uint64_t i;
+	unsigned int j;
+
+	(void)sdi;
+
+	st = cb_data;
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		st->headers++;
+		break;
+	case SR_DF_END:
+		st->ends++;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		st->unitsize = logic->unitsize;
+		ck_assert(logic->length % logic->unitsize == 0);
+		for (i = 0; i < logic->length; i += logic->unitsize) {
+			sample = (const uint8_t *)logic->data + i;
+			/* All bytes of a sample carry the same count. */
+			for (j = 0; j < logic->unitsize; j++) {
+				if (sample[j] != sample[0])
+					st->wrong_data++;
+			}
+			if (st->samples && sample[0] != (uint8_t)(st->last + 1))
+				st->wrong_data++;
+			st->last = sample[0];
+			st->samples++;
+		}
+		break;
+	case SR_DF_ANALOG:
+		ck_abort_msg("Unexpected analog data.");
+		break;
+	}
+}
+
+static struct sr_dev_inst *bench_open(void)
+{
+	struct sr_dev_driver *driver;
+	struct sr_config opts[2];
+	struct sr_dev_inst *sdi;
+	struct sr_channel_group *cg;
+	GSList *options, *devices, *l;
+
+	driver = srtest_driver_get("demo");
+	ck_assert(driver != NULL);
+	srtest_driver_init(srtest_ctx, driver);
+
+	opts[0].key = SR_CONF_NUM_LOGIC_CHANNELS;
+	opts[0].data = g_variant_ref_sink(g_variant_new_int32(NUM_LOGIC_CHANNELS));
+	opts[1].key = SR_CONF_NUM_ANALOG_CHANNELS;
+	opts[1].data = g_variant_ref_sink(g_variant_new_int32(0));
+	options = g_slist_append(NULL, &opts[0]);
+	options = g_slist_append(options, &opts[1]);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(opts[0].data);
+	g_variant_unref(opts[1].data);
+	ck_assert(g_slist_length(devices) == 1);
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	ck_assert(sr_dev_open(sdi) == SR_OK);
+	for (l = sr_dev_inst_channel_groups_get(sdi); l; l = l->next) {
+		cg = l->data;
+		if (strcmp(cg->name, "Logic"))
+			continue;
+		ck_assert(sr_config_set(sdi, cg, SR_CONF_PATTERN_MODE,
+			g_variant_new_string("incremental")) == SR_OK);
+	}
+	ck_assert(sr_config_set(sdi, NULL, SR_CONF_BENCHMARK,
+		g_variant_new_boolean(TRUE)) == SR_OK);
+
+	return sdi;
+}
+
+static void bench_run(struct sr_dev_inst *sdi, struct bench_state *st)
+{
+	memset(st, 0, sizeof(*st));
+	ck_assert(sr_session_new(srtest_ctx, &st->session) == SR_OK);
+	ck_assert(sr_session_dev_add(st->session, sdi) == SR_OK);
+	ck_assert(sr_session_datafeed_callback_add(st->session,
+		bench_datafeed_in, st) == SR_OK);
+	ck_assert(sr_session_start(st->session) == SR_OK);
+	ck_assert(sr_session_run(st->session) == SR_OK);
+	ck_assert(sr_session_destroy(st->session) == SR_OK);
+
+	ck_assert(st->headers == 1);
+	ck_assert(st->ends == 1);
+	ck_assert(st->unitsize == NUM_LOGIC_CHANNELS / 8);
+	ck_assert(st->wrong_data == 0);
+}
+
+/*
+ * Benchmark mode doesn't pace the data. At 1kHz, paced acquisition of
+ * this many samples would take longer than the test's timeout.
+ */
+START_TEST(test_demo_benchmark_samples)
+{
+	struct sr_dev_inst *sdi;
+	struct bench_state st;
+	GVariant *gvar;
+	uint64_t limit;
+
+	sdi = bench_open();
+	ck_assert(sr_config_get(sr_dev_inst_driver_get(sdi), sdi, NULL,
+		SR_CONF_BENCHMARK, &gvar) == SR_OK);
+	ck_assert(g_variant_get_boolean(gvar));
+	g_variant_unref(gvar);
+
+	/* Not a multiple of the chunk size, nor of the pattern's period. */
+	limit = 3 * 1024 * 1024 + 77;
+	ck_assert(sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_KHZ(1))) == SR_OK);
+	ck_assert(sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(limit)) == SR_OK);
+	bench_run(sdi, &st);
+	ck_assert(st.samples == limit);
+
+	ck_assert(sr_dev_close(sdi) == SR_OK);
+}
+END_TEST
+
+/* The time limit applies to the sample time, not to the wall clock. */
+START_TEST(test_demo_benchmark_msec)
+{
+	struct sr_dev_inst *sdi;
+	struct bench_state st;
+
+	sdi = bench_open();
+	ck_assert(sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_MHZ(1))) == SR_OK);
+	ck_assert(sr_config_set(sdi, NULL, SR_CONF_LIMIT_MSEC,
+		g_variant_new_uint64(1500)) == SR_OK);
+	bench_run(sdi, &st);
+	ck_assert(st.samples == SR_MHZ(1) * 1500 / 1000);
+
+	ck_assert(sr_dev_close(sdi) == SR_OK);
+}
+END_TEST
+
+Suite *suite_driver_demo(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("driver_demo");
+
+	tc = tcase_create("benchmark");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_demo_benchmark_samples);
+	tcase_add_test(tc, test_demo_benchmark_msec);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
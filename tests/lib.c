@@ -20,6 +20,7 @@
 #include <config.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <check.h>
@@ -162,3 +163,156 @@ GArray *srtest_get_enabled_logic_channels(const struct sr_dev_inst *sdi)
 
 	return channels;
 }
+
+void srtest_capture_init(struct srtest_capture *cap)
+{
+	memset(cap, 0, sizeof(*cap));
+	cap->logic = g_byte_array_new();
+	cap->analog = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, (GDestroyNotify)g_array_unref);
+}
+
+void srtest_capture_free(struct srtest_capture *cap)
+{
+	g_byte_array_unref(cap->logic);
+	g_hash_table_destroy(cap->analog);
+	memset(cap, 0, sizeof(*cap));
+}
+
+/* Get the samples which were received for an analog channel, or NULL. */
+GArray *srtest_capture_analog(struct srtest_capture *cap, int index)
+{
+	return g_hash_table_lookup(cap->analog, GINT_TO_POINTER(index));
+}
+
+static void capture_analog(struct srtest_capture *cap,
+	const struct sr_datafeed_analog *analog)
+{
+	struct sr_channel *ch;
+	GArray *samples;
+	float *buf;
+
+	ck_assert(g_slist_length(analog->meaning->channels) == 1);
+	ch = analog->meaning->channels->data;
+	samples = srtest_capture_analog(cap, ch->index);
+	if (!samples) {
+		samples = g_array_new(FALSE, FALSE, sizeof(float));
+		g_hash_table_insert(cap->analog, GINT_TO_POINTER(ch->index),
+			samples);
+	}
+	buf = g_malloc0_n(analog->num_samples + 1, sizeof(float));
+	ck_assert(sr_analog_to_float(analog, buf) == SR_OK);
+	g_array_append_vals(samples, buf, analog->num_samples);
+	g_free(buf);
+}
+
+/*
+ * Datafeed callback which collects the received data. Run-length
+ * encoded logic data gets expanded, and is counted separately.
+ */
+void srtest_capture_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct srtest_capture *cap;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	struct sr_logic_rle_iter iter;
+	const uint8_t *value;
+	uint64_t count;
+
+	(void)sdi;
+
+	cap = cb_data;
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		cap->headers++;
+		break;
+	case SR_DF_END:
+		cap->ends++;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		ck_assert(logic->unitsize > 0);
+		ck_assert(!cap->unitsize || cap->unitsize == logic->unitsize);
+		cap->unitsize = logic->unitsize;
+		g_byte_array_append(cap->logic, logic->data, logic->length);
+		cap->logic_packets++;
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		ck_assert(!cap->unitsize || cap->unitsize == rle->unitsize);
+		cap->unitsize = rle->unitsize;
+		sr_logic_rle_iter_init(&iter, rle);
+		while (sr_logic_rle_iter_next(&iter, &value, &count)) {
+			while (count--)
+				g_byte_array_append(cap->logic, value,
+					rle->unitsize);
+		}
+		cap->rle_packets++;
+		break;
+	case SR_DF_ANALOG:
+		capture_analog(cap, packet->payload);
+		cap->analog_packets++;
+		break;
+	default:
+		return;
+	}
+
+	if (cap->stop_after && cap->session &&
+			cap->logic_packets + cap->analog_packets == cap->stop_after)
+		sr_session_stop(cap->session);
+}
+
+/*
+ * Replay a session file, and collect the data which it delivers.
+ *
+ * Returns the result of sr_session_run().
+ */
+int srtest_capture_session_file(const char *filename,
+	struct srtest_capture *cap)
+{
+	int ret;
+
+	ret = sr_session_load(srtest_ctx, filename, &cap->session);
+	ck_assert_msg(ret == SR_OK, "Failed to load '%s': %d.", filename, ret);
+	ck_assert(sr_session_datafeed_callback_add(cap->session,
+		srtest_capture_datafeed_in, cap) == SR_OK);
+	ck_assert(sr_session_start(cap->session) == SR_OK);
+	ret = sr_session_run(cap->session);
+	ck_assert(sr_session_destroy(cap->session) == SR_OK);
+	cap->session = NULL;
+
+	return ret;
+}
+
+/* Send a packet to an output, append what it produced to 'text'. */
+void srtest_output_send(const struct sr_output *o, int type,
+	const void *payload, GString *text)
+{
+	struct sr_datafeed_packet packet;
+	GString *out;
+
+	memset(&packet, 0, sizeof(packet));
+	packet.type = type;
+	packet.payload = payload;
+	out = NULL;
+	ck_assert(sr_output_send(o, &packet, &out) == SR_OK);
+	if (out && text)
+		g_string_append_len(text, out->str, out->len);
+	if (out)
+		g_string_free(out, TRUE);
+}
+
+/* Get a name for a temporary file which doesn't exist. */
+char *srtest_tmpname(const char *pattern)
+{
+	char *filename;
+	int fd;
+
+	fd = g_file_open_tmp(pattern, &filename, NULL);
+	ck_assert(fd >= 0);
+	close(fd);
+	g_unlink(filename);
+
+	return filename;
+}
@@ -26,6 +26,20 @@
 
 extern struct sr_context *srtest_ctx;
 
+/* Data which a session delivered, see srtest_capture_datafeed_in(). */
+struct srtest_capture {
+	/* Stop the session after this many data packets, 0 runs to the end. */
+	unsigned int stop_after;
+	struct sr_session *session;
+	/* Logic data, RLE packets get expanded. */
+	GByteArray *logic;
+	unsigned int unitsize;
+	/* GArray of float per analog channel index. */
+	GHashTable *analog;
+	unsigned int headers, ends;
+	unsigned int logic_packets, rle_packets, analog_packets;
+};
+
 void srtest_setup(void);
 void srtest_teardown(void);
 
@@ -41,18 +55,34 @@ void srtest_check_samplerate(struct sr_context *sr_ctx, const char *drivername,
 
 GArray *srtest_get_enabled_logic_channels(const struct sr_dev_inst *sdi);
 
+void srtest_capture_init(struct srtest_capture *cap);
+void srtest_capture_free(struct srtest_capture *cap);
+GArray *srtest_capture_analog(struct srtest_capture *cap, int index);
+void srtest_capture_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data);
+int srtest_capture_session_file(const char *filename,
+	struct srtest_capture *cap);
+void srtest_output_send(const struct sr_output *o, int type,
+	const void *payload, GString *text);
+char *srtest_tmpname(const char *pattern);
+
 Suite *suite_core(void);
 Suite *suite_driver_all(void);
+Suite *suite_driver_demo(void);
 Suite *suite_input_all(void);
 Suite *suite_input_binary(void);
 Suite *suite_output_all(void);
+Suite *suite_output_srzip(void);
 Suite *suite_transform_all(void);
 Suite *suite_session(void);
+Suite *suite_session_index(void);
 Suite *suite_strutil(void);
 Suite *suite_version(void);
 Suite *suite_device(void);
 Suite *suite_trigger(void);
 Suite *suite_analog(void);
 Suite *suite_conv(void);
+Suite *suite_logic_rle(void);
+Suite *suite_transpose(void);
 
 #endif
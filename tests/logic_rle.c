@@ -0,0 +1,455 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include <stdio.h>
+#include <string.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+static uint16_t run_values[] = { 0x1234, 0x0000, 0xffff, 0xa5a5, 0x0001 };
+static uint64_t run_lengths[] = { 3, 0, 1000, 1, 17 };
+
+static void init_rle(struct sr_datafeed_logic_rle *rle)
+{
+	rle->num_runs = G_N_ELEMENTS(run_values);
+	rle->unitsize = sizeof(run_values[0]);
+	rle->data = run_values;
+	rle->lengths = run_lengths;
+}
+
+static void expand_reference(uint16_t *buf)
+{
+	unsigned int i;
+	uint64_t j;
+
+	for (i = 0; i < G_N_ELEMENTS(run_values); i++)
+		for (j = 0; j < run_lengths[i]; j++)
+			*buf++ = run_values[i];
+}
+
+START_TEST(test_logic_rle_num_samples)
+{
+	struct sr_datafeed_logic_rle rle;
+
+	init_rle(&rle);
+	ck_assert(sr_logic_rle_num_samples(&rle) == 1021);
+
+	rle.num_runs = 0;
+	ck_assert(sr_logic_rle_num_samples(&rle) == 0);
+}
+END_TEST
+
+START_TEST(test_logic_rle_iter)
+{
+	struct sr_datafeed_logic_rle rle;
+	struct sr_logic_rle_iter iter;
+	const uint8_t *value;
+	uint64_t count;
+	uint16_t v;
+	unsigned int i;
+
+	init_rle(&rle);
+	sr_logic_rle_iter_init(&iter, &rle);
+	for (i = 0; i < G_N_ELEMENTS(run_values); i++) {
+		/* Empty runs are skipped. */
+		if (!run_lengths[i])
+			continue;
+		ck_assert(sr_logic_rle_iter_next(&iter, &value, &count));
+		memcpy(&v, value, sizeof(v));
+		ck_assert(v == run_values[i]);
+		ck_assert(count == run_lengths[i]);
+	}
+	ck_assert(!sr_logic_rle_iter_next(&iter, &value, &count));
+}
+END_TEST
+
+START_TEST(test_logic_rle_expand)
+{
+	struct sr_datafeed_logic_rle rle;
+	struct sr_logic_rle_iter iter;
+	uint16_t ref[1021], buf[1021 + 1];
+	uint64_t count, total, chunk;
+
+	init_rle(&rle);
+	expand_reference(ref);
+
+	/* Expand in chunks of all sizes, including partial runs. */
+	for (chunk = 1; chunk <= G_N_ELEMENTS(buf); chunk++) {
+		sr_logic_rle_iter_init(&iter, &rle);
+		memset(buf, 0, sizeof(buf));
+		total = 0;
+		while ((count = sr_logic_rle_expand(&iter, (uint8_t *)&buf[total],
+				MIN(chunk, G_N_ELEMENTS(buf) - total)))) {
+			ck_assert(count <= chunk);
+			total += count;
+		}
+		ck_assert(total == G_N_ELEMENTS(ref));
+		ck_assert(memcmp(buf, ref, sizeof(ref)) == 0);
+		ck_assert(buf[G_N_ELEMENTS(ref)] == 0);
+	}
+}
+END_TEST
+
+/*
+ * Runs as a driver would submit them to the feed queue. Runs with equal
+ * values get merged, the expanded data matches run_values/run_lengths.
+ */
+static const struct {
+	uint16_t value;
+	size_t count;
+} submits[] = {
+	{ 0x1234, 2 }, { 0x1234, 1 }, { 0xffff, 600 }, { 0xffff, 0 },
+	{ 0xffff, 400 }, { 0xa5a5, 1 }, { 0x0001, 10 }, { 0x0001, 7 },
+};
+
+/* Number of runs after merging. */
+#define MERGED_RUNS 4
+
+static struct sr_dev_inst *create_sdi_channels(int num_channels)
+{
+	struct sr_dev_inst *sdi;
+	char name[8];
+	int i;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	ck_assert(sdi != NULL);
+	for (i = 0; i < num_channels; i++) {
+		snprintf(name, sizeof(name), "D%d", i);
+		ck_assert(sr_dev_inst_channel_add(sdi, i,
+			SR_CHANNEL_LOGIC, name) == SR_OK);
+	}
+
+	return sdi;
+}
+
+static struct sr_dev_inst *create_sdi(void)
+{
+	return create_sdi_channels(16);
+}
+
+static void submit_runs(const struct sr_dev_inst *sdi)
+{
+	struct feed_queue_logic *q;
+	unsigned int i;
+
+	q = feed_queue_logic_alloc(sdi, 16, sizeof(run_values[0]));
+	ck_assert(q != NULL);
+	ck_assert(feed_queue_logic_rle_set(q, TRUE) == SR_OK);
+	for (i = 0; i < G_N_ELEMENTS(submits); i++)
+		ck_assert(feed_queue_logic_submit_one(q,
+			(const uint8_t *)&submits[i].value,
+			submits[i].count) == SR_OK);
+	ck_assert(feed_queue_logic_flush(q) == SR_OK);
+	feed_queue_logic_free(q);
+}
+
+static void count_runs(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic_rle *rle;
+	uint64_t *runs;
+
+	(void)sdi;
+
+	ck_assert(packet->type != SR_DF_LOGIC);
+	if (packet->type != SR_DF_LOGIC_RLE)
+		return;
+	rle = packet->payload;
+	runs = cb_data;
+	*runs += rle->num_runs;
+}
+
+static void check_capture(const struct srtest_capture *cap,
+	const uint16_t *ref, size_t count)
+{
+	ck_assert(cap->unitsize == sizeof(ref[0]));
+	ck_assert(cap->logic->len == count * sizeof(ref[0]));
+	ck_assert(memcmp(cap->logic->data, ref, cap->logic->len) == 0);
+}
+
+/*
+ * RLE callbacks receive the runs as submitted to the feed queue, legacy
+ * callbacks receive the same samples as SR_DF_LOGIC.
+ */
+START_TEST(test_logic_rle_session)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct srtest_capture cap_logic, cap_rle;
+	uint16_t ref[1021];
+	uint64_t runs;
+
+	expand_reference(ref);
+	sdi = create_sdi();
+	ck_assert(sr_session_new(srtest_ctx, &session) == SR_OK);
+	ck_assert(sr_session_dev_add(session, sdi) == SR_OK);
+	srtest_capture_init(&cap_logic);
+	srtest_capture_init(&cap_rle);
+	runs = 0;
+	ck_assert(sr_session_datafeed_callback_add(session,
+		srtest_capture_datafeed_in, &cap_logic) == SR_OK);
+	ck_assert(sr_session_datafeed_callback_add_rle(session,
+		srtest_capture_datafeed_in, &cap_rle) == SR_OK);
+	ck_assert(sr_session_datafeed_callback_add_rle(session,
+		count_runs, &runs) == SR_OK);
+
+	submit_runs(sdi);
+
+	ck_assert(cap_logic.rle_packets == 0);
+	ck_assert(cap_logic.logic_packets > 0);
+	check_capture(&cap_logic, ref, G_N_ELEMENTS(ref));
+	ck_assert(cap_rle.logic_packets == 0);
+	ck_assert(cap_rle.rle_packets == 1);
+	check_capture(&cap_rle, ref, G_N_ELEMENTS(ref));
+	ck_assert(runs == MERGED_RUNS);
+
+	ck_assert(sr_session_destroy(session) == SR_OK);
+	srtest_capture_free(&cap_logic);
+	srtest_capture_free(&cap_rle);
+}
+END_TEST
+
+/*
+ * Repeated samples get expanded by the feed queue, for all unit sizes
+ * and across the boundaries of its buffer.
+ */
+START_TEST(test_logic_rle_feed_queue_fill)
+{
+	static const size_t counts[] = { 1, 2, 3, 7, 100, 1, 513 };
+	static const size_t unitsizes[] = { 1, 2, 3, 4, 5, 8 };
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct feed_queue_logic *q;
+	struct srtest_capture cap;
+	GByteArray *ref;
+	uint8_t value[8];
+	size_t unitsize, i, j, k;
+
+	for (i = 0; i < G_N_ELEMENTS(unitsizes); i++) {
+		unitsize = unitsizes[i];
+		sdi = create_sdi_channels(unitsize * 8);
+		ck_assert(sr_session_new(srtest_ctx, &session) == SR_OK);
+		ck_assert(sr_session_dev_add(session, sdi) == SR_OK);
+		srtest_capture_init(&cap);
+		ck_assert(sr_session_datafeed_callback_add(session,
+			srtest_capture_datafeed_in, &cap) == SR_OK);
+
+		ref = g_byte_array_new();
+		q = feed_queue_logic_alloc(sdi, 64, unitsize);
+		ck_assert(q != NULL);
+		for (j = 0; j < G_N_ELEMENTS(counts); j++) {
+			for (k = 0; k < unitsize; k++)
+				value[k] = 0x11 * (j + 1) + k;
+			ck_assert(feed_queue_logic_submit_one(q, value,
+				counts[j]) == SR_OK);
+			for (k = 0; k < counts[j]; k++)
+				g_byte_array_append(ref, value, unitsize);
+		}
+		ck_assert(feed_queue_logic_flush(q) == SR_OK);
+		feed_queue_logic_free(q);
+
+		ck_assert(cap.unitsize == unitsize);
+		ck_assert(cap.logic->len == ref->len);
+		ck_assert(memcmp(cap.logic->data, ref->data, ref->len) == 0);
+
+		g_byte_array_unref(ref);
+		ck_assert(sr_session_destroy(session) == SR_OK);
+		srtest_capture_free(&cap);
+	}
+}
+END_TEST
+
+/* Transforms only see expanded data, and so do all callbacks after them. */
+START_TEST(test_logic_rle_transform)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	const struct sr_transform *t;
+	struct srtest_capture cap_logic, cap_rle;
+	uint16_t ref[1021];
+	unsigned int i;
+
+	expand_reference(ref);
+	for (i = 0; i < G_N_ELEMENTS(ref); i++)
+		ref[i] = ~ref[i];
+	sdi = create_sdi();
+	ck_assert(sr_session_new(srtest_ctx, &session) == SR_OK);
+	ck_assert(sr_session_dev_add(session, sdi) == SR_OK);
+	t = sr_transform_new(sr_transform_find("invert"), NULL, sdi);
+	ck_assert(t != NULL);
+	srtest_capture_init(&cap_logic);
+	srtest_capture_init(&cap_rle);
+	ck_assert(sr_session_datafeed_callback_add(session,
+		srtest_capture_datafeed_in, &cap_logic) == SR_OK);
+	ck_assert(sr_session_datafeed_callback_add_rle(session,
+		srtest_capture_datafeed_in, &cap_rle) == SR_OK);
+
+	submit_runs(sdi);
+
+	ck_assert(cap_logic.rle_packets == 0);
+	check_capture(&cap_logic, ref, G_N_ELEMENTS(ref));
+	ck_assert(cap_rle.rle_packets == 0);
+	ck_assert(cap_rle.logic_packets == cap_logic.logic_packets);
+	check_capture(&cap_rle, ref, G_N_ELEMENTS(ref));
+
+	ck_assert(sr_session_destroy(session) == SR_OK);
+	sr_transform_free(t);
+	srtest_capture_free(&cap_logic);
+	srtest_capture_free(&cap_rle);
+}
+END_TEST
+
+/* Output modules without RLE support receive the expanded samples. */
+START_TEST(test_logic_rle_output_expand)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_logic_rle rle;
+	GString *text;
+	uint16_t ref[1021];
+
+	expand_reference(ref);
+	init_rle(&rle);
+	sdi = create_sdi();
+	o = sr_output_new(sr_output_find("binary"), NULL, sdi, NULL);
+	ck_assert(o != NULL);
+	text = g_string_new(NULL);
+	srtest_output_send(o, SR_DF_LOGIC_RLE, &rle, text);
+	srtest_output_send(o, SR_DF_LOGIC_RLE, &rle, text);
+	ck_assert(text->len == 2 * sizeof(ref));
+	ck_assert(memcmp(text->str, ref, sizeof(ref)) == 0);
+	ck_assert(memcmp(text->str + sizeof(ref), ref, sizeof(ref)) == 0);
+	g_string_free(text, TRUE);
+	ck_assert(sr_output_free(o) == SR_OK);
+}
+END_TEST
+
+/* Write the runs twice, either as RLE or as the expanded samples. */
+static void output_write(const struct sr_output *o, gboolean use_rle,
+	GString *text)
+{
+	struct sr_datafeed_logic_rle rle;
+	struct sr_datafeed_logic logic;
+	uint16_t ref[1021];
+	int i;
+
+	init_rle(&rle);
+	expand_reference(ref);
+	logic.length = sizeof(ref);
+	logic.unitsize = sizeof(ref[0]);
+	logic.data = ref;
+	for (i = 0; i < 2; i++) {
+		if (use_rle)
+			srtest_output_send(o, SR_DF_LOGIC_RLE, &rle, text);
+		else
+			srtest_output_send(o, SR_DF_LOGIC, &logic, text);
+	}
+	srtest_output_send(o, SR_DF_END, NULL, text);
+}
+
+/* The VCD output's native RLE support writes the same value changes. */
+START_TEST(test_logic_rle_output_vcd)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	GString *text[2];
+	const char *body[2];
+	int i;
+
+	sdi = create_sdi();
+	for (i = 0; i < 2; i++) {
+		o = sr_output_new(sr_output_find("vcd"), NULL, sdi, NULL);
+		ck_assert(o != NULL);
+		text[i] = g_string_new(NULL);
+		output_write(o, i == 0, text[i]);
+		ck_assert(sr_output_free(o) == SR_OK);
+
+		/* The header has a timestamp. */
+		body[i] = strstr(text[i]->str, "$enddefinitions $end");
+		ck_assert(body[i] != NULL);
+	}
+	ck_assert(strchr(body[0], '#') != NULL);
+	ck_assert_str_eq(body[0], body[1]);
+	g_string_free(text[0], TRUE);
+	g_string_free(text[1], TRUE);
+}
+END_TEST
+
+/* Session files written from RLE data read back as the expanded samples. */
+START_TEST(test_logic_rle_output_srzip)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct srtest_capture cap[2];
+	uint16_t ref[2 * 1021];
+	char *filename;
+	int i;
+
+	expand_reference(ref);
+	expand_reference(ref + 1021);
+	sdi = create_sdi();
+	for (i = 0; i < 2; i++) {
+		filename = srtest_tmpname("sigrok-rle-XXXXXX.sr");
+		o = sr_output_new(sr_output_find("srzip"), NULL, sdi, filename);
+		ck_assert(o != NULL);
+		output_write(o, i == 0, NULL);
+		ck_assert(sr_output_free(o) == SR_OK);
+
+		srtest_capture_init(&cap[i]);
+		ck_assert(srtest_capture_session_file(filename,
+			&cap[i]) == SR_OK);
+		check_capture(&cap[i], ref, G_N_ELEMENTS(ref));
+		ck_assert(cap[i].headers == 1 && cap[i].ends == 1);
+		g_unlink(filename);
+		g_free(filename);
+	}
+	srtest_capture_free(&cap[0]);
+	srtest_capture_free(&cap[1]);
+}
+END_TEST
+
+Suite *suite_logic_rle(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("logic_rle");
+
+	tc = tcase_create("helpers");
+	tcase_add_test(tc, test_logic_rle_num_samples);
+	tcase_add_test(tc, test_logic_rle_iter);
+	tcase_add_test(tc, test_logic_rle_expand);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("datafeed");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_logic_rle_session);
+	tcase_add_test(tc, test_logic_rle_feed_queue_fill);
+	tcase_add_test(tc, test_logic_rle_transform);
+	tcase_add_test(tc, test_logic_rle_output_expand);
+	tcase_add_test(tc, test_logic_rle_output_vcd);
+	tcase_add_test(tc, test_logic_rle_output_srzip);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -35,17 +35,22 @@ int main(void)
 	/* Add all testsuites to the master suite. */
 	srunner_add_suite(srunner, suite_core());
 	srunner_add_suite(srunner, suite_driver_all());
+	srunner_add_suite(srunner, suite_driver_demo());
 	srunner_add_suite(srunner, suite_input_all());
 	srunner_add_suite(srunner, suite_input_binary());
 	srunner_add_suite(srunner, suite_output_all());
+	srunner_add_suite(srunner, suite_output_srzip());
 	srunner_add_suite(srunner, suite_transform_all());
 	srunner_add_suite(srunner, suite_session());
+	srunner_add_suite(srunner, suite_session_index());
 	srunner_add_suite(srunner, suite_strutil());
 	srunner_add_suite(srunner, suite_version());
 	srunner_add_suite(srunner, suite_device());
 	srunner_add_suite(srunner, suite_trigger());
 	srunner_add_suite(srunner, suite_analog());
 	srunner_add_suite(srunner, suite_conv());
+	srunner_add_suite(srunner, suite_logic_rle());
+	srunner_add_suite(srunner, suite_transpose());
 
 	srunner_run_all(srunner, CK_VERBOSE);
 	ret = srunner_ntests_failed(srunner);
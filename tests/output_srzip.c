@@ -0,0 +1,483 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <zip.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+/* 8 logic channels and an analog one, the analog one is channel 9. */
+#define NUM_LOGIC_CHANNELS 8
+#define ANALOG_CHANNEL 8
+
+/* The srzip output writes members of this size. */
+#define MEMBER_SIZE (4 * 1024 * 1024)
+
+/* Enough samples for three logic members and two analog ones. */
+#define LOGIC_SAMPLES (2 * MEMBER_SIZE + 1234)
+#define ANALOG_SAMPLES (MEMBER_SIZE / sizeof(float) + 4321)
+#define LOGIC_MEMBERS 3
+#define ANALOG_MEMBERS 2
+#define PACKET_SAMPLES 100000
+
+static char *filename;
+
+static uint8_t logic_value(uint64_t sample)
+{
+	return (sample * 7) ^ (sample >> 11);
+}
+
+static float analog_value(uint64_t sample)
+{
+	return (float)(sample % 1000) * 0.25f - 100;
+}
+
+static void setup(void)
+{
+	srtest_setup();
+	filename = srtest_tmpname("sr-test-XXXXXX.sr");
+}
+
+static void teardown(void)
+{
+	g_unlink(filename);
+	g_free(filename);
+	filename = NULL;
+	srtest_teardown();
+}
+
+static GHashTable *options_new(void)
+{
+	return g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+}
+
+static void options_set(GHashTable *options, const char *key, GVariant *value)
+{
+	g_hash_table_insert(options, (char *)key, g_variant_ref_sink(value));
+}
+
+static const struct sr_output *output_new(GHashTable *options,
+	struct sr_dev_inst **sdi_out)
+{
+	struct sr_dev_inst *sdi;
+	int c;
+
+	*sdi_out = sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (c = 0; c < NUM_LOGIC_CHANNELS; c++)
+		sr_dev_inst_channel_add(sdi, c, SR_CHANNEL_LOGIC, "D");
+	sr_dev_inst_channel_add(sdi, ANALOG_CHANNEL, SR_CHANNEL_ANALOG, "A0");
+
+	return sr_output_new(sr_output_find("srzip"), options, sdi, filename);
+}
+
+/*
+ * Write the test data through the srzip output, logic and analog
+ * packets interleaved. Without 'end' the output gets freed while
+ * the session is still running.
+ */
+static void write_file(GHashTable *options, gboolean end)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_meta meta;
+	struct sr_config src;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	uint8_t *lbuf;
+	float *fbuf;
+	uint64_t lpos, apos, i;
+
+	o = output_new(options, &sdi);
+	ck_assert(o != NULL);
+
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_ref_sink(g_variant_new_uint64(SR_MHZ(1)));
+	meta.config = g_slist_append(NULL, &src);
+	srtest_output_send(o, SR_DF_META, &meta, NULL);
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+
+	memset(&analog, 0, sizeof(analog));
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	encoding.unitsize = sizeof(float);
+	encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	encoding.is_bigendian = TRUE;
+#endif
+	encoding.scale.p = encoding.scale.q = 1;
+	encoding.offset.q = 1;
+	meaning.channels = g_slist_append(NULL, g_slist_nth_data(
+		sr_dev_inst_channels_get(sdi), ANALOG_CHANNEL));
+
+	lbuf = g_malloc(PACKET_SAMPLES);
+	fbuf = g_malloc(PACKET_SAMPLES * sizeof(*fbuf));
+	logic.unitsize = 1;
+	logic.data = lbuf;
+	analog.data = fbuf;
+	lpos = apos = 0;
+	while (lpos < LOGIC_SAMPLES || apos < ANALOG_SAMPLES) {
+		if (lpos < LOGIC_SAMPLES) {
+			logic.length = MIN(PACKET_SAMPLES, LOGIC_SAMPLES - lpos);
+			for (i = 0; i < logic.length; i++)
+				lbuf[i] = logic_value(lpos + i);
+			srtest_output_send(o, SR_DF_LOGIC, &logic, NULL);
+			lpos += logic.length;
+		}
+		if (apos < ANALOG_SAMPLES) {
+			analog.num_samples = MIN(PACKET_SAMPLES,
+				ANALOG_SAMPLES - apos);
+			for (i = 0; i < analog.num_samples; i++)
+				fbuf[i] = analog_value(apos + i);
+			srtest_output_send(o, SR_DF_ANALOG, &analog, NULL);
+			apos += analog.num_samples;
+		}
+	}
+	g_free(lbuf);
+	g_free(fbuf);
+	g_slist_free(meaning.channels);
+
+	if (end)
+		srtest_output_send(o, SR_DF_END, NULL, NULL);
+	ck_assert(sr_output_free(o) == SR_OK);
+}
+
+/*
+ * Check that the chunks are complete, and numbered in the order of
+ * the archive. Data members must use the compression method 'method'.
+ */
+static void check_members(int method)
+{
+	struct zip *archive;
+	struct zip_stat zs;
+	zip_int64_t i, count;
+	unsigned int logic_num, analog_num, channel, num;
+	gboolean version, metadata;
+
+	archive = zip_open(filename, 0, NULL);
+	ck_assert(archive != NULL);
+	count = zip_get_num_entries(archive, 0);
+
+	version = metadata = FALSE;
+	logic_num = analog_num = 0;
+	for (i = 0; i < count; i++) {
+		ck_assert(zip_stat_index(archive, i, 0, &zs) == 0);
+		if (!strcmp(zs.name, "version")) {
+			version = TRUE;
+			continue;
+		}
+		if (!strcmp(zs.name, "metadata")) {
+			metadata = TRUE;
+			continue;
+		}
+		if (sscanf(zs.name, "logic-1-%u", &num) == 1) {
+			ck_assert_msg(num == logic_num + 1,
+				"Member %s out of order.", zs.name);
+			logic_num = num;
+		} else if (sscanf(zs.name, "analog-1-%u-%u",
+				&channel, &num) == 2) {
+			ck_assert(channel == ANALOG_CHANNEL + 1);
+			ck_assert_msg(num == analog_num + 1,
+				"Member %s out of order.", zs.name);
+			analog_num = num;
+		} else {
+			ck_abort_msg("Unexpected member %s.", zs.name);
+		}
+		ck_assert_msg(zs.comp_method == method,
+			"Member %s uses method %d.", zs.name, zs.comp_method);
+	}
+	ck_assert(version && metadata);
+	ck_assert_msg(logic_num == LOGIC_MEMBERS,
+		"%u logic members, not %d.", logic_num, LOGIC_MEMBERS);
+	ck_assert_msg(analog_num == ANALOG_MEMBERS,
+		"%u analog members, not %d.", analog_num, ANALOG_MEMBERS);
+
+	zip_discard(archive);
+}
+
+/* Sum up the compressed and the uncompressed sizes of data members. */
+static void data_sizes(uint64_t *comp_size, uint64_t *size)
+{
+	struct zip *archive;
+	struct zip_stat zs;
+	zip_int64_t i, count;
+
+	archive = zip_open(filename, 0, NULL);
+	ck_assert(archive != NULL);
+	count = zip_get_num_entries(archive, 0);
+	*comp_size = *size = 0;
+	for (i = 0; i < count; i++) {
+		ck_assert(zip_stat_index(archive, i, 0, &zs) == 0);
+		if (!strcmp(zs.name, "version") || !strcmp(zs.name, "metadata"))
+			continue;
+		*comp_size += zs.comp_size;
+		*size += zs.size;
+	}
+	zip_discard(archive);
+}
+
+/* Replay the file in a session, and compare all of the data. */
+static void check_session_load(void)
+{
+	struct srtest_capture cap;
+	GArray *samples;
+	uint64_t i;
+
+	srtest_capture_init(&cap);
+	ck_assert(srtest_capture_session_file(filename, &cap) == SR_OK);
+	ck_assert(cap.headers == 1);
+	ck_assert(cap.ends == 1);
+
+	ck_assert(cap.unitsize == 1);
+	ck_assert_msg(cap.logic->len == LOGIC_SAMPLES,
+		"Got %u logic samples, not %d.", cap.logic->len, LOGIC_SAMPLES);
+	for (i = 0; i < LOGIC_SAMPLES; i++) {
+		if (cap.logic->data[i] != logic_value(i))
+			ck_abort_msg("Logic sample %" PRIu64 " differs.", i);
+	}
+
+	samples = srtest_capture_analog(&cap, ANALOG_CHANNEL);
+	ck_assert(samples != NULL);
+	ck_assert(samples->len == ANALOG_SAMPLES);
+	for (i = 0; i < ANALOG_SAMPLES; i++) {
+		if (g_array_index(samples, float, i) != analog_value(i))
+			ck_abort_msg("Analog sample %" PRIu64 " differs.", i);
+	}
+
+	srtest_capture_free(&cap);
+}
+
+/* Read the file through an index, across member boundaries. */
+static void check_index(void)
+{
+	struct sr_session_index *index;
+	uint8_t lbuf[200];
+	float fbuf[200];
+	uint64_t samples, start, i;
+
+	ck_assert(sr_session_index_open(filename, FALSE, &index) == SR_OK);
+	ck_assert(sr_session_index_get_samples(index, 0, &samples) == SR_OK);
+	ck_assert(samples == LOGIC_SAMPLES);
+	ck_assert(sr_session_index_get_samples(index, ANALOG_CHANNEL,
+		&samples) == SR_OK);
+	ck_assert(samples == ANALOG_SAMPLES);
+
+	start = 2 * MEMBER_SIZE - 100;
+	ck_assert(sr_session_index_read_logic(index, start, ARRAY_SIZE(lbuf),
+		lbuf, &samples) == SR_OK);
+	ck_assert(samples == ARRAY_SIZE(lbuf));
+	for (i = 0; i < samples; i++)
+		ck_assert(lbuf[i] == logic_value(start + i));
+
+	start = MEMBER_SIZE / sizeof(float) - 100;
+	ck_assert(sr_session_index_read_analog(index, ANALOG_CHANNEL, start,
+		ARRAY_SIZE(fbuf), fbuf, &samples) == SR_OK);
+	ck_assert(samples == ARRAY_SIZE(fbuf));
+	for (i = 0; i < samples; i++)
+		ck_assert(fbuf[i] == analog_value(start + i));
+
+	ck_assert(sr_session_index_close(index) == SR_OK);
+}
+
+/* The streaming writer's archive reads back, metadata comes last. */
+START_TEST(test_srzip_streaming)
+{
+	GHashTable *options;
+	struct zip *archive;
+	zip_int64_t count;
+
+	options = options_new();
+	options_set(options, "streaming", g_variant_new_boolean(TRUE));
+	write_file(options, TRUE);
+	g_hash_table_destroy(options);
+
+	check_members(ZIP_CM_DEFLATE);
+	archive = zip_open(filename, 0, NULL);
+	ck_assert(archive != NULL);
+	count = zip_get_num_entries(archive, 0);
+	ck_assert(!strcmp(zip_get_name(archive, 0, 0), "version"));
+	ck_assert(!strcmp(zip_get_name(archive, count - 1, 0), "metadata"));
+	zip_discard(archive);
+
+	check_session_load();
+	check_index();
+}
+END_TEST
+
+/* The same data written by libzip, one archive update per member. */
+START_TEST(test_srzip_libzip)
+{
+	GHashTable *options;
+
+	options = options_new();
+	options_set(options, "streaming", g_variant_new_boolean(FALSE));
+	write_file(options, TRUE);
+	g_hash_table_destroy(options);
+
+	check_members(ZIP_CM_DEFLATE);
+	check_session_load();
+	check_index();
+}
+END_TEST
+
+/* Freeing a streaming output without SR_DF_END keeps the data. */
+START_TEST(test_srzip_streaming_cleanup)
+{
+	GHashTable *options;
+
+	options = options_new();
+	options_set(options, "streaming", g_variant_new_boolean(TRUE));
+	write_file(options, FALSE);
+	g_hash_table_destroy(options);
+
+	check_members(ZIP_CM_DEFLATE);
+	check_session_load();
+}
+END_TEST
+
+/* Worker threads compress the members, which keep their order. */
+START_TEST(test_srzip_threads)
+{
+	GHashTable *options;
+
+	options = options_new();
+	options_set(options, "streaming", g_variant_new_boolean(TRUE));
+	options_set(options, "threads", g_variant_new_uint32(4));
+	write_file(options, TRUE);
+	g_hash_table_destroy(options);
+
+	check_members(ZIP_CM_DEFLATE);
+	check_session_load();
+	check_index();
+}
+END_TEST
+
+/* Stored members, written by worker threads and by libzip. */
+START_TEST(test_srzip_store)
+{
+	GHashTable *options;
+	uint64_t comp_size, size;
+	int streaming;
+
+	for (streaming = 0; streaming <= 1; streaming++) {
+		options = options_new();
+		options_set(options, "streaming",
+			g_variant_new_boolean(streaming));
+		options_set(options, "compression",
+			g_variant_new_string("store"));
+		options_set(options, "threads", g_variant_new_uint32(4));
+		write_file(options, TRUE);
+		g_hash_table_destroy(options);
+
+		check_members(ZIP_CM_STORE);
+		data_sizes(&comp_size, &size);
+		ck_assert(size == LOGIC_SAMPLES + ANALOG_SAMPLES * sizeof(float));
+		ck_assert(comp_size == size);
+		check_session_load();
+		check_index();
+		g_unlink(filename);
+	}
+}
+END_TEST
+
+/* The deflate level gets applied, in both writers. */
+START_TEST(test_srzip_level)
+{
+	static const uint32_t levels[] = { 1, 9 };
+
+	GHashTable *options;
+	uint64_t comp_size[2], size;
+	int streaming, i;
+
+	for (streaming = 0; streaming <= 1; streaming++) {
+		for (i = 0; i < 2; i++) {
+			options = options_new();
+			options_set(options, "streaming",
+				g_variant_new_boolean(streaming));
+			options_set(options, "level",
+				g_variant_new_uint32(levels[i]));
+			write_file(options, TRUE);
+			g_hash_table_destroy(options);
+			check_members(ZIP_CM_DEFLATE);
+			data_sizes(&comp_size[i], &size);
+			g_unlink(filename);
+		}
+		ck_assert_msg(comp_size[1] < comp_size[0],
+			"Level 9 gave %" PRIu64 " bytes, level 1 %" PRIu64 ".",
+			comp_size[1], comp_size[0]);
+	}
+}
+END_TEST
+
+START_TEST(test_srzip_bogus_options)
+{
+	GHashTable *options;
+	struct sr_dev_inst *sdi;
+
+	options = options_new();
+	options_set(options, "level", g_variant_new_uint32(0));
+	ck_assert(output_new(options, &sdi) == NULL);
+	options_set(options, "level", g_variant_new_uint32(10));
+	ck_assert(output_new(options, &sdi) == NULL);
+	options_set(options, "level", g_variant_new_uint32(9));
+	options_set(options, "compression", g_variant_new_string("bzip2"));
+	ck_assert(output_new(options, &sdi) == NULL);
+	g_hash_table_destroy(options);
+}
+END_TEST
+
+Suite *suite_output_srzip(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("output-srzip");
+
+	tc = tcase_create("roundtrip");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_set_timeout(tc, 30);
+	tcase_add_test(tc, test_srzip_streaming);
+	tcase_add_test(tc, test_srzip_libzip);
+	tcase_add_test(tc, test_srzip_streaming_cleanup);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("compression");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_set_timeout(tc, 60);
+	tcase_add_test(tc, test_srzip_threads);
+	tcase_add_test(tc, test_srzip_store);
+	tcase_add_test(tc, test_srzip_level);
+	tcase_add_test(tc, test_srzip_bogus_options);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -19,9 +19,11 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
+#include "libsigrok-internal.h"
 
 /*
  * Check whether sr_session_new() works.
@@ -185,6 +187,743 @@ START_TEST(test_session_trigger_get_null)
 }
 END_TEST
 
+/*
+ * Check whether sr_session_stats_get() reports zeroed counters for all
+ * packet types of a fresh session.
+ */
+START_TEST(test_session_stats_get)
+{
+	int ret;
+	unsigned int num_types;
+	struct sr_session *sess;
+	struct sr_session_stats *stats;
+	struct sr_session_stats_packets *sp;
+	GSList *l;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_stats_get(sess, &stats);
+	ck_assert_msg(ret == SR_OK, "sr_session_stats_get() failed: %d.", ret);
+
+	num_types = 0;
+	for (l = stats->packets; l; l = l->next) {
+		sp = l->data;
+		ck_assert(sp->type == SR_DF_HEADER + num_types);
+		ck_assert(sp->packets == 0);
+		ck_assert(sp->bytes == 0);
+		ck_assert(sp->samples == 0);
+		num_types++;
+	}
+	ck_assert(num_types == SR_DF_LOGIC_RLE - SR_DF_HEADER + 1);
+	ck_assert(stats->transforms == NULL);
+	ck_assert(stats->callbacks == NULL);
+
+	sr_session_stats_free(stats);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+static unsigned int stats_callback_calls;
+
+static void stats_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+	(void)packet;
+	(void)cb_data;
+
+	stats_callback_calls++;
+}
+
+/* Send a header, logic data and an end packet via the binary input. */
+static void session_send_binary(struct sr_session *sess, gsize len)
+{
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	GString *buf;
+
+	imod = sr_input_find("binary");
+	ck_assert(imod != NULL);
+	in = sr_input_new(imod, NULL);
+	ck_assert(in != NULL);
+	ck_assert(sr_session_dev_add(sess, sr_input_dev_inst_get(in)) == SR_OK);
+
+	buf = g_string_new(NULL);
+	g_string_set_size(buf, len);
+	memset(buf->str, 0x55, len);
+	ck_assert(sr_input_send(in, buf) == SR_OK);
+	ck_assert(sr_input_end(in) == SR_OK);
+	g_string_free(buf, TRUE);
+	sr_input_free(in);
+}
+
+static const struct sr_session_stats_packets *stats_packets_find(
+	const struct sr_session_stats *stats, int type)
+{
+	const struct sr_session_stats_packets *sp;
+	GSList *l;
+
+	for (l = stats->packets; l; l = l->next) {
+		sp = l->data;
+		if (sp->type == type)
+			return sp;
+	}
+	ck_abort_msg("No statistics for packet type %d.", type);
+
+	return NULL;
+}
+
+/*
+ * Check the counters after packets were sent, and that nothing gets
+ * counted while statistics are disabled.
+ */
+START_TEST(test_session_stats_count)
+{
+	struct sr_session *sess;
+	struct sr_session_stats *stats;
+	const struct sr_session_stats_packets *sp;
+	const struct sr_session_stats_timing *st;
+
+	sr_session_new(srtest_ctx, &sess);
+	sr_session_datafeed_callback_add(sess, stats_datafeed_in, NULL);
+	stats_callback_calls = 0;
+
+	/* Disabled by default. */
+	session_send_binary(sess, 100);
+	ck_assert(stats_callback_calls == 3);
+	ck_assert(sr_session_stats_get(sess, &stats) == SR_OK);
+	ck_assert(stats_packets_find(stats, SR_DF_LOGIC)->packets == 0);
+	sr_session_stats_free(stats);
+
+	ck_assert(sr_session_stats_enable(sess, TRUE) == SR_OK);
+	session_send_binary(sess, 1000);
+	session_send_binary(sess, 24);
+	ck_assert(sr_session_stats_get(sess, &stats) == SR_OK);
+	sp = stats_packets_find(stats, SR_DF_HEADER);
+	ck_assert(sp->packets == 2);
+	sp = stats_packets_find(stats, SR_DF_END);
+	ck_assert(sp->packets == 2);
+	sp = stats_packets_find(stats, SR_DF_LOGIC);
+	ck_assert(sp->packets == 2);
+	ck_assert(sp->bytes == 1024);
+	ck_assert(sp->samples == 1024);
+	ck_assert(g_slist_length(stats->callbacks) == 1);
+	st = stats->callbacks->data;
+	ck_assert(st->calls == 6);
+	ck_assert(st->max_us <= st->total_us);
+	sr_session_stats_free(stats);
+
+	ck_assert(sr_session_stats_reset(sess) == SR_OK);
+	ck_assert(sr_session_stats_enable(sess, FALSE) == SR_OK);
+	session_send_binary(sess, 100);
+	ck_assert(sr_session_stats_get(sess, &stats) == SR_OK);
+	ck_assert(stats_packets_find(stats, SR_DF_LOGIC)->packets == 0);
+	st = stats->callbacks->data;
+	ck_assert(st->calls == 0);
+	sr_session_stats_free(stats);
+
+	ck_assert(sr_session_stats_enable(NULL, TRUE) == SR_ERR_ARG);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+START_TEST(test_session_stats_get_bogus)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_session_stats *stats;
+
+	/* NULL session, must not segfault. */
+	ret = sr_session_stats_get(NULL, &stats);
+	ck_assert(ret == SR_ERR_ARG);
+
+	/* NULL result pointer, must not segfault. */
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_stats_get(sess, NULL);
+	ck_assert(ret == SR_ERR_ARG);
+	sr_session_destroy(sess);
+
+	/* Freeing NULL statistics is allowed. */
+	sr_session_stats_free(NULL);
+}
+END_TEST
+
+#define QUEUE_SAMPLES 100000
+
+struct queue_state {
+	struct sr_session *session;
+	GThread *main_thread;
+	gboolean other_thread;
+	gboolean wait_for_drops;
+	unsigned int headers, ends, logic_packets, analog_packets;
+	uint64_t samples;
+	unsigned int sleep_us;
+};
+
+static void queue_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_session_stats_packets *sp;
+	struct sr_session_stats *stats;
+	struct queue_state *qs;
+	uint64_t sent;
+	int i;
+
+	(void)sdi;
+
+	qs = cb_data;
+	if (g_thread_self() != qs->main_thread)
+		qs->other_thread = TRUE;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		qs->headers++;
+		break;
+	case SR_DF_END:
+		qs->ends++;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		qs->samples += logic->length / logic->unitsize;
+		if (qs->logic_packets++ == 0 && qs->wait_for_drops) {
+			/* The queue is full while this callback runs. */
+			sent = 0;
+			for (i = 0; i < 5000 && sent < 4; i++) {
+				g_usleep(1000);
+				sr_session_stats_get(qs->session, &stats);
+				sp = stats_packets_find(stats, SR_DF_LOGIC);
+				sent = sp->packets;
+				sr_session_stats_free(stats);
+			}
+		}
+		if (qs->sleep_us)
+			g_usleep(qs->sleep_us);
+		break;
+	case SR_DF_ANALOG:
+		qs->analog_packets++;
+		break;
+	}
+}
+
+/* Run the demo driver until it sent its samples, with queued delivery. */
+static void queue_run(struct queue_state *qs, unsigned int depth,
+	enum sr_datafeed_overflow overflow)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	GSList *devices;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devices = sr_driver_scan(driver, NULL);
+	ck_assert(devices != NULL);
+	sdi = devices->data;
+	g_slist_free(devices);
+	ck_assert(sr_dev_open(sdi) == SR_OK);
+	ck_assert(sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_MHZ(1))) == SR_OK);
+	ck_assert(sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(QUEUE_SAMPLES)) == SR_OK);
+
+	sr_session_new(srtest_ctx, &qs->session);
+	qs->main_thread = g_thread_self();
+	ck_assert(sr_session_dev_add(qs->session, sdi) == SR_OK);
+	sr_session_datafeed_callback_add(qs->session, queue_datafeed_in, qs);
+	sr_session_stats_enable(qs->session, TRUE);
+	ck_assert(sr_session_datafeed_queue_set(qs->session, depth,
+		overflow) == SR_OK);
+
+	ck_assert(sr_session_start(qs->session) == SR_OK);
+	ck_assert(sr_session_run(qs->session) == SR_OK);
+
+	ck_assert(qs->other_thread);
+	ck_assert(qs->headers == 1);
+	ck_assert(qs->ends == 1);
+}
+
+static uint64_t queue_dropped(struct queue_state *qs)
+{
+	struct sr_session_stats *stats;
+	const struct sr_session_stats_timing *st;
+	uint64_t dropped;
+
+	ck_assert(sr_session_stats_get(qs->session, &stats) == SR_OK);
+	st = stats->callbacks->data;
+	dropped = st->dropped;
+	sr_session_stats_free(stats);
+
+	return dropped;
+}
+
+static void queue_finish(struct queue_state *qs)
+{
+	sr_session_dev_remove_all(qs->session);
+	sr_session_destroy(qs->session);
+}
+
+/* A slow callback in blocking mode still receives all samples. */
+START_TEST(test_queue_block)
+{
+	struct queue_state qs;
+
+	memset(&qs, 0, sizeof(qs));
+	qs.sleep_us = 2000;
+	queue_run(&qs, 2, SR_DF_OVERFLOW_BLOCK);
+	ck_assert(qs.samples == QUEUE_SAMPLES);
+	ck_assert(queue_dropped(&qs) == 0);
+	queue_finish(&qs);
+}
+END_TEST
+
+/* Data packets get dropped from a full queue, but no others. */
+START_TEST(test_queue_drop)
+{
+	struct queue_state qs;
+	struct sr_session_stats *stats;
+	uint64_t dropped, sent;
+
+	memset(&qs, 0, sizeof(qs));
+	qs.wait_for_drops = TRUE;
+	queue_run(&qs, 1, SR_DF_OVERFLOW_DROP);
+	dropped = queue_dropped(&qs);
+	ck_assert(dropped >= 3);
+	ck_assert(qs.samples < QUEUE_SAMPLES);
+
+	/* Each data packet was either delivered or dropped. */
+	ck_assert(sr_session_stats_get(qs.session, &stats) == SR_OK);
+	sent = stats_packets_find(stats, SR_DF_LOGIC)->packets;
+	sent += stats_packets_find(stats, SR_DF_ANALOG)->packets;
+	ck_assert(qs.logic_packets + qs.analog_packets + dropped == sent);
+	sr_session_stats_free(stats);
+	queue_finish(&qs);
+}
+END_TEST
+
+/* Huge depths get capped, and don't stall the session start. */
+START_TEST(test_queue_depth_max)
+{
+	struct queue_state qs;
+
+	memset(&qs, 0, sizeof(qs));
+	queue_run(&qs, G_MAXUINT, SR_DF_OVERFLOW_BLOCK);
+	ck_assert(qs.samples == QUEUE_SAMPLES);
+	queue_finish(&qs);
+
+	ck_assert(sr_session_datafeed_queue_set(NULL, 1,
+		SR_DF_OVERFLOW_BLOCK) == SR_ERR_ARG);
+}
+END_TEST
+
+/* A single logic channel which toggles every 10 samples. */
+static const char *buffer_vcd =
+	"$timescale 1 us $end\n"
+	"$scope module top $end\n"
+	"$var wire 1 ! d0 $end\n"
+	"$upscope $end\n"
+	"$enddefinitions $end\n"
+	"#0\n0!\n#10\n1!\n#20\n0!\n#30\n1!\n#40\n";
+
+struct buffer_state {
+	struct sr_buffer *buf;
+	void *data;
+	size_t offset;
+	uint64_t length;
+	unsigned int logic_packets;
+	unsigned int unbuffered;
+};
+
+static void buffer_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct buffer_state *bs;
+	const struct sr_datafeed_logic *logic;
+	struct sr_datafeed_packet *copy;
+	struct sr_buffer *buf;
+	const uint8_t *start;
+
+	(void)sdi;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+
+	bs = cb_data;
+	bs->logic_packets++;
+	logic = packet->payload;
+	buf = sr_packet_buffer_ref(packet);
+	if (!buf) {
+		bs->unbuffered++;
+		return;
+	}
+
+	/* The payload lies within the buffer. */
+	start = sr_buffer_data_get(buf);
+	ck_assert((const uint8_t *)logic->data >= start);
+	ck_assert((const uint8_t *)logic->data + logic->length <=
+		start + sr_buffer_size_get(buf));
+
+	/* Copies share the buffer instead of duplicating the data. */
+	ck_assert(sr_packet_copy(packet, &copy) == SR_OK);
+	ck_assert(sr_packet_buffer_ref(copy) == buf);
+	sr_buffer_unref(buf);
+	sr_packet_free(copy);
+
+	/* Keep the first buffer beyond the end of the session. */
+	if (!bs->buf) {
+		bs->buf = buf;
+		bs->data = g_malloc(logic->length);
+		memcpy(bs->data, logic->data, logic->length);
+		bs->length = logic->length;
+		bs->offset = (const uint8_t *)logic->data - start;
+	} else {
+		sr_buffer_unref(buf);
+	}
+}
+
+static void buffer_run(struct buffer_state *bs, const char *format,
+	const char *text)
+{
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	struct sr_session *sess;
+	GString *buf;
+
+	memset(bs, 0, sizeof(*bs));
+	ck_assert(sr_session_new(srtest_ctx, &sess) == SR_OK);
+	ck_assert(sr_session_datafeed_callback_add(sess,
+		buffer_datafeed_in, bs) == SR_OK);
+
+	imod = sr_input_find(format);
+	ck_assert(imod != NULL);
+	in = sr_input_new(imod, NULL);
+	ck_assert(in != NULL);
+	ck_assert(sr_session_dev_add(sess, sr_input_dev_inst_get(in)) == SR_OK);
+
+	buf = g_string_new(text);
+	ck_assert(sr_input_send(in, buf) == SR_OK);
+	ck_assert(sr_input_end(in) == SR_OK);
+	g_string_free(buf, TRUE);
+	sr_input_free(in);
+	sr_session_destroy(sess);
+}
+
+/* Check that buffered logic packets hand out references to their data. */
+START_TEST(test_packet_buffer_ref)
+{
+	struct buffer_state bs;
+
+	buffer_run(&bs, "vcd", buffer_vcd);
+	fail_unless(bs.logic_packets > 0, "No logic packets received.");
+	fail_unless(bs.unbuffered == 0, "Logic packet without buffer.");
+	ck_assert(bs.buf != NULL);
+
+	/* The reference keeps the data alive and unchanged. */
+	ck_assert(sr_buffer_size_get(bs.buf) >= bs.offset + bs.length);
+	ck_assert(memcmp((uint8_t *)sr_buffer_data_get(bs.buf) + bs.offset,
+		bs.data, bs.length) == 0);
+	sr_buffer_unref(bs.buf);
+	g_free(bs.data);
+}
+END_TEST
+
+/* Check that packets sent via sr_session_send() carry no buffer. */
+START_TEST(test_packet_buffer_ref_unbuffered)
+{
+	struct buffer_state bs;
+	GString *data;
+
+	data = g_string_new(NULL);
+	g_string_set_size(data, 256);
+	memset(data->str, 0xaa, data->len);
+	buffer_run(&bs, "binary", data->str);
+	g_string_free(data, TRUE);
+	fail_unless(bs.logic_packets > 0, "No logic packets received.");
+	fail_unless(bs.unbuffered == bs.logic_packets,
+		"Unexpected buffer on a logic packet.");
+	ck_assert(bs.buf == NULL);
+}
+END_TEST
+
+/* Check that NULL packets and buffers are handled gracefully. */
+START_TEST(test_packet_buffer_ref_bogus)
+{
+	struct sr_datafeed_packet packet;
+
+	ck_assert(sr_packet_buffer_ref(NULL) == NULL);
+	memset(&packet, 0, sizeof(packet));
+	packet.type = SR_DF_END;
+	ck_assert(sr_packet_buffer_ref(&packet) == NULL);
+	sr_buffer_unref(NULL);
+}
+END_TEST
+
+#define USB_THREAD_SAMPLES 100000
+
+struct usb_thread_state {
+	struct sr_session *session;
+	uint64_t samples;
+	unsigned int ends;
+	int set_ret;
+};
+
+static void usb_thread_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct usb_thread_state *st;
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	st = cb_data;
+	if (packet->type == SR_DF_HEADER) {
+		st->set_ret = sr_session_usb_event_thread_set(st->session,
+			FALSE);
+	} else if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		st->samples += logic->length / logic->unitsize;
+	} else if (packet->type == SR_DF_END) {
+		st->ends++;
+	}
+}
+
+/* Acquire a fixed number of samples with the USB event thread enabled. */
+static void usb_thread_run(struct sr_dev_inst *sdi)
+{
+	struct usb_thread_state st;
+
+	memset(&st, 0, sizeof(st));
+	ck_assert(sr_dev_open(sdi) == SR_OK);
+	ck_assert(sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_MHZ(1))) == SR_OK);
+	ck_assert(sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(USB_THREAD_SAMPLES)) == SR_OK);
+
+	ck_assert(sr_session_new(srtest_ctx, &st.session) == SR_OK);
+	ck_assert(sr_session_usb_event_thread_set(st.session, TRUE) == SR_OK);
+	ck_assert(sr_session_dev_add(st.session, sdi) == SR_OK);
+	sr_session_datafeed_callback_add(st.session, usb_thread_datafeed_in,
+		&st);
+
+	ck_assert(sr_session_start(st.session) == SR_OK);
+	ck_assert(sr_session_run(st.session) == SR_OK);
+
+	/* The setting is fixed while the session runs. */
+	ck_assert(st.set_ret == SR_ERR);
+	ck_assert(st.ends == 1);
+	ck_assert(st.samples == USB_THREAD_SAMPLES);
+	ck_assert(sr_session_usb_event_thread_set(st.session, FALSE) == SR_OK);
+
+	sr_session_destroy(st.session);
+	sr_dev_close(sdi);
+}
+
+/*
+ * Check acquisitions with the USB event thread. Drivers without USB
+ * keep using the main loop. Connected fx2lafw devices, which support
+ * the thread, get exercised as well.
+ */
+START_TEST(test_usb_event_thread)
+{
+	struct sr_dev_driver **drivers;
+	GSList *devices, *l;
+	int i;
+
+	drivers = sr_driver_list(srtest_ctx);
+	ck_assert(drivers != NULL);
+	for (i = 0; drivers[i]; i++) {
+		if (strcmp(drivers[i]->name, "demo") &&
+				strcmp(drivers[i]->name, "fx2lafw"))
+			continue;
+		srtest_driver_init(srtest_ctx, drivers[i]);
+		devices = sr_driver_scan(drivers[i], NULL);
+		if (!strcmp(drivers[i]->name, "demo"))
+			ck_assert(devices != NULL);
+		for (l = devices; l; l = l->next)
+			usb_thread_run(l->data);
+		g_slist_free(devices);
+	}
+}
+END_TEST
+
+#ifdef HAVE_LIBUSB_1_0
+#define FAKE_USB_PACKETS 50
+#define FAKE_USB_PACKET_SIZE 100
+
+/* A driver without hardware, whose "transfers" complete in the thread. */
+struct fake_usb_state {
+	GThread *main_thread;
+	gboolean completed;
+	gboolean completed_in_main;
+	uint64_t samples;
+	unsigned int wrong_thread, wrong_data;
+};
+
+static int fake_usb_receive(int fd, int revents, void *cb_data)
+{
+	(void)fd;
+	(void)revents;
+	(void)cb_data;
+
+	return TRUE;
+}
+
+/* Runs in the USB event thread, like a transfer completion callback. */
+static gboolean fake_usb_complete(void *data)
+{
+	struct sr_dev_inst *sdi;
+	struct fake_usb_state *st;
+	struct feed_queue_logic *q;
+	uint8_t buf[FAKE_USB_PACKET_SIZE];
+	unsigned int i, j;
+
+	sdi = data;
+	st = sdi->priv;
+	st->completed_in_main = g_thread_self() == st->main_thread;
+
+	q = feed_queue_logic_alloc(sdi, FAKE_USB_PACKET_SIZE, 1);
+	for (i = 0; i < FAKE_USB_PACKETS; i++) {
+		for (j = 0; j < sizeof(buf); j++)
+			buf[j] = i * FAKE_USB_PACKET_SIZE + j;
+		feed_queue_logic_submit_many(q, buf, sizeof(buf));
+		feed_queue_logic_flush(q);
+	}
+	feed_queue_logic_free(q);
+	st->completed = TRUE;
+
+	/* The last transfer ends the acquisition. */
+	usb_source_remove(sdi->session, srtest_ctx);
+
+	return G_SOURCE_REMOVE;
+}
+
+static int fake_usb_open(struct sr_dev_inst *sdi)
+{
+	(void)sdi;
+
+	return SR_OK;
+}
+
+static int fake_usb_acquisition_start(const struct sr_dev_inst *sdi)
+{
+	int ret;
+
+	ret = usb_source_add_threaded(sdi->session, srtest_ctx, 1000,
+		fake_usb_receive, NULL);
+	if (ret != SR_OK)
+		return ret;
+
+	return usb_source_invoke(sdi->session, srtest_ctx, fake_usb_complete,
+		(void *)sdi);
+}
+
+static int fake_usb_acquisition_stop(struct sr_dev_inst *sdi)
+{
+	return usb_source_remove(sdi->session, srtest_ctx);
+}
+
+static struct sr_dev_driver fake_usb_driver = {
+	.name = "fake-usb",
+	.longname = "USB event thread test",
+	.api_version = 1,
+	.dev_open = fake_usb_open,
+	.dev_acquisition_start = fake_usb_acquisition_start,
+	.dev_acquisition_stop = fake_usb_acquisition_stop,
+};
+
+static void fake_usb_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct fake_usb_state *st;
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *data;
+	uint64_t i;
+
+	(void)sdi;
+
+	st = cb_data;
+	if (g_thread_self() != st->main_thread)
+		st->wrong_thread++;
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	data = logic->data;
+	for (i = 0; i < logic->length; i++) {
+		if (data[i] != (uint8_t)(st->samples + i))
+			st->wrong_data++;
+	}
+	st->samples += logic->length;
+}
+
+/*
+ * Packets which transfer completions send in the USB event thread get
+ * delivered in the session thread, in order. Removing the USB source
+ * from the event thread ends the session.
+ */
+START_TEST(test_usb_event_thread_deferred)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct fake_usb_state st;
+
+	memset(&st, 0, sizeof(st));
+	st.main_thread = g_thread_self();
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	ck_assert(sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_LOGIC,
+		"D0") == SR_OK);
+	sdi->driver = &fake_usb_driver;
+	sdi->status = SR_ST_ACTIVE;
+	sdi->priv = &st;
+
+	ck_assert(sr_session_new(srtest_ctx, &session) == SR_OK);
+	ck_assert(sr_session_usb_event_thread_set(session, TRUE) == SR_OK);
+	ck_assert(sr_session_dev_add(session, sdi) == SR_OK);
+	ck_assert(sr_session_datafeed_callback_add(session,
+		fake_usb_datafeed_in, &st) == SR_OK);
+	ck_assert(sr_session_start(session) == SR_OK);
+	ck_assert(sr_session_run(session) == SR_OK);
+
+	ck_assert(st.completed);
+	ck_assert(!st.completed_in_main);
+	ck_assert(st.wrong_thread == 0);
+	ck_assert(st.wrong_data == 0);
+	ck_assert(st.samples == FAKE_USB_PACKETS * FAKE_USB_PACKET_SIZE);
+
+	sr_session_destroy(session);
+	sdi->priv = NULL;
+}
+END_TEST
+
+/* Without the thread setting, the main loop handles USB events. */
+START_TEST(test_usb_event_thread_off)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct fake_usb_state st;
+
+	memset(&st, 0, sizeof(st));
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	ck_assert(sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_LOGIC,
+		"D0") == SR_OK);
+	sdi->driver = &fake_usb_driver;
+	sdi->status = SR_ST_ACTIVE;
+	sdi->priv = &st;
+
+	ck_assert(sr_session_new(srtest_ctx, &session) == SR_OK);
+	ck_assert(sr_session_dev_add(session, sdi) == SR_OK);
+	ck_assert(sr_session_start(session) == SR_ERR_NA);
+	ck_assert(!st.completed);
+
+	sr_session_destroy(session);
+	sdi->priv = NULL;
+}
+END_TEST
+#endif
+
+START_TEST(test_usb_event_thread_bogus)
+{
+	ck_assert(sr_session_usb_event_thread_set(NULL, TRUE) == SR_ERR_ARG);
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -209,5 +948,36 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_trigger_get_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("stats");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_stats_get);
+	tcase_add_test(tc, test_session_stats_count);
+	tcase_add_test(tc, test_session_stats_get_bogus);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("datafeed_queue");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_queue_block);
+	tcase_add_test(tc, test_queue_drop);
+	tcase_add_test(tc, test_queue_depth_max);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("packet_buffer");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_packet_buffer_ref);
+	tcase_add_test(tc, test_packet_buffer_ref_unbuffered);
+	tcase_add_test(tc, test_packet_buffer_ref_bogus);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("usb_event_thread");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_usb_event_thread);
+#ifdef HAVE_LIBUSB_1_0
+	tcase_add_test(tc, test_usb_event_thread_deferred);
+	tcase_add_test(tc, test_usb_event_thread_off);
+#endif
+	tcase_add_test(tc, test_usb_event_thread_bogus);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
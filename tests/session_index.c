@@ -0,0 +1,746 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <math.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <zip.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+/* Logic data in chunks of these sizes, one analog channel. */
+static const uint64_t logic_chunks[] = { 1000, 1000, 500 };
+static const uint64_t analog_chunks[] = { 300, 200 };
+#define LOGIC_SAMPLES 2500
+#define ANALOG_SAMPLES 500
+#define ANALOG_CHANNEL 16
+
+static const char metadata[] =
+	"[global]\n"
+	"sigrok version=0.6.0\n"
+	"[device 1]\n"
+	"capturefile=logic-1\n"
+	"total probes=16\n"
+	"samplerate=1 MHz\n"
+	"total analog=1\n"
+	"unitsize=2\n"
+	"probe1=D0\n"
+	"analog17=A0\n";
+
+/* The same analog data without logic data, the channel is the first one. */
+static const char metadata_analog[] =
+	"[global]\n"
+	"sigrok version=0.6.0\n"
+	"[device 1]\n"
+	"samplerate=1 MHz\n"
+	"total analog=1\n"
+	"analog1=A0\n";
+
+/* Logic data only, in more members than the reader has buffers. */
+static const char metadata_logic[] =
+	"[global]\n"
+	"sigrok version=0.6.0\n"
+	"[device 1]\n"
+	"capturefile=logic-1\n"
+	"total probes=16\n"
+	"samplerate=1 MHz\n"
+	"total analog=0\n"
+	"unitsize=2\n"
+	"probe1=D0\n";
+#define MANY_CHUNKS 12
+
+/* Summaries get written by the srzip output, for this much data. */
+#define SUMMARY_LOGIC_SAMPLES 20000
+#define SUMMARY_ANALOG_SAMPLES 6000
+#define SUMMARY_PACKET 3000
+#define SUMMARY_BASE 1024
+#define SUMMARY_LEVELS 4
+
+static char *filename;
+static GSList *member_bufs;
+
+static uint16_t logic_value(uint64_t sample)
+{
+	return sample * 31;
+}
+
+static float analog_value(uint64_t sample)
+{
+	return sample * 0.5f;
+}
+
+static void close_archive(struct zip *archive)
+{
+	ck_assert(zip_close(archive) == 0);
+	g_slist_free_full(member_bufs, g_free);
+	member_bufs = NULL;
+}
+
+/* Add a member, optionally uncompressed. */
+static void add_member(struct zip *archive, const char *name,
+	void *data, size_t len, gboolean store)
+{
+	struct zip_source *src;
+	zip_int64_t idx;
+
+	/* libzip reads the data when the archive gets closed. */
+	member_bufs = g_slist_prepend(member_bufs, data);
+	src = zip_source_buffer(archive, data, len, 0);
+	idx = zip_file_add(archive, name, src, 0);
+	ck_assert(idx >= 0);
+	if (store)
+		zip_set_file_compression(archive, idx, ZIP_CM_STORE, 0);
+}
+
+static void add_logic_chunk(struct zip *archive, int num,
+	uint64_t first, uint64_t count)
+{
+	uint16_t *buf;
+	char *name;
+	uint64_t i;
+
+	buf = g_malloc(count * sizeof(*buf));
+	for (i = 0; i < count; i++)
+		buf[i] = GUINT16_TO_LE(logic_value(first + i));
+	name = g_strdup_printf("logic-1-%d", num);
+	add_member(archive, name, buf, count * sizeof(*buf), num == 2);
+	g_free(name);
+}
+
+/* Add the analog chunks, for the 1-based channel number 'ch_nr'. */
+static void add_analog_chunks(struct zip *archive, int ch_nr)
+{
+	float *fbuf;
+	char *name;
+	uint64_t first, i;
+	unsigned int c;
+
+	first = 0;
+	for (c = 0; c < ARRAY_SIZE(analog_chunks); c++) {
+		fbuf = g_malloc(analog_chunks[c] * sizeof(*fbuf));
+		for (i = 0; i < analog_chunks[c]; i++)
+			fbuf[i] = analog_value(first + i);
+		name = g_strdup_printf("analog-1-%d-%u", ch_nr, c + 1);
+		add_member(archive, name, fbuf,
+			analog_chunks[c] * sizeof(*fbuf), c == 0);
+		g_free(name);
+		first += analog_chunks[c];
+	}
+}
+
+/* Start a new session file, with the given metadata. */
+static struct zip *new_archive(const char *meta)
+{
+	struct zip *archive;
+
+	g_unlink(filename);
+	archive = zip_open(filename, ZIP_CREATE, NULL);
+	ck_assert(archive != NULL);
+	add_member(archive, "version", g_strdup("2"), 1, FALSE);
+	add_member(archive, "metadata", g_strdup(meta), strlen(meta), FALSE);
+
+	return archive;
+}
+
+static void create_session_file(void)
+{
+	struct zip *archive;
+	uint64_t first;
+	unsigned int c;
+	int fd;
+
+	fd = g_file_open_tmp("sr-test-XXXXXX.sr", &filename, NULL);
+	ck_assert(fd >= 0);
+	close(fd);
+
+	archive = new_archive(metadata);
+	first = 0;
+	for (c = 0; c < ARRAY_SIZE(logic_chunks); c++) {
+		add_logic_chunk(archive, c + 1, first, logic_chunks[c]);
+		first += logic_chunks[c];
+	}
+	add_analog_chunks(archive, ANALOG_CHANNEL + 1);
+	close_archive(archive);
+}
+
+static void setup(void)
+{
+	srtest_setup();
+	create_session_file();
+}
+
+static void teardown(void)
+{
+	g_unlink(filename);
+	g_free(filename);
+	filename = NULL;
+	srtest_teardown();
+}
+
+static void check_logic(struct sr_session_index *index,
+	uint64_t start, uint64_t count)
+{
+	uint16_t *buf;
+	uint64_t got, i, expected;
+	int ret;
+
+	buf = g_malloc0((count + 1) * sizeof(*buf));
+	ret = sr_session_index_read_logic(index, start, count,
+		(uint8_t *)buf, &got);
+	ck_assert_msg(ret == SR_OK, "Read of %" PRIu64 "+%" PRIu64 " failed.",
+		start, count);
+	expected = MIN(count, LOGIC_SAMPLES - start);
+	ck_assert_msg(got == expected, "Read %" PRIu64 " samples, not %"
+		PRIu64 ".", got, expected);
+	for (i = 0; i < got; i++)
+		ck_assert(GUINT16_FROM_LE(buf[i]) == logic_value(start + i));
+	g_free(buf);
+}
+
+static void check_analog(struct sr_session_index *index,
+	uint64_t start, uint64_t count)
+{
+	float *buf;
+	uint64_t got, i;
+	int ret;
+
+	buf = g_malloc0((count + 1) * sizeof(*buf));
+	ret = sr_session_index_read_analog(index, ANALOG_CHANNEL,
+		start, count, buf, &got);
+	ck_assert(ret == SR_OK);
+	ck_assert(got == MIN(count, ANALOG_SAMPLES - start));
+	for (i = 0; i < got; i++)
+		ck_assert(buf[i] == analog_value(start + i));
+	g_free(buf);
+}
+
+static gboolean has_index_member(void)
+{
+	struct zip *archive;
+	gboolean found;
+
+	archive = zip_open(filename, 0, NULL);
+	ck_assert(archive != NULL);
+	found = zip_name_locate(archive, "index", 0) >= 0;
+	close_archive(archive);
+
+	return found;
+}
+
+/* Check the layout, and reads at random positions within and across chunks. */
+START_TEST(test_index_read)
+{
+	struct sr_session_index *index;
+	uint64_t samples;
+	int unitsize;
+	uint8_t buf[4];
+
+	ck_assert(sr_session_index_open(filename, FALSE, &index) == SR_OK);
+	ck_assert(!has_index_member());
+
+	ck_assert(sr_session_index_get_unitsize(index, &unitsize) == SR_OK);
+	ck_assert(unitsize == 2);
+	ck_assert(sr_session_index_get_samples(index, 0, &samples) == SR_OK);
+	ck_assert(samples == LOGIC_SAMPLES);
+	ck_assert(sr_session_index_get_samples(index, ANALOG_CHANNEL,
+		&samples) == SR_OK);
+	ck_assert(samples == ANALOG_SAMPLES);
+	ck_assert(sr_session_index_get_samples(index, ANALOG_CHANNEL + 1,
+		&samples) == SR_ERR_ARG);
+
+	/* Across chunk boundaries, backwards, and past the end. */
+	check_logic(index, 900, 700);
+	check_logic(index, 1600, 10);
+	check_logic(index, 10, 20);
+	check_logic(index, 1999, 1);
+	check_logic(index, 2400, 500);
+	check_logic(index, LOGIC_SAMPLES, 1);
+	check_analog(index, 250, 100);
+	check_analog(index, 0, ANALOG_SAMPLES);
+
+	ck_assert(sr_session_index_read_logic(index, LOGIC_SAMPLES + 1, 1,
+		buf, &samples) == SR_ERR_ARG);
+	ck_assert(sr_session_index_read_analog(index, 0, 0, 1,
+		(float *)buf, &samples) == SR_ERR_ARG);
+
+	ck_assert(sr_session_index_close(index) == SR_OK);
+}
+END_TEST
+
+/* A persisted index gets used, and ignored after members were added. */
+START_TEST(test_index_persist)
+{
+	struct sr_session_index *index;
+	struct zip *archive;
+	uint64_t samples;
+
+	ck_assert(sr_session_index_open(filename, TRUE, &index) == SR_OK);
+	ck_assert(sr_session_index_close(index) == SR_OK);
+	ck_assert(has_index_member());
+
+	ck_assert(sr_session_index_open(filename, FALSE, &index) == SR_OK);
+	ck_assert(sr_session_index_get_samples(index, 0, &samples) == SR_OK);
+	ck_assert(samples == LOGIC_SAMPLES);
+	check_logic(index, 0, LOGIC_SAMPLES);
+	check_analog(index, 123, 321);
+	ck_assert(sr_session_index_close(index) == SR_OK);
+
+	archive = zip_open(filename, 0, NULL);
+	ck_assert(archive != NULL);
+	add_logic_chunk(archive, ARRAY_SIZE(logic_chunks) + 1,
+		LOGIC_SAMPLES, 100);
+	close_archive(archive);
+
+	ck_assert(sr_session_index_open(filename, FALSE, &index) == SR_OK);
+	ck_assert(sr_session_index_get_samples(index, 0, &samples) == SR_OK);
+	ck_assert(samples == LOGIC_SAMPLES + 100);
+	ck_assert(sr_session_index_close(index) == SR_OK);
+}
+END_TEST
+
+static uint8_t summary_logic_value(uint64_t sample)
+{
+	return (sample * 7) ^ (sample >> 5);
+}
+
+static float summary_analog_value(uint64_t sample)
+{
+	return (float)(sample % 97) * 0.25f - 10;
+}
+
+static void send_packet(const struct sr_output *o, int type,
+	const void *payload)
+{
+	struct sr_datafeed_packet packet;
+	GString *out;
+
+	packet.type = type;
+	packet.payload = payload;
+	ck_assert(sr_output_send(o, &packet, &out) == SR_OK);
+	if (out)
+		g_string_free(out, TRUE);
+}
+
+/* Write 8 logic channels and an analog one through the srzip output. */
+static void create_summary_file(void)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	GHashTable *options;
+	uint8_t *lbuf;
+	float *fbuf;
+	uint64_t first, i;
+	int c;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (c = 0; c < 8; c++)
+		sr_dev_inst_channel_add(sdi, c, SR_CHANNEL_LOGIC, "D");
+	sr_dev_inst_channel_add(sdi, 8, SR_CHANNEL_ANALOG, "A0");
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "summary",
+		g_variant_ref_sink(g_variant_new_boolean(TRUE)));
+	g_unlink(filename);
+	o = sr_output_new(sr_output_find("srzip"), options, sdi, filename);
+	ck_assert(o != NULL);
+	g_hash_table_destroy(options);
+
+	lbuf = g_malloc(SUMMARY_PACKET);
+	logic.unitsize = 1;
+	logic.data = lbuf;
+	for (first = 0; first < SUMMARY_LOGIC_SAMPLES; first += SUMMARY_PACKET) {
+		logic.length = MIN(SUMMARY_PACKET, SUMMARY_LOGIC_SAMPLES - first);
+		for (i = 0; i < logic.length; i++)
+			lbuf[i] = summary_logic_value(first + i);
+		send_packet(o, SR_DF_LOGIC, &logic);
+	}
+	g_free(lbuf);
+
+	memset(&analog, 0, sizeof(analog));
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	encoding.unitsize = sizeof(float);
+	encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	encoding.is_bigendian = TRUE;
+#endif
+	encoding.scale.p = encoding.scale.q = 1;
+	encoding.offset.q = 1;
+	meaning.channels = g_slist_append(NULL,
+		g_slist_nth_data(sr_dev_inst_channels_get(sdi), 8));
+	fbuf = g_malloc(SUMMARY_PACKET * sizeof(*fbuf));
+	analog.data = fbuf;
+	for (first = 0; first < SUMMARY_ANALOG_SAMPLES; first += SUMMARY_PACKET) {
+		analog.num_samples = MIN(SUMMARY_PACKET,
+			SUMMARY_ANALOG_SAMPLES - first);
+		for (i = 0; i < analog.num_samples; i++)
+			fbuf[i] = summary_analog_value(first + i);
+		send_packet(o, SR_DF_ANALOG, &analog);
+	}
+	g_free(fbuf);
+	g_slist_free(meaning.channels);
+
+	send_packet(o, SR_DF_END, NULL);
+	ck_assert(sr_output_free(o) == SR_OK);
+}
+
+/* Compare a logic channel's records against the samples they cover. */
+static void check_logic_summary(struct sr_session_index *index,
+	int channel, int level)
+{
+	struct sr_summary_logic *summary;
+	uint64_t record_samples, records, got, r, i, start, end;
+	uint32_t transitions;
+	gboolean bit, any, all;
+
+	ck_assert(sr_session_index_get_summary(index, channel, level,
+		&record_samples, &records) == SR_OK);
+	ck_assert(records == (SUMMARY_LOGIC_SAMPLES + record_samples - 1)
+		/ record_samples);
+	summary = g_malloc0_n(records, sizeof(*summary));
+	ck_assert(sr_session_index_read_logic_summary(index, channel, level,
+		0, records + 1, summary, &got) == SR_OK);
+	ck_assert(got == records);
+
+	for (r = 0; r < records; r++) {
+		start = r * record_samples;
+		end = MIN(start + record_samples, SUMMARY_LOGIC_SAMPLES);
+		any = FALSE;
+		all = TRUE;
+		transitions = 0;
+		for (i = start; i < end; i++) {
+			bit = (summary_logic_value(i) >> channel) & 1;
+			any |= bit;
+			all &= bit;
+			if (i > start && bit != ((summary_logic_value(i - 1)
+					>> channel) & 1))
+				transitions++;
+		}
+		ck_assert(summary[r].samples == end - start);
+		ck_assert(summary[r].first ==
+			((summary_logic_value(start) >> channel) & 1));
+		ck_assert(summary[r].last ==
+			((summary_logic_value(end - 1) >> channel) & 1));
+		ck_assert(summary[r].any_high == any);
+		ck_assert(summary[r].all_high == all);
+		ck_assert_msg(summary[r].transitions == transitions,
+			"Level %d record %" PRIu64 ": %u transitions, not %u.",
+			level, r, summary[r].transitions, transitions);
+	}
+	g_free(summary);
+}
+
+static void check_analog_summary(struct sr_session_index *index, int level)
+{
+	struct sr_summary_analog *summary;
+	uint64_t record_samples, records, got, r, i, start, end;
+	float min, max;
+	double sum;
+
+	ck_assert(sr_session_index_get_summary(index, 8, level,
+		&record_samples, &records) == SR_OK);
+	ck_assert(records == (SUMMARY_ANALOG_SAMPLES + record_samples - 1)
+		/ record_samples);
+	summary = g_malloc0_n(records, sizeof(*summary));
+	ck_assert(sr_session_index_read_analog_summary(index, 8, level,
+		0, records, summary, &got) == SR_OK);
+	ck_assert(got == records);
+
+	for (r = 0; r < records; r++) {
+		start = r * record_samples;
+		end = MIN(start + record_samples, SUMMARY_ANALOG_SAMPLES);
+		min = max = summary_analog_value(start);
+		sum = 0;
+		for (i = start; i < end; i++) {
+			min = MIN(min, summary_analog_value(i));
+			max = MAX(max, summary_analog_value(i));
+			sum += summary_analog_value(i);
+		}
+		ck_assert(summary[r].samples == end - start);
+		ck_assert(summary[r].min == min);
+		ck_assert(summary[r].max == max);
+		ck_assert(fabs(summary[r].mean - sum / (end - start)) < 1e-3);
+	}
+	g_free(summary);
+}
+
+/* Summary levels written by the srzip output match the samples. */
+START_TEST(test_index_summary)
+{
+	struct sr_session_index *index;
+	struct sr_summary_logic logic[2];
+	struct sr_summary_analog analog;
+	uint64_t record_samples, records, got;
+	int levels, level, channel;
+
+	ck_assert(sr_session_index_open(filename, FALSE, &index) == SR_OK);
+	ck_assert(sr_session_index_get_summary_levels(index,
+		&levels) == SR_ERR_NA);
+	ck_assert(sr_session_index_close(index) == SR_OK);
+
+	create_summary_file();
+	ck_assert(sr_session_index_open(filename, FALSE, &index) == SR_OK);
+	ck_assert(sr_session_index_get_summary_levels(index, &levels) == SR_OK);
+	ck_assert(levels == SUMMARY_LEVELS);
+
+	for (level = 0; level < levels; level++) {
+		for (channel = 0; channel < 8; channel++)
+			check_logic_summary(index, channel, level);
+	}
+	/* The analog channel has fewer samples, thus fewer levels. */
+	for (level = 0; level < levels - 1; level++)
+		check_analog_summary(index, level);
+	ck_assert(sr_session_index_get_summary(index, 8, levels - 1,
+		&record_samples, &records) == SR_ERR_NA);
+
+	/* Reads from within, at the end, and beyond. */
+	ck_assert(sr_session_index_read_logic_summary(index, 3, 0, 5, 2,
+		logic, &got) == SR_OK);
+	ck_assert(got == 2);
+	ck_assert(logic[1].samples == SUMMARY_BASE);
+	ck_assert(sr_session_index_read_logic_summary(index, 3, 1, 5, 1,
+		logic, &got) == SR_OK);
+	ck_assert(got == 0);
+	ck_assert(sr_session_index_read_logic_summary(index, 3, 1, 6, 1,
+		logic, &got) == SR_ERR_ARG);
+	ck_assert(sr_session_index_read_logic_summary(index, 8, 0, 0, 1,
+		logic, &got) == SR_ERR_ARG);
+	ck_assert(sr_session_index_read_analog_summary(index, 0, 0, 0, 1,
+		&analog, &got) == SR_ERR_ARG);
+
+	ck_assert(sr_session_index_close(index) == SR_OK);
+}
+END_TEST
+
+START_TEST(test_index_bogus)
+{
+	struct sr_session_index *index;
+	uint64_t samples;
+
+	ck_assert(sr_session_index_open(NULL, FALSE, &index) == SR_ERR_ARG);
+	ck_assert(sr_session_index_open(filename, FALSE, NULL) == SR_ERR_ARG);
+	ck_assert(sr_session_index_open("/nonexistent.sr", FALSE,
+		&index) != SR_OK);
+	ck_assert(sr_session_index_close(NULL) == SR_ERR_ARG);
+	ck_assert(sr_session_index_get_samples(NULL, 0, &samples) == SR_ERR_ARG);
+}
+END_TEST
+
+/* Compare the logic data which a session delivered, from sample 0. */
+static void check_capture_logic(struct srtest_capture *cap, uint64_t samples)
+{
+	const uint8_t *p;
+	uint64_t i;
+
+	ck_assert(cap->unitsize == 2);
+	ck_assert_msg(cap->logic->len == samples * 2,
+		"Got %u bytes of logic data, not %" PRIu64 ".",
+		cap->logic->len, samples * 2);
+	for (i = 0; i < samples; i++) {
+		p = &cap->logic->data[2 * i];
+		ck_assert((uint16_t)(p[0] | p[1] << 8) == logic_value(i));
+	}
+}
+
+static void check_capture_analog(struct srtest_capture *cap, int index)
+{
+	GArray *samples;
+	uint64_t i;
+
+	samples = srtest_capture_analog(cap, index);
+	ck_assert(samples != NULL);
+	ck_assert(samples->len == ANALOG_SAMPLES);
+	for (i = 0; i < ANALOG_SAMPLES; i++)
+		ck_assert(g_array_index(samples, float, i) == analog_value(i));
+}
+
+/* Stored and deflated members, in chunks, replayed by a session. */
+START_TEST(test_load)
+{
+	struct srtest_capture cap;
+
+	srtest_capture_init(&cap);
+	ck_assert(srtest_capture_session_file(filename, &cap) == SR_OK);
+	ck_assert(cap.headers == 1);
+	ck_assert(cap.ends == 1);
+	ck_assert(cap.logic_packets == ARRAY_SIZE(logic_chunks));
+	ck_assert(cap.analog_packets == ARRAY_SIZE(analog_chunks));
+	check_capture_logic(&cap, LOGIC_SAMPLES);
+	check_capture_analog(&cap, ANALOG_CHANNEL);
+	srtest_capture_free(&cap);
+}
+END_TEST
+
+START_TEST(test_load_analog_only)
+{
+	struct srtest_capture cap;
+	struct zip *archive;
+
+	archive = new_archive(metadata_analog);
+	add_analog_chunks(archive, 1);
+	close_archive(archive);
+
+	srtest_capture_init(&cap);
+	ck_assert(srtest_capture_session_file(filename, &cap) == SR_OK);
+	ck_assert(cap.ends == 1);
+	ck_assert(cap.logic_packets == 0);
+	ck_assert(cap.logic->len == 0);
+	check_capture_analog(&cap, 0);
+	srtest_capture_free(&cap);
+}
+END_TEST
+
+/* Stopping the session releases a reader which waits for buffers. */
+START_TEST(test_load_stop)
+{
+	struct srtest_capture cap;
+	struct zip *archive;
+	int c;
+
+	archive = new_archive(metadata_logic);
+	for (c = 0; c < MANY_CHUNKS; c++)
+		add_logic_chunk(archive, c + 1, c * 1000, 1000);
+	close_archive(archive);
+
+	srtest_capture_init(&cap);
+	cap.stop_after = 2;
+	ck_assert(srtest_capture_session_file(filename, &cap) == SR_OK);
+	ck_assert(cap.headers == 1);
+	ck_assert(cap.ends == 1);
+	ck_assert_msg(cap.logic_packets >= 2 && cap.logic_packets < MANY_CHUNKS,
+		"Got %u packets after the stop.", cap.logic_packets);
+	check_capture_logic(&cap, cap.logic_packets * 1000);
+	srtest_capture_free(&cap);
+
+	/* Without the stop, all of it arrives. */
+	srtest_capture_init(&cap);
+	ck_assert(srtest_capture_session_file(filename, &cap) == SR_OK);
+	check_capture_logic(&cap, MANY_CHUNKS * 1000);
+	srtest_capture_free(&cap);
+}
+END_TEST
+
+static int count_incomplete(void *cb_data, int loglevel, const char *format,
+		va_list args)
+{
+	(void)args;
+
+	if (loglevel == SR_LOG_ERR && strstr(format, "is incomplete"))
+		(*(int *)cb_data)++;
+
+	return SR_OK;
+}
+
+/* Break the CRC of a member in the central directory. */
+static void corrupt_crc(const char *name)
+{
+	gchar *contents;
+	gsize len, pos, name_len;
+	gboolean found;
+
+	ck_assert(g_file_get_contents(filename, &contents, &len, NULL));
+	name_len = strlen(name);
+	found = FALSE;
+	for (pos = 46; pos + name_len <= len && !found; pos++) {
+		if (memcmp(&contents[pos - 46], "PK\x01\x02", 4))
+			continue;
+		if (memcmp(&contents[pos], name, name_len))
+			continue;
+		if ((guint8)contents[pos - 46 + 28] != name_len)
+			continue;
+		contents[pos - 46 + 16] ^= 0xff;
+		found = TRUE;
+	}
+	ck_assert(found);
+	ck_assert(g_file_set_contents(filename, contents, len, NULL));
+	g_free(contents);
+}
+
+/* A read error ends the session after the data before it, and gets reported. */
+START_TEST(test_load_read_error)
+{
+	struct srtest_capture cap;
+	int errors, loglevel;
+
+	/* The third logic chunk is deflated, libzip checks its CRC. */
+	corrupt_crc("logic-1-3");
+
+	errors = 0;
+	loglevel = sr_log_loglevel_get();
+	sr_log_loglevel_set(SR_LOG_ERR);
+	sr_log_callback_set(count_incomplete, &errors);
+
+	srtest_capture_init(&cap);
+	ck_assert(srtest_capture_session_file(filename, &cap) == SR_OK);
+
+	sr_log_callback_set_default();
+	sr_log_loglevel_set(loglevel);
+
+	ck_assert(cap.ends == 1);
+	ck_assert_msg(errors == 1, "The read error was not reported.");
+	/* Data of the broken member may arrive before its CRC is checked. */
+	ck_assert(cap.logic->len == 2 * (logic_chunks[0] + logic_chunks[1]) ||
+		cap.logic->len == 2 * LOGIC_SAMPLES);
+	check_capture_logic(&cap, cap.logic->len / 2);
+	/* Reading ends at the error, the analog members come later. */
+	ck_assert(srtest_capture_analog(&cap, ANALOG_CHANNEL) == NULL);
+	srtest_capture_free(&cap);
+}
+END_TEST
+
+Suite *suite_session_index(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("session-index");
+
+	tc = tcase_create("read");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_index_read);
+	tcase_add_test(tc, test_index_persist);
+	tcase_add_test(tc, test_index_summary);
+	tcase_add_test(tc, test_index_bogus);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("load");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_load);
+	tcase_add_test(tc, test_load_analog_only);
+	tcase_add_test(tc, test_load_stop);
+	tcase_add_test(tc, test_load_read_error);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,140 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include <string.h>
+#include "lib.h"
+#include "libsigrok-internal.h"
+
+#define ITERATIONS 1000
+
+static uint64_t random_u64(GRand *rand)
+{
+	return (uint64_t)g_rand_int(rand) << 32 | g_rand_int(rand);
+}
+
+static int get_bit(uint64_t word, int bit)
+{
+	return (word >> bit) & 1;
+}
+
+START_TEST(test_transpose_small)
+{
+	GRand *rand;
+	uint16_t m, t;
+	uint64_t m64, t64;
+	int i, r, c;
+
+	rand = g_rand_new_with_seed(0x5eed);
+	for (i = 0; i < ITERATIONS; i++) {
+		m = g_rand_int(rand);
+		t = sr_transpose_4x4(m);
+		for (r = 0; r < 4; r++)
+			for (c = 0; c < 4; c++)
+				ck_assert(get_bit(m, 4 * r + c) ==
+					get_bit(t, 4 * c + r));
+		ck_assert(sr_transpose_4x4(t) == m);
+
+		t = sr_transpose_8x2(m);
+		for (r = 0; r < 8; r++)
+			for (c = 0; c < 2; c++)
+				ck_assert(get_bit(m, 2 * r + c) ==
+					get_bit(t, 8 * c + r));
+
+		m64 = random_u64(rand);
+		t64 = sr_transpose_8x8(m64);
+		for (r = 0; r < 8; r++)
+			for (c = 0; c < 8; c++)
+				ck_assert(get_bit(m64, 8 * r + c) ==
+					get_bit(t64, 8 * c + r));
+		ck_assert(sr_transpose_8x8(t64) == m64);
+	}
+	g_rand_free(rand);
+
+	/* Sigma 100MHz/200MHz sample data interleave. */
+	ck_assert(sr_transpose_8x2(0x5555) == 0x00ff);
+	ck_assert(sr_transpose_8x2(0xaaaa) == 0xff00);
+	ck_assert(sr_transpose_4x4(0x1111) == 0x000f);
+	ck_assert(sr_transpose_4x4(0x8888) == 0xf000);
+}
+END_TEST
+
+START_TEST(test_transpose_16x16)
+{
+	GRand *rand;
+	uint16_t m[16], t[16];
+	int i, r, c;
+
+	rand = g_rand_new_with_seed(0x5eed);
+	for (i = 0; i < ITERATIONS; i++) {
+		for (r = 0; r < 16; r++)
+			m[r] = g_rand_int(rand);
+		sr_transpose_16x16(t, m);
+		for (r = 0; r < 16; r++)
+			for (c = 0; c < 16; c++)
+				ck_assert(get_bit(m[r], c) == get_bit(t[c], r));
+
+		/* In place operation. */
+		sr_transpose_16x16(t, t);
+		ck_assert(memcmp(t, m, sizeof(m)) == 0);
+	}
+	g_rand_free(rand);
+}
+END_TEST
+
+START_TEST(test_transpose_64x64)
+{
+	GRand *rand;
+	uint64_t m[64], t[64];
+	int i, r, c;
+
+	rand = g_rand_new_with_seed(0x5eed);
+	for (i = 0; i < ITERATIONS / 10; i++) {
+		for (r = 0; r < 64; r++)
+			m[r] = random_u64(rand);
+		sr_transpose_64x64(t, m);
+		for (r = 0; r < 64; r++)
+			for (c = 0; c < 64; c++)
+				ck_assert(get_bit(m[r], c) == get_bit(t[c], r));
+
+		/* In place operation. */
+		sr_transpose_64x64(t, t);
+		ck_assert(memcmp(t, m, sizeof(m)) == 0);
+	}
+	g_rand_free(rand);
+}
+END_TEST
+
+Suite *suite_transpose(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("transpose");
+
+	tc = tcase_create("bitmatrix");
+	tcase_add_test(tc, test_transpose_small);
+	tcase_add_test(tc, test_transpose_16x16);
+	tcase_add_test(tc, test_transpose_64x64);
+	suite_add_tcase(s, tc);
+
+	return s;
+}